@@ -0,0 +1,115 @@
+// Iterating a million actors: the animation and world matrix systems from one thread to every hardware thread, a
+// serial walk over two joined pools, and the same update through one heap object and a virtual call per actor
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "Scene.h"
+
+namespace {
+    using bench::Clock;
+    using bench::elapsed_ms;
+    using bench::best_ms;
+
+    // What the scene looked like before actors, for comparison
+    class SceneObject {
+    public:
+        virtual ~SceneObject() = default;
+        virtual void update(float time) = 0;
+        Transform transform;
+        glm::mat4 world;
+        Bounds bounds;
+    };
+
+    class SpinningObject final : public SceneObject {
+    public:
+        void update(float time) override {
+            transform.rotation = glm::angleAxis(time * parameters.spin_speed + parameters.phase, parameters.spin_axis);
+            transform.position = parameters.rest_position;
+            transform.position.y += parameters.bob_height * std::sin(time * parameters.bob_speed + parameters.phase);
+            world = glm::translate(transform.position) * glm::toMat4(transform.rotation) * glm::scale(transform.scale);
+        }
+        EffectParameters parameters;
+    };
+}
+
+// Optional arguments: actor count, highest thread count to measure
+int main(int argc, char** argv) {
+    const uint32_t actor_count = argc > 1 ? static_cast<uint32_t>(std::max(1, std::atoi(argv[1]))) : 1'000'000;
+    const uint32_t max_threads = argc > 2 ? static_cast<uint32_t>(std::max(1, std::atoi(argv[2]))) : std::max(1u, std::thread::hardware_concurrency());
+
+    ActorRegistry actors;
+    std::vector<std::unique_ptr<SceneObject>> objects;
+    objects.reserve(actor_count);
+    const double create_ms = best_ms(1, [&]() {
+        for (uint32_t i = 0; i < actor_count; i++) {
+            EffectParameters parameters = {};
+            parameters.spin_speed = 0.5f + static_cast<float>(i % 7) * 0.1f;
+            parameters.bob_height = 0.25f;
+            parameters.bob_speed = 2.0f;
+            parameters.phase = static_cast<float>(i) * 0.01f;
+            parameters.rest_position = glm::vec3(static_cast<float>(i % 1000) * 3.0f - 1500.0f, 0.0f, static_cast<float>(i / 1000) * -3.0f);
+            const Bounds bounds = {glm::vec3(0.0f), 1.0f, glm::vec3(1.0f)};
+
+            const Actor actor = actors.create();
+            actors.add(actor, Transform{.position = parameters.rest_position});
+            actors.add(actor, parameters);
+            actors.add(actor, bounds);
+
+            auto object = std::make_unique<SpinningObject>();
+            object->parameters = parameters;
+            object->bounds = bounds;
+            objects.push_back(std::move(object));
+        }
+    });
+    std::printf("%u actors created in %.2f ms\n\n", actor_count, create_ms);
+
+    std::printf("%8s %14s %10s\n", "threads", "update", "speedup");
+    double single_thread_ms = 0.0;
+    for (uint32_t threads = 1; threads <= max_threads; threads++) {
+        JobSystem jobs;
+        jobs.init(threads);
+        float time = 0.0f;
+        const double update_ms = best_ms(5, [&]() {
+            JobCounter animation;
+            JobCounter transforms;
+            systems::animate(actors, jobs, time, &animation);
+            jobs.wait(animation);
+            systems::update_world_matrices(actors, jobs, &transforms);
+            jobs.wait(transforms);
+            time += 0.016f;
+        });
+        if (threads == 1) {
+            single_thread_ms = update_ms;
+        }
+        std::printf("%8u %11.2f ms %9.2fx\n", threads, update_ms, single_thread_ms / update_ms);
+        jobs.shutdown();
+    }
+
+    // Transform drives, Bounds is looked up through its sparse array. Both pools were filled in the same order
+    uint32_t in_front = 0;
+    const double join_ms = best_ms(5, [&]() {
+        in_front = 0;
+        actors.each<Transform, Bounds>([&in_front](uint32_t, const Transform& transform, const Bounds& bounds) {
+            const glm::vec3 center = transform_point(transform.world, bounds.origin);
+            in_front += center.z + bounds.sphere_radius > -1000.0f ? 1 : 0;
+        });
+    });
+
+    float time = 0.0f;
+    const double virtual_ms = best_ms(5, [&]() {
+        for (const std::unique_ptr<SceneObject>& object : objects) {
+            object->update(time);
+        }
+        time += 0.016f;
+    });
+
+    std::printf("\n%-40s %9.2f ms (%u in front)\n", "transform + bounds walk, 1 thread", join_ms, in_front);
+    std::printf("%-40s %9.2f ms\n", "virtual update per object, 1 thread", virtual_ms);
+    return 0;
+}
@@ -0,0 +1,28 @@
+#ifndef PORTFOLIO_BENCH_UTIL_H
+#define PORTFOLIO_BENCH_UTIL_H
+
+#include <algorithm>
+#include <chrono>
+
+// Timing shared by the benchmark executables
+namespace bench {
+    using Clock = std::chrono::steady_clock;
+
+    inline double elapsed_ms(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // Best of a few runs, the first one warms up the workers and the caches
+    template<typename F>
+    double best_ms(int runs, F&& body) {
+        double best = 1e30;
+        for (int i = 0; i < runs; i++) {
+            const Clock::time_point start = Clock::now();
+            body();
+            best = std::min(best, elapsed_ms(start));
+        }
+        return best;
+    }
+}
+
+#endif //PORTFOLIO_BENCH_UTIL_H
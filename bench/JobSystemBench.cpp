@@ -0,0 +1,77 @@
+// Scaling of the job system from one thread to every hardware thread.
+// Each configuration runs a compute heavy parallel_for, a flood of tiny jobs and a dependency chain
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "JobSystem.h"
+
+namespace {
+    using bench::Clock;
+    using bench::elapsed_ms;
+    using bench::best_ms;
+}
+
+// Optional argument: highest thread count to measure, defaults to the hardware thread count
+int main(int argc, char** argv) {
+    const uint32_t max_threads = argc > 1 ? static_cast<uint32_t>(std::max(1, std::atoi(argv[1]))) : std::max(1u, std::thread::hardware_concurrency());
+    constexpr uint32_t element_count = 1 << 22;
+    constexpr uint32_t tiny_job_count = 100'000;
+    // Every link is scheduled from the main thread before any runs, it has to fit the main worker's job ring
+    constexpr uint32_t chain_length = JobSystem::JOBS_PER_WORKER / 2;
+    std::vector<float> values(element_count);
+    std::iota(values.begin(), values.end(), 0.0f);
+    std::vector<float> results(element_count);
+
+    std::printf("%8s %14s %10s %14s %14s\n", "threads", "parallel_for", "speedup", "tiny jobs/ms", "chain us/job");
+    double single_thread_ms = 0.0;
+    for (uint32_t threads = 1; threads <= max_threads; threads++) {
+        JobSystem jobs;
+        jobs.init(threads);
+
+        const float* input = values.data();
+        float* output = results.data();
+        const double parallel_ms = best_ms(5, [&]() {
+            JobCounter counter;
+            jobs.parallel_for(element_count, 16 * 1024, [input, output](uint32_t begin, uint32_t end, uint32_t) {
+                for (uint32_t i = begin; i < end; i++) {
+                    output[i] = std::sqrt(input[i]) * std::sin(input[i]) + std::cos(input[i] * 0.5f);
+                }
+            }, &counter);
+            jobs.wait(counter);
+        });
+        if (threads == 1) {
+            single_thread_ms = parallel_ms;
+        }
+
+        std::atomic<uint32_t> executed = 0;
+        std::atomic<uint32_t>* executed_pointer = &executed;
+        const double tiny_ms = best_ms(3, [&]() {
+            JobCounter counter;
+            for (uint32_t i = 0; i < tiny_job_count; i++) {
+                jobs.run([executed_pointer](uint32_t) { executed_pointer->fetch_add(1, std::memory_order_relaxed); }, &counter);
+            }
+            jobs.wait(counter);
+        });
+
+        // Every link only becomes runnable when the previous one finished, measures scheduling latency
+        const double chain_ms = best_ms(3, [&]() {
+            std::vector<JobCounter> counters(chain_length);
+            JobCounter* links = counters.data();
+            jobs.run([](uint32_t) {}, &links[0]);
+            for (uint32_t i = 1; i < chain_length; i++) {
+                jobs.run_after(links[i - 1], [](uint32_t) {}, &links[i]);
+            }
+            jobs.wait(links[chain_length - 1]);
+        });
+
+        const JobSystemStats stats = jobs.stats();
+        std::printf("%8u %11.2f ms %9.2fx %14.0f %14.3f   (%llu stolen)\n", threads, parallel_ms, single_thread_ms / parallel_ms,
+            tiny_job_count / tiny_ms, chain_ms * 1000.0 / chain_length, static_cast<unsigned long long>(stats.jobs_stolen));
+        jobs.shutdown();
+    }
+    return 0;
+}
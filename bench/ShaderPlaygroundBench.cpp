@@ -0,0 +1,586 @@
+// The renderer's standard scenes, headless, written out as JSON so runs from different builds and machines can be
+// compared by a script. Defaults to a software Vulkan implementation such as lavapipe, which keeps the numbers about
+// the code rather than the GPU it happened to run on
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "SDL3/SDL.h"
+
+#include "BenchUtil.h"
+#include "Renderer.h"
+#include "TransformMath.h"
+
+namespace {
+    using bench::Clock;
+    using bench::elapsed_ms;
+
+    struct Statistics {
+        size_t count = 0;
+        double mean = 0.0;
+        double stddev = 0.0;
+        double min = 0.0;
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    // Nearest rank, samples are few enough that interpolating would only suggest precision that isn't there
+    Statistics summarize(std::vector<double> samples) {
+        Statistics statistics;
+        if (samples.empty()) {
+            return statistics;
+        }
+        std::ranges::sort(samples);
+        double sum = 0.0;
+        for (const double sample : samples) {
+            sum += sample;
+        }
+        statistics.count = samples.size();
+        statistics.mean = sum / static_cast<double>(samples.size());
+        double variance = 0.0;
+        for (const double sample : samples) {
+            variance += (sample - statistics.mean) * (sample - statistics.mean);
+        }
+        statistics.stddev = std::sqrt(variance / static_cast<double>(samples.size()));
+        auto percentile = [&samples](double p) {
+            const size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(samples.size())));
+            return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+        };
+        statistics.min = samples.front();
+        statistics.p50 = percentile(0.50);
+        statistics.p90 = percentile(0.90);
+        statistics.p95 = percentile(0.95);
+        statistics.p99 = percentile(0.99);
+        statistics.max = samples.back();
+        return statistics;
+    }
+
+    std::string json_string(std::string_view text) {
+        std::string escaped = "\"";
+        for (const char c : text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+                escaped += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped + "\"";
+    }
+
+    std::string json_number(double value) {
+        // JSON has no NaN or infinity
+        if (!std::isfinite(value)) {
+            return "null";
+        }
+        char number[32];
+        std::snprintf(number, sizeof(number), "%.6g", value);
+        return number;
+    }
+
+    struct Metric {
+        std::string name;
+        std::string unit;
+        std::vector<double> samples;
+    };
+
+    // One configuration of one benchmark, parameters are what tells it apart from its siblings
+    struct BenchResult {
+        std::string suite;
+        std::string name;
+        std::vector<std::pair<std::string, double>> parameters;
+        std::vector<Metric> metrics;
+    };
+
+    struct BenchOptions {
+        std::string output_path = "bench_results.json";
+        int warmup_frames = 10;
+        int measured_frames = 60;
+        // Iterations of the CPU side benchmarks
+        int runs = 20;
+        bool prefer_cpu_device = true;
+        // Substring of suite names, empty runs them all
+        std::string filter;
+    };
+
+    std::string build_type() {
+#ifdef NDEBUG
+        return "release";
+#else
+        return "debug";
+#endif
+    }
+
+    std::string compiler() {
+#if defined(__clang__)
+        return "clang " __clang_version__;
+#elif defined(__GNUC__)
+        return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        return "msvc " + std::to_string(_MSC_VER);
+#else
+        return "unknown";
+#endif
+    }
+}
+
+class RendererBench {
+public:
+    RendererBench(Renderer& renderer, const BenchOptions& options) : r(renderer), m_options(options) {}
+
+    void run_all() {
+        if (enabled("compute_effect")) {
+            bench_compute_effects();
+        }
+        if (enabled("mesh_upload")) {
+            bench_mesh_upload();
+        }
+        if (enabled("descriptor_allocation")) {
+            bench_descriptor_allocation();
+        }
+        if (enabled("transform_update")) {
+            bench_transform_updates();
+        }
+        if (enabled("culling")) {
+            bench_culling();
+        }
+        if (enabled("full_frame")) {
+            bench_full_frame();
+        }
+    }
+
+    bool write_json(const std::string& file_path) const {
+        std::ofstream file(file_path, std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to write benchmark results to " << file_path << std::endl;
+            return false;
+        }
+
+        const VkPhysicalDeviceProperties& device = r.m_vkb_physical_device.properties;
+        char api_version[32];
+        std::snprintf(api_version, sizeof(api_version), "%u.%u.%u", VK_API_VERSION_MAJOR(device.apiVersion),
+            VK_API_VERSION_MINOR(device.apiVersion), VK_API_VERSION_PATCH(device.apiVersion));
+        char timestamp[32] = {};
+        const std::time_t now = std::time(nullptr);
+        std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        file << "{\n  \"schema_version\": 1,\n  \"environment\": {\n";
+        file << "    \"timestamp\": " << json_string(timestamp) << ",\n";
+        file << "    \"platform\": " << json_string(SDL_GetPlatform()) << ",\n";
+        file << "    \"video_driver\": " << json_string(SDL_GetCurrentVideoDriver() ? SDL_GetCurrentVideoDriver() : "none") << ",\n";
+        file << "    \"cpu_threads\": " << std::thread::hardware_concurrency() << ",\n";
+        file << "    \"job_threads\": " << r.m_jobs.thread_count() << ",\n";
+        file << "    \"transform_kernels\": " << json_string(transform_math::isa_name(transform_math::active_isa())) << ",\n";
+        file << "    \"compiler\": " << json_string(compiler()) << ",\n";
+        file << "    \"build_type\": " << json_string(build_type()) << ",\n";
+        file << "    \"device_name\": " << json_string(device.deviceName) << ",\n";
+        file << "    \"device_type\": " << json_string(string_VkPhysicalDeviceType(device.deviceType)) << ",\n";
+        file << "    \"vendor_id\": " << device.vendorID << ",\n";
+        file << "    \"driver_version\": " << device.driverVersion << ",\n";
+        file << "    \"api_version\": " << json_string(api_version) << ",\n";
+        file << "    \"timestamps_supported\": " << (device.limits.timestampComputeAndGraphics ? "true" : "false") << "\n";
+        file << "  },\n  \"config\": {\n";
+        file << "    \"warmup_frames\": " << m_options.warmup_frames << ",\n";
+        file << "    \"measured_frames\": " << m_options.measured_frames << ",\n";
+        file << "    \"runs\": " << m_options.runs << "\n";
+        file << "  },\n  \"results\": [";
+
+        for (size_t i = 0; i < m_results.size(); i++) {
+            const BenchResult& result = m_results[i];
+            file << (i == 0 ? "\n" : ",\n") << "    {\n";
+            file << "      \"suite\": " << json_string(result.suite) << ",\n";
+            file << "      \"name\": " << json_string(result.name) << ",\n";
+            file << "      \"parameters\": {";
+            for (size_t p = 0; p < result.parameters.size(); p++) {
+                file << (p == 0 ? "" : ", ") << json_string(result.parameters[p].first) << ": " << json_number(result.parameters[p].second);
+            }
+            file << "},\n      \"metrics\": {";
+            for (size_t m = 0; m < result.metrics.size(); m++) {
+                const Metric& metric = result.metrics[m];
+                const Statistics s = summarize(metric.samples);
+                file << (m == 0 ? "\n" : ",\n") << "        " << json_string(metric.name) << ": {\"unit\": " << json_string(metric.unit)
+                     << ", \"count\": " << s.count << ", \"mean\": " << json_number(s.mean) << ", \"stddev\": " << json_number(s.stddev)
+                     << ", \"min\": " << json_number(s.min) << ", \"p50\": " << json_number(s.p50) << ", \"p90\": " << json_number(s.p90)
+                     << ", \"p95\": " << json_number(s.p95) << ", \"p99\": " << json_number(s.p99) << ", \"max\": " << json_number(s.max) << "}";
+            }
+            file << "\n      }\n    }";
+        }
+        file << "\n  ]\n}\n";
+        std::cout << m_results.size() << " benchmark results written to " << file_path << std::endl;
+        return true;
+    }
+
+private:
+    struct FrameSample {
+        double scene_update_ms;
+        double record_ms;
+        float graphics_gpu_ms;
+        float background_gpu_ms;
+        int draw_call_count;
+        int triangle_count;
+    };
+
+    static constexpr VkExtent2D RESOLUTIONS[] = {{640, 360}, {1280, 720}, {1920, 1080}};
+
+    Renderer& r;
+    BenchOptions m_options;
+    std::vector<BenchResult> m_results;
+    float m_time = 0.0f;
+    uint64_t m_frame_number = 0;
+
+    bool enabled(std::string_view suite) const {
+        return m_options.filter.empty() || suite.find(m_options.filter) != std::string_view::npos;
+    }
+
+    // Nothing the UI would change mid-run, no pacing against the display and the background on the graphics queue
+    static RenderSettings base_settings() {
+        RenderSettings settings;
+        settings.use_dynamic_resolution = false;
+        settings.render_scale = 1.0f;
+        settings.use_async_compute = false;
+        settings.use_upscaler = false;
+        settings.present_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        settings.use_present_wait = false;
+        return settings;
+    }
+
+    void set_window_extent(VkExtent2D extent) {
+        SDL_SetWindowSize(r.m_window, static_cast<int>(extent.width), static_cast<int>(extent.height));
+        SDL_SyncWindow(r.m_window);
+    }
+
+    // One frame the way the main and render threads split it, both on this thread. GPU times are from the frame this
+    // slot submitted last, warmup frames of the same configuration cover the switch from the previous one
+    FrameSample run_frame(const RenderSettings& settings, VkExtent2D extent) {
+        SDL_PumpEvents();
+        FrameSnapshot& snapshot = r.m_snapshots.write_slot();
+        snapshot.settings = settings;
+        snapshot.resize_requested = extent.width != r.m_swapchain_extent.width || extent.height != r.m_swapchain_extent.height;
+        snapshot.window_extent = extent;
+        snapshot.mouse_position = {static_cast<float>(extent.width) * 0.5f, static_cast<float>(extent.height) * 0.5f};
+        // Fixed step, so every run animates through the same states
+        snapshot.time = m_time;
+        snapshot.frame_number = m_frame_number++;
+        m_time += 1.0f / 60.0f;
+
+        FrameSample sample = {};
+        const Clock::time_point scene_start = Clock::now();
+        r.update_scene(snapshot);
+        sample.scene_update_ms = elapsed_ms(scene_start);
+
+        r.apply_snapshot(snapshot);
+        r.wait_for_frame();
+        sample.graphics_gpu_ms = r.m_stats.graphics_gpu_time;
+        sample.background_gpu_ms = r.m_stats.background_gpu_time;
+        const Clock::time_point record_start = Clock::now();
+        if (r.resize_requested) {
+            r.resize_swapchain(r.m_window_extent.width, r.m_window_extent.height);
+        }
+        r.draw_frame();
+        sample.record_ms = elapsed_ms(record_start);
+        sample.draw_call_count = r.m_stats.draw_call_count;
+        sample.triangle_count = r.m_stats.triangle_count;
+        r.m_snapshot = nullptr;
+        return sample;
+    }
+
+    std::vector<FrameSample> run_frames(const RenderSettings& settings, VkExtent2D extent) {
+        set_window_extent(extent);
+        for (int i = 0; i < m_options.warmup_frames; i++) {
+            run_frame(settings, extent);
+        }
+        std::vector<FrameSample> samples;
+        samples.reserve(m_options.measured_frames);
+        for (int i = 0; i < m_options.measured_frames; i++) {
+            samples.push_back(run_frame(settings, extent));
+        }
+        return samples;
+    }
+
+    template<typename F>
+    std::vector<double> time_runs(F&& body) {
+        std::vector<double> samples;
+        samples.reserve(m_options.runs);
+        // First run is a warmup, it pays for page faults and pool growth the rest don't
+        body();
+        for (int i = 0; i < m_options.runs; i++) {
+            const Clock::time_point start = Clock::now();
+            body();
+            samples.push_back(elapsed_ms(start));
+        }
+        return samples;
+    }
+
+    // Every effect and chain alone in the frame at each resolution, GPU time of the background pass
+    void bench_compute_effects() {
+        std::vector<std::string> names;
+        {
+            std::scoped_lock lock(r.m_effects_mutex);
+            for (const ComputeEffect& effect : r.m_effect_registry.effects()) {
+                names.push_back(effect.name);
+            }
+            for (const EffectChain& chain : r.m_effect_registry.chains()) {
+                names.push_back(chain.name);
+            }
+        }
+
+        RenderSettings settings = base_settings();
+        settings.draw_meshes = false;
+        for (const VkExtent2D extent : RESOLUTIONS) {
+            for (size_t i = 0; i < names.size(); i++) {
+                settings.background_effect = static_cast<int>(i);
+                const std::vector<FrameSample> frames = run_frames(settings, extent);
+                BenchResult result = {"compute_effect", names[i], {{"width", extent.width}, {"height", extent.height}}, {}};
+                Metric gpu = {"background_gpu", "ms", {}};
+                Metric record = {"record_cpu", "ms", {}};
+                for (const FrameSample& frame : frames) {
+                    gpu.samples.push_back(frame.background_gpu_ms);
+                    record.samples.push_back(frame.record_ms);
+                }
+                result.metrics = {std::move(gpu), std::move(record)};
+                report(std::move(result));
+            }
+        }
+    }
+
+    // A flat grid of vertices through the staging buffer into the geometry pool, freed again after every run
+    void bench_mesh_upload() {
+        for (const uint32_t side : {32u, 128u, 512u}) {
+            std::vector<Vertex> vertices(side * side);
+            std::vector<uint32_t> indices;
+            indices.reserve((side - 1) * (side - 1) * 6);
+            for (uint32_t y = 0; y < side; y++) {
+                for (uint32_t x = 0; x < side; x++) {
+                    Vertex& vertex = vertices[y * side + x];
+                    vertex.position = glm::vec3(static_cast<float>(x), 0.0f, static_cast<float>(y));
+                    vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+                    vertex.uv_x = static_cast<float>(x) / static_cast<float>(side - 1);
+                    vertex.uv_y = static_cast<float>(y) / static_cast<float>(side - 1);
+                    vertex.color = glm::vec4(1.0f);
+                    if (x + 1 < side && y + 1 < side) {
+                        const uint32_t corner = y * side + x;
+                        indices.insert(indices.end(), {corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1});
+                    }
+                }
+            }
+
+            const std::vector<double> samples = time_runs([&]() {
+                r.destroy_mesh(r.upload_mesh(indices, vertices));
+            });
+            const double bytes = static_cast<double>(vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t));
+            Metric throughput = {"throughput", "MB/s", {}};
+            for (const double ms : samples) {
+                throughput.samples.push_back(bytes / (1024.0 * 1024.0) / (ms / 1000.0));
+            }
+            report({"mesh_upload", "grid", {{"vertices", static_cast<double>(vertices.size())}, {"indices", static_cast<double>(indices.size())}},
+                {{"upload", "ms", samples}, std::move(throughput)}});
+        }
+    }
+
+    // Sets for the first effect's layout out of a growable allocator like the per-frame ones, each written with one
+    // storage image, then every pool reset at once the way a frame slot does it
+    void bench_descriptor_allocation() {
+        VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+        {
+            std::scoped_lock lock(r.m_effects_mutex);
+            if (!r.m_effect_registry.effects().empty()) {
+                layout = r.m_effect_registry.effects().front().set_layout;
+            }
+        }
+        if (layout == VK_NULL_HANDLE) {
+            std::cerr << "No compute effects loaded, skipping descriptor allocation" << std::endl;
+            return;
+        }
+
+        const VkDevice device = r.m_vkb_device.device;
+        std::vector<DescriptorAllocatorGrowable::PoolSizeRatio> ratios = {
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
+        };
+        FrameArena arena;
+        arena.init(1024 * 1024);
+        for (const uint32_t set_count : {100u, 1000u, 10000u}) {
+            DescriptorAllocatorGrowable allocator;
+            allocator.init(device, 1000, ratios);
+            Metric per_set = {"per_set", "us", {}};
+            std::vector<double> samples = time_runs([&]() {
+                for (uint32_t i = 0; i < set_count; i++) {
+                    DescriptorWriter writer(&arena);
+                    writer.write_image(0, r.m_draw_image.image_view, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+                    writer.update_set(device, allocator.allocate(device, layout));
+                }
+                allocator.clear_pools(device);
+                arena.reset();
+            });
+            for (const double ms : samples) {
+                per_set.samples.push_back(ms * 1000.0 / static_cast<double>(set_count));
+            }
+            allocator.destroy_pools(device);
+            report({"descriptor_allocation", "storage_image_set", {{"sets", static_cast<double>(set_count)}},
+                {{"allocate_write_reset", "ms", std::move(samples)}, std::move(per_set)}});
+        }
+        arena.destroy();
+    }
+
+    // Actors laid out like populate_scene's, in a registry of their own so the scene's draws don't come into it
+    static void populate(ActorRegistry& actors, uint32_t count) {
+        actors.clear();
+        const uint32_t row = std::max(1u, static_cast<uint32_t>(std::sqrt(static_cast<double>(count))));
+        for (uint32_t i = 0; i < count; i++) {
+            EffectParameters parameters = {};
+            parameters.spin_speed = 0.5f;
+            parameters.phase = static_cast<float>(i) * 0.01f;
+            parameters.rest_position = glm::vec3(static_cast<float>(i % row) * 3.0f - static_cast<float>(row) * 1.5f, 0.0f, static_cast<float>(i / row) * -3.0f);
+            const Actor actor = actors.create();
+            actors.add(actor, Transform{.position = parameters.rest_position});
+            actors.add(actor, parameters);
+            actors.add(actor, Bounds{glm::vec3(0.0f), 1.8f, glm::vec3(1.0f)});
+        }
+    }
+
+    void bench_transform_updates() {
+        for (const uint32_t count : {10'000u, 100'000u, 1'000'000u}) {
+            ActorRegistry actors;
+            populate(actors, count);
+            float time = 0.0f;
+            const std::vector<double> samples = time_runs([&]() {
+                JobCounter animation;
+                JobCounter transforms;
+                systems::animate(actors, r.m_jobs, time, &animation);
+                r.m_jobs.wait(animation);
+                systems::update_world_matrices(actors, r.m_jobs, &transforms);
+                r.m_jobs.wait(transforms);
+                time += 1.0f / 60.0f;
+            });
+            report({"transform_update", "animate_and_compose", {{"actors", static_cast<double>(count)}}, {{"update", "ms", samples}}});
+        }
+    }
+
+    // The frustum test update_scene runs, over the same camera the scene uses
+    void bench_culling() {
+        const float aspect = 16.0f / 9.0f;
+        glm::mat4 proj = glm::perspective(glm::radians(70.0f), aspect, 10000.0f, 0.1f);
+        proj[1][1] *= -1;
+        const glm::mat4 view_proj = proj * glm::translate(glm::vec3(0.0f, 0.0f, -8.0f));
+
+        for (const uint32_t count : {10'000u, 100'000u, 1'000'000u}) {
+            ActorRegistry actors;
+            populate(actors, count);
+            JobCounter animation;
+            JobCounter transforms;
+            systems::animate(actors, r.m_jobs, 0.0f, &animation);
+            r.m_jobs.wait(animation);
+            systems::update_world_matrices(actors, r.m_jobs, &transforms);
+            r.m_jobs.wait(transforms);
+
+            std::vector<uint8_t> visible(count);
+            uint8_t* visible_data = visible.data();
+            const glm::mat4* view_proj_data = &view_proj;
+            const std::vector<double> samples = time_runs([&]() {
+                JobCounter culling;
+                actors.parallel_each<Transform, Bounds>(r.m_jobs, 1024, [visible_data, view_proj_data](uint32_t position,
+                    const Transform& transform, const Bounds& bounds) {
+                    visible_data[position] = Renderer::is_visible(bounds, transform.world, *view_proj_data) ? 1 : 0;
+                }, &culling);
+                r.m_jobs.wait(culling);
+            });
+            const double visible_count = static_cast<double>(std::count(visible.begin(), visible.end(), 1));
+            report({"culling", "frustum", {{"actors", static_cast<double>(count)}, {"visible", visible_count}}, {{"cull", "ms", samples}}});
+        }
+    }
+
+    // The test meshes in ever larger grids over the default background, at one resolution
+    void bench_full_frame() {
+        const VkExtent2D extent = {1280, 720};
+        for (const bool instancing : {false, true}) {
+            for (const int grid_size : {1, 10, 25, 50}) {
+                r.m_use_instancing = instancing;
+                r.m_mesh_grid_size = grid_size;
+                const std::vector<FrameSample> frames = run_frames(base_settings(), extent);
+                BenchResult result = {"full_frame", instancing ? "test_meshes_instanced" : "test_meshes",
+                    {{"grid_size", grid_size}, {"actors", static_cast<double>(r.m_actors.actor_count())},
+                     {"width", extent.width}, {"height", extent.height}}, {}};
+                Metric scene = {"scene_update_cpu", "ms", {}};
+                Metric record = {"record_cpu", "ms", {}};
+                Metric cpu = {"frame_cpu", "ms", {}};
+                Metric gpu = {"graphics_gpu", "ms", {}};
+                Metric draws = {"draw_calls", "count", {}};
+                Metric triangles = {"triangles", "count", {}};
+                for (const FrameSample& frame : frames) {
+                    scene.samples.push_back(frame.scene_update_ms);
+                    record.samples.push_back(frame.record_ms);
+                    cpu.samples.push_back(frame.scene_update_ms + frame.record_ms);
+                    gpu.samples.push_back(frame.graphics_gpu_ms);
+                    draws.samples.push_back(frame.draw_call_count);
+                    triangles.samples.push_back(frame.triangle_count);
+                }
+                result.metrics = {std::move(scene), std::move(record), std::move(cpu), std::move(gpu), std::move(draws), std::move(triangles)};
+                report(std::move(result));
+            }
+        }
+        r.m_use_instancing = false;
+        r.m_mesh_grid_size = 1;
+    }
+
+    void report(BenchResult result) {
+        std::printf("%-22s %-24s", result.suite.c_str(), result.name.c_str());
+        for (const auto& [name, value] : result.parameters) {
+            std::printf(" %s=%g", name.c_str(), value);
+        }
+        const Statistics s = summarize(result.metrics.front().samples);
+        std::printf("  %s mean %.3f p95 %.3f %s\n", result.metrics.front().name.c_str(), s.mean, s.p95, result.metrics.front().unit.c_str());
+        m_results.push_back(std::move(result));
+    }
+};
+
+// Run from the build directory like ShaderPlayground itself. Shaders are embedded, only ../assets/basicmesh.glb is
+// found relative to the working directory
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view argument = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (argument == "--output" && has_value) {
+            options.output_path = argv[++i];
+        } else if (argument == "--frames" && has_value) {
+            options.measured_frames = std::max(1, std::atoi(argv[++i]));
+        } else if (argument == "--warmup" && has_value) {
+            options.warmup_frames = std::max(0, std::atoi(argv[++i]));
+        } else if (argument == "--runs" && has_value) {
+            options.runs = std::max(1, std::atoi(argv[++i]));
+        } else if (argument == "--filter" && has_value) {
+            options.filter = argv[++i];
+        } else if (argument == "--gpu") {
+            options.prefer_cpu_device = false;
+        } else {
+            std::cerr << "Unknown argument " << argument << std::endl;
+            std::cerr << "Usage: " << argv[0] << " [--output <file>] [--frames <n>] [--warmup <n>] [--runs <n>] [--filter <suite>] [--gpu]" << std::endl;
+            return 1;
+        }
+    }
+
+    RendererOptions renderer_options;
+    renderer_options.headless = true;
+    renderer_options.prefer_cpu_device = options.prefer_cpu_device;
+    Renderer renderer(renderer_options);
+    RendererBench bench(renderer, options);
+    bench.run_all();
+    return bench.write_json(options.output_path) ? 0 : 1;
+}
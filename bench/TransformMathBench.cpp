@@ -0,0 +1,155 @@
+// The batched transform kernels on every instruction set this CPU runs, against glm doing the same one matrix at a time
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include "BenchUtil.h"
+#include "TransformMath.h"
+
+namespace {
+    using bench::Clock;
+    using bench::elapsed_ms;
+    using bench::best_ms;
+
+    // Largest difference to glm's result over every element, so a fast kernel that is wrong doesn't go unnoticed
+    float max_error(const std::vector<Affine3x4>& results, const std::vector<glm::mat4>& expected) {
+        float error = 0.0f;
+        for (size_t i = 0; i < results.size(); i++) {
+            const glm::mat4 result = to_mat4(results[i]);
+            for (int column = 0; column < 4; column++) {
+                for (int row = 0; row < 3; row++) {
+                    error = std::max(error, std::abs(result[column][row] - expected[i][column][row]));
+                }
+            }
+        }
+        return error;
+    }
+
+    float max_error(const std::vector<glm::mat4>& results, const std::vector<glm::mat4>& expected) {
+        float error = 0.0f;
+        for (size_t i = 0; i < results.size(); i++) {
+            for (int column = 0; column < 4; column++) {
+                for (int row = 0; row < 4; row++) {
+                    error = std::max(error, std::abs(results[i][column][row] - expected[i][column][row]));
+                }
+            }
+        }
+        return error;
+    }
+
+    void print_row(const char* name, double glm_ms, const std::vector<double>& kernel_ms, float error) {
+        std::printf("%-18s %9.2f", name, glm_ms);
+        for (const double ms : kernel_ms) {
+            std::printf(" %9.2f (%4.1fx)", ms, glm_ms / ms);
+        }
+        std::printf("   max error %.2e\n", error);
+    }
+}
+
+// Optional argument: element count, defaults to a million
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 ? static_cast<size_t>(std::max(1, std::atoi(argv[1]))) : 1'000'000;
+    constexpr int runs = 10;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<glm::vec3> translations(count);
+    std::vector<glm::quat> rotations(count);
+    std::vector<glm::vec3> scales(count);
+    for (size_t i = 0; i < count; i++) {
+        translations[i] = glm::vec3(position(rng), position(rng), position(rng));
+        rotations[i] = glm::normalize(glm::quat(unit(rng), unit(rng), unit(rng), unit(rng)));
+        scales[i] = glm::vec3(scale(rng), scale(rng), scale(rng));
+    }
+
+    // glm, the reference results every kernel is checked against
+    std::vector<glm::mat4> glm_worlds(count);
+    std::vector<glm::mat4> glm_products(count);
+    std::vector<glm::mat4> glm_inverses(count);
+    std::vector<glm::mat4> glm_normals(count);
+    const double glm_compose = best_ms(runs, [&]() {
+        for (size_t i = 0; i < count; i++) {
+            glm_worlds[i] = glm::translate(translations[i]) * glm::toMat4(rotations[i]) * glm::scale(scales[i]);
+        }
+    });
+    // Each world matrix times the next one, like a parent and its child
+    const double glm_multiply = best_ms(runs, [&]() {
+        for (size_t i = 0; i < count; i++) {
+            glm_products[i] = glm_worlds[i] * glm_worlds[(i + 1) % count];
+        }
+    });
+    const double glm_inverse = best_ms(runs, [&]() {
+        for (size_t i = 0; i < count; i++) {
+            glm_inverses[i] = glm::affineInverse(glm_worlds[i]);
+        }
+    });
+    const double glm_normal = best_ms(runs, [&]() {
+        for (size_t i = 0; i < count; i++) {
+            glm_normals[i] = glm::mat4(glm::inverseTranspose(glm::mat3(glm_worlds[i])));
+        }
+    });
+
+    std::vector<Affine3x4> worlds(count);
+    std::vector<Affine3x4> next_worlds(count);
+    std::vector<Affine3x4> results(count);
+    std::vector<glm::mat4> next_glm_worlds(count);
+    std::vector<glm::mat4> mat4_results(count);
+    for (size_t i = 0; i < count; i++) {
+        next_glm_worlds[i] = glm_worlds[(i + 1) % count];
+    }
+
+    std::vector<double> compose_ms, multiply_ms, affine_multiply_ms, inverse_ms, normal_ms;
+    float compose_error = 0.0f, multiply_error = 0.0f, affine_multiply_error = 0.0f, inverse_error = 0.0f, normal_error = 0.0f;
+    std::printf("%zu elements, best of %d runs, ms\n\n%-18s %9s", count, runs, "", "glm");
+    const transform_math::Isa supported = transform_math::supported_isa();
+    for (int isa = 0; isa <= static_cast<int>(supported); isa++) {
+        transform_math::set_isa(static_cast<transform_math::Isa>(isa));
+        std::printf(" %17s", transform_math::isa_name(transform_math::active_isa()));
+
+        compose_ms.push_back(best_ms(runs, [&]() {
+            transform_math::compose_trs(translations.data(), rotations.data(), scales.data(), worlds.data(), count);
+        }));
+        compose_error = std::max(compose_error, max_error(worlds, glm_worlds));
+        for (size_t i = 0; i < count; i++) {
+            next_worlds[i] = worlds[(i + 1) % count];
+        }
+
+        multiply_ms.push_back(best_ms(runs, [&]() {
+            transform_math::multiply(glm_worlds.data(), next_glm_worlds.data(), mat4_results.data(), count);
+        }));
+        multiply_error = std::max(multiply_error, max_error(mat4_results, glm_products));
+
+        affine_multiply_ms.push_back(best_ms(runs, [&]() {
+            transform_math::multiply(worlds.data(), next_worlds.data(), results.data(), count);
+        }));
+        affine_multiply_error = std::max(affine_multiply_error, max_error(results, glm_products));
+
+        inverse_ms.push_back(best_ms(runs, [&]() {
+            transform_math::inverse(worlds.data(), results.data(), count);
+        }));
+        inverse_error = std::max(inverse_error, max_error(results, glm_inverses));
+
+        normal_ms.push_back(best_ms(runs, [&]() {
+            transform_math::normal_matrices(worlds.data(), results.data(), count);
+        }));
+        normal_error = std::max(normal_error, max_error(results, glm_normals));
+    }
+    std::printf("\n");
+
+    print_row("compose TRS", glm_compose, compose_ms, compose_error);
+    print_row("mat4 x mat4", glm_multiply, multiply_ms, multiply_error);
+    print_row("affine x affine", glm_multiply, affine_multiply_ms, affine_multiply_error);
+    print_row("affine inverse", glm_inverse, inverse_ms, inverse_error);
+    print_row("normal matrix", glm_normal, normal_ms, normal_error);
+    std::printf("\n%zu bytes per affine result against %zu per mat4\n", sizeof(Affine3x4), sizeof(glm::mat4));
+    return 0;
+}
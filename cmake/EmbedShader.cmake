@@ -0,0 +1,43 @@
+# Writes a file into a header as a constexpr array, run as a script:
+#   cmake -DINPUT=<file> -DOUTPUT=<header> -DSYMBOL=<name> -DKIND=spirv|text -P EmbedShader.cmake
+# SPIR-V becomes 32 bit words, text becomes chars with a terminating zero so it can be read as a string_view
+foreach (variable INPUT OUTPUT SYMBOL KIND)
+    if (NOT DEFINED ${variable})
+        message(FATAL_ERROR "EmbedShader.cmake needs -D${variable}=...")
+    endif()
+endforeach()
+
+file(READ "${INPUT}" contents HEX)
+string(LENGTH "${contents}" hex_length)
+
+if (KIND STREQUAL "spirv")
+    math(EXPR word_remainder "${hex_length} % 8")
+    if (hex_length EQUAL 0 OR NOT word_remainder EQUAL 0)
+        message(FATAL_ERROR "${INPUT} isn't a whole number of SPIR-V words")
+    endif()
+    # Words are stored little endian, reverse each group of four bytes into a literal
+    string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u," values "${contents}")
+    set(element_type "uint32_t")
+elseif (KIND STREQUAL "text")
+    string(REGEX REPLACE "(..)" "0x\\1," values "${contents}")
+    string(APPEND values "0x00,")
+    set(element_type "char")
+else()
+    message(FATAL_ERROR "Unknown embed kind ${KIND}")
+endif()
+
+# Sixteen values to a line rather than one line of several hundred kilobytes
+string(REGEX REPLACE "(([^,]+,){16})" "\\1\n        " values "${values}")
+
+file(WRITE "${OUTPUT}"
+"// Generated from ${INPUT} by EmbedShader.cmake, don't edit
+#pragma once
+
+#include <cstdint>
+
+namespace embedded_shaders {
+    inline constexpr ${element_type} ${SYMBOL}[] = {
+        ${values}
+    };
+}
+")
@@ -1 +1,58 @@
-#include "Actor.h"
\ No newline at end of file
+#include "Actor.h"
+
+#include <atomic>
+
+uint32_t detail::next_component_id() {
+    static std::atomic<uint32_t> next_id = 0;
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+Actor ActorRegistry::create() {
+    Actor actor = {};
+    if (!m_free_indices.empty()) {
+        actor.index = m_free_indices.back();
+        m_free_indices.pop_back();
+    } else {
+        actor.index = static_cast<uint32_t>(m_generations.size());
+        m_generations.push_back(0);
+        m_alive.push_back(false);
+    }
+    actor.generation = m_generations[actor.index];
+    m_alive[actor.index] = true;
+    m_actor_count++;
+    return actor;
+}
+
+void ActorRegistry::destroy(Actor actor) {
+    if (!alive(actor)) {
+        return;
+    }
+    for (const std::unique_ptr<ComponentPoolBase>& pool : m_pools) {
+        if (pool) {
+            pool->remove(actor.index);
+        }
+    }
+    // Handles still pointing at the slot go stale
+    m_generations[actor.index]++;
+    m_alive[actor.index] = false;
+    m_free_indices.push_back(actor.index);
+    m_actor_count--;
+}
+
+void ActorRegistry::clear() {
+    for (const std::unique_ptr<ComponentPoolBase>& pool : m_pools) {
+        if (pool) {
+            pool->clear();
+        }
+    }
+    m_free_indices.clear();
+    // Backwards, so actors created next take the slots in order again
+    for (uint32_t i = static_cast<uint32_t>(m_generations.size()); i-- > 0;) {
+        if (m_alive[i]) {
+            m_generations[i]++;
+            m_alive[i] = false;
+        }
+        m_free_indices.push_back(i);
+    }
+    m_actor_count = 0;
+}
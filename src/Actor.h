@@ -1,9 +1,194 @@
 #ifndef PORTFOLIO_ACTOR_H
 #define PORTFOLIO_ACTOR_H
 
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
 
-class Actor {
+#include "JobSystem.h"
+
+// Handle to an actor. The index picks its slot in every component pool, the generation makes handles to a
+// destroyed actor stale once the slot is reused
+struct Actor {
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    uint32_t index = INVALID_INDEX;
+    uint32_t generation = 0;
+
+    bool operator==(const Actor&) const = default;
+};
+
+class ComponentPoolBase {
+public:
+    virtual ~ComponentPoolBase() = default;
+    virtual void remove(uint32_t actor_index) = 0;
+    virtual void clear() = 0;
+};
+
+// Sparse set. Components are packed into one array with the index of the actor owning each next to it, the sparse
+// array maps an actor index back to its position. Removing swaps the last component into the hole, so iterating
+// is always a straight walk over size() components
+template<typename T>
+class ComponentPool final : public ComponentPoolBase {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    T& add(uint32_t actor_index, const T& component) {
+        if (actor_index >= m_sparse.size()) {
+            m_sparse.resize(actor_index + 1, NONE);
+        }
+        if (m_sparse[actor_index] != NONE) {
+            return m_components[m_sparse[actor_index]] = component;
+        }
+        m_sparse[actor_index] = static_cast<uint32_t>(m_components.size());
+        m_actors.push_back(actor_index);
+        return m_components.emplace_back(component);
+    }
+
+    void remove(uint32_t actor_index) override {
+        if (!contains(actor_index)) {
+            return;
+        }
+        const uint32_t position = m_sparse[actor_index];
+        const uint32_t last = static_cast<uint32_t>(m_components.size() - 1);
+        if (position != last) {
+            m_components[position] = std::move(m_components[last]);
+            m_actors[position] = m_actors[last];
+            m_sparse[m_actors[position]] = position;
+        }
+        m_components.pop_back();
+        m_actors.pop_back();
+        m_sparse[actor_index] = NONE;
+    }
+
+    void clear() override {
+        m_components.clear();
+        m_actors.clear();
+        m_sparse.clear();
+    }
+
+    void reserve(size_t count) {
+        m_components.reserve(count);
+        m_actors.reserve(count);
+    }
+
+    bool contains(uint32_t actor_index) const { return actor_index < m_sparse.size() && m_sparse[actor_index] != NONE; }
+    T* find(uint32_t actor_index) { return contains(actor_index) ? &m_components[m_sparse[actor_index]] : nullptr; }
+    T& get(uint32_t actor_index) {
+        assert(contains(actor_index));
+        return m_components[m_sparse[actor_index]];
+    }
+    // Position of an actor's component in components(), NONE without one
+    uint32_t position(uint32_t actor_index) const { return actor_index < m_sparse.size() ? m_sparse[actor_index] : NONE; }
+
+    std::span<T> components() { return m_components; }
+    // Owner of each component, in the same order
+    std::span<const uint32_t> actors() const { return m_actors; }
+    size_t size() const { return m_components.size(); }
+
+private:
+    std::vector<T> m_components;
+    std::vector<uint32_t> m_actors;
+    std::vector<uint32_t> m_sparse;
 };
 
+namespace detail {
+    uint32_t next_component_id();
+}
+
+template<typename T>
+uint32_t component_id() {
+    static const uint32_t id = detail::next_component_id();
+    return id;
+}
+
+// Owns every actor and one pool per component type. Systems are plain functions over the pools, nothing is virtual
+// per actor. Creating and destroying actors or adding components is for one thread at a time, iterating can be
+// spread over the job system as long as nothing is added or removed meanwhile
+class ActorRegistry {
+public:
+    Actor create();
+    void destroy(Actor actor);
+    bool alive(Actor actor) const { return actor.index < m_generations.size() && m_generations[actor.index] == actor.generation && m_alive[actor.index]; }
+    // Destroys every actor, pools keep their capacity
+    void clear();
+    size_t actor_count() const { return m_actor_count; }
+
+    template<typename T>
+    T& add(Actor actor, const T& component) {
+        assert(alive(actor));
+        return pool<T>().add(actor.index, component);
+    }
+
+    template<typename T>
+    void remove(Actor actor) {
+        assert(alive(actor));
+        pool<T>().remove(actor.index);
+    }
+
+    template<typename T>
+    T* find(Actor actor) {
+        return alive(actor) ? pool<T>().find(actor.index) : nullptr;
+    }
+
+    template<typename T>
+    ComponentPool<T>& pool() {
+        const uint32_t id = component_id<T>();
+        if (id >= m_pools.size()) {
+            m_pools.resize(id + 1);
+        }
+        if (!m_pools[id]) {
+            m_pools[id] = std::make_unique<ComponentPool<T>>();
+        }
+        return static_cast<ComponentPool<T>&>(*m_pools[id]);
+    }
+
+    // function(position, First&, Rest&...) for every actor with all of them, position being the index into First's
+    // components. First's pool drives the walk, so it should be the one with the fewest components
+    template<typename First, typename... Rest, typename F>
+    void each(F&& function) {
+        (pool<Rest>(), ...);
+        each_in_range<First, Rest...>(0, static_cast<uint32_t>(pool<First>().size()), function);
+    }
+
+    // Same as each(), batches of First's components run as jobs
+    template<typename First, typename... Rest, typename F>
+    void parallel_each(JobSystem& jobs, uint32_t batch_size, const F& function, JobCounter* counter) {
+        // Created up front, the jobs only ever look pools up
+        pool<First>();
+        (pool<Rest>(), ...);
+        jobs.parallel_for(static_cast<uint32_t>(pool<First>().size()), batch_size, [this, function](uint32_t begin, uint32_t end, uint32_t) {
+            each_in_range<First, Rest...>(begin, end, function);
+        }, counter);
+    }
+
+private:
+    template<typename T>
+    ComponentPool<T>& existing_pool() const {
+        return static_cast<ComponentPool<T>&>(*m_pools[component_id<T>()]);
+    }
+
+    template<typename First, typename... Rest, typename F>
+    void each_in_range(uint32_t begin, uint32_t end, const F& function) const {
+        ComponentPool<First>& first = existing_pool<First>();
+        const std::span<First> components = first.components();
+        const std::span<const uint32_t> actors = first.actors();
+        for (uint32_t i = begin; i < end; i++) {
+            const uint32_t actor_index = actors[i];
+            if ((existing_pool<Rest>().contains(actor_index) && ...)) {
+                function(i, components[i], existing_pool<Rest>().get(actor_index)...);
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<ComponentPoolBase>> m_pools;
+    std::vector<uint32_t> m_generations;
+    std::vector<bool> m_alive;
+    std::vector<uint32_t> m_free_indices;
+    size_t m_actor_count = 0;
+};
 
-#endif //PORTFOLIO_ACTOR_H
\ No newline at end of file
+#endif //PORTFOLIO_ACTOR_H
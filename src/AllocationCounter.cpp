@@ -0,0 +1,80 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    std::atomic<uint64_t> g_allocation_count = 0;
+    // Constant initialized, so touching it from operator new never needs a dynamic initializer
+    thread_local uint64_t t_allocation_count = 0;
+
+    void* counted_malloc(size_t size) {
+        g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+        t_allocation_count++;
+        // malloc(0) may return null, operator new has to hand out a unique pointer either way
+        return std::malloc(size == 0 ? 1 : size);
+    }
+}
+
+namespace memory {
+    uint64_t allocation_count() {
+        return g_allocation_count.load(std::memory_order_relaxed);
+    }
+
+    uint64_t thread_allocation_count() {
+        return t_allocation_count;
+    }
+
+    void count_allocation() {
+        g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+        t_allocation_count++;
+    }
+}
+
+// Aligned overloads are left to the standard library, it pairs them with its own aligned deletes
+void* operator new(size_t size) {
+    if (void* pointer = counted_malloc(size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    if (void* pointer = counted_malloc(size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return counted_malloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return counted_malloc(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+    std::free(pointer);
+}
@@ -0,0 +1,15 @@
+#ifndef PORTFOLIO_ALLOCATIONCOUNTER_H
+#define PORTFOLIO_ALLOCATIONCOUNTER_H
+
+#include <cstdint>
+
+// Counts heap allocations made through the global operator new, which this module replaces, and through anything
+// that reports to count_allocation(). A frame's share is the difference between two reads
+namespace memory {
+    uint64_t allocation_count();
+    // Only the calling thread's, for measuring code while other threads allocate
+    uint64_t thread_allocation_count();
+    void count_allocation();
+}
+
+#endif //PORTFOLIO_ALLOCATIONCOUNTER_H
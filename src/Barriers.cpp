@@ -0,0 +1,133 @@
+#include "Barriers.h"
+
+#include <cassert>
+
+#include "Initializers.h"
+
+namespace {
+    constexpr VkAccessFlags2 WRITE_ACCESS_MASK =
+        VK_ACCESS_2_SHADER_WRITE_BIT |
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+        VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_2_TRANSFER_WRITE_BIT |
+        VK_ACCESS_2_HOST_WRITE_BIT |
+        VK_ACCESS_2_MEMORY_WRITE_BIT;
+}
+
+ImageState image_usage_state(ImageUsage usage) {
+    switch (usage) {
+        case ImageUsage::Undefined:
+            return {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE};
+        case ImageUsage::ComputeWrite:
+            return {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT};
+        case ImageUsage::ComputeRead:
+            return {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT};
+        case ImageUsage::ComputeReadWrite:
+            return {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT};
+        case ImageUsage::TransferSrc:
+            return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT};
+        case ImageUsage::TransferDst:
+            return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT};
+        case ImageUsage::ColorAttachment:
+            return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT};
+        case ImageUsage::DepthAttachment:
+            return {VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+        case ImageUsage::DepthRead:
+            return {VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT};
+        case ImageUsage::ShaderRead:
+            return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT};
+        case ImageUsage::Present:
+            // Presentation waits on the submit semaphore, the barrier only has to change the layout
+            return {VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE};
+    }
+    return {};
+}
+
+void BarrierTracker::track(VkImage image, VkImageAspectFlags aspect, ImageState initial_state) {
+    m_images[image] = TrackedImage{aspect, initial_state, -1};
+}
+
+void BarrierTracker::forget(VkImage image) {
+    m_images.erase(image);
+}
+
+void BarrierTracker::transition(VkImage image, ImageUsage usage, bool discard_contents) {
+    auto it = m_images.find(image);
+    assert(it != m_images.end() && "transition called on an untracked image");
+    TrackedImage& tracked = it->second;
+    const ImageState target = image_usage_state(usage);
+
+    // Nothing was recorded since the queued barrier, so A -> B -> C collapses into A -> C
+    if (tracked.pending_barrier >= 0) {
+        VkImageMemoryBarrier2& pending = m_pending[tracked.pending_barrier];
+        pending.newLayout = target.layout;
+        pending.dstStageMask = target.stage;
+        pending.dstAccessMask = target.access;
+        if (discard_contents) {
+            pending.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        }
+        tracked.state = target;
+        return;
+    }
+
+    const bool layout_change = discard_contents || tracked.state.layout != target.layout;
+    const bool previous_write = (tracked.state.access & WRITE_ACCESS_MASK) != 0;
+    const bool next_write = (target.access & WRITE_ACCESS_MASK) != 0;
+
+    // Read after read in the same layout needs no barrier, but a later write has to wait on both reads
+    if (!layout_change && !previous_write && !next_write) {
+        tracked.state.stage |= target.stage;
+        tracked.state.access |= target.access;
+        return;
+    }
+
+    VkImageMemoryBarrier2 image_barrier = {};
+    image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    image_barrier.pNext = nullptr;
+    image_barrier.srcStageMask = tracked.state.stage;
+    // Write after read only needs an execution dependency, there is nothing to make available
+    image_barrier.srcAccessMask = previous_write ? (tracked.state.access & WRITE_ACCESS_MASK) : VK_ACCESS_2_NONE;
+    image_barrier.dstStageMask = target.stage;
+    image_barrier.dstAccessMask = target.access;
+    image_barrier.oldLayout = discard_contents ? VK_IMAGE_LAYOUT_UNDEFINED : tracked.state.layout;
+    image_barrier.newLayout = target.layout;
+    image_barrier.subresourceRange = init::image_subresource_range(tracked.aspect);
+    image_barrier.image = image;
+
+    tracked.pending_barrier = static_cast<int32_t>(m_pending.size());
+    tracked.state = target;
+    m_pending.push_back(image_barrier);
+}
+
+void BarrierTracker::flush(VkCommandBuffer cmd) {
+    if (m_pending.empty()) {
+        return;
+    }
+
+    VkDependencyInfo dependency_info {};
+    dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependency_info.pNext = nullptr;
+    dependency_info.imageMemoryBarrierCount = static_cast<uint32_t>(m_pending.size());
+    dependency_info.pImageMemoryBarriers = m_pending.data();
+
+    vkCmdPipelineBarrier2(cmd, &dependency_info);
+
+    m_stats.barrier_count += static_cast<uint32_t>(m_pending.size());
+    m_stats.batch_count++;
+    for (const VkImageMemoryBarrier2& barrier : m_pending) {
+        auto it = m_images.find(barrier.image);
+        if (it != m_images.end()) {
+            it->second.pending_barrier = -1;
+        }
+    }
+    m_pending.clear();
+}
+
+ImageState BarrierTracker::state(VkImage image) const {
+    auto it = m_images.find(image);
+    return it != m_images.end() ? it->second.state : ImageState{};
+}
@@ -0,0 +1,66 @@
+#ifndef PORTFOLIO_BARRIERS_H
+#define PORTFOLIO_BARRIERS_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// How an image is about to be used. Each usage maps to exactly one layout and the narrowest stage/access pair
+enum class ImageUsage : uint8_t {
+    Undefined,
+    ComputeWrite,
+    ComputeRead,
+    ComputeReadWrite,
+    TransferSrc,
+    TransferDst,
+    ColorAttachment,
+    DepthAttachment,
+    DepthRead,
+    ShaderRead,
+    Present
+};
+
+struct ImageState {
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    // Stages/accesses of the last write, or of every read since it, so the next barrier waits on exactly that
+    VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 access = VK_ACCESS_2_NONE;
+};
+
+struct BarrierStats {
+    uint32_t barrier_count = 0;
+    uint32_t batch_count = 0;
+};
+
+ImageState image_usage_state(ImageUsage usage);
+
+// Remembers the current layout and last stage/access of every tracked image, turns transitions into minimal
+// VkImageMemoryBarrier2s and flushes everything queued since the last sync point in one vkCmdPipelineBarrier2.
+class BarrierTracker {
+public:
+    void track(VkImage image, VkImageAspectFlags aspect, ImageState initial_state = {});
+    void forget(VkImage image);
+
+    // discard_contents transitions from UNDEFINED, letting the driver skip preserving what was there
+    void transition(VkImage image, ImageUsage usage, bool discard_contents = false);
+    void flush(VkCommandBuffer cmd);
+
+    ImageState state(VkImage image) const;
+    BarrierStats stats() const { return m_stats; }
+    void reset_stats() { m_stats = {}; }
+
+private:
+    struct TrackedImage {
+        VkImageAspectFlags aspect;
+        ImageState state;
+        int32_t pending_barrier = -1;
+    };
+
+    std::unordered_map<VkImage, TrackedImage> m_images;
+    std::vector<VkImageMemoryBarrier2> m_pending;
+    BarrierStats m_stats = {};
+};
+
+#endif //PORTFOLIO_BARRIERS_H
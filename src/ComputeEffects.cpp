@@ -0,0 +1,481 @@
+#include "ComputeEffects.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+#include "Descriptors.h"
+#include "EmbeddedShaders.h"
+#include "Types.h"
+#include "Utilities.h"
+
+namespace {
+    std::optional<EffectInput> parse_input(const std::string& value) {
+        if (value == "@time") return EffectInput::Time;
+        if (value == "@mouse") return EffectInput::Mouse;
+        if (value == "@mouse_workgroup") return EffectInput::MouseWorkgroup;
+        if (value == "@extent") return EffectInput::Extent;
+        if (value == "@reset") return EffectInput::Reset;
+        return std::nullopt;
+    }
+
+    // Writes up to member.components values, converted to whatever scalar type the member has
+    void write_values(std::byte* destination, const ShaderBlockMember& member, std::span<const float> values) {
+        const size_t count = std::min<size_t>(values.size(), member.components);
+        for (size_t i = 0; i < count; i++) {
+            std::byte* component = destination + i * 4;
+            if (member.type == ShaderValueType::Float) {
+                std::memcpy(component, &values[i], 4);
+            } else if (member.type == ShaderValueType::Int) {
+                const int32_t value = static_cast<int32_t>(values[i]);
+                std::memcpy(component, &value, 4);
+            } else if (member.type == ShaderValueType::UInt) {
+                const uint32_t value = static_cast<uint32_t>(std::max(values[i], 0.0f));
+                std::memcpy(component, &value, 4);
+            }
+        }
+    }
+}
+
+void ComputeEffect::update_inputs(const EffectFrameInputs& inputs) {
+    for (const EffectParameter& parameter : parameters) {
+        switch (parameter.input) {
+            case EffectInput::None:
+                break;
+            case EffectInput::Time: {
+                const float values[] = {inputs.time};
+                write_values(parameter_data(parameter), parameter.member, values);
+                break;
+            }
+            case EffectInput::Mouse: {
+                const float values[] = {inputs.mouse_x, inputs.mouse_y};
+                write_values(parameter_data(parameter), parameter.member, values);
+                break;
+            }
+            case EffectInput::MouseWorkgroup: {
+                const float values[] = {
+                    std::floor(inputs.mouse_x / static_cast<float>(local_size[0])),
+                    std::floor(inputs.mouse_y / static_cast<float>(local_size[1]))
+                };
+                write_values(parameter_data(parameter), parameter.member, values);
+                break;
+            }
+            case EffectInput::Extent: {
+                const float values[] = {static_cast<float>(inputs.extent.width), static_cast<float>(inputs.extent.height)};
+                write_values(parameter_data(parameter), parameter.member, values);
+                break;
+            }
+            case EffectInput::Reset: {
+                const float values[] = {inputs.reset ? 1.0f : 0.0f};
+                write_values(parameter_data(parameter), parameter.member, values);
+                break;
+            }
+        }
+    }
+}
+
+std::array<uint32_t, 3> ComputeEffect::group_count(VkExtent2D extent) const {
+    return {
+        (extent.width + local_size[0] - 1) / local_size[0],
+        (extent.height + local_size[1] - 1) / local_size[1],
+        1
+    };
+}
+
+VkImageView EffectChain::image_view(const ChainImageRef& ref, VkImageView output) const {
+    if (ref.image == ChainImageRef::OUTPUT) {
+        return output;
+    }
+    const ChainImage& image = images[ref.image];
+    if (!image.ping_pong) {
+        return image.targets[0].image_view;
+    }
+    return image.targets[ref.write_side ? current ^ 1 : current].image_view;
+}
+
+void PipelineLayoutCache::init(VkDevice device) {
+    m_device = device;
+}
+
+void PipelineLayoutCache::destroy() {
+    for (const auto& [key, layout] : m_pipeline_layouts) {
+        vkDestroyPipelineLayout(m_device, layout, nullptr);
+    }
+    for (const auto& [key, layout] : m_set_layouts) {
+        vkDestroyDescriptorSetLayout(m_device, layout, nullptr);
+    }
+    m_pipeline_layouts.clear();
+    m_set_layouts.clear();
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::descriptor_set_layout(std::span<const ShaderBinding> bindings, VkShaderStageFlags stages) {
+    std::ostringstream key;
+    key << stages;
+    for (const ShaderBinding& binding : bindings) {
+        key << ';' << binding.binding << ':' << binding.type << ':' << binding.count;
+    }
+
+    const auto existing = m_set_layouts.find(key.str());
+    if (existing != m_set_layouts.end()) {
+        return existing->second;
+    }
+
+    DescriptorLayoutBuilder builder;
+    for (const ShaderBinding& binding : bindings) {
+        builder.add_binding(binding.binding, binding.type);
+        builder.bindings.back().descriptorCount = binding.count;
+    }
+    VkDescriptorSetLayout layout = builder.build(m_device, stages);
+    m_set_layouts.emplace(key.str(), layout);
+    return layout;
+}
+
+VkPipelineLayout PipelineLayoutCache::pipeline_layout(std::span<const VkDescriptorSetLayout> set_layouts, uint32_t push_constant_size, VkShaderStageFlags stages) {
+    std::ostringstream key;
+    key << stages << ';' << push_constant_size;
+    for (VkDescriptorSetLayout set_layout : set_layouts) {
+        key << ';' << set_layout;
+    }
+
+    const auto existing = m_pipeline_layouts.find(key.str());
+    if (existing != m_pipeline_layouts.end()) {
+        return existing->second;
+    }
+
+    VkPushConstantRange push_constant = {};
+    push_constant.stageFlags = stages;
+    push_constant.offset = 0;
+    push_constant.size = push_constant_size;
+
+    VkPipelineLayoutCreateInfo layout_info = {};
+    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.pNext = nullptr;
+    layout_info.pSetLayouts = set_layouts.data();
+    layout_info.setLayoutCount = static_cast<uint32_t>(set_layouts.size());
+    layout_info.pPushConstantRanges = push_constant_size > 0 ? &push_constant : nullptr;
+    layout_info.pushConstantRangeCount = push_constant_size > 0 ? 1 : 0;
+
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VK_CHECK(vkCreatePipelineLayout(m_device, &layout_info, nullptr, &layout));
+    m_pipeline_layouts.emplace(key.str(), layout);
+    return layout;
+}
+
+void EffectRegistry::init(VkDevice device, PipelineLayoutCache* layout_cache) {
+    m_device = device;
+    m_layout_cache = layout_cache;
+}
+
+void EffectRegistry::destroy() {
+    for (const ComputeEffect& effect : m_effects) {
+        vkDestroyPipeline(m_device, effect.pipeline, nullptr);
+    }
+    for (const EffectChain& chain : m_chains) {
+        for (const ChainPass& pass : chain.passes) {
+            vkDestroyPipeline(m_device, pass.effect.pipeline, nullptr);
+        }
+    }
+    for (VkPipeline pipeline : m_retired_pipelines) {
+        vkDestroyPipeline(m_device, pipeline, nullptr);
+    }
+    m_effects.clear();
+    m_chains.clear();
+    m_retired_pipelines.clear();
+}
+
+size_t EffectRegistry::load_manifest(std::string_view manifest) {
+    std::istringstream file{std::string(manifest)};
+    size_t loaded = 0;
+    // Chain being read, a broken line anywhere inside drops the whole chain
+    std::optional<EffectChain> chain;
+    bool chain_valid = false;
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+
+        std::istringstream tokens(line);
+        std::string keyword;
+        if (!(tokens >> keyword)) {
+            continue;
+        }
+
+        std::vector<std::string> arguments;
+        for (std::string argument; tokens >> argument;) {
+            arguments.push_back(argument);
+        }
+
+        if (keyword == "chain") {
+            if (chain.has_value() || arguments.empty()) {
+                std::cerr << "Effect manifest: chain needs a name and can't be nested" << std::endl;
+                continue;
+            }
+            chain = EffectChain{};
+            chain->name = arguments[0];
+            chain_valid = true;
+            for (size_t i = 1; i < arguments.size(); i++) {
+                if (arguments[i].starts_with("ticks=")) {
+                    chain->ticks_per_frame = std::max(1, std::atoi(arguments[i].c_str() + 6));
+                }
+            }
+            continue;
+        }
+
+        if (keyword == "end") {
+            if (!chain.has_value()) {
+                std::cerr << "Effect manifest: end without chain" << std::endl;
+                continue;
+            }
+            if (chain_valid && !chain->passes.empty()) {
+                m_chains.push_back(std::move(chain.value()));
+                loaded++;
+            } else {
+                std::cerr << "Effect chain " << chain->name << " skipped" << std::endl;
+                for (const ChainPass& pass : chain->passes) {
+                    vkDestroyPipeline(m_device, pass.effect.pipeline, nullptr);
+                }
+            }
+            chain.reset();
+            continue;
+        }
+
+        if (chain.has_value()) {
+            if (keyword == "image" && !arguments.empty()) {
+                ChainImage image = {};
+                image.name = arguments[0];
+                image.ping_pong = arguments.size() > 1 && arguments[1] == "ping_pong";
+                chain->images.push_back(image);
+            } else if ((keyword == "tick" || keyword == "pass") && !arguments.empty()) {
+                const std::span<const std::string> assignments = std::span<const std::string>(arguments).subspan(1);
+                chain_valid &= add_chain_pass(chain.value(), arguments[0], assignments, keyword == "tick");
+            } else {
+                std::cerr << "Effect chain " << chain->name << ": can't read \"" << line << "\"" << std::endl;
+                chain_valid = false;
+            }
+            continue;
+        }
+
+        if (arguments.empty()) {
+            std::cerr << "Effect " << keyword << " has no shader" << std::endl;
+            continue;
+        }
+
+        const std::optional<std::span<const uint32_t>> code = find_embedded_shader(arguments[0]);
+        if (!code.has_value()) {
+            std::cerr << "No embedded shader " << arguments[0] << " for effect " << keyword << std::endl;
+            continue;
+        }
+        const std::span<const std::string> assignments = std::span<const std::string>(arguments).subspan(1);
+        std::optional<ComputeEffect> effect = build_effect(keyword, code.value(), assignments, nullptr, std::cerr);
+        if (effect.has_value()) {
+            m_effects.push_back(std::move(effect.value()));
+            loaded++;
+        }
+    }
+
+    if (chain.has_value()) {
+        std::cerr << "Effect chain " << chain->name << " is missing its end line" << std::endl;
+        for (const ChainPass& pass : chain->passes) {
+            vkDestroyPipeline(m_device, pass.effect.pipeline, nullptr);
+        }
+    }
+    return loaded;
+}
+
+std::optional<size_t> EffectRegistry::replace_effect(const std::string& name, std::span<const uint32_t> code, std::span<const std::string> assignments,
+    std::ostream& errors) {
+    std::optional<ComputeEffect> effect = build_effect(name, code, assignments, nullptr, errors);
+    if (!effect.has_value()) {
+        return std::nullopt;
+    }
+
+    auto existing = std::ranges::find(m_effects, name, &ComputeEffect::name);
+    if (existing == m_effects.end()) {
+        m_effects.push_back(std::move(effect.value()));
+        return m_effects.size() - 1;
+    }
+
+    // Values already tuned survive a recompile as long as the member kept its name and type
+    for (const EffectParameter& parameter : effect->parameters) {
+        auto previous = std::ranges::find_if(existing->parameters, [&](const EffectParameter& candidate) {
+            return candidate.member.name == parameter.member.name && candidate.member.type == parameter.member.type &&
+                candidate.member.components == parameter.member.components;
+        });
+        if (parameter.editable() && previous != existing->parameters.end() && previous->editable()) {
+            memcpy(effect->parameter_data(parameter), existing->parameter_data(*previous), parameter.member.size);
+        }
+    }
+    m_retired_pipelines.push_back(existing->pipeline);
+    *existing = std::move(effect.value());
+    return static_cast<size_t>(existing - m_effects.begin());
+}
+
+bool EffectRegistry::add_chain_pass(EffectChain& chain, const std::string& shader_name, std::span<const std::string> assignments, bool per_tick) {
+    const std::string name = chain.name + "/" + std::filesystem::path(shader_name).stem().string();
+    std::vector<std::pair<std::string, std::string>> image_assignments;
+    const std::optional<std::span<const uint32_t>> code = find_embedded_shader(shader_name);
+    if (!code.has_value()) {
+        std::cerr << "No embedded shader " << shader_name << " for effect " << name << std::endl;
+        return false;
+    }
+    std::optional<ComputeEffect> effect = build_effect(name, code.value(), assignments, &image_assignments, std::cerr);
+    if (!effect.has_value()) {
+        return false;
+    }
+
+    ChainPass pass = {};
+    pass.per_tick = per_tick;
+    bool valid = true;
+    // Every binding has to point somewhere, the renderer only fills what the manifest names
+    for (const ShaderBinding& binding : effect->bindings) {
+        auto assignment = std::find_if(image_assignments.begin(), image_assignments.end(), [&](const auto& candidate) {
+            return candidate.first == binding.name;
+        });
+        if (binding.type != VK_DESCRIPTOR_TYPE_STORAGE_IMAGE || assignment == image_assignments.end()) {
+            std::cerr << "Effect " << name << ": binding " << binding.name << " needs a storage image from the chain" << std::endl;
+            valid = false;
+            continue;
+        }
+
+        ChainImageRef ref = {};
+        ref.binding = binding.binding;
+        std::string image_name = assignment->second;
+        if (image_name.ends_with(".read") || image_name.ends_with(".write")) {
+            ref.write_side = image_name.ends_with(".write");
+            image_name.erase(image_name.rfind('.'));
+        }
+
+        if (image_name == "output") {
+            ref.image = ChainImageRef::OUTPUT;
+        } else {
+            auto image = std::find_if(chain.images.begin(), chain.images.end(), [&](const ChainImage& candidate) {
+                return candidate.name == image_name;
+            });
+            if (image == chain.images.end()) {
+                std::cerr << "Effect " << name << ": no image called " << image_name << std::endl;
+                valid = false;
+                continue;
+            }
+            ref.image = static_cast<uint32_t>(image - chain.images.begin());
+        }
+        pass.images.push_back(ref);
+    }
+
+    pass.effect = std::move(effect.value());
+    chain.passes.push_back(std::move(pass));
+    return valid;
+}
+
+std::optional<ComputeEffect> EffectRegistry::build_effect(const std::string& name, std::span<const uint32_t> code, std::span<const std::string> assignments,
+    std::vector<std::pair<std::string, std::string>>* image_assignments, std::ostream& errors) {
+    const std::optional<ShaderReflection> reflection = reflect::reflect_spirv(code);
+    if (!reflection.has_value() || reflection->stage != VK_SHADER_STAGE_COMPUTE_BIT) {
+        errors << "Effect " << name << " needs a compute shader" << std::endl;
+        return std::nullopt;
+    }
+
+    ComputeEffect effect = {};
+    effect.name = name;
+    effect.local_size = reflection->local_size;
+
+    // Effects draw into one set, anything else would need the renderer to know what to bind there. Chain passes
+    // get every binding from the manifest, standalone effects write their first storage image
+    bool has_output = image_assignments != nullptr;
+    for (const ShaderBinding& binding : reflection->bindings) {
+        if (binding.set != 0 || binding.count != 1) {
+            errors << "Effect " << name << ": binding " << binding.name << " must be a single descriptor in set 0" << std::endl;
+            return std::nullopt;
+        }
+        if (!has_output && binding.type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) {
+            effect.output_binding = binding.binding;
+            has_output = true;
+        }
+        effect.bindings.push_back(binding);
+    }
+    if (!has_output) {
+        errors << "Effect " << name << " has no storage image to write to" << std::endl;
+        return std::nullopt;
+    }
+
+    effect.push_constants.resize(reflection->push_constant_size);
+    for (size_t i = 0; i < reflection->push_constants.size(); i++) {
+        EffectParameter parameter = {};
+        parameter.member = reflection->push_constants[i];
+        if (parameter.member.name.empty()) {
+            // Stripped debug info, still editable just not nicely labelled
+            parameter.member.name = "member" + std::to_string(i);
+        }
+        effect.parameters.push_back(parameter);
+    }
+
+    for (const std::string& assignment : assignments) {
+        const size_t equals = assignment.find('=');
+        const std::string member_name = assignment.substr(0, equals);
+        if (image_assignments != nullptr && equals != std::string::npos) {
+            const bool names_binding = std::any_of(effect.bindings.begin(), effect.bindings.end(), [&](const ShaderBinding& binding) {
+                return binding.name == member_name;
+            });
+            if (names_binding) {
+                image_assignments->emplace_back(member_name, assignment.substr(equals + 1));
+                continue;
+            }
+        }
+        auto parameter = std::find_if(effect.parameters.begin(), effect.parameters.end(), [&](const EffectParameter& candidate) {
+            return candidate.member.name == member_name;
+        });
+        if (equals == std::string::npos || parameter == effect.parameters.end() || parameter->member.type == ShaderValueType::Other) {
+            errors << "Effect " << name << ": ignoring " << assignment << std::endl;
+            continue;
+        }
+
+        const std::string value = assignment.substr(equals + 1);
+        if (const std::optional<EffectInput> input = parse_input(value)) {
+            parameter->input = input.value();
+            continue;
+        }
+
+        std::vector<float> values;
+        std::istringstream components(value);
+        for (std::string component; std::getline(components, component, ',');) {
+            try {
+                values.push_back(std::stof(component));
+            } catch (const std::exception&) {
+                errors << "Effect " << name << ": bad value " << component << " for " << member_name << std::endl;
+            }
+        }
+        write_values(effect.parameter_data(*parameter), parameter->member, values);
+    }
+
+    effect.set_layout = m_layout_cache->descriptor_set_layout(effect.bindings, VK_SHADER_STAGE_COMPUTE_BIT);
+    effect.layout = m_layout_cache->pipeline_layout({&effect.set_layout, 1}, reflection->push_constant_size, VK_SHADER_STAGE_COMPUTE_BIT);
+
+    VkShaderModule shader = {};
+    if (!util::create_shader_module(code, m_device, &shader)) {
+        errors << "Failed to create shader module for effect " << name << std::endl;
+        return std::nullopt;
+    }
+
+    VkPipelineShaderStageCreateInfo stage_info = {};
+    stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stage_info.pNext = nullptr;
+    stage_info.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    stage_info.module = shader;
+    stage_info.pName = reflection->entry_point.c_str();
+
+    VkComputePipelineCreateInfo pipeline_info = {};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.pNext = nullptr;
+    pipeline_info.layout = effect.layout;
+    pipeline_info.stage = stage_info;
+    VK_CHECK(vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &effect.pipeline));
+    vkDestroyShaderModule(m_device, shader, nullptr);
+
+    std::cout << "Effect " << name << " loaded, workgroup " << effect.local_size[0] << "x" << effect.local_size[1] << "x" << effect.local_size[2]
+        << ", " << effect.push_constants.size() << " bytes of push constants" << std::endl;
+    return effect;
+}
@@ -0,0 +1,170 @@
+#ifndef PORTFOLIO_COMPUTEEFFECTS_H
+#define PORTFOLIO_COMPUTEEFFECTS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "ShaderReflection.h"
+#include "Types.h"
+
+// Values the renderer writes into a push constant every frame instead of the user
+enum class EffectInput : uint8_t {
+    None,
+    Time,
+    Mouse,
+    // Mouse position divided by the effect's workgroup size
+    MouseWorkgroup,
+    Extent,
+    // 1 for the first tick after a chain's images were (re)created, 0 otherwise
+    Reset
+};
+
+struct EffectParameter {
+    ShaderBlockMember member;
+    EffectInput input = EffectInput::None;
+
+    // Shown as a widget, the rest are filled by the renderer or have no widget for their type
+    bool editable() const { return input == EffectInput::None && member.type != ShaderValueType::Other; }
+};
+
+struct EffectFrameInputs {
+    float time = 0.0f;
+    float mouse_x = 0.0f;
+    float mouse_y = 0.0f;
+    VkExtent2D extent = {};
+    bool reset = false;
+};
+
+struct ComputeEffect {
+    std::string name;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    // Owned by the PipelineLayoutCache, effects with the same resources and push constant size share them
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout set_layout = VK_NULL_HANDLE;
+    std::array<uint32_t, 3> local_size = {1, 1, 1};
+    // First storage image in set 0, where the effect writes its result
+    uint32_t output_binding = 0;
+    std::vector<ShaderBinding> bindings;
+    std::vector<EffectParameter> parameters;
+    // Raw push constant block, laid out as the shader declares it
+    std::vector<std::byte> push_constants;
+
+    std::byte* parameter_data(const EffectParameter& parameter) { return push_constants.data() + parameter.member.offset; }
+    void update_inputs(const EffectFrameInputs& inputs);
+    // Workgroup counts that cover extent with local_size
+    std::array<uint32_t, 3> group_count(VkExtent2D extent) const;
+};
+
+// Binding of a chain pass to one of the chain's images, or to the target the background is drawn into
+struct ChainImageRef {
+    static constexpr uint32_t OUTPUT = UINT32_MAX;
+
+    uint32_t binding;
+    uint32_t image;
+    // For ping-pong images: the side written this tick rather than the one written last tick
+    bool write_side;
+};
+
+struct ChainPass {
+    ComputeEffect effect;
+    std::vector<ChainImageRef> images;
+    // Runs once per simulation tick instead of once per frame
+    bool per_tick;
+};
+
+struct ChainImage {
+    std::string name;
+    bool ping_pong;
+    // Second image only used by ping-pong pairs
+    std::array<AllocatedImage, 2> targets;
+};
+
+// Several effects that run back to back each frame over images the chain owns. Images persist between frames,
+// ping-pong pairs swap after every tick, so a pass can read last tick's state while writing the next one
+struct EffectChain {
+    std::string name;
+    std::vector<ChainImage> images;
+    std::vector<ChainPass> passes;
+    int ticks_per_frame = 1;
+    // Side of every ping-pong pair that was written last
+    uint32_t current = 0;
+    // Extent the images were created at, zero until the chain first runs
+    VkExtent2D extent = {};
+    bool needs_reset = true;
+    // Smoothed GPU time of one tick
+    float tick_ms = 0.0f;
+
+    VkImageView image_view(const ChainImageRef& ref, VkImageView output) const;
+    void swap() { current ^= 1; }
+};
+
+// Dedupes descriptor set layouts and pipeline layouts by what they contain
+class PipelineLayoutCache {
+public:
+    void init(VkDevice device);
+    void destroy();
+
+    VkDescriptorSetLayout descriptor_set_layout(std::span<const ShaderBinding> bindings, VkShaderStageFlags stages);
+    VkPipelineLayout pipeline_layout(std::span<const VkDescriptorSetLayout> set_layouts, uint32_t push_constant_size, VkShaderStageFlags stages);
+
+    size_t descriptor_set_layout_count() const { return m_set_layouts.size(); }
+    size_t pipeline_layout_count() const { return m_pipeline_layouts.size(); }
+
+private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::unordered_map<std::string, VkDescriptorSetLayout> m_set_layouts;
+    std::unordered_map<std::string, VkPipelineLayout> m_pipeline_layouts;
+};
+
+// Background effects described by a manifest rather than code. Each non-comment line is
+//     name shader.comp member=value,value,... member=@input ...
+// where the shader is one the build embeds, named by its source file, and @time, @mouse, @mouse_workgroup, @extent or @reset tie a
+// push constant to a per-frame value. Layouts, workgroup size and the parameter list come from the shader itself.
+// Chains sit between "chain name [ticks=n]" and "end" lines:
+//     image name [ping_pong]
+//     tick shader.comp binding=image.read binding=image.write member=value ...
+//     pass shader.comp binding=image binding=output member=value ...
+// tick passes run ticks times a frame with ping-pong pairs swapping in between, pass lines run once afterwards.
+class EffectRegistry {
+public:
+    void init(VkDevice device, PipelineLayoutCache* layout_cache);
+    void destroy();
+
+    // Returns how many effects were built, broken lines and shaders are reported and skipped
+    size_t load_manifest(std::string_view manifest);
+
+    // Builds an effect from SPIR-V compiled at runtime, taking the place of the effect with the same name if there is
+    // one. Returns its index, or nothing with the reasons written to errors. The pipeline it replaces may still be in
+    // flight, it's kept until take_retired_pipelines()
+    std::optional<size_t> replace_effect(const std::string& name, std::span<const uint32_t> code, std::span<const std::string> assignments,
+        std::ostream& errors);
+    std::vector<VkPipeline> take_retired_pipelines() { return std::exchange(m_retired_pipelines, {}); }
+
+    std::vector<ComputeEffect>& effects() { return m_effects; }
+    std::vector<EffectChain>& chains() { return m_chains; }
+
+private:
+    // Assignments naming a binding rather than a push constant are handed back through image_assignments
+    std::optional<ComputeEffect> build_effect(const std::string& name, std::span<const uint32_t> code, std::span<const std::string> assignments,
+        std::vector<std::pair<std::string, std::string>>* image_assignments, std::ostream& errors);
+    bool add_chain_pass(EffectChain& chain, const std::string& shader_name, std::span<const std::string> assignments, bool per_tick);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    PipelineLayoutCache* m_layout_cache = nullptr;
+    std::vector<ComputeEffect> m_effects;
+    std::vector<EffectChain> m_chains;
+    std::vector<VkPipeline> m_retired_pipelines;
+};
+
+#endif //PORTFOLIO_COMPUTEEFFECTS_H
@@ -6,6 +6,8 @@
 #include <deque>
 #include <span>
 
+#include "FrameArena.h"
+
 struct DescriptorLayoutBuilder {
 	std::vector<VkDescriptorSetLayoutBinding> bindings;
 
@@ -15,9 +17,15 @@ struct DescriptorLayoutBuilder {
 };
 
 struct DescriptorWriter {
-    std::deque<VkDescriptorImageInfo> image_infos;
-    std::deque<VkDescriptorBufferInfo> buffer_infos;
-    std::vector<VkWriteDescriptorSet> writes;
+    std::deque<VkDescriptorImageInfo, ArenaAllocator<VkDescriptorImageInfo>> image_infos;
+    std::deque<VkDescriptorBufferInfo, ArenaAllocator<VkDescriptorBufferInfo>> buffer_infos;
+    std::vector<VkWriteDescriptorSet, ArenaAllocator<VkWriteDescriptorSet>> writes;
+
+    DescriptorWriter() = default;
+    // Writers recorded every frame keep their bookkeeping in the frame's arena instead of the heap
+    explicit DescriptorWriter(FrameArena* arena)
+        : image_infos(ArenaAllocator<VkDescriptorImageInfo>(arena)), buffer_infos(ArenaAllocator<VkDescriptorBufferInfo>(arena)),
+          writes(ArenaAllocator<VkWriteDescriptorSet>(arena)) {}
 
     void write_image(int binding, VkImageView image, VkSampler sampler, VkImageLayout layout, VkDescriptorType type);
     void write_buffer(int binding, VkBuffer buffer, size_t size, size_t offset, VkDescriptorType type);
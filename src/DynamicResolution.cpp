@@ -0,0 +1,35 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+float DynamicResolution::update(float gpu_frame_ms) {
+    if (gpu_frame_ms <= 0.0f || settings.target_frame_ms <= 0.0f) {
+        return m_scale;
+    }
+
+    m_smoothed_ms = m_smoothed_ms <= 0.0f ? gpu_frame_ms : m_smoothed_ms + settings.smoothing * (gpu_frame_ms - m_smoothed_ms);
+
+    // Positive error means headroom, so the scale goes up
+    const float error = (settings.target_frame_ms - m_smoothed_ms) / settings.target_frame_ms;
+
+    // Velocity form: the scale itself accumulates the output, so the integral gain acts on the error directly and
+    // proportional/derivative act on its changes. Clamping the scale is then all the anti-windup it needs
+    if (std::abs(error) >= settings.deadband) {
+        const float output = settings.proportional_gain * (error - m_previous_error) +
+            settings.integral_gain * error +
+            settings.derivative_gain * (error - 2.0f * m_previous_error + m_previous_previous_error);
+        m_scale = std::clamp(m_scale + std::clamp(output, -settings.max_step, settings.max_step), settings.min_scale, settings.max_scale);
+    }
+
+    m_previous_previous_error = m_previous_error;
+    m_previous_error = error;
+    return m_scale;
+}
+
+void DynamicResolution::reset(float scale) {
+    m_scale = std::clamp(scale, settings.min_scale, settings.max_scale);
+    m_smoothed_ms = 0.0f;
+    m_previous_error = 0.0f;
+    m_previous_previous_error = 0.0f;
+}
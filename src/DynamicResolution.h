@@ -0,0 +1,39 @@
+#ifndef PORTFOLIO_DYNAMICRESOLUTION_H
+#define PORTFOLIO_DYNAMICRESOLUTION_H
+
+struct DynamicResolutionSettings {
+    float target_frame_ms = 1000.0f / 60.0f;
+    float min_scale = 0.3f;
+    float max_scale = 1.0f;
+    // Gains act on the error as a fraction of the target, so they don't depend on the frame rate aimed for
+    float proportional_gain = 0.1f;
+    float integral_gain = 0.05f;
+    float derivative_gain = 0.01f;
+    // Weight of the newest timing in the exponential moving average
+    float smoothing = 0.15f;
+    // Errors within this fraction of the target leave the scale alone
+    float deadband = 0.05f;
+    // Largest change per update, keeps a single spike from halving the resolution
+    float max_step = 0.05f;
+};
+
+// PID controller that picks a render scale from measured GPU frame time. Timings come in a few frames late,
+// hence the smoothing, the deadband and the clamped step instead of reacting to every sample
+class DynamicResolution {
+public:
+    DynamicResolutionSettings settings = {};
+
+    float update(float gpu_frame_ms);
+    void reset(float scale);
+
+    float scale() const { return m_scale; }
+    float smoothed_frame_ms() const { return m_smoothed_ms; }
+
+private:
+    float m_scale = 1.0f;
+    float m_smoothed_ms = 0.0f;
+    float m_previous_error = 0.0f;
+    float m_previous_previous_error = 0.0f;
+};
+
+#endif //PORTFOLIO_DYNAMICRESOLUTION_H
@@ -0,0 +1,17 @@
+#include "EmbeddedShaders.h"
+
+#include "shaders/EmbeddedShaderTable.h"
+
+std::optional<std::span<const uint32_t>> find_embedded_shader(std::string_view name) {
+    for (const EmbeddedShaderEntry& entry : EMBEDDED_SHADERS) {
+        if (name == entry.name) {
+            return entry.code;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view embedded_effect_manifest() {
+    // Minus the terminating zero
+    return std::string_view(embedded_shaders::effects_txt, sizeof(embedded_shaders::effects_txt) - 1);
+}
@@ -0,0 +1,35 @@
+#ifndef PORTFOLIO_EMBEDDED_SHADERS_H
+#define PORTFOLIO_EMBEDDED_SHADERS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "shaders/EmbeddedShaderNames.h"
+
+// A shader name checked at compile time against the files in src/shaders, so a typo or a shader that was never added
+// fails the build instead of turning a feature off at startup. Only takes literals, runtime names go through
+// find_embedded_shader
+class EmbeddedShaderName {
+public:
+    consteval EmbeddedShaderName(const char* name) : m_name(name) {
+        if (std::find(std::begin(EMBEDDED_SHADER_NAMES), std::end(EMBEDDED_SHADER_NAMES), m_name) == std::end(EMBEDDED_SHADER_NAMES)) {
+            throw "No shader with this name in src/shaders";
+        }
+    }
+
+    std::string_view view() const { return m_name; }
+
+private:
+    std::string_view m_name;
+};
+
+// SPIR-V for every shader in src/shaders, compiled by the build and looked up by source file name, e.g. "mesh.vert"
+std::optional<std::span<const uint32_t>> find_embedded_shader(std::string_view name);
+// src/shaders/effects.txt as it was at build time
+std::string_view embedded_effect_manifest();
+
+#endif //PORTFOLIO_EMBEDDED_SHADERS_H
@@ -0,0 +1,88 @@
+#include "FrameArena.h"
+
+#include <bit>
+#include <new>
+
+#include "AllocationCounter.h"
+
+namespace {
+    size_t align_up(size_t value, size_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+void FrameArena::init(size_t capacity, uint32_t thread_count, size_t thread_capacity) {
+    destroy();
+    m_capacity = capacity;
+    m_memory = static_cast<std::byte*>(::operator new(m_capacity, std::align_val_t{alignof(std::max_align_t)}));
+    // Room for the bookkeeping up front, an overflow should cost one allocation rather than two
+    m_overflow_blocks.reserve(16);
+
+    m_thread_count = thread_count;
+    if (m_thread_count > 0) {
+        m_thread_arenas = std::make_unique<FrameArena[]>(m_thread_count);
+        for (uint32_t i = 0; i < m_thread_count; i++) {
+            m_thread_arenas[i].init(thread_capacity);
+        }
+    }
+}
+
+void FrameArena::destroy() {
+    free_overflow_blocks();
+    if (m_memory != nullptr) {
+        ::operator delete(m_memory, std::align_val_t{alignof(std::max_align_t)});
+        m_memory = nullptr;
+    }
+    m_capacity = 0;
+    m_offset = 0;
+    m_thread_arenas.reset();
+    m_thread_count = 0;
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+    const size_t offset = align_up(m_offset, alignment);
+    if (offset + size <= m_capacity) {
+        m_offset = offset + size;
+        return m_memory + offset;
+    }
+
+    // Aligned operator new isn't one the allocation counter replaces
+    memory::count_allocation();
+    void* block = ::operator new(size, std::align_val_t{alignment});
+    m_overflow_blocks.push_back({block, alignment});
+    m_overflow_bytes += size + alignment;
+    return block;
+}
+
+void FrameArena::reset() {
+    if (!m_overflow_blocks.empty()) {
+        // Size the block for what the frame actually needed, the next one will most likely need as much
+        const size_t required = m_offset + m_overflow_bytes;
+        free_overflow_blocks();
+
+        ::operator delete(m_memory, std::align_val_t{alignof(std::max_align_t)});
+        m_capacity = std::bit_ceil(required);
+        m_memory = static_cast<std::byte*>(::operator new(m_capacity, std::align_val_t{alignof(std::max_align_t)}));
+    }
+    m_offset = 0;
+
+    for (uint32_t i = 0; i < m_thread_count; i++) {
+        m_thread_arenas[i].reset();
+    }
+}
+
+void FrameArena::free_overflow_blocks() {
+    for (const auto& [block, alignment] : m_overflow_blocks) {
+        ::operator delete(block, std::align_val_t{alignment});
+    }
+    m_overflow_blocks.clear();
+    m_overflow_bytes = 0;
+}
+
+size_t FrameArena::used() const {
+    size_t used = m_offset + m_overflow_bytes;
+    for (uint32_t i = 0; i < m_thread_count; i++) {
+        used += m_thread_arenas[i].used();
+    }
+    return used;
+}
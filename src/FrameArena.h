@@ -0,0 +1,97 @@
+#ifndef PORTFOLIO_FRAMEARENA_H
+#define PORTFOLIO_FRAMEARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for data that lives for one frame. Nothing is freed individually, reset() rewinds the whole arena
+// once the frame's fence has signalled. Allocations that don't fit go to the heap and are counted, the next reset
+// grows the block so a steady state frame never leaves it.
+// One arena is only ever touched by one thread, jobs allocate from their thread's sub-arena instead
+class FrameArena {
+public:
+    FrameArena() = default;
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+    ~FrameArena() { destroy(); }
+
+    void init(size_t capacity, uint32_t thread_count = 0, size_t thread_capacity = 0);
+    void destroy();
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    template<typename T>
+    T* allocate_array(size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "Arena memory is never destroyed");
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+    // Also resets every sub-arena, so no job of this frame may still be running
+    void reset();
+
+    FrameArena& thread_arena(uint32_t thread_index) { return m_thread_arenas[thread_index]; }
+    uint32_t thread_count() const { return m_thread_count; }
+
+    // Bytes handed out since the last reset, sub-arenas included
+    size_t used() const;
+    size_t capacity() const { return m_capacity; }
+    // Heap allocations since the last reset because the block was full
+    uint32_t overflow_count() const { return static_cast<uint32_t>(m_overflow_blocks.size()); }
+
+private:
+    void free_overflow_blocks();
+
+    std::byte* m_memory = nullptr;
+    size_t m_capacity = 0;
+    size_t m_offset = 0;
+    // Pointer and alignment, the aligned delete needs it back
+    std::vector<std::pair<void*, size_t>> m_overflow_blocks;
+    size_t m_overflow_bytes = 0;
+    std::unique_ptr<FrameArena[]> m_thread_arenas;
+    uint32_t m_thread_count = 0;
+};
+
+// std allocator over a FrameArena. deallocate does nothing, the memory comes back with the arena's reset.
+// Without an arena it falls back to the global heap, so containers can be arena backed only where it matters
+template<typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    // Moving a container moves its storage along with the arena it came from
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator() = default;
+    explicit ArenaAllocator(FrameArena* arena) : m_arena(arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.arena()) {}
+
+    T* allocate(size_t count) {
+        if (m_arena != nullptr) {
+            return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, size_t) {
+        if (m_arena == nullptr) {
+            ::operator delete(pointer);
+        }
+    }
+
+    FrameArena* arena() const { return m_arena; }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return m_arena == other.arena(); }
+
+private:
+    FrameArena* m_arena = nullptr;
+};
+
+template<typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif //PORTFOLIO_FRAMEARENA_H
@@ -0,0 +1,225 @@
+#include "FrameCapture.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr uint32_t CAPTURE_MAGIC = 0x50414353; // "SCAP"
+    constexpr uint32_t CAPTURE_VERSION = 2;
+
+    template<typename T>
+    void write_value(std::ofstream& file, const T& value) {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    bool read_value(std::ifstream& file, T& value) {
+        file.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return static_cast<bool>(file);
+    }
+}
+
+CaptureWriter::~CaptureWriter() {
+    close();
+}
+
+bool CaptureWriter::open(const std::string& file_path, size_t inputs_size, ParameterBlocks blocks) {
+    close();
+    m_file.open(file_path, std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        std::cerr << "Failed to open capture " << file_path << " for writing" << std::endl;
+        return false;
+    }
+
+    m_inputs_size = inputs_size;
+    m_frame_count = 0;
+    // Empty, so the first record carries every block
+    m_last_blocks.assign(blocks.size(), {});
+    write_value(m_file, CAPTURE_MAGIC);
+    write_value(m_file, CAPTURE_VERSION);
+    write_value(m_file, static_cast<uint32_t>(inputs_size));
+    write_value(m_file, static_cast<uint32_t>(blocks.size()));
+    for (const std::span<std::byte>& block : blocks) {
+        write_value(m_file, static_cast<uint32_t>(block.size()));
+    }
+    write_value(m_file, m_frame_count);
+    std::cout << "Capturing frames to " << file_path << std::endl;
+    return true;
+}
+
+void CaptureWriter::write_frame(const void* inputs, ParameterBlocks blocks) {
+    if (!m_file.is_open()) {
+        return;
+    }
+
+    m_file.write(static_cast<const char*>(inputs), static_cast<std::streamsize>(m_inputs_size));
+    uint32_t changed_count = 0;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        changed_count += std::ranges::equal(blocks[i], m_last_blocks[i]) ? 0 : 1;
+    }
+    write_value(m_file, changed_count);
+    for (size_t i = 0; i < blocks.size(); i++) {
+        if (std::ranges::equal(blocks[i], m_last_blocks[i])) {
+            continue;
+        }
+        write_value(m_file, static_cast<uint32_t>(i));
+        m_file.write(reinterpret_cast<const char*>(blocks[i].data()), static_cast<std::streamsize>(blocks[i].size()));
+        m_last_blocks[i].assign(blocks[i].begin(), blocks[i].end());
+    }
+    m_frame_count++;
+}
+
+void CaptureWriter::close() {
+    if (!m_file.is_open()) {
+        return;
+    }
+    // Frame count sits right after the block sizes
+    m_file.seekp(static_cast<std::streamoff>(sizeof(uint32_t) * (4 + m_last_blocks.size())));
+    write_value(m_file, m_frame_count);
+    m_file.close();
+    std::cout << "Capture closed after " << m_frame_count << " frames" << std::endl;
+}
+
+bool CaptureReader::open(const std::string& file_path, size_t inputs_size, ParameterBlocks blocks) {
+    m_file.open(file_path, std::ios::binary);
+    if (!m_file.is_open()) {
+        std::cerr << "Failed to open capture " << file_path << std::endl;
+        return false;
+    }
+
+    uint32_t header[4] = {};
+    m_file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!m_file || header[0] != CAPTURE_MAGIC || header[1] != CAPTURE_VERSION) {
+        std::cerr << file_path << " is not a capture this build can read" << std::endl;
+        m_file.close();
+        return false;
+    }
+    if (header[2] != inputs_size || header[3] != blocks.size()) {
+        std::cerr << file_path << " was captured by a build with different frame inputs or effects" << std::endl;
+        m_file.close();
+        return false;
+    }
+    for (const std::span<std::byte>& block : blocks) {
+        uint32_t size = 0;
+        if (!read_value(m_file, size) || size != block.size()) {
+            std::cerr << file_path << " was captured with different effect parameters" << std::endl;
+            m_file.close();
+            return false;
+        }
+    }
+    read_value(m_file, m_frame_count);
+
+    m_inputs_size = inputs_size;
+    m_frames_read = 0;
+    std::cout << "Replaying " << file_path << ", " << m_frame_count << " frames" << std::endl;
+    return true;
+}
+
+bool CaptureReader::read_frame(void* inputs, ParameterBlocks blocks) {
+    if (!m_file.is_open() || (m_frame_count > 0 && m_frames_read == m_frame_count)) {
+        return false;
+    }
+
+    // Read whole before anything is copied, a record cut short by a crash while capturing leaves the state as it was
+    m_record.resize(m_inputs_size);
+    m_file.read(reinterpret_cast<char*>(m_record.data()), static_cast<std::streamsize>(m_inputs_size));
+    uint32_t changed_count = 0;
+    if (!read_value(m_file, changed_count) || changed_count > blocks.size()) {
+        return false;
+    }
+    m_changed_blocks.clear();
+    for (uint32_t i = 0; i < changed_count; i++) {
+        uint32_t index = 0;
+        if (!read_value(m_file, index) || index >= blocks.size()) {
+            return false;
+        }
+        const size_t offset = m_record.size();
+        m_record.resize(offset + blocks[index].size());
+        m_file.read(reinterpret_cast<char*>(m_record.data() + offset), static_cast<std::streamsize>(blocks[index].size()));
+        if (!m_file) {
+            return false;
+        }
+        m_changed_blocks.push_back(index);
+    }
+
+    memcpy(inputs, m_record.data(), m_inputs_size);
+    size_t offset = m_inputs_size;
+    for (const uint32_t index : m_changed_blocks) {
+        memcpy(blocks[index].data(), m_record.data() + offset, blocks[index].size());
+        offset += blocks[index].size();
+    }
+    m_frames_read++;
+    return true;
+}
+
+FrameTiming& FrameTimingLog::frame(uint64_t frame_number) {
+    if (frame_number >= m_frames.size()) {
+        m_frames.resize(frame_number + 1);
+    }
+    return m_frames[frame_number];
+}
+
+bool FrameTimingLog::write_csv(const std::string& file_path) const {
+    std::ofstream file(file_path, std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to write frame timings to " << file_path << std::endl;
+        return false;
+    }
+
+    // Unmeasured times are left empty rather than written as a number someone might average
+    auto write_time = [&file](float ms) {
+        file << ',';
+        if (ms >= 0.0f) {
+            file << ms;
+        }
+    };
+    file << "frame,main_thread_ms,scene_update_ms,render_thread_ms,graphics_gpu_ms,background_gpu_ms,depth_prepass_gpu_ms,geometry_gpu_ms,draw_calls,triangles\n";
+    for (size_t i = 0; i < m_frames.size(); i++) {
+        const FrameTiming& timing = m_frames[i];
+        file << i;
+        write_time(timing.main_thread_ms);
+        write_time(timing.scene_update_ms);
+        write_time(timing.render_thread_ms);
+        write_time(timing.graphics_gpu_ms);
+        write_time(timing.background_gpu_ms);
+        write_time(timing.depth_prepass_gpu_ms);
+        write_time(timing.geometry_gpu_ms);
+        file << ',' << timing.draw_call_count << ',' << timing.triangle_count << '\n';
+    }
+    std::cout << "Frame timings written to " << file_path << std::endl;
+    return true;
+}
+
+void FrameTimingLog::print_summary() const {
+    auto summarize = [this](const char* name, float FrameTiming::* field) {
+        std::vector<float> times;
+        for (const FrameTiming& timing : m_frames) {
+            if (timing.*field >= 0.0f) {
+                times.push_back(timing.*field);
+            }
+        }
+        if (times.empty()) {
+            return;
+        }
+        std::ranges::sort(times);
+        double sum = 0.0;
+        for (const float time : times) {
+            sum += time;
+        }
+        char line[128];
+        snprintf(line, sizeof(line), "%-16s mean %8.3f  median %8.3f  p95 %8.3f ms", name, sum / static_cast<double>(times.size()),
+            times[times.size() / 2], times[std::min(times.size() - 1, times.size() * 95 / 100)]);
+        std::cout << line << std::endl;
+    };
+
+    std::cout << m_frames.size() << " frames replayed" << std::endl;
+    summarize("main thread", &FrameTiming::main_thread_ms);
+    summarize("scene update", &FrameTiming::scene_update_ms);
+    summarize("render thread", &FrameTiming::render_thread_ms);
+    summarize("graphics gpu", &FrameTiming::graphics_gpu_ms);
+    summarize("background gpu", &FrameTiming::background_gpu_ms);
+    summarize("depth prepass gpu", &FrameTiming::depth_prepass_gpu_ms);
+    summarize("geometry gpu", &FrameTiming::geometry_gpu_ms);
+}
@@ -0,0 +1,82 @@
+#ifndef PORTFOLIO_FRAME_CAPTURE_H
+#define PORTFOLIO_FRAME_CAPTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+// Byte ranges the UI edits in place, a writer only ever reads them
+using ParameterBlocks = std::span<const std::span<std::byte>>;
+
+// Capture layout: magic, version, inputs size, block count, each block's size, frame count, then one record per
+// frame. A record is the frame's fixed size inputs, the number of blocks that changed since the record before and
+// for each of those its index and bytes. Blocks are whatever state the UI edits in place, numbered in the order the
+// caller lists them, which has to come out the same on replay
+class CaptureWriter {
+public:
+    ~CaptureWriter();
+
+    bool open(const std::string& file_path, size_t inputs_size, ParameterBlocks blocks);
+    // Same blocks in the same order as open()
+    void write_frame(const void* inputs, ParameterBlocks blocks);
+    // Fills in the frame count, a capture that was never closed still replays up to its last whole record
+    void close();
+    bool is_open() const { return m_file.is_open(); }
+    uint32_t frame_count() const { return m_frame_count; }
+
+private:
+    std::ofstream m_file;
+    size_t m_inputs_size = 0;
+    std::vector<std::vector<std::byte>> m_last_blocks;
+    uint32_t m_frame_count = 0;
+};
+
+class CaptureReader {
+public:
+    // Fails when the capture was made with a different inputs layout or different blocks
+    bool open(const std::string& file_path, size_t inputs_size, ParameterBlocks blocks);
+    // Copies the next frame's inputs and changed blocks into place, false once every frame was read
+    bool read_frame(void* inputs, ParameterBlocks blocks);
+    // Zero for a capture that was never closed
+    uint32_t frame_count() const { return m_frame_count; }
+
+private:
+    std::ifstream m_file;
+    size_t m_inputs_size = 0;
+    uint32_t m_frame_count = 0;
+    uint32_t m_frames_read = 0;
+    // The record being read, inputs then changed blocks back to back, kept to spare an allocation per frame
+    std::vector<std::byte> m_record;
+    std::vector<uint32_t> m_changed_blocks;
+};
+
+// Milliseconds, negative where nothing was measured, GPU times of the last frames in flight are never read back
+struct FrameTiming {
+    float main_thread_ms = -1.0f;
+    float scene_update_ms = -1.0f;
+    float render_thread_ms = -1.0f;
+    float graphics_gpu_ms = -1.0f;
+    float background_gpu_ms = -1.0f;
+    float depth_prepass_gpu_ms = -1.0f;
+    float geometry_gpu_ms = -1.0f;
+    int draw_call_count = 0;
+    int triangle_count = 0;
+};
+
+// Timings of a replay by frame number, so two builds replaying the same capture line up row for row
+class FrameTimingLog {
+public:
+    FrameTiming& frame(uint64_t frame_number);
+    bool write_csv(const std::string& file_path) const;
+    // Mean, median and 95th percentile of each time
+    void print_summary() const;
+    size_t frame_count() const { return m_frames.size(); }
+
+private:
+    std::vector<FrameTiming> m_frames;
+};
+
+#endif //PORTFOLIO_FRAME_CAPTURE_H
@@ -0,0 +1,243 @@
+#include "FrameReadback.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+
+#include "Initializers.h"
+
+namespace {
+    // RGBA16F, the draw image's format
+    constexpr VkDeviceSize TEXEL_SIZE = 8;
+}
+
+bool FrameReadback::init(VkDevice device, VmaAllocator allocator, const std::string& directory, ImageFileFormat format, uint32_t buffer_count, uint32_t worker_count) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cerr << "Failed to create frame output directory " << directory << ": " << error.message() << std::endl;
+        return false;
+    }
+
+    m_device = device;
+    m_allocator = allocator;
+    m_directory = directory;
+    m_format = format;
+
+    VkSemaphoreTypeCreateInfo timeline_info = {};
+    timeline_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timeline_info.pNext = nullptr;
+    timeline_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timeline_info.initialValue = 0;
+    VkSemaphoreCreateInfo semaphore_info = init::semaphore_create_info();
+    semaphore_info.pNext = &timeline_info;
+    VK_CHECK(vkCreateSemaphore(m_device, &semaphore_info, nullptr, &m_timeline));
+    m_timeline_value = 0;
+
+    // Buffers are created on first use, sized for the frame that first needs them
+    m_slots.assign(std::max(buffer_count, 1u), {});
+    m_stopping = false;
+    for (uint32_t i = 0; i < std::max(worker_count, 1u); i++) {
+        m_workers.emplace_back(&FrameReadback::worker_main, this);
+    }
+    std::cout << "Frame readback writing " << image_file_extension(format) << " to " << directory << " with " << m_slots.size()
+              << " buffers and " << m_workers.size() << " workers" << std::endl;
+    return true;
+}
+
+void FrameReadback::destroy() {
+    if (!enabled()) {
+        return;
+    }
+
+    // Every copy is done once the device is idle, the workers drain the queue before they stop
+    poll();
+    {
+        std::scoped_lock lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_available.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+
+    for (Slot& slot : m_slots) {
+        if (slot.buffer.buffer != VK_NULL_HANDLE) {
+            vmaDestroyBuffer(m_allocator, slot.buffer.buffer, slot.buffer.allocation);
+        }
+    }
+    m_slots.clear();
+    vkDestroySemaphore(m_device, m_timeline, nullptr);
+    m_timeline = VK_NULL_HANDLE;
+
+    const double seconds = m_frames_written > 1 ? std::chrono::duration<double>(m_last_write - m_first_write).count() : 0.0;
+    std::cout << "Frame readback wrote " << m_frames_written << " frames";
+    if (seconds > 0.0) {
+        std::cout << " at " << static_cast<double>(m_frames_written - 1) / seconds << " fps";
+    }
+    std::cout << ", dropped " << m_frames_dropped << std::endl;
+}
+
+bool FrameReadback::record_copy(VkCommandBuffer cmd, VkImage image, VkExtent2D extent, uint64_t frame_number) {
+    Slot* slot = nullptr;
+    {
+        std::scoped_lock lock(m_mutex);
+        const auto free_slot = std::ranges::find(m_slots, SlotState::Free, &Slot::state);
+        if (free_slot == m_slots.end()) {
+            m_frames_dropped++;
+            return false;
+        }
+        slot = &*free_slot;
+        // Claimed here, so a worker freeing another slot meanwhile can't hand this one out twice
+        slot->state = SlotState::Copying;
+    }
+
+    // A free slot is out of the GPU's and the workers' hands, its buffer can be replaced right away
+    const VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * TEXEL_SIZE;
+    if (slot->capacity < size) {
+        if (slot->buffer.buffer != VK_NULL_HANDLE) {
+            vmaDestroyBuffer(m_allocator, slot->buffer.buffer, slot->buffer.allocation);
+        }
+        VkBufferCreateInfo buffer_info = {};
+        buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_info.pNext = nullptr;
+        buffer_info.size = size;
+        buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+        // Read once by the CPU, cached host memory makes that read a lot faster where it's offered
+        VmaAllocationCreateInfo alloc_info = {};
+        alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+        alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+        VK_CHECK(vmaCreateBuffer(m_allocator, &buffer_info, &alloc_info, &slot->buffer.buffer, &slot->buffer.allocation, &slot->buffer.info));
+        slot->capacity = size;
+    }
+
+    VkBufferImageCopy region = {};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->buffer.buffer, 1, &region);
+
+    // The semaphore signal makes the copy available to the device, this carries it on to the host
+    VkMemoryBarrier2 host_barrier = {};
+    host_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    host_barrier.pNext = nullptr;
+    host_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    host_barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    host_barrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    host_barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+    VkDependencyInfo dependency_info = {};
+    dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependency_info.pNext = nullptr;
+    dependency_info.memoryBarrierCount = 1;
+    dependency_info.pMemoryBarriers = &host_barrier;
+    vkCmdPipelineBarrier2(cmd, &dependency_info);
+
+    slot->extent = extent;
+    slot->frame_number = frame_number;
+    slot->timeline_value = ++m_timeline_value;
+    return true;
+}
+
+VkSemaphoreSubmitInfo FrameReadback::signal_info() const {
+    VkSemaphoreSubmitInfo info = init::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_timeline);
+    info.value = m_timeline_value;
+    return info;
+}
+
+void FrameReadback::poll() {
+    uint64_t completed = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(m_device, m_timeline, &completed));
+
+    size_t queued = 0;
+    {
+        std::scoped_lock lock(m_mutex);
+        // Oldest first, so frames mostly land on disk in order
+        std::vector<uint32_t> finished;
+        for (uint32_t i = 0; i < m_slots.size(); i++) {
+            if (m_slots[i].state == SlotState::Copying && m_slots[i].timeline_value <= completed) {
+                finished.push_back(i);
+            }
+        }
+        std::ranges::sort(finished, {}, [this](uint32_t i) { return m_slots[i].timeline_value; });
+        for (const uint32_t i : finished) {
+            m_slots[i].state = SlotState::Writing;
+            m_queue.push_back(i);
+        }
+        queued = finished.size();
+    }
+    if (queued > 0) {
+        m_work_available.notify_all();
+    }
+}
+
+ReadbackStats FrameReadback::stats() {
+    std::scoped_lock lock(m_mutex);
+    const Clock::time_point second_ago = Clock::now() - std::chrono::seconds(1);
+    while (!m_recent_writes.empty() && m_recent_writes.front() < second_ago) {
+        m_recent_writes.pop_front();
+    }
+
+    ReadbackStats stats = {};
+    stats.frames_per_second = static_cast<float>(m_recent_writes.size());
+    stats.frames_written = m_frames_written;
+    stats.frames_dropped = m_frames_dropped;
+    stats.frames_pending = static_cast<uint32_t>(std::ranges::count_if(m_slots, [](const Slot& slot) { return slot.state != SlotState::Free; }));
+    return stats;
+}
+
+void FrameReadback::worker_main() {
+    while (true) {
+        uint32_t index = 0;
+        {
+            std::unique_lock lock(m_mutex);
+            m_work_available.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;
+            }
+            index = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        // Nobody else touches a slot while it's being written
+        write_slot(m_slots[index]);
+
+        std::scoped_lock lock(m_mutex);
+        m_slots[index].state = SlotState::Free;
+        const Clock::time_point now = Clock::now();
+        if (m_frames_written == 0) {
+            m_first_write = now;
+        }
+        m_last_write = now;
+        m_frames_written++;
+        m_recent_writes.push_back(now);
+        // Only stats() trims this, keep it from growing without bound if nobody asks
+        if (m_recent_writes.size() > 4096) {
+            m_recent_writes.pop_front();
+        }
+    }
+}
+
+void FrameReadback::write_slot(Slot& slot) {
+    // A no-op on host coherent memory
+    VK_CHECK(vmaInvalidateAllocation(m_allocator, slot.buffer.allocation, 0, VK_WHOLE_SIZE));
+
+    char file_name[96];
+    if (m_format == ImageFileFormat::Raw) {
+        std::snprintf(file_name, sizeof(file_name), "frame_%06llu_%ux%u_rgba16f.raw", static_cast<unsigned long long>(slot.frame_number),
+            slot.extent.width, slot.extent.height);
+    } else {
+        std::snprintf(file_name, sizeof(file_name), "frame_%06llu.%s", static_cast<unsigned long long>(slot.frame_number), image_file_extension(m_format));
+    }
+
+    const HalfImage image = {static_cast<const std::byte*>(slot.buffer.info.pMappedData), slot.extent.width, slot.extent.height,
+        static_cast<size_t>(slot.extent.width) * TEXEL_SIZE};
+    write_image((std::filesystem::path(m_directory) / file_name).string(), m_format, image);
+}
@@ -0,0 +1,88 @@
+#ifndef PORTFOLIO_FRAMEREADBACK_H
+#define PORTFOLIO_FRAMEREADBACK_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ImageWriter.h"
+#include "Types.h"
+
+struct ReadbackStats {
+    // Frames written to disk over the last second
+    float frames_per_second;
+    uint64_t frames_written;
+    // Frames skipped because every readback buffer was still being copied into or encoded
+    uint64_t frames_dropped;
+    uint32_t frames_pending;
+};
+
+// Copies frames into a ring of host visible buffers and writes them out on worker threads, the render thread never
+// waits on either. Each copy rides along with the frame's own submit and signals a timeline semaphore, poll() checks
+// that without blocking and hands finished copies to the workers. A buffer goes back into the ring once its frame is
+// on disk, when none is free the frame is dropped and counted rather than stalling the frame
+class FrameReadback {
+public:
+    // Frames land in directory as frame_<number>.<format>, which is created if needed
+    bool init(VkDevice device, VmaAllocator allocator, const std::string& directory, ImageFileFormat format, uint32_t buffer_count, uint32_t worker_count);
+    // Device has to be idle. Waits for the workers to write every frame already copied
+    void destroy();
+    bool enabled() const { return m_timeline != VK_NULL_HANDLE; }
+
+    // Records a copy of the top left extent of an RGBA16F image in TRANSFER_SRC_OPTIMAL. Returns false, recording
+    // nothing, when no buffer is free. After a true the submit carrying cmd has to include signal_info()
+    bool record_copy(VkCommandBuffer cmd, VkImage image, VkExtent2D extent, uint64_t frame_number);
+    VkSemaphoreSubmitInfo signal_info() const;
+    // Hands every copy the GPU has finished to the workers
+    void poll();
+    ReadbackStats stats();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class SlotState {
+        Free,
+        Copying,
+        Writing,
+    };
+
+    struct Slot {
+        AllocatedBuffer buffer = {};
+        VkDeviceSize capacity = 0;
+        VkExtent2D extent = {};
+        uint64_t frame_number = 0;
+        // Timeline value the copy's submit signals
+        uint64_t timeline_value = 0;
+        SlotState state = SlotState::Free;
+    };
+
+    void worker_main();
+    void write_slot(Slot& slot);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VmaAllocator m_allocator = VK_NULL_HANDLE;
+    std::string m_directory;
+    ImageFileFormat m_format = ImageFileFormat::Png;
+    VkSemaphore m_timeline = VK_NULL_HANDLE;
+    uint64_t m_timeline_value = 0;
+
+    // Slot states and everything below are shared with the workers
+    std::mutex m_mutex;
+    std::condition_variable m_work_available;
+    std::vector<Slot> m_slots;
+    std::deque<uint32_t> m_queue;
+    std::vector<std::thread> m_workers;
+    bool m_stopping = false;
+    uint64_t m_frames_written = 0;
+    uint64_t m_frames_dropped = 0;
+    Clock::time_point m_first_write = {};
+    Clock::time_point m_last_write = {};
+    std::deque<Clock::time_point> m_recent_writes;
+};
+
+#endif //PORTFOLIO_FRAMEREADBACK_H
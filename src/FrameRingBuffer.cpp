@@ -0,0 +1,87 @@
+#include "FrameRingBuffer.h"
+
+#include <algorithm>
+#include <bit>
+#include <iostream>
+
+void FrameRingBuffer::init(VkDevice device, VmaAllocator allocator, VkDeviceSize capacity, VkDeviceSize alignment, uint32_t frame_slots) {
+    m_device = device;
+    m_allocator = allocator;
+    m_alignment = alignment;
+    m_frame_ends.assign(frame_slots, 0);
+    create_buffer(capacity);
+}
+
+void FrameRingBuffer::destroy() {
+    if (m_buffer.buffer != VK_NULL_HANDLE) {
+        vmaDestroyBuffer(m_allocator, m_buffer.buffer, m_buffer.allocation);
+    }
+    m_buffer = {};
+    m_address = 0;
+    m_capacity = 0;
+}
+
+void FrameRingBuffer::create_buffer(VkDeviceSize capacity) {
+    VkBufferCreateInfo buffer_info = {};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.pNext = nullptr;
+    buffer_info.size = capacity;
+    buffer_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+    // Written once by the CPU and read once by the GPU, device local host visible memory is the best fit where it exists
+    VmaAllocationCreateInfo alloc_info = {};
+    alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+    VK_CHECK(vmaCreateBuffer(m_allocator, &buffer_info, &alloc_info, &m_buffer.buffer, &m_buffer.allocation, &m_buffer.info));
+
+    VkBufferDeviceAddressInfo address_info = {.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, .buffer = m_buffer.buffer};
+    m_address = vkGetBufferDeviceAddress(m_device, &address_info);
+    m_capacity = capacity;
+
+    m_head = 0;
+    m_tail = 0;
+    m_frame_start = 0;
+    std::ranges::fill(m_frame_ends, 0);
+}
+
+void FrameRingBuffer::begin_frame(uint32_t frame_slot) {
+    // Frames retire in submission order, whatever this slot allocated last time is the newest data the GPU is done with
+    m_tail = std::max(m_tail, m_frame_ends[frame_slot]);
+    m_frame_start = m_head;
+}
+
+void FrameRingBuffer::end_frame(uint32_t frame_slot) {
+    m_frame_ends[frame_slot] = m_head;
+    // A no-op on host coherent memory. Only this frame's bytes changed, but the range may wrap, flushing it all is simpler
+    if (m_head != m_frame_start) {
+        VK_CHECK(vmaFlushAllocation(m_allocator, m_buffer.allocation, 0, VK_WHOLE_SIZE));
+    }
+}
+
+std::optional<RingAllocation> FrameRingBuffer::allocate(VkDeviceSize size) {
+    uint64_t start = (m_head + m_alignment - 1) / m_alignment * m_alignment;
+    const uint64_t position = start % m_capacity;
+    // Allocations never straddle the end of the buffer, the remainder is skipped instead
+    if (position + size > m_capacity) {
+        start += m_capacity - position;
+    }
+    if (start + size - m_tail > m_capacity) {
+        return std::nullopt;
+    }
+
+    m_head = start + size;
+    const VkDeviceSize offset = start % m_capacity;
+    return RingAllocation{m_buffer.buffer, offset, m_address + offset, static_cast<std::byte*>(m_buffer.info.pMappedData) + offset};
+}
+
+void FrameRingBuffer::grow(VkDeviceSize min_size, DeletionQueue& retired) {
+    // end_frame only flushes the new buffer, what this frame already wrote into the old one goes out now
+    VK_CHECK(vmaFlushAllocation(m_allocator, m_buffer.allocation, 0, VK_WHOLE_SIZE));
+    retired.push_function([allocator = m_allocator, buffer = m_buffer]() {
+        vmaDestroyBuffer(allocator, buffer.buffer, buffer.allocation);
+    });
+
+    const VkDeviceSize capacity = std::bit_ceil(std::max(m_capacity * 2, m_head - m_tail + min_size + m_alignment));
+    std::cout << "Frame ring buffer grown to " << capacity / 1024 << " KB" << std::endl;
+    create_buffer(capacity);
+}
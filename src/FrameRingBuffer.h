@@ -0,0 +1,67 @@
+#ifndef PORTFOLIO_FRAMERINGBUFFER_H
+#define PORTFOLIO_FRAMERINGBUFFER_H
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+#include "Types.h"
+
+struct RingAllocation {
+    VkBuffer buffer;
+    // For dynamic offsets and descriptor writes
+    VkDeviceSize offset;
+    VkDeviceAddress address;
+    void* data;
+};
+
+// One persistently mapped buffer that every frame sub-allocates its uniform and storage data from. The head only
+// moves forward and wraps, a frame's range is handed back once that frame slot's fence has been waited on, so
+// steady state frames make no VMA calls. Data is reached through dynamic offsets or buffer device addresses
+class FrameRingBuffer {
+public:
+    void init(VkDevice device, VmaAllocator allocator, VkDeviceSize capacity, VkDeviceSize alignment, uint32_t frame_slots);
+    void destroy();
+
+    // Call after waiting on the slot's fence, everything the slot allocated last time is free again
+    void begin_frame(uint32_t frame_slot);
+    // Records where the slot's allocations end and makes them visible to the device
+    void end_frame(uint32_t frame_slot);
+
+    std::optional<RingAllocation> allocate(VkDeviceSize size);
+    template<typename T>
+    std::optional<RingAllocation> push(const T& value) {
+        std::optional<RingAllocation> allocation = allocate(sizeof(T));
+        if (allocation) {
+            memcpy(allocation->data, &value, sizeof(T));
+        }
+        return allocation;
+    }
+    // Replaces the buffer with one that fits at least min_size on top of what is in use. The old buffer is handed
+    // to retired, allocations already made from it stay valid until that queue is flushed
+    void grow(VkDeviceSize min_size, DeletionQueue& retired);
+
+    VkBuffer buffer() const { return m_buffer.buffer; }
+    VkDeviceSize capacity() const { return m_capacity; }
+    // Bytes allocated since begin_frame, alignment padding included
+    VkDeviceSize frame_bytes() const { return m_head - m_frame_start; }
+
+private:
+    void create_buffer(VkDeviceSize capacity);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VmaAllocator m_allocator = VK_NULL_HANDLE;
+    AllocatedBuffer m_buffer = {};
+    VkDeviceAddress m_address = 0;
+    VkDeviceSize m_capacity = 0;
+    VkDeviceSize m_alignment = 1;
+
+    // Offsets keep counting past the end of the buffer, the position inside it is offset % capacity
+    uint64_t m_head = 0;
+    uint64_t m_tail = 0;
+    uint64_t m_frame_start = 0;
+    std::vector<uint64_t> m_frame_ends;
+};
+
+#endif //PORTFOLIO_FRAMERINGBUFFER_H
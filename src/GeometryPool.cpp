@@ -0,0 +1,336 @@
+#include "GeometryPool.h"
+
+#include <bit>
+
+namespace {
+    constexpr uint32_t MANTISSA_BITS = 3;
+    constexpr uint32_t MANTISSA_VALUE = 1 << MANTISSA_BITS;
+    constexpr uint32_t MANTISSA_MASK = MANTISSA_VALUE - 1;
+
+    // Bin index for a size, rounded up so any node in the bin is guaranteed to fit the request
+    uint32_t size_to_bin_round_up(uint32_t size) {
+        uint32_t exponent = 0;
+        uint32_t mantissa = 0;
+        if (size < MANTISSA_VALUE) {
+            mantissa = size;
+        } else {
+            const uint32_t highest_set_bit = 31 - std::countl_zero(size);
+            const uint32_t mantissa_start_bit = highest_set_bit - MANTISSA_BITS;
+            exponent = mantissa_start_bit + 1;
+            mantissa = (size >> mantissa_start_bit) & MANTISSA_MASK;
+
+            const uint32_t low_bits_mask = (1u << mantissa_start_bit) - 1;
+            if ((size & low_bits_mask) != 0) {
+                mantissa++; // overflow carries into the exponent, which is what we want
+            }
+        }
+        return (exponent << MANTISSA_BITS) + mantissa;
+    }
+
+    // Bin index for a size, rounded down so the node is never advertised as bigger than it is
+    uint32_t size_to_bin_round_down(uint32_t size) {
+        uint32_t exponent = 0;
+        uint32_t mantissa = 0;
+        if (size < MANTISSA_VALUE) {
+            mantissa = size;
+        } else {
+            const uint32_t highest_set_bit = 31 - std::countl_zero(size);
+            const uint32_t mantissa_start_bit = highest_set_bit - MANTISSA_BITS;
+            exponent = mantissa_start_bit + 1;
+            mantissa = (size >> mantissa_start_bit) & MANTISSA_MASK;
+        }
+        return (exponent << MANTISSA_BITS) | mantissa;
+    }
+
+    uint32_t bin_to_size(uint32_t bin) {
+        const uint32_t exponent = bin >> MANTISSA_BITS;
+        const uint32_t mantissa = bin & MANTISSA_MASK;
+        if (exponent == 0) {
+            return mantissa;
+        }
+        return (mantissa | MANTISSA_VALUE) << (exponent - 1);
+    }
+
+    uint32_t find_lowest_set_bit_after(uint32_t mask, uint32_t start_index) {
+        const uint32_t mask_before_start = (1u << start_index) - 1;
+        const uint32_t bits_after = mask & ~mask_before_start;
+        if (bits_after == 0) {
+            return OffsetAllocator::INVALID;
+        }
+        return std::countr_zero(bits_after);
+    }
+}
+
+void OffsetAllocator::init(uint32_t size, uint32_t max_allocations) {
+    m_size = size;
+    m_free_space = 0;
+    m_used_bins_top = 0;
+    for (auto& bin : m_used_bins) {
+        bin = 0;
+    }
+    for (auto& index : m_bin_indices) {
+        index = INVALID;
+    }
+
+    m_nodes.assign(max_allocations, Node{});
+    m_free_nodes.resize(max_allocations);
+    // Popped from the back, so node 0 is handed out first
+    for (uint32_t i = 0; i < max_allocations; i++) {
+        m_free_nodes[i] = max_allocations - i - 1;
+    }
+
+    insert_node_into_bin(size, 0);
+}
+
+OffsetAllocator::Allocation OffsetAllocator::allocate(uint32_t size) {
+    if (size == 0 || m_free_nodes.empty()) {
+        return {};
+    }
+
+    const uint32_t min_bin = size_to_bin_round_up(size);
+    const uint32_t min_top_bin = min_bin >> MANTISSA_BITS;
+    const uint32_t min_leaf_bin = min_bin & MANTISSA_MASK;
+
+    uint32_t top_bin = min_top_bin;
+    uint32_t leaf_bin = INVALID;
+
+    // Try the requested top bin first, then fall back to the next populated one
+    if (m_used_bins_top & (1u << top_bin)) {
+        leaf_bin = find_lowest_set_bit_after(m_used_bins[top_bin], min_leaf_bin);
+    }
+    if (leaf_bin == INVALID) {
+        if (top_bin + 1 >= NUM_TOP_BINS) {
+            return {};
+        }
+        top_bin = find_lowest_set_bit_after(m_used_bins_top, top_bin + 1);
+        if (top_bin == INVALID) {
+            return {};
+        }
+        leaf_bin = std::countr_zero(static_cast<uint32_t>(m_used_bins[top_bin]));
+    }
+
+    const uint32_t bin_index = (top_bin << MANTISSA_BITS) | leaf_bin;
+    const uint32_t node_index = m_bin_indices[bin_index];
+    Node& node = m_nodes[node_index];
+    const uint32_t node_total_size = node.size;
+
+    remove_node_from_bin(node_index);
+    node.size = size;
+    node.used = true;
+
+    // Hand the tail back to the allocator as a new free neighbor
+    const uint32_t remainder = node_total_size - size;
+    if (remainder > 0) {
+        const uint32_t new_node_index = insert_node_into_bin(remainder, node.offset + size);
+        Node& current = m_nodes[node_index];
+        if (current.neighbor_next != INVALID) {
+            m_nodes[current.neighbor_next].neighbor_prev = new_node_index;
+        }
+        m_nodes[new_node_index].neighbor_prev = node_index;
+        m_nodes[new_node_index].neighbor_next = current.neighbor_next;
+        current.neighbor_next = new_node_index;
+    }
+
+    const Node& allocated = m_nodes[node_index];
+    return {allocated.offset, node_index};
+}
+
+void OffsetAllocator::free(Allocation allocation) {
+    if (!allocation.is_valid() || allocation.node == INVALID) {
+        return;
+    }
+
+    const uint32_t node_index = allocation.node;
+    Node& node = m_nodes[node_index];
+    assert(node.used);
+
+    uint32_t offset = node.offset;
+    uint32_t size = node.size;
+
+    // Coalesce with free neighbors on both sides
+    if (node.neighbor_prev != INVALID && !m_nodes[node.neighbor_prev].used) {
+        const uint32_t prev_index = node.neighbor_prev;
+        Node& prev = m_nodes[prev_index];
+        offset = prev.offset;
+        size += prev.size;
+
+        remove_node_from_bin(prev_index);
+        node.neighbor_prev = prev.neighbor_prev;
+        if (node.neighbor_prev != INVALID) {
+            m_nodes[node.neighbor_prev].neighbor_next = node_index;
+        }
+        m_free_nodes.push_back(prev_index);
+    }
+
+    if (node.neighbor_next != INVALID && !m_nodes[node.neighbor_next].used) {
+        const uint32_t next_index = node.neighbor_next;
+        Node& next = m_nodes[next_index];
+        size += next.size;
+
+        remove_node_from_bin(next_index);
+        node.neighbor_next = next.neighbor_next;
+        if (node.neighbor_next != INVALID) {
+            m_nodes[node.neighbor_next].neighbor_prev = node_index;
+        }
+        m_free_nodes.push_back(next_index);
+    }
+
+    const uint32_t neighbor_prev = node.neighbor_prev;
+    const uint32_t neighbor_next = node.neighbor_next;
+    m_free_nodes.push_back(node_index);
+
+    const uint32_t combined_index = insert_node_into_bin(size, offset);
+    m_nodes[combined_index].neighbor_prev = neighbor_prev;
+    m_nodes[combined_index].neighbor_next = neighbor_next;
+    if (neighbor_prev != INVALID) {
+        m_nodes[neighbor_prev].neighbor_next = combined_index;
+    }
+    if (neighbor_next != INVALID) {
+        m_nodes[neighbor_next].neighbor_prev = combined_index;
+    }
+}
+
+uint32_t OffsetAllocator::allocation_size(Allocation allocation) const {
+    if (!allocation.is_valid()) {
+        return 0;
+    }
+    return m_nodes[allocation.node].size;
+}
+
+uint32_t OffsetAllocator::largest_free_region() const {
+    if (m_used_bins_top == 0) {
+        return 0;
+    }
+    const uint32_t top_bin = 31 - std::countl_zero(m_used_bins_top);
+    const uint32_t leaf_bin = 31 - std::countl_zero(static_cast<uint32_t>(m_used_bins[top_bin]));
+    return bin_to_size((top_bin << MANTISSA_BITS) | leaf_bin);
+}
+
+uint32_t OffsetAllocator::insert_node_into_bin(uint32_t size, uint32_t offset) {
+    const uint32_t bin_index = size_to_bin_round_down(size);
+    const uint32_t top_bin = bin_index >> MANTISSA_BITS;
+    const uint32_t leaf_bin = bin_index & MANTISSA_MASK;
+
+    if (m_bin_indices[bin_index] == INVALID) {
+        m_used_bins[top_bin] |= 1u << leaf_bin;
+        m_used_bins_top |= 1u << top_bin;
+    }
+
+    const uint32_t top_node_index = m_bin_indices[bin_index];
+    const uint32_t node_index = m_free_nodes.back();
+    m_free_nodes.pop_back();
+
+    m_nodes[node_index] = Node{.offset = offset, .size = size, .bin_next = top_node_index};
+    if (top_node_index != INVALID) {
+        m_nodes[top_node_index].bin_prev = node_index;
+    }
+    m_bin_indices[bin_index] = node_index;
+
+    m_free_space += size;
+    return node_index;
+}
+
+void OffsetAllocator::remove_node_from_bin(uint32_t node_index) {
+    const Node& node = m_nodes[node_index];
+
+    if (node.bin_prev != INVALID) {
+        m_nodes[node.bin_prev].bin_next = node.bin_next;
+        if (node.bin_next != INVALID) {
+            m_nodes[node.bin_next].bin_prev = node.bin_prev;
+        }
+    } else {
+        // Node is the head of its bin
+        const uint32_t bin_index = size_to_bin_round_down(node.size);
+        const uint32_t top_bin = bin_index >> MANTISSA_BITS;
+        const uint32_t leaf_bin = bin_index & MANTISSA_MASK;
+
+        m_bin_indices[bin_index] = node.bin_next;
+        if (node.bin_next != INVALID) {
+            m_nodes[node.bin_next].bin_prev = INVALID;
+        } else {
+            m_used_bins[top_bin] &= ~(1u << leaf_bin);
+            if (m_used_bins[top_bin] == 0) {
+                m_used_bins_top &= ~(1u << top_bin);
+            }
+        }
+    }
+
+    m_nodes[node_index].bin_prev = INVALID;
+    m_nodes[node_index].bin_next = INVALID;
+    m_free_space -= node.size;
+}
+
+void GeometryPool::init(VkDevice device, VmaAllocator allocator, uint32_t vertex_capacity, uint32_t vertex_stride, uint32_t index_capacity) {
+    m_device = device;
+    m_allocator = allocator;
+    m_vertex_stride = vertex_stride;
+
+    VmaAllocationCreateInfo alloc_info = {};
+    alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    alloc_info.requiredFlags = static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkBufferCreateInfo vertex_info = {};
+    vertex_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    vertex_info.pNext = nullptr;
+    vertex_info.size = static_cast<VkDeviceSize>(vertex_capacity) * vertex_stride;
+    vertex_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    VK_CHECK(vmaCreateBuffer(m_allocator, &vertex_info, &alloc_info, &m_vertex_buffer.buffer, &m_vertex_buffer.allocation, &m_vertex_buffer.info));
+
+    VkBufferCreateInfo index_info = {};
+    index_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    index_info.pNext = nullptr;
+    index_info.size = static_cast<VkDeviceSize>(index_capacity) * sizeof(uint32_t);
+    index_info.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    VK_CHECK(vmaCreateBuffer(m_allocator, &index_info, &alloc_info, &m_index_buffer.buffer, &m_index_buffer.allocation, &m_index_buffer.info));
+
+    VkBufferDeviceAddressInfo address_info = { .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, .buffer = m_vertex_buffer.buffer };
+    m_vertex_buffer_address = vkGetBufferDeviceAddress(m_device, &address_info);
+
+    // Every mesh takes one node from each allocator, plus one spare for the trailing free range
+    constexpr uint32_t max_meshes = 64 * 1024;
+    m_vertex_ranges.init(vertex_capacity, max_meshes + 1);
+    m_index_ranges.init(index_capacity, max_meshes + 1);
+    m_mesh_count = 0;
+}
+
+void GeometryPool::destroy() {
+    vmaDestroyBuffer(m_allocator, m_vertex_buffer.buffer, m_vertex_buffer.allocation);
+    vmaDestroyBuffer(m_allocator, m_index_buffer.buffer, m_index_buffer.allocation);
+    m_vertex_buffer = {};
+    m_index_buffer = {};
+    m_vertex_buffer_address = 0;
+}
+
+OffsetAllocator::Allocation GeometryPool::allocate_vertices(uint32_t count) {
+    return m_vertex_ranges.allocate(count);
+}
+
+OffsetAllocator::Allocation GeometryPool::allocate_indices(uint32_t count) {
+    OffsetAllocator::Allocation allocation = m_index_ranges.allocate(count);
+    if (allocation.is_valid()) {
+        m_mesh_count++;
+    }
+    return allocation;
+}
+
+void GeometryPool::free(OffsetAllocator::Allocation vertices, OffsetAllocator::Allocation indices) {
+    m_vertex_ranges.free(vertices);
+    if (indices.is_valid()) {
+        m_index_ranges.free(indices);
+        m_mesh_count--;
+    }
+}
+
+void GeometryPool::bind_index_buffer(VkCommandBuffer cmd) const {
+    vkCmdBindIndexBuffer(cmd, m_index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+GeometryPoolStats GeometryPool::stats() const {
+    GeometryPoolStats stats = {};
+    stats.vertex_capacity = m_vertex_ranges.capacity();
+    stats.vertices_free = m_vertex_ranges.free_space();
+    stats.index_capacity = m_index_ranges.capacity();
+    stats.indices_free = m_index_ranges.free_space();
+    stats.mesh_count = m_mesh_count;
+    return stats;
+}
@@ -0,0 +1,101 @@
+#ifndef PORTFOLIO_GEOMETRYPOOL_H
+#define PORTFOLIO_GEOMETRYPOOL_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Types.h"
+
+// Two level segregated fit (TLSF) allocator that hands out ranges of an externally owned buffer.
+// Sizes and offsets are in elements, so the same allocator works for vertices and indices.
+// Bins follow a small floating point distribution (3 mantissa bits) which keeps allocate/free O(1).
+class OffsetAllocator {
+public:
+    static constexpr uint32_t INVALID = 0xFFFFFFFF;
+
+    struct Allocation {
+        uint32_t offset = INVALID;
+        uint32_t node = INVALID;
+
+        bool is_valid() const { return offset != INVALID; }
+    };
+
+    void init(uint32_t size, uint32_t max_allocations);
+    Allocation allocate(uint32_t size);
+    void free(Allocation allocation);
+
+    uint32_t allocation_size(Allocation allocation) const;
+    uint32_t free_space() const { return m_free_space; }
+    uint32_t largest_free_region() const;
+    uint32_t capacity() const { return m_size; }
+
+private:
+    static constexpr uint32_t NUM_TOP_BINS = 32;
+    static constexpr uint32_t BINS_PER_LEAF = 8;
+    static constexpr uint32_t NUM_LEAF_BINS = NUM_TOP_BINS * BINS_PER_LEAF;
+
+    struct Node {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        uint32_t bin_prev = INVALID;
+        uint32_t bin_next = INVALID;
+        uint32_t neighbor_prev = INVALID;
+        uint32_t neighbor_next = INVALID;
+        bool used = false;
+    };
+
+    uint32_t insert_node_into_bin(uint32_t size, uint32_t offset);
+    void remove_node_from_bin(uint32_t node_index);
+
+    uint32_t m_size = 0;
+    uint32_t m_free_space = 0;
+    uint32_t m_used_bins_top = 0;
+    uint8_t m_used_bins[NUM_TOP_BINS] = {};
+    uint32_t m_bin_indices[NUM_LEAF_BINS] = {};
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_free_nodes;
+};
+
+struct GeometryPoolStats {
+    uint32_t vertex_capacity;
+    uint32_t vertices_free;
+    uint32_t index_capacity;
+    uint32_t indices_free;
+    uint32_t mesh_count;
+};
+
+// Device local mega-buffers shared by every mesh. Meshes only own ranges in them,
+// so the whole scene can be drawn with a single index buffer bind and one vertex buffer address.
+class GeometryPool {
+public:
+    void init(VkDevice device, VmaAllocator allocator, uint32_t vertex_capacity, uint32_t vertex_stride, uint32_t index_capacity);
+    void destroy();
+
+    OffsetAllocator::Allocation allocate_vertices(uint32_t count);
+    OffsetAllocator::Allocation allocate_indices(uint32_t count);
+    void free(OffsetAllocator::Allocation vertices, OffsetAllocator::Allocation indices);
+
+    void bind_index_buffer(VkCommandBuffer cmd) const;
+
+    VkBuffer vertex_buffer() const { return m_vertex_buffer.buffer; }
+    VkBuffer index_buffer() const { return m_index_buffer.buffer; }
+    VkDeviceAddress vertex_buffer_address() const { return m_vertex_buffer_address; }
+    uint32_t vertex_stride() const { return m_vertex_stride; }
+    GeometryPoolStats stats() const;
+
+private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    VmaAllocator m_allocator = VK_NULL_HANDLE;
+
+    AllocatedBuffer m_vertex_buffer = {};
+    AllocatedBuffer m_index_buffer = {};
+    VkDeviceAddress m_vertex_buffer_address = 0;
+    uint32_t m_vertex_stride = 0;
+    uint32_t m_mesh_count = 0;
+
+    OffsetAllocator m_vertex_ranges;
+    OffsetAllocator m_index_ranges;
+};
+
+#endif //PORTFOLIO_GEOMETRYPOOL_H
@@ -0,0 +1,89 @@
+#include "GpuProfiler.h"
+
+#include <iostream>
+
+#include "Types.h"
+
+void GpuProfiler::init(VkDevice device, float timestamp_period, uint32_t frame_count) {
+    m_device = device;
+    m_timestamp_period_ms = static_cast<double>(timestamp_period) / 1'000'000.0;
+    m_frame_count = frame_count;
+    m_scope_names.assign(frame_count, {});
+    for (std::vector<const char*>& names : m_scope_names) {
+        names.reserve(MAX_SCOPES_PER_FRAME);
+    }
+    m_timestamps.resize(MAX_SCOPES_PER_FRAME * 2);
+    m_results.reserve(MAX_SCOPES_PER_FRAME);
+
+    VkQueryPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    pool_info.pNext = nullptr;
+    pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    pool_info.queryCount = frame_count * MAX_SCOPES_PER_FRAME * 2;
+    VK_CHECK(vkCreateQueryPool(m_device, &pool_info, nullptr, &m_query_pool));
+}
+
+void GpuProfiler::destroy() {
+    vkDestroyQueryPool(m_device, m_query_pool, nullptr);
+    m_query_pool = VK_NULL_HANDLE;
+}
+
+void GpuProfiler::begin_frame(uint32_t frame_slot) {
+    m_frame_slot = frame_slot % m_frame_count;
+    std::vector<const char*>& names = m_scope_names[m_frame_slot];
+    if (names.empty()) {
+        return;
+    }
+
+    const uint32_t first_query = m_frame_slot * MAX_SCOPES_PER_FRAME * 2;
+    const uint32_t query_count = static_cast<uint32_t>(names.size()) * 2;
+    const VkResult result = vkGetQueryPoolResults(m_device, m_query_pool, first_query, query_count,
+        query_count * sizeof(uint64_t), m_timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    // A scope that was begun but never ended leaves its queries unavailable, keep the previous results then
+    if (result == VK_SUCCESS) {
+        m_results.clear();
+        for (size_t i = 0; i < names.size(); i++) {
+            GpuScope scope = {};
+            scope.name = names[i];
+            scope.begin_ms = static_cast<double>(m_timestamps[i * 2]) * m_timestamp_period_ms;
+            scope.end_ms = static_cast<double>(m_timestamps[i * 2 + 1]) * m_timestamp_period_ms;
+            m_results.push_back(scope);
+        }
+    }
+    names.clear();
+}
+
+uint32_t GpuProfiler::begin_scope(VkCommandBuffer cmd, const char* name, VkPipelineStageFlags2 stage) {
+    std::vector<const char*>& names = m_scope_names[m_frame_slot];
+    if (names.size() >= MAX_SCOPES_PER_FRAME) {
+        std::cerr << "GpuProfiler out of scopes, dropping " << name << std::endl;
+        return MAX_SCOPES_PER_FRAME;
+    }
+
+    const uint32_t scope = static_cast<uint32_t>(names.size());
+    const uint32_t query = (m_frame_slot * MAX_SCOPES_PER_FRAME + scope) * 2;
+    names.push_back(name);
+
+    vkCmdResetQueryPool(cmd, m_query_pool, query, 2);
+    vkCmdWriteTimestamp2(cmd, stage, m_query_pool, query);
+    return scope;
+}
+
+void GpuProfiler::end_scope(VkCommandBuffer cmd, uint32_t scope, VkPipelineStageFlags2 stage) {
+    if (scope >= MAX_SCOPES_PER_FRAME) {
+        return;
+    }
+
+    const uint32_t query = (m_frame_slot * MAX_SCOPES_PER_FRAME + scope) * 2 + 1;
+    vkCmdWriteTimestamp2(cmd, stage, m_query_pool, query);
+}
+
+std::optional<GpuScope> GpuProfiler::find(std::string_view name) const {
+    for (const GpuScope& scope : m_results) {
+        if (std::string_view(scope.name) == name) {
+            return scope;
+        }
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,56 @@
+#ifndef PORTFOLIO_GPUPROFILER_H
+#define PORTFOLIO_GPUPROFILER_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+struct GpuScope {
+    // The pointer begin_scope was given, a string literal
+    const char* name;
+    // Milliseconds on the device timeline, only differences between scopes of the same frame mean anything
+    double begin_ms;
+    double end_ms;
+
+    double duration_ms() const { return end_ms - begin_ms; }
+};
+
+// Timestamp queries with one query range per frame in flight. Each scope resets its own pair of queries in the
+// command buffer that writes them, so scopes can be recorded on any queue in any order. Storage is sized at init,
+// a frame's scopes and read back allocate nothing.
+class GpuProfiler {
+public:
+    static constexpr uint32_t MAX_SCOPES_PER_FRAME = 32;
+
+    void init(VkDevice device, float timestamp_period, uint32_t frame_count);
+    void destroy();
+
+    // Reads back what frame_slot recorded the last time it was used, call after waiting on that slot's fence
+    void begin_frame(uint32_t frame_slot);
+    // Only the pointer is kept, results() hands it back, so name has to live as long as the profiler: a string literal
+    uint32_t begin_scope(VkCommandBuffer cmd, const char* name, VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT);
+    void end_scope(VkCommandBuffer cmd, uint32_t scope, VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT);
+
+    // Scopes of the most recently read back frame
+    std::span<const GpuScope> results() const { return m_results; }
+    std::optional<GpuScope> find(std::string_view name) const;
+
+private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueryPool m_query_pool = VK_NULL_HANDLE;
+    double m_timestamp_period_ms = 0.0;
+    uint32_t m_frame_count = 0;
+    uint32_t m_frame_slot = 0;
+
+    // Names recorded per slot, so the read back knows what it got
+    std::vector<std::vector<const char*>> m_scope_names;
+    // Query results of the slot being read back, two per scope
+    std::vector<uint64_t> m_timestamps;
+    std::vector<GpuScope> m_results;
+};
+
+#endif //PORTFOLIO_GPUPROFILER_H
@@ -0,0 +1,53 @@
+#include "ImGuiDrawDataCopy.h"
+
+#include <cstring>
+
+namespace {
+    template<typename T>
+    void copy_vector(ImVector<T>& destination, const ImVector<T>& source) {
+        // resize() keeps the capacity, so this stops allocating once the largest frame went through
+        destination.resize(source.Size);
+        if (source.Size > 0) {
+            memcpy(destination.Data, source.Data, source.size_in_bytes());
+        }
+    }
+}
+
+ImGuiDrawDataCopy::~ImGuiDrawDataCopy() {
+    for (ImDrawList* list : m_lists) {
+        IM_DELETE(list);
+    }
+}
+
+void ImGuiDrawDataCopy::copy(const ImDrawData& source) {
+    while (m_lists.size() < static_cast<size_t>(source.CmdListsCount)) {
+        m_lists.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+    }
+
+    m_draw_data.CmdLists.resize(source.CmdListsCount);
+    for (int i = 0; i < source.CmdListsCount; i++) {
+        const ImDrawList* source_list = source.CmdLists[i];
+        ImDrawList* list = m_lists[i];
+        // Only what a renderer backend reads, the copies are never drawn into
+        copy_vector(list->CmdBuffer, source_list->CmdBuffer);
+        copy_vector(list->IdxBuffer, source_list->IdxBuffer);
+        copy_vector(list->VtxBuffer, source_list->VtxBuffer);
+        list->Flags = source_list->Flags;
+        // Resolved now, the texture data behind a reference belongs to the thread running ImGui
+        for (ImDrawCmd& command : list->CmdBuffer) {
+            command.TexRef = ImTextureRef(command.GetTexID());
+        }
+        m_draw_data.CmdLists[i] = list;
+    }
+
+    m_draw_data.Valid = source.Valid;
+    m_draw_data.CmdListsCount = source.CmdListsCount;
+    m_draw_data.TotalIdxCount = source.TotalIdxCount;
+    m_draw_data.TotalVtxCount = source.TotalVtxCount;
+    m_draw_data.DisplayPos = source.DisplayPos;
+    m_draw_data.DisplaySize = source.DisplaySize;
+    m_draw_data.FramebufferScale = source.FramebufferScale;
+    m_draw_data.OwnerViewport = source.OwnerViewport;
+    // Texture updates are left to whoever built the frame, they have to happen before it is copied
+    m_draw_data.Textures = nullptr;
+}
@@ -0,0 +1,27 @@
+#ifndef PORTFOLIO_IMGUIDRAWDATACOPY_H
+#define PORTFOLIO_IMGUIDRAWDATACOPY_H
+
+#include <vector>
+
+#include "imgui.h"
+
+// Deep copy of a frame's ImDrawData. ImGui reuses its draw lists on the next NewFrame(), a copy lets another thread
+// render the frame while the next one is being built. Lists are kept between copies and only reallocate when a
+// frame needs more than any before it. Pending texture updates are not carried over, process them before copying
+class ImGuiDrawDataCopy {
+public:
+    ImGuiDrawDataCopy() = default;
+    ImGuiDrawDataCopy(const ImGuiDrawDataCopy&) = delete;
+    ImGuiDrawDataCopy& operator=(const ImGuiDrawDataCopy&) = delete;
+    ~ImGuiDrawDataCopy();
+
+    void copy(const ImDrawData& source);
+    // Invalid until the first copy
+    ImDrawData* draw_data() { return &m_draw_data; }
+
+private:
+    ImDrawData m_draw_data;
+    std::vector<ImDrawList*> m_lists;
+};
+
+#endif //PORTFOLIO_IMGUIDRAWDATACOPY_H
@@ -0,0 +1,283 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <glm/gtc/packing.hpp>
+
+namespace {
+    // Both formats store little endian values, as does every platform we build for
+    template<typename T>
+    void append(std::vector<std::byte>& bytes, const T& value) {
+        const size_t offset = bytes.size();
+        bytes.resize(offset + sizeof(T));
+        memcpy(bytes.data() + offset, &value, sizeof(T));
+    }
+
+    void append(std::vector<std::byte>& bytes, const char* text) {
+        const size_t length = strlen(text) + 1;
+        const size_t offset = bytes.size();
+        bytes.resize(offset + length);
+        memcpy(bytes.data() + offset, text, length);
+    }
+
+    void append_big_endian(std::vector<std::byte>& bytes, uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            bytes.push_back(static_cast<std::byte>(value >> shift));
+        }
+    }
+
+    bool write_file(const std::string& file_path, const std::vector<std::byte>& bytes) {
+        std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open " << file_path << " for writing" << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!file) {
+            std::cerr << "Failed to write " << file_path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    const uint16_t* row_halves(const HalfImage& image, uint32_t y) {
+        return reinterpret_cast<const uint16_t*>(image.pixels + static_cast<size_t>(y) * image.row_pitch);
+    }
+
+    constexpr std::array<uint32_t, 256> CRC_TABLE = []() {
+        std::array<uint32_t, 256> table = {};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }();
+
+    uint32_t crc32(const std::byte* data, size_t size) {
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; i++) {
+            crc = CRC_TABLE[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    uint32_t adler32(const std::byte* data, size_t size) {
+        // 5552 is the most bytes that can be summed before the 32 bit sums could overflow
+        uint32_t a = 1;
+        uint32_t b = 0;
+        while (size > 0) {
+            const size_t count = std::min<size_t>(size, 5552);
+            for (size_t i = 0; i < count; i++) {
+                a += static_cast<uint8_t>(data[i]);
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+            data += count;
+            size -= count;
+        }
+        return (b << 16) | a;
+    }
+
+    void append_png_chunk(std::vector<std::byte>& png, const char (&type)[5], const std::vector<std::byte>& data) {
+        append_big_endian(png, static_cast<uint32_t>(data.size()));
+        const size_t type_offset = png.size();
+        for (int i = 0; i < 4; i++) {
+            png.push_back(static_cast<std::byte>(type[i]));
+        }
+        png.insert(png.end(), data.begin(), data.end());
+        append_big_endian(png, crc32(png.data() + type_offset, png.size() - type_offset));
+    }
+
+    // Every half value's 8 bit UNORM encoding, NaN and negatives go to 0 like they would on the way to the swapchain
+    const std::array<uint8_t, 65536>& half_to_unorm8() {
+        static const std::array<uint8_t, 65536> table = []() {
+            std::array<uint8_t, 65536> values = {};
+            for (uint32_t i = 0; i < 65536; i++) {
+                const float value = glm::unpackHalf1x16(static_cast<uint16_t>(i));
+                values[i] = value > 0.0f ? static_cast<uint8_t>(std::min(value, 1.0f) * 255.0f + 0.5f) : 0;
+            }
+            return values;
+        }();
+        return table;
+    }
+}
+
+const char* image_file_extension(ImageFileFormat format) {
+    switch (format) {
+        case ImageFileFormat::Png: return "png";
+        case ImageFileFormat::Exr: return "exr";
+        case ImageFileFormat::Raw: return "raw";
+    }
+    return "";
+}
+
+bool parse_image_file_format(const std::string& name, ImageFileFormat& format) {
+    for (const ImageFileFormat candidate : {ImageFileFormat::Png, ImageFileFormat::Exr, ImageFileFormat::Raw}) {
+        if (name == image_file_extension(candidate)) {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool write_png(const std::string& file_path, const HalfImage& image) {
+    // Filter type 0 in front of every row, then the row as 8 bit RGBA
+    const size_t row_size = 1 + static_cast<size_t>(image.width) * 4;
+    std::vector<std::byte> scanlines(row_size * image.height);
+    const std::array<uint8_t, 65536>& unorm8 = half_to_unorm8();
+    for (uint32_t y = 0; y < image.height; y++) {
+        const uint16_t* source = row_halves(image, y);
+        std::byte* row = scanlines.data() + y * row_size;
+        row[0] = std::byte{0};
+        for (size_t i = 0; i < static_cast<size_t>(image.width) * 4; i++) {
+            row[1 + i] = static_cast<std::byte>(unorm8[source[i]]);
+        }
+    }
+
+    // zlib header without a preset dictionary, stored blocks of at most 65535 bytes, then the Adler-32 of the data
+    constexpr size_t MAX_STORED_BLOCK = 65535;
+    std::vector<std::byte> zlib;
+    zlib.reserve(scanlines.size() + (scanlines.size() / MAX_STORED_BLOCK + 1) * 5 + 6);
+    zlib.push_back(std::byte{0x78});
+    zlib.push_back(std::byte{0x01});
+    size_t offset = 0;
+    do {
+        const size_t size = std::min(MAX_STORED_BLOCK, scanlines.size() - offset);
+        const bool final_block = offset + size == scanlines.size();
+        zlib.push_back(std::byte{final_block ? uint8_t{1} : uint8_t{0}});
+        append(zlib, static_cast<uint16_t>(size));
+        append(zlib, static_cast<uint16_t>(~size));
+        zlib.insert(zlib.end(), scanlines.begin() + static_cast<std::ptrdiff_t>(offset), scanlines.begin() + static_cast<std::ptrdiff_t>(offset + size));
+        offset += size;
+    } while (offset < scanlines.size());
+    append_big_endian(zlib, adler32(scanlines.data(), scanlines.size()));
+
+    std::vector<std::byte> header;
+    append_big_endian(header, image.width);
+    append_big_endian(header, image.height);
+    // 8 bits per channel, RGBA, deflate, adaptive filtering, no interlacing
+    for (const uint8_t value : {8, 6, 0, 0, 0}) {
+        header.push_back(static_cast<std::byte>(value));
+    }
+
+    std::vector<std::byte> png;
+    png.reserve(zlib.size() + 64);
+    for (const uint8_t value : {0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A}) {
+        png.push_back(static_cast<std::byte>(value));
+    }
+    append_png_chunk(png, "IHDR", header);
+    append_png_chunk(png, "IDAT", zlib);
+    append_png_chunk(png, "IEND", {});
+    return write_file(file_path, png);
+}
+
+bool write_exr(const std::string& file_path, const HalfImage& image) {
+    std::vector<std::byte> exr;
+    append(exr, uint32_t{20000630});
+    // Version 2, single part scanline, short names
+    append(exr, uint32_t{2});
+
+    // Channels have to be listed in alphabetical order, scanlines store them in the same order
+    constexpr const char* CHANNEL_NAMES[] = {"A", "B", "G", "R"};
+    constexpr int CHANNEL_COMPONENTS[] = {3, 2, 1, 0};
+    append(exr, "channels");
+    append(exr, "chlist");
+    append(exr, uint32_t{4 * (2 + 16) + 1});
+    for (const char* name : CHANNEL_NAMES) {
+        append(exr, name);
+        // HALF, not perceptually linear, three reserved bytes, no subsampling
+        append(exr, uint32_t{1});
+        append(exr, uint32_t{0});
+        append(exr, int32_t{1});
+        append(exr, int32_t{1});
+    }
+    exr.push_back(std::byte{0});
+
+    append(exr, "compression");
+    append(exr, "compression");
+    append(exr, uint32_t{1});
+    exr.push_back(std::byte{0});
+
+    const int32_t window[4] = {0, 0, static_cast<int32_t>(image.width) - 1, static_cast<int32_t>(image.height) - 1};
+    for (const char* name : {"dataWindow", "displayWindow"}) {
+        append(exr, name);
+        append(exr, "box2i");
+        append(exr, uint32_t{sizeof(window)});
+        append(exr, window);
+    }
+
+    append(exr, "lineOrder");
+    append(exr, "lineOrder");
+    append(exr, uint32_t{1});
+    exr.push_back(std::byte{0});
+
+    append(exr, "pixelAspectRatio");
+    append(exr, "float");
+    append(exr, uint32_t{4});
+    append(exr, 1.0f);
+
+    append(exr, "screenWindowCenter");
+    append(exr, "v2f");
+    append(exr, uint32_t{8});
+    append(exr, 0.0f);
+    append(exr, 0.0f);
+
+    append(exr, "screenWindowWidth");
+    append(exr, "float");
+    append(exr, uint32_t{4});
+    append(exr, 1.0f);
+    exr.push_back(std::byte{0});
+
+    // One scanline per block without compression: its y, its size, then each channel's row of halves
+    const uint32_t line_size = image.width * 4 * sizeof(uint16_t);
+    const uint64_t first_line = exr.size() + static_cast<uint64_t>(image.height) * sizeof(uint64_t);
+    for (uint32_t y = 0; y < image.height; y++) {
+        append(exr, first_line + static_cast<uint64_t>(y) * (8 + line_size));
+    }
+    exr.resize(first_line + static_cast<size_t>(image.height) * (8 + line_size));
+    std::byte* line = exr.data() + first_line;
+    for (uint32_t y = 0; y < image.height; y++) {
+        const int32_t line_y = static_cast<int32_t>(y);
+        memcpy(line, &line_y, sizeof(line_y));
+        memcpy(line + 4, &line_size, sizeof(line_size));
+        // The header has no alignment, so neither do the lines
+        std::byte* destination = line + 8;
+        const uint16_t* source = row_halves(image, y);
+        for (const int component : CHANNEL_COMPONENTS) {
+            for (uint32_t x = 0; x < image.width; x++) {
+                memcpy(destination, &source[x * 4 + component], sizeof(uint16_t));
+                destination += sizeof(uint16_t);
+            }
+        }
+        line += 8 + line_size;
+    }
+    return write_file(file_path, exr);
+}
+
+bool write_raw(const std::string& file_path, const HalfImage& image) {
+    const size_t row_size = static_cast<size_t>(image.width) * 4 * sizeof(uint16_t);
+    std::vector<std::byte> raw(row_size * image.height);
+    for (uint32_t y = 0; y < image.height; y++) {
+        memcpy(raw.data() + y * row_size, image.pixels + static_cast<size_t>(y) * image.row_pitch, row_size);
+    }
+    return write_file(file_path, raw);
+}
+
+bool write_image(const std::string& file_path, ImageFileFormat format, const HalfImage& image) {
+    switch (format) {
+        case ImageFileFormat::Png: return write_png(file_path, image);
+        case ImageFileFormat::Exr: return write_exr(file_path, image);
+        case ImageFileFormat::Raw: return write_raw(file_path, image);
+    }
+    return false;
+}
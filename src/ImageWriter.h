@@ -0,0 +1,34 @@
+#ifndef PORTFOLIO_IMAGE_WRITER_H
+#define PORTFOLIO_IMAGE_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class ImageFileFormat {
+    Png,
+    Exr,
+    // Pixels exactly as read back, the size and format go in the file name
+    Raw,
+};
+
+// RGBA16F pixels as the draw image holds them, rows row_pitch bytes apart
+struct HalfImage {
+    const std::byte* pixels;
+    uint32_t width;
+    uint32_t height;
+    size_t row_pitch;
+};
+
+const char* image_file_extension(ImageFileFormat format);
+bool parse_image_file_format(const std::string& name, ImageFileFormat& format);
+
+// 8 bit RGBA, clamped the same way a blit to a UNORM swapchain clamps. Deflate blocks are stored uncompressed, the
+// files come out about as big as the pixels but writing one costs little more than the copy
+bool write_png(const std::string& file_path, const HalfImage& image);
+// Uncompressed scanline OpenEXR with half channels, keeps the full range of the draw image
+bool write_exr(const std::string& file_path, const HalfImage& image);
+bool write_raw(const std::string& file_path, const HalfImage& image);
+bool write_image(const std::string& file_path, ImageFileFormat format, const HalfImage& image);
+
+#endif //PORTFOLIO_IMAGE_WRITER_H
@@ -0,0 +1,274 @@
+#include "JobSystem.h"
+
+#include <bit>
+#include <cassert>
+#include <iostream>
+
+namespace {
+    thread_local uint32_t t_worker_index = UINT32_MAX;
+
+    uint32_t xorshift(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+}
+
+WorkStealingQueue::WorkStealingQueue(uint32_t capacity) {
+    const uint32_t size = std::bit_ceil(capacity);
+    m_jobs = std::make_unique<std::atomic<Job*>[]>(size);
+    m_mask = size - 1;
+}
+
+bool WorkStealingQueue::push(Job* job) {
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    const int64_t top = m_top.load(std::memory_order_acquire);
+    if (bottom - top > m_mask) {
+        return false;
+    }
+    m_jobs[bottom & m_mask].store(job, std::memory_order_relaxed);
+    // Publishes the job, a thief that sees the new bottom sees what was written into it
+    m_bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+Job* WorkStealingQueue::pop() {
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    // Orders the bottom store before the top load, a thief racing for the last job sees one or the other
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = m_jobs[bottom & m_mask].load(std::memory_order_relaxed);
+    if (top == bottom) {
+        // Last job, whoever moves top first gets it
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* WorkStealingQueue::steal() {
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+    if (top >= bottom) {
+        return nullptr;
+    }
+
+    Job* job = m_jobs[top & m_mask].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        // Lost to the owner or another thief
+        return nullptr;
+    }
+    return job;
+}
+
+void JobSystem::init(uint32_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    m_thread_count = thread_count;
+    m_running.store(true, std::memory_order_release);
+
+    m_workers.reserve(m_thread_count);
+    for (uint32_t i = 0; i < m_thread_count; i++) {
+        std::unique_ptr<Worker>& worker = m_workers.emplace_back(std::make_unique<Worker>(JOBS_PER_WORKER));
+        worker->jobs = std::make_unique<Job[]>(JOBS_PER_WORKER);
+        worker->random_state = 0x9E3779B9u * (i + 1);
+    }
+
+    t_worker_index = 0;
+    for (uint32_t i = 1; i < m_thread_count; i++) {
+        m_workers[i]->thread = std::thread(&JobSystem::worker_main, this, i);
+    }
+    std::cout << "Job system started with " << m_thread_count << " threads" << std::endl;
+}
+
+void JobSystem::shutdown() {
+    if (!m_running.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    m_signal.fetch_add(1, std::memory_order_release);
+    m_signal.notify_all();
+    for (std::unique_ptr<Worker>& worker : m_workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    m_workers.clear();
+    m_thread_count = 0;
+    t_worker_index = UINT32_MAX;
+}
+
+uint32_t JobSystem::worker_index() {
+    return t_worker_index;
+}
+
+JobSystemStats JobSystem::stats() const {
+    JobSystemStats stats = {};
+    for (const std::unique_ptr<Worker>& worker : m_workers) {
+        stats.jobs_executed += worker->jobs_executed.load(std::memory_order_relaxed);
+        stats.jobs_stolen += worker->jobs_stolen.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+Job* JobSystem::allocate_job() {
+    assert(t_worker_index < m_thread_count && "Jobs can only be scheduled from a worker thread");
+    Worker& worker = *m_workers[t_worker_index];
+    Job* job = &worker.jobs[worker.next_job];
+    worker.next_job = (worker.next_job + 1) % JOBS_PER_WORKER;
+    // The ring wrapped onto a job that hasn't finished yet, help until it has rather than overwrite it
+    while (job->in_flight.load(std::memory_order_acquire)) {
+        if (!execute_one(t_worker_index)) {
+            std::this_thread::yield();
+        }
+    }
+    job->in_flight.store(true, std::memory_order_relaxed);
+    return job;
+}
+
+void JobSystem::schedule(Job* job) {
+    Worker& worker = *m_workers[t_worker_index];
+    while (!worker.queue.push(job)) {
+        // Full, draining our own queue is the quickest way to make room
+        execute_one(t_worker_index);
+    }
+    wake_workers(1);
+}
+
+void JobSystem::schedule_after(JobCounter& dependency, Job* job) {
+    while (dependency.m_lock.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    if (dependency.m_value.load(std::memory_order_acquire) == 0) {
+        dependency.m_lock.clear(std::memory_order_release);
+        schedule(job);
+        return;
+    }
+    job->next = dependency.m_continuations;
+    dependency.m_continuations = job;
+    dependency.m_lock.clear(std::memory_order_release);
+}
+
+bool JobSystem::execute_one(uint32_t worker_index) {
+    Worker& worker = *m_workers[worker_index];
+    Job* job = worker.queue.pop();
+    if (job == nullptr && m_thread_count > 1) {
+        // Random victim first, so idle workers don't all hammer the same queue
+        const uint32_t first = xorshift(worker.random_state) % m_thread_count;
+        for (uint32_t i = 0; i < m_thread_count && job == nullptr; i++) {
+            const uint32_t victim = (first + i) % m_thread_count;
+            if (victim != worker_index) {
+                job = m_workers[victim]->queue.steal();
+            }
+        }
+        if (job != nullptr) {
+            worker.jobs_stolen.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (job == nullptr) {
+        return false;
+    }
+
+    job->invoke(job->storage, worker_index);
+    worker.jobs_executed.fetch_add(1, std::memory_order_relaxed);
+    finish(job, worker_index);
+    return true;
+}
+
+void JobSystem::finish(Job* job, uint32_t worker_index) {
+    JobCounter* counter = job->counter;
+    job->in_flight.store(false, std::memory_order_release);
+    if (counter == nullptr) {
+        return;
+    }
+
+    counter->m_finishing.fetch_add(1, std::memory_order_seq_cst);
+    if (counter->m_value.fetch_sub(1, std::memory_order_seq_cst) != 1) {
+        counter->m_finishing.fetch_sub(1, std::memory_order_seq_cst);
+        return;
+    }
+
+    while (counter->m_lock.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    Job* continuation = counter->m_continuations;
+    counter->m_continuations = nullptr;
+    counter->m_lock.clear(std::memory_order_release);
+    // Last access, a waiter may destroy the counter from here on
+    counter->m_finishing.fetch_sub(1, std::memory_order_seq_cst);
+
+    Worker& worker = *m_workers[worker_index];
+    uint32_t released = 0;
+    while (continuation != nullptr) {
+        Job* next = continuation->next;
+        while (!worker.queue.push(continuation)) {
+            execute_one(worker_index);
+        }
+        continuation = next;
+        released++;
+    }
+    if (released > 0) {
+        wake_workers(released);
+    }
+}
+
+void JobSystem::wait(const JobCounter& counter) {
+    const uint32_t worker_index = t_worker_index;
+    assert(worker_index < m_thread_count && "Only worker threads can wait on a counter");
+    uint32_t spins = 0;
+    while (!counter.done()) {
+        if (execute_one(worker_index)) {
+            spins = 0;
+        } else if (++spins > 64) {
+            // The remaining jobs are running elsewhere, give their threads the core
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::wake_workers(uint32_t count) {
+    m_signal.fetch_add(1, std::memory_order_release);
+    if (m_sleeping.load(std::memory_order_acquire) == 0) {
+        return;
+    }
+    if (count == 1) {
+        m_signal.notify_one();
+    } else {
+        m_signal.notify_all();
+    }
+}
+
+void JobSystem::worker_main(uint32_t worker_index) {
+    t_worker_index = worker_index;
+    uint32_t spins = 0;
+    while (m_running.load(std::memory_order_acquire)) {
+        // Read before looking for work, anything scheduled after this changes it and the wait below returns at once
+        const uint32_t signal = m_signal.load(std::memory_order_acquire);
+        if (execute_one(worker_index)) {
+            spins = 0;
+            continue;
+        }
+        if (++spins < 64) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        m_sleeping.fetch_add(1, std::memory_order_acq_rel);
+        if (m_running.load(std::memory_order_acquire)) {
+            m_signal.wait(signal, std::memory_order_acquire);
+        }
+        m_sleeping.fetch_sub(1, std::memory_order_acq_rel);
+        spins = 0;
+    }
+}
@@ -0,0 +1,164 @@
+#ifndef PORTFOLIO_JOBSYSTEM_H
+#define PORTFOLIO_JOBSYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class JobSystem;
+
+// Small callable stored inline, so scheduling a job never touches the heap.
+// Captures have to be trivially copyable, lambdas capturing pointers, references and plain values are
+struct Job {
+    static constexpr size_t STORAGE_SIZE = 48;
+
+    alignas(16) std::byte storage[STORAGE_SIZE];
+    void (*invoke)(const std::byte* storage, uint32_t worker_index);
+    class JobCounter* counter;
+    // Next continuation waiting on the same counter
+    Job* next;
+    // Set from scheduling until the job finished, catches a ring of job slots wrapping onto itself
+    std::atomic<bool> in_flight;
+};
+
+// Counts jobs that have been scheduled but not finished. Jobs scheduled with run_after() wait on one
+class JobCounter {
+public:
+    uint32_t value() const { return m_value.load(std::memory_order_seq_cst); }
+    // Also waits out a worker that is still releasing continuations, the counter can go out of scope once this is true
+    bool done() const { return value() == 0 && m_finishing.load(std::memory_order_seq_cst) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_value = 0;
+    // Workers between decrementing m_value and their last access to the counter
+    std::atomic<uint32_t> m_finishing = 0;
+    // Guards m_continuations against the counter reaching zero while one is being added
+    std::atomic_flag m_lock;
+    Job* m_continuations = nullptr;
+};
+
+// Bounded Chase-Lev deque. The owning worker pushes and pops at the bottom, every other worker steals from the top
+class WorkStealingQueue {
+public:
+    explicit WorkStealingQueue(uint32_t capacity);
+
+    bool push(Job* job);
+    Job* pop();
+    Job* steal();
+
+private:
+    std::unique_ptr<std::atomic<Job*>[]> m_jobs;
+    int64_t m_mask;
+    alignas(64) std::atomic<int64_t> m_top = 0;
+    alignas(64) std::atomic<int64_t> m_bottom = 0;
+};
+
+struct JobSystemStats {
+    uint64_t jobs_executed;
+    uint64_t jobs_stolen;
+};
+
+// Fixed pool of workers, each with its own deque. The thread calling init() becomes worker 0 and only runs jobs
+// while it waits on a counter, so waiting never blocks progress. Jobs may only be scheduled from worker threads
+class JobSystem {
+public:
+    // Ring of job slots per worker. Scheduling onto a slot that is still unfinished runs jobs until it is, a worker
+    // with this many jobs waiting on dependencies it scheduled itself would never get one back
+    static constexpr uint32_t JOBS_PER_WORKER = 4096;
+
+    JobSystem() = default;
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+    ~JobSystem() { shutdown(); }
+
+    // thread_count includes the calling thread, 0 picks one per hardware thread
+    void init(uint32_t thread_count = 0);
+    void shutdown();
+
+    template<typename F>
+    void run(const F& function, JobCounter* counter = nullptr) {
+        schedule(create_job(function, counter));
+    }
+
+    // Scheduled once dependency reaches zero, counter is incremented right away so waiting on it covers the job
+    template<typename F>
+    void run_after(JobCounter& dependency, const F& function, JobCounter* counter = nullptr) {
+        schedule_after(dependency, create_job(function, counter));
+    }
+
+    // function(begin, end, worker_index) over [0, count) in batches of batch_size. Every batch gets its own copy of
+    // function, so it can be a temporary even when this is called from inside a job
+    template<typename F>
+    void parallel_for(uint32_t count, uint32_t batch_size, const F& function, JobCounter* counter) {
+        batch_size = std::max(batch_size, 1u);
+        for (uint32_t begin = 0; begin < count; begin += batch_size) {
+            const uint32_t end = std::min(count, begin + batch_size);
+            run([function, begin, end](uint32_t worker_index) { function(begin, end, worker_index); }, counter);
+        }
+    }
+
+    // Runs other jobs until counter reaches zero
+    void wait(const JobCounter& counter);
+
+    uint32_t thread_count() const { return m_thread_count; }
+    // Index of the calling thread, UINT32_MAX outside the pool
+    static uint32_t worker_index();
+    JobSystemStats stats() const;
+
+private:
+    template<typename F>
+    Job* create_job(const F& function, JobCounter* counter) {
+        static_assert(sizeof(F) <= Job::STORAGE_SIZE, "Job captures too large, capture a pointer to the data instead");
+        static_assert(alignof(F) <= 16, "Job captures over-aligned");
+        static_assert(std::is_trivially_copyable_v<F> && std::is_trivially_destructible_v<F>, "Job captures must be trivially copyable");
+
+        Job* job = allocate_job();
+        new (job->storage) F(function);
+        job->invoke = [](const std::byte* storage, uint32_t worker_index) {
+            (*std::launder(reinterpret_cast<const F*>(storage)))(worker_index);
+        };
+        job->counter = counter;
+        job->next = nullptr;
+        if (counter != nullptr) {
+            counter->m_value.fetch_add(1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    struct alignas(64) Worker {
+        explicit Worker(uint32_t queue_capacity) : queue(queue_capacity) {}
+
+        WorkStealingQueue queue;
+        std::unique_ptr<Job[]> jobs;
+        uint32_t next_job = 0;
+        uint32_t random_state = 0;
+        std::atomic<uint64_t> jobs_executed = 0;
+        std::atomic<uint64_t> jobs_stolen = 0;
+        std::thread thread;
+    };
+
+    Job* allocate_job();
+    void schedule(Job* job);
+    void schedule_after(JobCounter& dependency, Job* job);
+    bool execute_one(uint32_t worker_index);
+    void finish(Job* job, uint32_t worker_index);
+    void worker_main(uint32_t worker_index);
+    void wake_workers(uint32_t count);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    uint32_t m_thread_count = 0;
+    std::atomic<bool> m_running = false;
+    // Bumped on every schedule, idle workers sleep on it
+    std::atomic<uint32_t> m_signal = 0;
+    std::atomic<uint32_t> m_sleeping = 0;
+};
+
+#endif //PORTFOLIO_JOBSYSTEM_H
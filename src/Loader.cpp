@@ -0,0 +1,159 @@
+#include "Loader.h"
+
+#include <iostream>
+#include <string>
+#include <variant>
+
+#include <fastgltf/core.hpp>
+#include <fastgltf/glm_element_traits.hpp>
+#include <fastgltf/tools.hpp>
+
+#include "Renderer.h"
+
+namespace loader {
+    std::optional<std::vector<std::shared_ptr<MeshAsset>>> load_gltf_meshes(Renderer* renderer, const std::filesystem::path& file_path) {
+        std::cout << "Loading glTF: " << file_path << std::endl;
+
+        auto data = fastgltf::GltfDataBuffer::FromPath(file_path);
+        if (data.error() != fastgltf::Error::None) {
+            std::cerr << "Failed to read " << file_path << ": " << fastgltf::getErrorMessage(data.error()) << std::endl;
+            return std::nullopt;
+        }
+
+        fastgltf::Parser parser;
+        auto asset = parser.loadGltf(data.get(), file_path.parent_path(), fastgltf::Options::LoadExternalBuffers);
+        if (asset.error() != fastgltf::Error::None) {
+            std::cerr << "Failed to parse " << file_path << ": " << fastgltf::getErrorMessage(asset.error()) << std::endl;
+            return std::nullopt;
+        }
+
+        // Materials first so surfaces can point at them. An image used by several materials under the same role is
+        // imported once
+        std::vector<std::string> image_paths;
+        std::vector<TextureRole> image_roles;
+        const auto image_index = [&](const fastgltf::Optional<fastgltf::TextureInfo>& info, TextureRole role) -> std::optional<uint32_t> {
+            if (!info.has_value() || !asset->textures[info->textureIndex].imageIndex.has_value()) {
+                return std::nullopt;
+            }
+            const fastgltf::Image& image = asset->images[asset->textures[info->textureIndex].imageIndex.value()];
+            const auto* uri = std::get_if<fastgltf::sources::URI>(&image.data);
+            if (uri == nullptr || !uri->uri.isLocalPath()) {
+                std::cerr << "Skipping image " << image.name << " of " << file_path << ", only image files are imported" << std::endl;
+                return std::nullopt;
+            }
+
+            const std::string path = (file_path.parent_path() / uri->uri.fspath()).string();
+            for (size_t i = 0; i < image_paths.size(); i++) {
+                if (image_paths[i] == path && image_roles[i] == role) {
+                    return static_cast<uint32_t>(i);
+                }
+            }
+            image_paths.push_back(path);
+            image_roles.push_back(role);
+            return static_cast<uint32_t>(image_paths.size() - 1);
+        };
+
+        std::vector<MaterialDescription> descriptions;
+        descriptions.reserve(asset->materials.size());
+        for (const fastgltf::Material& material : asset->materials) {
+            MaterialDescription description = {};
+            const auto& color = material.pbrData.baseColorFactor;
+            description.constants.color_factors = glm::vec4(color[0], color[1], color[2], color[3]);
+            description.constants.metal_rough_factors = glm::vec4(material.pbrData.metallicFactor, material.pbrData.roughnessFactor, 0.0f, 0.0f);
+            description.color_image = image_index(material.pbrData.baseColorTexture, TextureRole::Albedo);
+            description.metal_rough_image = image_index(material.pbrData.metallicRoughnessTexture, TextureRole::MetalRough);
+            descriptions.push_back(description);
+        }
+        const std::vector<std::shared_ptr<GLTFMaterial>> materials = renderer->create_materials(descriptions, image_paths, image_roles);
+
+        std::vector<std::shared_ptr<MeshAsset>> meshes;
+        // Reused between meshes so each one doesn't start from an empty allocation
+        std::vector<uint32_t> indices;
+        std::vector<Vertex> vertices;
+        for (fastgltf::Mesh& mesh : asset->meshes) {
+            MeshAsset new_mesh = {};
+            new_mesh.name = mesh.name;
+            indices.clear();
+            vertices.clear();
+
+            for (fastgltf::Primitive& primitive : mesh.primitives) {
+                const auto position = primitive.findAttribute("POSITION");
+                if (!primitive.indicesAccessor.has_value() || position == primitive.attributes.end()) {
+                    std::cerr << "Skipping a primitive of " << mesh.name << " without indices or positions" << std::endl;
+                    continue;
+                }
+
+                GeoSurface surface = {};
+                surface.start_index = static_cast<uint32_t>(indices.size());
+                surface.count = static_cast<uint32_t>(asset->accessors[primitive.indicesAccessor.value()].count);
+                if (primitive.materialIndex.has_value() && primitive.materialIndex.value() < materials.size()) {
+                    surface.material = materials[primitive.materialIndex.value()];
+                }
+
+                // Surfaces of a mesh share one vertex range, so indices get rebased onto it
+                const size_t initial_vertex = vertices.size();
+                fastgltf::Accessor& index_accessor = asset->accessors[primitive.indicesAccessor.value()];
+                indices.reserve(indices.size() + index_accessor.count);
+                fastgltf::iterateAccessor<uint32_t>(asset.get(), index_accessor, [&](uint32_t index) {
+                    indices.push_back(static_cast<uint32_t>(index + initial_vertex));
+                });
+
+                fastgltf::Accessor& position_accessor = asset->accessors[position->accessorIndex];
+                vertices.resize(initial_vertex + position_accessor.count);
+                fastgltf::iterateAccessorWithIndex<glm::vec3>(asset.get(), position_accessor, [&](glm::vec3 value, size_t index) {
+                    Vertex vertex = {};
+                    vertex.position = value;
+                    vertex.normal = {1, 0, 0};
+                    vertex.color = glm::vec4{1.0f};
+                    vertices[initial_vertex + index] = vertex;
+                });
+
+                const auto normals = primitive.findAttribute("NORMAL");
+                if (normals != primitive.attributes.end()) {
+                    fastgltf::iterateAccessorWithIndex<glm::vec3>(asset.get(), asset->accessors[normals->accessorIndex], [&](glm::vec3 value, size_t index) {
+                        vertices[initial_vertex + index].normal = value;
+                    });
+                }
+
+                const auto uv = primitive.findAttribute("TEXCOORD_0");
+                if (uv != primitive.attributes.end()) {
+                    fastgltf::iterateAccessorWithIndex<glm::vec2>(asset.get(), asset->accessors[uv->accessorIndex], [&](glm::vec2 value, size_t index) {
+                        vertices[initial_vertex + index].uv_x = value.x;
+                        vertices[initial_vertex + index].uv_y = value.y;
+                    });
+                }
+
+                const auto colors = primitive.findAttribute("COLOR_0");
+                if (colors != primitive.attributes.end()) {
+                    fastgltf::iterateAccessorWithIndex<glm::vec4>(asset.get(), asset->accessors[colors->accessorIndex], [&](glm::vec4 value, size_t index) {
+                        vertices[initial_vertex + index].color = value;
+                    });
+                }
+
+                // Culling bounds, the box around this primitive's positions
+                glm::vec3 min_pos = vertices[initial_vertex].position;
+                glm::vec3 max_pos = vertices[initial_vertex].position;
+                for (size_t i = initial_vertex; i < vertices.size(); i++) {
+                    min_pos = glm::min(min_pos, vertices[i].position);
+                    max_pos = glm::max(max_pos, vertices[i].position);
+                }
+                surface.bounds.origin = (max_pos + min_pos) / 2.0f;
+                surface.bounds.extents = (max_pos - min_pos) / 2.0f;
+                surface.bounds.sphere_radius = glm::length(surface.bounds.extents);
+
+                new_mesh.surfaces.push_back(surface);
+            }
+
+            if (new_mesh.surfaces.empty()) {
+                continue;
+            }
+            new_mesh.mesh_buffers = renderer->upload_mesh(indices, vertices);
+            if (new_mesh.mesh_buffers.index_count == 0) {
+                continue;
+            }
+            meshes.emplace_back(std::make_shared<MeshAsset>(std::move(new_mesh)));
+        }
+
+        return meshes;
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef PORTFOLIO_LOADER_H
+#define PORTFOLIO_LOADER_H
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+class Renderer;
+struct MeshAsset;
+
+namespace loader {
+    // Every mesh in the file, each primitive becoming a surface of it. Geometry is uploaded into the renderer's
+    // geometry pool and materials are built through Renderer::create_materials, with their base colour and
+    // metal-rough images imported by role. Only image files next to the glTF are imported, images embedded in a
+    // buffer leave the material sampling white. The node hierarchy is ignored
+    std::optional<std::vector<std::shared_ptr<MeshAsset>>> load_gltf_meshes(Renderer* renderer, const std::filesystem::path& file_path);
+}
+
+#endif //PORTFOLIO_LOADER_H
@@ -0,0 +1,161 @@
+#include "Pipelines.h"
+
+#include <iostream>
+
+#include "Initializers.h"
+
+void PipelineBuilder::clear() {
+    m_input_assembly = {.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+    m_rasterizer = {.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+    m_color_blend_attachment = {};
+    m_multisampling = {.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+    m_pipeline_layout = VK_NULL_HANDLE;
+    m_depth_stencil = {.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+    m_render_info = {.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
+    m_color_attachment_format = VK_FORMAT_UNDEFINED;
+    m_shader_stages.clear();
+}
+
+VkPipeline PipelineBuilder::build_pipeline(VkDevice device) {
+    VkPipelineViewportStateCreateInfo viewport_state = {};
+    viewport_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_state.pNext = nullptr;
+    viewport_state.viewportCount = 1;
+    viewport_state.scissorCount = 1;
+
+    VkPipelineColorBlendStateCreateInfo color_blending = {};
+    color_blending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    color_blending.pNext = nullptr;
+    color_blending.logicOpEnable = VK_FALSE;
+    color_blending.logicOp = VK_LOGIC_OP_COPY;
+    color_blending.attachmentCount = m_render_info.colorAttachmentCount;
+    color_blending.pAttachments = &m_color_blend_attachment;
+
+    // Vertices are pulled from the geometry pool through buffer device addresses, there is no vertex input
+    VkPipelineVertexInputStateCreateInfo vertex_input_info = {.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+
+    constexpr VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamic_info = {.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+    dynamic_info.pDynamicStates = dynamic_states;
+    dynamic_info.dynamicStateCount = 2;
+
+    VkGraphicsPipelineCreateInfo pipeline_info = {.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+    pipeline_info.pNext = &m_render_info;
+    pipeline_info.stageCount = static_cast<uint32_t>(m_shader_stages.size());
+    pipeline_info.pStages = m_shader_stages.data();
+    pipeline_info.pVertexInputState = &vertex_input_info;
+    pipeline_info.pInputAssemblyState = &m_input_assembly;
+    pipeline_info.pViewportState = &viewport_state;
+    pipeline_info.pRasterizationState = &m_rasterizer;
+    pipeline_info.pMultisampleState = &m_multisampling;
+    pipeline_info.pColorBlendState = &color_blending;
+    pipeline_info.pDepthStencilState = &m_depth_stencil;
+    pipeline_info.pDynamicState = &dynamic_info;
+    pipeline_info.layout = m_pipeline_layout;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline) != VK_SUCCESS) {
+        std::cerr << "Failed to create graphics pipeline" << std::endl;
+        return VK_NULL_HANDLE;
+    }
+    return pipeline;
+}
+
+void PipelineBuilder::set_shaders(VkShaderModule vertex_shader, VkShaderModule fragment_shader) {
+    m_shader_stages.clear();
+    m_shader_stages.push_back(init::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, vertex_shader));
+    if (fragment_shader != VK_NULL_HANDLE) {
+        m_shader_stages.push_back(init::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, fragment_shader));
+    }
+}
+
+void PipelineBuilder::set_input_topology(VkPrimitiveTopology topology) {
+    m_input_assembly.topology = topology;
+    m_input_assembly.primitiveRestartEnable = VK_FALSE;
+}
+
+void PipelineBuilder::set_polygon_mode(VkPolygonMode mode) {
+    m_rasterizer.polygonMode = mode;
+    m_rasterizer.lineWidth = 1.0f;
+}
+
+void PipelineBuilder::set_cull_mode(VkCullModeFlags cull_mode, VkFrontFace front_face) {
+    m_rasterizer.cullMode = cull_mode;
+    m_rasterizer.frontFace = front_face;
+}
+
+void PipelineBuilder::set_multisampling_none() {
+    m_multisampling.sampleShadingEnable = VK_FALSE;
+    m_multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    m_multisampling.minSampleShading = 1.0f;
+    m_multisampling.pSampleMask = nullptr;
+    m_multisampling.alphaToCoverageEnable = VK_FALSE;
+    m_multisampling.alphaToOneEnable = VK_FALSE;
+}
+
+void PipelineBuilder::disable_blending() {
+    m_color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    m_color_blend_attachment.blendEnable = VK_FALSE;
+}
+
+void PipelineBuilder::enable_blending_additive() {
+    m_color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    m_color_blend_attachment.blendEnable = VK_TRUE;
+    m_color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    m_color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    m_color_blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
+    m_color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    m_color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    m_color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+}
+
+void PipelineBuilder::enable_blending_alphablend() {
+    m_color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    m_color_blend_attachment.blendEnable = VK_TRUE;
+    m_color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    m_color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    m_color_blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
+    m_color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    m_color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    m_color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+}
+
+void PipelineBuilder::set_color_attachment_format(VkFormat format) {
+    m_color_attachment_format = format;
+    m_render_info.colorAttachmentCount = 1;
+    m_render_info.pColorAttachmentFormats = &m_color_attachment_format;
+}
+
+void PipelineBuilder::set_no_color_attachment() {
+    m_color_attachment_format = VK_FORMAT_UNDEFINED;
+    m_render_info.colorAttachmentCount = 0;
+    m_render_info.pColorAttachmentFormats = nullptr;
+}
+
+void PipelineBuilder::set_depth_format(VkFormat format) {
+    m_render_info.depthAttachmentFormat = format;
+}
+
+void PipelineBuilder::disable_depthtest() {
+    m_depth_stencil.depthTestEnable = VK_FALSE;
+    m_depth_stencil.depthWriteEnable = VK_FALSE;
+    m_depth_stencil.depthCompareOp = VK_COMPARE_OP_NEVER;
+    m_depth_stencil.depthBoundsTestEnable = VK_FALSE;
+    m_depth_stencil.stencilTestEnable = VK_FALSE;
+    m_depth_stencil.front = {};
+    m_depth_stencil.back = {};
+    m_depth_stencil.minDepthBounds = 0.0f;
+    m_depth_stencil.maxDepthBounds = 1.0f;
+}
+
+void PipelineBuilder::enable_depthtest(bool depth_write_enable, VkCompareOp op) {
+    m_depth_stencil.depthTestEnable = VK_TRUE;
+    m_depth_stencil.depthWriteEnable = depth_write_enable ? VK_TRUE : VK_FALSE;
+    m_depth_stencil.depthCompareOp = op;
+    m_depth_stencil.depthBoundsTestEnable = VK_FALSE;
+    m_depth_stencil.stencilTestEnable = VK_FALSE;
+    m_depth_stencil.front = {};
+    m_depth_stencil.back = {};
+    m_depth_stencil.minDepthBounds = 0.0f;
+    m_depth_stencil.maxDepthBounds = 1.0f;
+}
@@ -0,0 +1,44 @@
+#ifndef PORTFOLIO_PIPELINES_H
+#define PORTFOLIO_PIPELINES_H
+
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// Graphics pipelines for dynamic rendering. Viewport and scissor are dynamic, everything else is baked in
+class PipelineBuilder {
+public:
+    PipelineBuilder() { clear(); }
+
+    void clear();
+    VkPipeline build_pipeline(VkDevice device);
+
+    void set_layout(VkPipelineLayout layout) { m_pipeline_layout = layout; }
+    // fragment_shader may be VK_NULL_HANDLE for depth only pipelines
+    void set_shaders(VkShaderModule vertex_shader, VkShaderModule fragment_shader);
+    void set_input_topology(VkPrimitiveTopology topology);
+    void set_polygon_mode(VkPolygonMode mode);
+    void set_cull_mode(VkCullModeFlags cull_mode, VkFrontFace front_face);
+    void set_multisampling_none();
+    void disable_blending();
+    void enable_blending_additive();
+    void enable_blending_alphablend();
+    void set_color_attachment_format(VkFormat format);
+    void set_no_color_attachment();
+    void set_depth_format(VkFormat format);
+    void disable_depthtest();
+    void enable_depthtest(bool depth_write_enable, VkCompareOp op);
+
+private:
+    std::vector<VkPipelineShaderStageCreateInfo> m_shader_stages;
+    VkPipelineInputAssemblyStateCreateInfo m_input_assembly;
+    VkPipelineRasterizationStateCreateInfo m_rasterizer;
+    VkPipelineColorBlendAttachmentState m_color_blend_attachment;
+    VkPipelineMultisampleStateCreateInfo m_multisampling;
+    VkPipelineLayout m_pipeline_layout;
+    VkPipelineDepthStencilStateCreateInfo m_depth_stencil;
+    VkPipelineRenderingCreateInfo m_render_info;
+    VkFormat m_color_attachment_format;
+};
+
+#endif //PORTFOLIO_PIPELINES_H
@@ -0,0 +1,470 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "AllocationCounter.h"
+#include "Initializers.h"
+
+namespace {
+    VkImageUsageFlags usage_flags(ImageUsage usage) {
+        switch (usage) {
+            case ImageUsage::ComputeWrite:
+            case ImageUsage::ComputeRead:
+            case ImageUsage::ComputeReadWrite:
+                return VK_IMAGE_USAGE_STORAGE_BIT;
+            case ImageUsage::TransferSrc:
+                return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            case ImageUsage::TransferDst:
+                return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+            case ImageUsage::ColorAttachment:
+                return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+            case ImageUsage::DepthAttachment:
+                return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            case ImageUsage::DepthRead:
+                return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+            case ImageUsage::ShaderRead:
+                return VK_IMAGE_USAGE_SAMPLED_BIT;
+            default:
+                return 0;
+        }
+    }
+
+    void add_unique(std::vector<uint32_t>& list, uint32_t value) {
+        if (std::find(list.begin(), list.end(), value) == list.end()) {
+            list.push_back(value);
+        }
+    }
+}
+
+void RGPassBuilder::read(RGResource resource, ImageUsage usage) {
+    m_graph.m_passes[m_pass_index].accesses.push_back({resource, usage, false, false});
+}
+
+void RGPassBuilder::write(RGResource resource, ImageUsage usage, bool discard_contents) {
+    m_graph.m_passes[m_pass_index].accesses.push_back({resource, usage, true, discard_contents});
+}
+
+void RGPassBuilder::side_effect() {
+    m_graph.m_passes[m_pass_index].side_effects = true;
+}
+
+void RenderGraph::init(VkDevice device, VmaAllocator allocator, BarrierTracker* barriers) {
+    m_device = device;
+    m_allocator = allocator;
+    m_barriers = barriers;
+}
+
+void RenderGraph::destroy() {
+    destroy_transients(nullptr);
+}
+
+void RenderGraph::begin_frame() {
+    m_allocation_mark = memory::thread_allocation_count();
+    m_heap_allocations = 0;
+    m_pass_count = 0;
+    m_resources.clear();
+    m_schedule.clear();
+}
+
+RGResource RenderGraph::import_image(const char* name, VkImage image, VkImageView image_view, VkExtent2D extent, VkImageAspectFlags aspect) {
+    Resource resource = {};
+    resource.name = name;
+    resource.imported = true;
+    resource.desc.extent = extent;
+    resource.desc.aspect = aspect;
+    resource.image = image;
+    resource.image_view = image_view;
+    m_resources.push_back(resource);
+    return static_cast<RGResource>(m_resources.size() - 1);
+}
+
+RGResource RenderGraph::create_image(const char* name, const RGImageDesc& desc) {
+    Resource resource = {};
+    resource.name = name;
+    resource.desc = desc;
+    resource.usage = desc.extra_usage;
+    m_resources.push_back(resource);
+    return static_cast<RGResource>(m_resources.size() - 1);
+}
+
+void RenderGraph::set_output(RGResource resource, ImageUsage final_usage) {
+    m_resources[resource].output = true;
+    m_resources[resource].final_usage = final_usage;
+}
+
+uint32_t RenderGraph::begin_pass(const char* name) {
+    if (m_pass_count == m_passes.size()) {
+        m_passes.emplace_back();
+    }
+
+    Pass& pass = m_passes[m_pass_count];
+    pass.name = name;
+    pass.accesses.clear();
+    pass.side_effects = false;
+    pass.live = false;
+    pass.data_dependencies.clear();
+    pass.order_dependencies.clear();
+    return m_pass_count++;
+}
+
+void RenderGraph::compile(DeletionQueue& retire_queue) {
+    build_dependencies();
+    cull_passes();
+    schedule_passes();
+    realize_transients(retire_queue);
+}
+
+void RenderGraph::build_dependencies() {
+    // Declaration order defines what each read sees, walk it once and record who has to come before whom
+    m_last_writer.assign(m_resources.size(), -1);
+    m_first_reader.assign(m_resources.size(), -1);
+    m_reader_nodes.clear();
+
+    for (uint32_t pass_index = 0; pass_index < m_pass_count; pass_index++) {
+        Pass& pass = m_passes[pass_index];
+        for (const Access& access : pass.accesses) {
+            const int32_t writer = m_last_writer[access.resource];
+            const bool consumes_previous = !access.write || !access.discard_contents;
+
+            if (writer >= 0 && writer != static_cast<int32_t>(pass_index)) {
+                if (consumes_previous) {
+                    add_unique(pass.data_dependencies, writer);
+                }
+                add_unique(pass.order_dependencies, writer);
+            }
+
+            if (access.write) {
+                for (int32_t node = m_first_reader[access.resource]; node >= 0; node = m_reader_nodes[node].second) {
+                    const uint32_t reader = m_reader_nodes[node].first;
+                    if (reader != pass_index) {
+                        add_unique(pass.order_dependencies, reader);
+                    }
+                }
+                m_first_reader[access.resource] = -1;
+                m_last_writer[access.resource] = static_cast<int32_t>(pass_index);
+            } else {
+                m_reader_nodes.emplace_back(pass_index, m_first_reader[access.resource]);
+                m_first_reader[access.resource] = static_cast<int32_t>(m_reader_nodes.size() - 1);
+            }
+
+            m_resources[access.resource].usage |= usage_flags(access.usage);
+        }
+    }
+
+    // Final writer of every output is what the frame exists for
+    for (uint32_t resource_index = 0; resource_index < m_resources.size(); resource_index++) {
+        if (m_resources[resource_index].output && m_last_writer[resource_index] >= 0) {
+            m_passes[m_last_writer[resource_index]].side_effects = true;
+        }
+    }
+}
+
+void RenderGraph::cull_passes() {
+    m_pass_stack.clear();
+    for (uint32_t pass_index = 0; pass_index < m_pass_count; pass_index++) {
+        if (m_passes[pass_index].side_effects) {
+            m_passes[pass_index].live = true;
+            m_pass_stack.push_back(pass_index);
+        }
+    }
+
+    while (!m_pass_stack.empty()) {
+        const uint32_t pass_index = m_pass_stack.back();
+        m_pass_stack.pop_back();
+        for (uint32_t dependency : m_passes[pass_index].data_dependencies) {
+            if (!m_passes[dependency].live) {
+                m_passes[dependency].live = true;
+                m_pass_stack.push_back(dependency);
+            }
+        }
+    }
+}
+
+void RenderGraph::schedule_passes() {
+    // Dependents laid out flat: count them per pass, sum the counts into the end of each pass's range, then fill
+    // each range back to front, which leaves its offset at the start
+    m_remaining_dependencies.assign(m_pass_count, 0);
+    m_dependent_offsets.assign(m_pass_count + 1, 0);
+    for (uint32_t pass_index = 0; pass_index < m_pass_count; pass_index++) {
+        if (!m_passes[pass_index].live) {
+            continue;
+        }
+        for (uint32_t dependency : m_passes[pass_index].order_dependencies) {
+            if (m_passes[dependency].live) {
+                m_remaining_dependencies[pass_index]++;
+                m_dependent_offsets[dependency]++;
+            }
+        }
+    }
+    for (uint32_t pass_index = 1; pass_index <= m_pass_count; pass_index++) {
+        m_dependent_offsets[pass_index] += m_dependent_offsets[pass_index - 1];
+    }
+    m_dependents.resize(m_dependent_offsets[m_pass_count]);
+    for (uint32_t pass_index = m_pass_count; pass_index-- > 0;) {
+        if (!m_passes[pass_index].live) {
+            continue;
+        }
+        for (uint32_t dependency : m_passes[pass_index].order_dependencies) {
+            if (m_passes[dependency].live) {
+                m_dependents[--m_dependent_offsets[dependency]] = pass_index;
+            }
+        }
+    }
+
+    m_ready.clear();
+    for (uint32_t pass_index = 0; pass_index < m_pass_count; pass_index++) {
+        if (m_passes[pass_index].live && m_remaining_dependencies[pass_index] == 0) {
+            m_ready.push_back(pass_index);
+        }
+    }
+
+    // Among the ready passes prefer one that doesn't depend on the pass just scheduled, so the barrier
+    // between a producer and its consumer has other work in front of it. Ties keep declaration order.
+    while (!m_ready.empty()) {
+        std::sort(m_ready.begin(), m_ready.end());
+        size_t pick = 0;
+        if (!m_schedule.empty()) {
+            const uint32_t previous = m_schedule.back();
+            for (size_t i = 0; i < m_ready.size(); i++) {
+                const std::vector<uint32_t>& dependencies = m_passes[m_ready[i]].order_dependencies;
+                if (std::find(dependencies.begin(), dependencies.end(), previous) == dependencies.end()) {
+                    pick = i;
+                    break;
+                }
+            }
+        }
+
+        const uint32_t pass_index = m_ready[pick];
+        m_ready.erase(m_ready.begin() + static_cast<std::ptrdiff_t>(pick));
+        m_schedule.push_back(pass_index);
+
+        for (uint32_t i = m_dependent_offsets[pass_index]; i < m_dependent_offsets[pass_index + 1]; i++) {
+            const uint32_t dependent = m_dependents[i];
+            if (--m_remaining_dependencies[dependent] == 0) {
+                m_ready.push_back(dependent);
+            }
+        }
+    }
+
+    for (uint32_t order = 0; order < m_schedule.size(); order++) {
+        for (const Access& access : m_passes[m_schedule[order]].accesses) {
+            Resource& resource = m_resources[access.resource];
+            if (resource.first_use < 0) {
+                resource.first_use = static_cast<int32_t>(order);
+            }
+            resource.last_use = static_cast<int32_t>(order);
+        }
+    }
+
+    m_stats.pass_count = m_pass_count;
+    m_stats.culled_pass_count = static_cast<uint32_t>(m_pass_count - m_schedule.size());
+}
+
+void RenderGraph::realize_transients(DeletionQueue& retire_queue) {
+    std::vector<uint32_t>& transient_resources = m_transient_resources;
+    transient_resources.clear();
+    for (uint32_t resource_index = 0; resource_index < m_resources.size(); resource_index++) {
+        const Resource& resource = m_resources[resource_index];
+        // Transients only used by culled passes never get memory
+        if (!resource.imported && resource.first_use >= 0) {
+            transient_resources.push_back(resource_index);
+        }
+    }
+
+    // Frames usually look the same as the last one, in which case the images from last time are reused as is
+    bool matches_cache = transient_resources.size() == m_transients.size();
+    for (size_t i = 0; matches_cache && i < transient_resources.size(); i++) {
+        const Resource& resource = m_resources[transient_resources[i]];
+        const TransientImage& cached = m_transients[i];
+        matches_cache = cached.desc.format == resource.desc.format &&
+            cached.desc.extent.width == resource.desc.extent.width &&
+            cached.desc.extent.height == resource.desc.extent.height &&
+            cached.desc.aspect == resource.desc.aspect &&
+            cached.usage == resource.usage &&
+            cached.first_use == resource.first_use &&
+            cached.last_use == resource.last_use;
+    }
+
+    if (!matches_cache) {
+        destroy_transients(&retire_queue);
+
+        std::vector<VkMemoryRequirements> requirements(transient_resources.size());
+        for (size_t i = 0; i < transient_resources.size(); i++) {
+            const Resource& resource = m_resources[transient_resources[i]];
+            TransientImage transient = {};
+            transient.desc = resource.desc;
+            transient.usage = resource.usage;
+            transient.first_use = resource.first_use;
+            transient.last_use = resource.last_use;
+
+            VkImageCreateInfo image_info = init::image_create_info(resource.desc.format, resource.usage, VkExtent3D{resource.desc.extent.width, resource.desc.extent.height, 1});
+            VK_CHECK(vkCreateImage(m_device, &image_info, nullptr, &transient.image));
+            vkGetImageMemoryRequirements(m_device, transient.image, &requirements[i]);
+            m_transients.push_back(transient);
+        }
+
+        // Greedy first fit, biggest first: an image joins a block if the block is big enough, the memory types
+        // agree and nothing already in it is alive at the same time
+        std::vector<size_t> by_size(m_transients.size());
+        for (size_t i = 0; i < by_size.size(); i++) {
+            by_size[i] = i;
+        }
+        std::sort(by_size.begin(), by_size.end(), [&](size_t a, size_t b) { return requirements[a].size > requirements[b].size; });
+
+        std::vector<VkMemoryRequirements> block_requirements;
+        std::vector<std::vector<size_t>> block_occupants;
+        for (size_t index : by_size) {
+            TransientImage& transient = m_transients[index];
+            bool placed = false;
+            for (size_t block = 0; block < block_requirements.size() && !placed; block++) {
+                VkMemoryRequirements& block_reqs = block_requirements[block];
+                const uint32_t shared_types = block_reqs.memoryTypeBits & requirements[index].memoryTypeBits;
+                if (shared_types == 0 || block_reqs.size < requirements[index].size) {
+                    continue;
+                }
+
+                const bool overlaps = std::any_of(block_occupants[block].begin(), block_occupants[block].end(), [&](size_t other) {
+                    return m_transients[other].first_use <= transient.last_use && transient.first_use <= m_transients[other].last_use;
+                });
+                if (overlaps) {
+                    continue;
+                }
+
+                block_reqs.memoryTypeBits = shared_types;
+                block_reqs.alignment = std::max(block_reqs.alignment, requirements[index].alignment);
+                block_occupants[block].push_back(index);
+                transient.memory_block = static_cast<uint32_t>(block);
+                placed = true;
+            }
+
+            if (!placed) {
+                transient.memory_block = static_cast<uint32_t>(block_requirements.size());
+                block_requirements.push_back(requirements[index]);
+                block_occupants.push_back({index});
+            }
+        }
+
+        m_stats.transient_memory = 0;
+        m_stats.transient_memory_unaliased = 0;
+        for (const VkMemoryRequirements& reqs : requirements) {
+            m_stats.transient_memory_unaliased += reqs.size;
+        }
+
+        VmaAllocationCreateInfo alloc_info = {};
+        alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        alloc_info.requiredFlags = static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        for (size_t block = 0; block < block_requirements.size(); block++) {
+            VmaAllocation allocation = VK_NULL_HANDLE;
+            VK_CHECK(vmaAllocateMemory(m_allocator, &block_requirements[block], &alloc_info, &allocation, nullptr));
+            m_memory_blocks.push_back(allocation);
+            m_stats.transient_memory += block_requirements[block].size;
+
+            // Occupants in the order they come alive, each one waits on the one before it.
+            // The first waits on the last, which held the memory at the end of the previous frame
+            std::vector<size_t>& occupants = block_occupants[block];
+            std::sort(occupants.begin(), occupants.end(), [&](size_t a, size_t b) { return m_transients[a].first_use < m_transients[b].first_use; });
+            for (size_t i = 0; i < occupants.size(); i++) {
+                m_transients[occupants[i]].alias_predecessor = static_cast<uint32_t>(occupants[(i + occupants.size() - 1) % occupants.size()]);
+            }
+        }
+
+        for (TransientImage& transient : m_transients) {
+            VK_CHECK(vmaBindImageMemory(m_allocator, m_memory_blocks[transient.memory_block], transient.image));
+            VkImageViewCreateInfo view_info = init::image_view_create_info(transient.desc.format, transient.image, transient.desc.aspect);
+            VK_CHECK(vkCreateImageView(m_device, &view_info, nullptr, &transient.image_view));
+            m_barriers->track(transient.image, transient.desc.aspect);
+        }
+
+        std::cout << "Render graph placed " << m_transients.size() << " transient images in " << m_memory_blocks.size() << " memory blocks" << std::endl;
+    }
+
+    for (size_t i = 0; i < transient_resources.size(); i++) {
+        Resource& resource = m_resources[transient_resources[i]];
+        resource.transient_index = static_cast<uint32_t>(i);
+        resource.image = m_transients[i].image;
+        resource.image_view = m_transients[i].image_view;
+    }
+    m_stats.transient_image_count = static_cast<uint32_t>(m_transients.size());
+}
+
+void RenderGraph::destroy_transients(DeletionQueue* retire_queue) {
+    for (const TransientImage& transient : m_transients) {
+        m_barriers->forget(transient.image);
+    }
+
+    std::vector<TransientImage> transients = std::move(m_transients);
+    std::vector<VmaAllocation> memory_blocks = std::move(m_memory_blocks);
+    m_transients.clear();
+    m_memory_blocks.clear();
+
+    auto destroy = [device = m_device, allocator = m_allocator, transients, memory_blocks]() {
+        for (const TransientImage& transient : transients) {
+            vkDestroyImageView(device, transient.image_view, nullptr);
+            vkDestroyImage(device, transient.image, nullptr);
+        }
+        for (VmaAllocation allocation : memory_blocks) {
+            vmaFreeMemory(allocator, allocation);
+        }
+    };
+
+    if (retire_queue) {
+        retire_queue->push_function(std::move(destroy));
+    } else {
+        destroy();
+    }
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd) {
+    m_acquired.assign(m_resources.size(), 0);
+    for (uint32_t order = 0; order < m_schedule.size(); order++) {
+        Pass& pass = m_passes[m_schedule[order]];
+
+        for (const Access& access : pass.accesses) {
+            const Resource& resource = m_resources[access.resource];
+            const bool first_use = !resource.imported && !m_acquired[access.resource];
+            if (first_use) {
+                m_acquired[access.resource] = 1;
+                // Memory may still be in use by the previous occupant, wait on its last use before taking it over
+                const TransientImage& transient = m_transients[resource.transient_index];
+                const ImageState previous = m_barriers->state(m_transients[transient.alias_predecessor].image);
+                const ImageState own = m_barriers->state(transient.image);
+                m_barriers->track(transient.image, transient.desc.aspect, {VK_IMAGE_LAYOUT_UNDEFINED, previous.stage | own.stage, previous.access | own.access});
+            }
+            m_barriers->transition(resource.image, access.usage, access.discard_contents || first_use);
+        }
+        m_barriers->flush(cmd);
+
+        count_allocations();
+        pass.execute(pass.storage, cmd, *this);
+        m_allocation_mark = memory::thread_allocation_count();
+    }
+
+    for (const Resource& resource : m_resources) {
+        if (resource.output && resource.final_usage != ImageUsage::Undefined) {
+            m_barriers->transition(resource.image, resource.final_usage);
+        }
+    }
+    m_barriers->flush(cmd);
+
+    count_allocations();
+    m_stats.heap_allocations = static_cast<uint32_t>(m_heap_allocations);
+}
+
+void RenderGraph::count_allocations() {
+    const uint64_t now = memory::thread_allocation_count();
+    m_heap_allocations += now - m_allocation_mark;
+    m_allocation_mark = now;
+}
+
+VkImage RenderGraph::image(RGResource resource) const {
+    return m_resources[resource].image;
+}
+
+VkImageView RenderGraph::image_view(RGResource resource) const {
+    return m_resources[resource].image_view;
+}
+
+VkExtent2D RenderGraph::extent(RGResource resource) const {
+    return m_resources[resource].desc.extent;
+}
@@ -0,0 +1,190 @@
+#ifndef PORTFOLIO_RENDERGRAPH_H
+#define PORTFOLIO_RENDERGRAPH_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Barriers.h"
+#include "Types.h"
+
+using RGResource = uint32_t;
+
+struct RGImageDesc {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent = {};
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    // Usage flags implied by the declared accesses are added automatically
+    VkImageUsageFlags extra_usage = 0;
+};
+
+struct RenderGraphStats {
+    uint32_t pass_count;
+    uint32_t culled_pass_count;
+    uint32_t transient_image_count;
+    VkDeviceSize transient_memory;
+    // What the transients would take if none of them shared memory
+    VkDeviceSize transient_memory_unaliased;
+    // Heap allocations on the render thread from begin_frame() to the end of execute(), pass callbacks excluded.
+    // Zero in a steady state frame, anything else is a transient rebuild or storage still growing
+    uint32_t heap_allocations;
+};
+
+class RenderGraph;
+
+class RGPassBuilder {
+public:
+    void read(RGResource resource, ImageUsage usage);
+    // discard_contents means the pass overwrites everything it cares about, so earlier writers aren't needed
+    void write(RGResource resource, ImageUsage usage, bool discard_contents = false);
+    // Keeps the pass alive even if nothing reads what it writes
+    void side_effect();
+
+private:
+    friend class RenderGraph;
+    RGPassBuilder(RenderGraph& graph, uint32_t pass_index) : m_graph(graph), m_pass_index(pass_index) {}
+
+    RenderGraph& m_graph;
+    uint32_t m_pass_index;
+};
+
+// Frame is described as passes that declare what they read and write. compile() culls passes nothing depends on,
+// orders the rest, and places transient images in shared memory when their lifetimes don't overlap.
+// execute() issues one batched barrier per pass through the BarrierTracker.
+// Everything a frame declares goes into storage kept from the frames before, so a steady state frame doesn't allocate
+class RenderGraph {
+public:
+    void init(VkDevice device, VmaAllocator allocator, BarrierTracker* barriers);
+    void destroy();
+
+    void begin_frame();
+    // Names aren't copied, they have to outlive the frame. Imported images are owned elsewhere and must already be
+    // tracked by the BarrierTracker
+    RGResource import_image(const char* name, VkImage image, VkImageView image_view, VkExtent2D extent, VkImageAspectFlags aspect);
+    RGResource create_image(const char* name, const RGImageDesc& desc);
+    // Outputs are what the frame is for, anything not contributing to one gets culled
+    void set_output(RGResource resource, ImageUsage final_usage);
+
+    // setup(RGPassBuilder&) runs right away, execute(VkCommandBuffer, const RenderGraph&) is stored inline in the pass
+    // like a job's captures, so it has to be small and trivially copyable
+    template<typename Setup, typename Execute>
+    void add_pass(const char* name, const Setup& setup, const Execute& execute) {
+        static_assert(sizeof(Execute) <= PASS_STORAGE_SIZE, "Pass captures too large, capture a pointer to the data instead");
+        static_assert(alignof(Execute) <= 16, "Pass captures over-aligned");
+        static_assert(std::is_trivially_copyable_v<Execute> && std::is_trivially_destructible_v<Execute>, "Pass captures must be trivially copyable");
+
+        const uint32_t pass_index = begin_pass(name);
+        Pass& pass = m_passes[pass_index];
+        new (pass.storage) Execute(execute);
+        pass.execute = [](const std::byte* storage, VkCommandBuffer cmd, const RenderGraph& graph) {
+            (*std::launder(reinterpret_cast<const Execute*>(storage)))(cmd, graph);
+        };
+
+        RGPassBuilder builder(*this, pass_index);
+        setup(builder);
+    }
+
+    // Transients that get replaced are destroyed through retire_queue once the frame using them has finished
+    void compile(DeletionQueue& retire_queue);
+    void execute(VkCommandBuffer cmd);
+
+    VkImage image(RGResource resource) const;
+    VkImageView image_view(RGResource resource) const;
+    VkExtent2D extent(RGResource resource) const;
+    RenderGraphStats stats() const { return m_stats; }
+
+private:
+    friend class RGPassBuilder;
+
+    struct Access {
+        RGResource resource;
+        ImageUsage usage;
+        bool write;
+        bool discard_contents;
+    };
+
+    static constexpr size_t PASS_STORAGE_SIZE = 48;
+
+    // Kept across frames with their vectors' capacity, only the first m_pass_count are this frame's
+    struct Pass {
+        const char* name = nullptr;
+        std::vector<Access> accesses;
+        alignas(16) std::byte storage[PASS_STORAGE_SIZE];
+        void (*execute)(const std::byte* storage, VkCommandBuffer cmd, const RenderGraph& graph) = nullptr;
+        bool side_effects = false;
+        bool live = false;
+        // Producers whose results this pass consumes. Only these keep other passes alive
+        std::vector<uint32_t> data_dependencies;
+        // Every pass that has to run before this one (data plus write-after-read/write-after-write ordering)
+        std::vector<uint32_t> order_dependencies;
+    };
+
+    struct Resource {
+        const char* name = nullptr;
+        bool imported = false;
+        bool output = false;
+        ImageUsage final_usage = ImageUsage::Undefined;
+        RGImageDesc desc = {};
+        VkImageUsageFlags usage = 0;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView image_view = VK_NULL_HANDLE;
+        int32_t first_use = -1;
+        int32_t last_use = -1;
+        uint32_t transient_index = 0;
+    };
+
+    // A realized transient image. Several share one memory block when their lifetimes don't overlap
+    struct TransientImage {
+        RGImageDesc desc;
+        VkImageUsageFlags usage;
+        int32_t first_use;
+        int32_t last_use;
+        VkImage image;
+        VkImageView image_view;
+        uint32_t memory_block;
+        // Previous occupant of the same memory, its last use is what the first barrier waits on
+        uint32_t alias_predecessor;
+    };
+
+    uint32_t begin_pass(const char* name);
+    void build_dependencies();
+    void cull_passes();
+    void schedule_passes();
+    void realize_transients(DeletionQueue& retire_queue);
+    void destroy_transients(DeletionQueue* retire_queue);
+    // Adds the allocations since the last mark to the frame's count and moves the mark to now
+    void count_allocations();
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VmaAllocator m_allocator = VK_NULL_HANDLE;
+    BarrierTracker* m_barriers = nullptr;
+
+    std::vector<Pass> m_passes;
+    uint32_t m_pass_count = 0;
+    std::vector<Resource> m_resources;
+    std::vector<uint32_t> m_schedule;
+
+    // Scratch for compile() and execute(), members so their capacity carries over to the next frame
+    std::vector<int32_t> m_last_writer;
+    // Per resource list of the passes that read it since its last write, linked through m_reader_nodes
+    std::vector<int32_t> m_first_reader;
+    std::vector<std::pair<uint32_t, int32_t>> m_reader_nodes;
+    std::vector<uint32_t> m_pass_stack;
+    std::vector<uint32_t> m_remaining_dependencies;
+    // Dependents of pass i are m_dependents[m_dependent_offsets[i]] up to m_dependent_offsets[i + 1]
+    std::vector<uint32_t> m_dependent_offsets;
+    std::vector<uint32_t> m_dependents;
+    std::vector<uint32_t> m_ready;
+    std::vector<uint32_t> m_transient_resources;
+    std::vector<uint8_t> m_acquired;
+    uint64_t m_allocation_mark = 0;
+    uint64_t m_heap_allocations = 0;
+
+    std::vector<TransientImage> m_transients;
+    std::vector<VmaAllocation> m_memory_blocks;
+    RenderGraphStats m_stats = {};
+};
+
+#endif //PORTFOLIO_RENDERGRAPH_H
@@ -4,17 +4,87 @@
 #include <cmath>
 #include <iostream>
 #include <thread>
+#include <tuple>
 #include <array>
+#include <chrono>
+#include <sstream>
 
 #include "SDL3/SDL_vulkan.h"
+#include "AllocationCounter.h"
+#include "EmbeddedShaders.h"
 #include "Initializers.h"
+#include "Loader.h"
+#include "Pipelines.h"
+#include "Textures.h"
 #include "Utilities.h"
 
 #include "imgui.h"
 #include "backends/imgui_impl_vulkan.h"
 #include "backends/imgui_impl_sdl3.h"
 
-Renderer::Renderer() {
+namespace {
+    // What the shader editor starts with: push constants the registry can fill, one storage image to write
+    constexpr const char* EDITOR_TEMPLATE = R"(#version 460
+
+layout (local_size_x = 16, local_size_y = 16) in;
+
+layout(rgba16f, set = 0, binding = 0) uniform image2D image;
+
+layout(push_constant) uniform constants {
+    vec4 color;
+    float time;
+} pc;
+
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(image);
+    if (texel.x >= size.x || texel.y >= size.y) {
+        return;
+    }
+    vec2 uv = vec2(texel) / vec2(size);
+    float wave = 0.5 + 0.5 * sin(uv.x * 12.0 + pc.time * 2.0);
+    imageStore(image, texel, vec4(pc.color.rgb * wave * uv.y, 1.0));
+}
+)";
+
+    // A directory under the per user data directory. A path relative to the working directory would scatter caches
+    // wherever the executable was launched from. Empty when there is none, callers then keep nothing on disk
+    std::string user_data_directory(const char* name) {
+        char* pref_path = SDL_GetPrefPath("VulkanPortfolio", "ShaderPlayground");
+        if (pref_path == nullptr) {
+            std::cerr << "No user data directory for the " << name << " cache: " << SDL_GetError() << std::endl;
+            return {};
+        }
+        std::string directory = std::string(pref_path) + name;
+        SDL_free(pref_path);
+        return directory;
+    }
+
+    // Lets ImGui edit a std::string in place, growing it as the text does
+    int resize_string(ImGuiInputTextCallbackData* data) {
+        if (data->EventFlag == ImGuiInputTextFlags_CallbackResize) {
+            auto* text = static_cast<std::string*>(data->UserData);
+            text->resize(data->BufTextLen);
+            data->Buf = text->data();
+        }
+        return 0;
+    }
+
+    bool input_string(const char* label, std::string& text) {
+        return ImGui::InputText(label, text.data(), text.capacity() + 1, ImGuiInputTextFlags_CallbackResize, resize_string, &text);
+    }
+
+    std::vector<std::string> split_words(const std::string& text) {
+        std::istringstream tokens(text);
+        std::vector<std::string> words;
+        for (std::string word; tokens >> word;) {
+            words.push_back(word);
+        }
+        return words;
+    }
+}
+
+Renderer::Renderer(const RendererOptions& options) : m_options(options) {
     init_sdl();
     init_vulkan();
     m_is_initialized = true;
@@ -39,16 +109,31 @@ Renderer::~Renderer() {
 }
 
 void Renderer::init_sdl() {
+    if (m_options.headless) {
+        // Presents to VK_EXT_headless_surface, no display needed
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    }
     if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMEPAD)) {
         std::cerr << "Failed to initialize SDL: " << SDL_GetError() << std::endl;
+        if (m_options.headless) {
+            std::cerr << "Falling back to a hidden window" << std::endl;
+            SDL_ResetHint(SDL_HINT_VIDEO_DRIVER);
+            SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMEPAD);
+        }
     }
 
     const float main_scale = SDL_GetDisplayContentScale(SDL_GetPrimaryDisplay());
-    constexpr SDL_WindowFlags window_flags = SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_HIGH_PIXEL_DENSITY; // | SDL_WINDOW_HIDDEN
+    SDL_WindowFlags window_flags = SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_HIGH_PIXEL_DENSITY;
+    if (m_options.headless) {
+        window_flags |= SDL_WINDOW_HIDDEN;
+    }
 
+    // A replay resizes the window to the captured size on its first frame
     const SDL_DisplayMode* mode = SDL_GetCurrentDisplayMode(SDL_GetPrimaryDisplay());
-    m_window_extent.width = (mode->w * 0.8f) / main_scale;
-    m_window_extent.height = (mode->h * 0.8f) / main_scale;
+    if (mode && main_scale > 0.0f) {
+        m_window_extent.width = (mode->w * 0.8f) / main_scale;
+        m_window_extent.height = (mode->h * 0.8f) / main_scale;
+    }
 
     m_window = SDL_CreateWindow("Vulkan Portfolio", m_window_extent.width, m_window_extent.height, window_flags);
     if (!m_window)
@@ -74,11 +159,20 @@ void Renderer::init_vulkan() {
     init_vma();
     init_swapchain();
     init_commands();
+    init_geometry_pool();
+    init_render_graph();
     init_sync_objects();
+    init_job_system();
+    init_render_thread();
     init_descriptors();
+    init_async_compute();
+    init_profiler();
     init_pipelines();
     init_imgui();
     init_default_data();
+    init_capture();
+    init_readback();
+    init_shader_compiler();
     m_is_initialized = true;
 }
 
@@ -137,15 +231,43 @@ void Renderer::create_physical_device() {
     features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
     features12.bufferDeviceAddress = true;
     features12.descriptorIndexing = true;
+    features12.timelineSemaphore = true;
 
     vkb::PhysicalDeviceSelector selector(m_vkb_instance);
     m_vkb_physical_device = selector.set_minimum_version(1, 4)
+        .prefer_gpu_device_type(m_options.prefer_cpu_device ? vkb::PreferredDeviceType::cpu : vkb::PreferredDeviceType::discrete)
         .set_required_features_13(features13)
         .set_required_features_12(features12)
         .set_surface(m_surface)
         .select()
         .value();
 
+    // BC textures are optional, without them compressed imports fall back to uncompressed uploads
+    VkPhysicalDeviceFeatures optional_features = {};
+    optional_features.textureCompressionBC = true;
+    m_bc_textures_supported = m_vkb_physical_device.enable_features_if_present(optional_features);
+
+    // The upscaler writes BGRA swapchain images, which have no GLSL format qualifier
+    VkPhysicalDeviceFeatures storage_features = {};
+    storage_features.shaderStorageImageWriteWithoutFormat = true;
+    m_storage_write_without_format = m_vkb_physical_device.enable_features_if_present(storage_features);
+
+    // Present wait lets the CPU hold off sampling input until an earlier frame is actually on screen
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features = {};
+    present_id_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    present_id_features.presentId = true;
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features = {};
+    present_wait_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    present_wait_features.presentWait = true;
+    m_present_wait_supported = m_vkb_physical_device.enable_extensions_if_present({VK_KHR_PRESENT_ID_EXTENSION_NAME, VK_KHR_PRESENT_WAIT_EXTENSION_NAME}) &&
+        m_vkb_physical_device.enable_extension_features_if_present(present_id_features) &&
+        m_vkb_physical_device.enable_extension_features_if_present(present_wait_features);
+
+    uint32_t present_mode_count = 0;
+    VK_CHECK(vkGetPhysicalDeviceSurfacePresentModesKHR(m_vkb_physical_device.physical_device, m_surface, &present_mode_count, nullptr));
+    m_supported_present_modes.resize(present_mode_count);
+    VK_CHECK(vkGetPhysicalDeviceSurfacePresentModesKHR(m_vkb_physical_device.physical_device, m_surface, &present_mode_count, m_supported_present_modes.data()));
+
     std::cout << "vkb physical device created" << std::endl;
 }
 
@@ -158,52 +280,130 @@ void Renderer::create_device() {
 
     m_graphics_queue = m_vkb_device.get_queue(vkb::QueueType::graphics).value();
     m_graphics_queue_index = m_vkb_device.get_queue_index(vkb::QueueType::graphics).value();
+
+    if (m_present_wait_supported) {
+        m_wait_for_present = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(m_vkb_device.device, "vkWaitForPresentKHR"));
+        m_present_wait_supported = m_wait_for_present != nullptr;
+    }
+
+    // A compute-only family lets the background run beside graphics work, without one everything stays on one queue
+    auto compute_queue = m_vkb_device.get_dedicated_queue(vkb::QueueType::compute);
+    if (compute_queue.has_value()) {
+        m_compute_queue = compute_queue.value();
+        m_compute_queue_index = m_vkb_device.get_dedicated_queue_index(vkb::QueueType::compute).value();
+        m_async_compute_available = true;
+        m_ui_settings.use_async_compute = true;
+        std::cout << "Dedicated compute queue family " << m_compute_queue_index << " found" << std::endl;
+    }
+
+    const std::vector<VkQueueFamilyProperties> queue_families = m_vkb_physical_device.get_queue_families();
+    m_compute_timestamps_supported = m_async_compute_available && queue_families[m_compute_queue_index].timestampValidBits > 0;
 }
 
 void Renderer::create_swapchain(const uint32_t width, const uint32_t height) {
     vkb::SwapchainBuilder swapchain_builder(m_vkb_physical_device.physical_device, m_vkb_device.device, m_surface);
     m_swapchain_image_format = VK_FORMAT_B8G8R8A8_UNORM;
+    m_present_mode = choose_present_mode(m_settings.present_mode);
+
+    // Storage swapchain images let the upscaler write the final image directly instead of through an intermediate
+    VkSurfaceCapabilitiesKHR surface_capabilities = {};
+    VK_CHECK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_vkb_physical_device.physical_device, m_surface, &surface_capabilities));
+    VkFormatProperties format_properties = {};
+    vkGetPhysicalDeviceFormatProperties(m_vkb_physical_device.physical_device, m_swapchain_image_format, &format_properties);
+    m_swapchain_storage_supported = m_storage_write_without_format &&
+        (surface_capabilities.supportedUsageFlags & VK_IMAGE_USAGE_STORAGE_BIT) != 0 &&
+        (format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
 
     m_vkb_swapchain = swapchain_builder.set_desired_format(VkSurfaceFormatKHR{.format = m_swapchain_image_format, .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR})
-        .set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR) // VSync
+        .set_desired_present_mode(m_present_mode)
         .set_desired_extent(width, height)
-        .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
-        .set_desired_min_image_count(3)
+        .add_image_usage_flags(swapchain_usage_flags())
+        .set_desired_min_image_count(swapchain_image_count())
         .build()
         .value();
 
     m_swapchain_extent = m_vkb_swapchain.extent;
     m_swapchain_images = m_vkb_swapchain.get_images().value();
     m_swapchain_image_views = m_vkb_swapchain.get_image_views().value();
-    m_submit_semaphores.resize(m_swapchain_images.size());
 }
 
 void Renderer::resize_swapchain(const uint32_t width, const uint32_t height) {
-    vkDeviceWaitIdle(m_vkb_device.device);
-
+    // No wait for idle: the new swapchain is built from the old one while frames are still in flight,
+    // and everything tied to the old one is retired through the current frame's deletion queue
+    m_present_mode = choose_present_mode(m_settings.present_mode);
     vkb::SwapchainBuilder swapchain_builder{ m_vkb_device };
     auto swap_ret = swapchain_builder.set_old_swapchain(m_vkb_swapchain)
         .set_desired_format(VkSurfaceFormatKHR{.format = m_swapchain_image_format, .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR})
-        .set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR) // VSync
+        .set_desired_present_mode(m_present_mode)
         .set_desired_extent(width, height)
-        .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
-        .set_desired_min_image_count(3)
+        .add_image_usage_flags(swapchain_usage_flags())
+        .set_desired_min_image_count(swapchain_image_count())
         .build();
-    if (!swap_ret){
-        m_vkb_swapchain.swapchain = VK_NULL_HANDLE;
+    if (!swap_ret) {
+        // Usually a zero sized surface mid-resize, keep the old swapchain and try again next frame
+        std::cerr << "Failed to recreate swapchain: " << swap_ret.error().message() << std::endl;
+        return;
     }
 
-    for (const VkImageView& image_view : m_swapchain_image_views) {
-        vkDestroyImageView(m_vkb_device.device, image_view, nullptr);
+    // The old swapchain's images can still be waiting on presentation. When this frame slot comes around again
+    // every frame that used them has finished, which is when they and their semaphores go
+    for (const VkImage& image : m_swapchain_images) {
+        m_barriers.forget(image);
     }
-    vkb::destroy_swapchain(m_vkb_swapchain);
+    get_current_frame().deletion_queue.push_function([device = m_vkb_device.device, old_swapchain = m_vkb_swapchain,
+        image_views = m_swapchain_image_views, semaphores = m_submit_semaphores]() {
+        for (VkImageView image_view : image_views) {
+            vkDestroyImageView(device, image_view, nullptr);
+        }
+        for (VkSemaphore semaphore : semaphores) {
+            vkDestroySemaphore(device, semaphore, nullptr);
+        }
+        vkb::destroy_swapchain(old_swapchain);
+    });
+
     m_vkb_swapchain = swap_ret.value();
     m_swapchain_extent = m_vkb_swapchain.extent;
     m_swapchain_images = m_vkb_swapchain.get_images().value();
     m_swapchain_image_views = m_vkb_swapchain.get_image_views().value();
+    // Present ids count per swapchain, the new one starts over
+    m_present_id = 0;
+    m_submit_semaphores.clear();
+    create_submit_semaphores();
+
+    ensure_render_targets(m_swapchain_extent);
     resize_requested = false;
 }
 
+VkPresentModeKHR Renderer::choose_present_mode(VkPresentModeKHR requested) const {
+    // Each mode falls back towards FIFO, the one mode every implementation has to support.
+    // IMMEDIATE prefers MAILBOX next since both are about latency, MAILBOX goes straight to FIFO rather than start tearing
+    std::vector<VkPresentModeKHR> candidates = {requested};
+    if (requested == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+        candidates.push_back(VK_PRESENT_MODE_MAILBOX_KHR);
+    }
+    for (VkPresentModeKHR candidate : candidates) {
+        if (std::find(m_supported_present_modes.begin(), m_supported_present_modes.end(), candidate) != m_supported_present_modes.end()) {
+            return candidate;
+        }
+    }
+    std::cout << "Present mode " << string_VkPresentModeKHR(requested) << " not supported, falling back to FIFO" << std::endl;
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+VkImageUsageFlags Renderer::swapchain_usage_flags() const {
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if (m_swapchain_storage_supported) {
+        usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    }
+    return usage;
+}
+
+uint32_t Renderer::swapchain_image_count() const {
+    // One image per frame the CPU may be recording plus the one on screen. Mailbox needs a spare to replace
+    const uint32_t minimum = m_present_mode == VK_PRESENT_MODE_MAILBOX_KHR ? 3 : 2;
+    return std::max(m_frames_in_flight + 1, minimum);
+}
+
 void Renderer::init_swapchain() {
     create_swapchain(m_window_extent.width, m_window_extent.height);
     std::cout << "Initial swapchain created" << std::endl;
@@ -213,51 +413,113 @@ void Renderer::init_swapchain() {
     //     m_deletion_queue.push_function([&](){vkDestroyImageView(m_vkb_device.device, image_view, nullptr);});
     // }
 
-    VkExtent3D draw_image_extent = {
-        m_window_extent.width,
-        m_window_extent.height,
-        1
-    };
+    create_render_targets(m_swapchain_extent);
+
+    m_deletion_queue.push_function([this]() {
+        std::cout << "m_deletion_queue destroy render targets" << std::endl;
+        destroy_render_targets(m_render_targets);
+    });
+}
+
+void Renderer::create_render_targets(VkExtent2D extent) {
+    const VkExtent3D image_extent = {extent.width, extent.height, 1};
+    VmaAllocationCreateInfo render_img_alloc_info = {};
+    render_img_alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY; // Allocate it from gpu local memory
+    render_img_alloc_info.requiredFlags = static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
     m_draw_image.image_format = VK_FORMAT_R16G16B16A16_SFLOAT;
-    m_draw_image.image_extent = draw_image_extent;
+    m_draw_image.image_extent = image_extent;
 
     VkImageUsageFlags draw_image_usages = {};
     draw_image_usages |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
     draw_image_usages |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
     draw_image_usages |= VK_IMAGE_USAGE_STORAGE_BIT;
     draw_image_usages |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    draw_image_usages |= VK_IMAGE_USAGE_SAMPLED_BIT;
 
-    VkImageCreateInfo render_img_info = init::image_create_info(m_draw_image.image_format, draw_image_usages, draw_image_extent);
-    VmaAllocationCreateInfo render_img_alloc_info = {};
-    render_img_alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY; // Allocate it from gpu local memory
-    render_img_alloc_info.requiredFlags = static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    vmaCreateImage(m_allocator, &render_img_info, &render_img_alloc_info, &m_draw_image.image, &m_draw_image.allocation, nullptr);
+    VkImageCreateInfo render_img_info = init::image_create_info(m_draw_image.image_format, draw_image_usages, image_extent);
+    VK_CHECK(vmaCreateImage(m_allocator, &render_img_info, &render_img_alloc_info, &m_draw_image.image, &m_draw_image.allocation, nullptr));
     VkImageViewCreateInfo render_view_info = init::image_view_create_info(m_draw_image.image_format, m_draw_image.image, VK_IMAGE_ASPECT_COLOR_BIT);
     VK_CHECK(vkCreateImageView(m_vkb_device.device, &render_view_info, nullptr, &m_draw_image.image_view));
+    m_barriers.track(m_draw_image.image, VK_IMAGE_ASPECT_COLOR_BIT);
 
-    m_deletion_queue.push_function([this]() {
-        std::cout << "m_deletion_queue vmaDestroyImage(m_allocator, m_draw_image.image, m_draw_image.allocation);" << std::endl;
-        vkDestroyImageView(m_vkb_device.device, m_draw_image.image_view, nullptr);
-        vmaDestroyImage(m_allocator, m_draw_image.image, m_draw_image.allocation);
-    });
+    m_render_targets.clear();
+    m_render_targets.push_back(m_draw_image);
 
-    m_depth_image.image_format = VK_FORMAT_D32_SFLOAT;
-    m_depth_image.image_extent = draw_image_extent;
-    VkImageUsageFlags depth_image_usages = {};
-    depth_image_usages |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    // Concurrent sharing spares the queue family ownership transfers, the timeline semaphore does the ordering.
+    // One image per frame in flight so compute can fill the next one while graphics still reads the last
+    if (m_async_compute_available) {
+        for (AllocatedImage& background : m_background_images) {
+            background = create_shared_storage_image(image_extent, VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+            m_render_targets.push_back(background);
+        }
+    }
 
-    VkImageCreateInfo depth_img_info = init::image_create_info(m_depth_image.image_format, depth_image_usages, draw_image_extent);
-    vmaCreateImage(m_allocator, &depth_img_info, &render_img_alloc_info, &m_depth_image.image, &m_depth_image.allocation, nullptr);
-    VkImageViewCreateInfo depth_view_info = init::image_view_create_info(m_depth_image.image_format, m_depth_image.image, VK_IMAGE_ASPECT_DEPTH_BIT);
-    VK_CHECK(vkCreateImageView(m_vkb_device.device, &depth_view_info, nullptr, &m_depth_image.image_view));
+    std::cout << "Render targets allocated at " << extent.width << "x" << extent.height << std::endl;
+}
 
-    m_deletion_queue.push_function([this]() {
-        std::cout << "m_deletion_queue vmaDestroyImage(m_allocator, m_depth_image.image, m_depth_image.allocation);" << std::endl;
-        vkDestroyImageView(m_vkb_device.device, m_depth_image.image_view, nullptr);
-        vmaDestroyImage(m_allocator, m_depth_image.image, m_depth_image.allocation);
-});
+AllocatedImage Renderer::create_shared_storage_image(VkExtent3D extent, VkImageUsageFlags usage) {
+    VmaAllocationCreateInfo alloc_info = {};
+    alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    alloc_info.requiredFlags = static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    AllocatedImage image = {};
+    image.image_format = VK_FORMAT_R16G16B16A16_SFLOAT;
+    image.image_extent = extent;
+
+    VkImageCreateInfo image_info = init::image_create_info(image.image_format, VK_IMAGE_USAGE_STORAGE_BIT | usage, extent);
+    // Concurrent sharing spares the queue family ownership transfers when the background moves between queues
+    const uint32_t queue_families[] = {m_graphics_queue_index, m_compute_queue_index};
+    if (m_async_compute_available) {
+        image_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        image_info.queueFamilyIndexCount = 2;
+        image_info.pQueueFamilyIndices = queue_families;
+    }
+    VK_CHECK(vmaCreateImage(m_allocator, &image_info, &alloc_info, &image.image, &image.allocation, nullptr));
+
+    VkImageViewCreateInfo view_info = init::image_view_create_info(image.image_format, image.image, VK_IMAGE_ASPECT_COLOR_BIT);
+    VK_CHECK(vkCreateImageView(m_vkb_device.device, &view_info, nullptr, &image.image_view));
+    return image;
+}
+
+void Renderer::destroy_render_targets(const std::vector<AllocatedImage>& render_targets) {
+    for (const AllocatedImage& image : render_targets) {
+        vkDestroyImageView(m_vkb_device.device, image.image_view, nullptr);
+        vmaDestroyImage(m_allocator, image.image, image.allocation);
+    }
+}
+
+void Renderer::ensure_render_targets(VkExtent2D required) {
+    const VkExtent2D current = {m_draw_image.image_extent.width, m_draw_image.image_extent.height};
+    const bool grow = required.width > current.width || required.height > current.height;
+    // Giving memory back is only worth a reallocation once most of it sits unused
+    const bool shrink = static_cast<uint64_t>(required.width) * required.height * RENDER_TARGET_SHRINK_RATIO <
+        static_cast<uint64_t>(current.width) * current.height;
+    if (!grow && !shrink) {
+        return;
+    }
+
+    // Overshoot on the way up so dragging a window edge reallocates a handful of times instead of every frame
+    const uint32_t max_dimension = m_vkb_physical_device.properties.limits.maxImageDimension2D;
+    VkExtent2D extent = {
+        std::min(static_cast<uint32_t>(std::ceil(required.width * RENDER_TARGET_GROWTH)), max_dimension),
+        std::min(static_cast<uint32_t>(std::ceil(required.height * RENDER_TARGET_GROWTH)), max_dimension)
+    };
+    if (grow) {
+        extent.width = std::max(extent.width, current.width);
+        extent.height = std::max(extent.height, current.height);
+    }
+
+    // Frames in flight may still use the old images, they go once this frame slot comes around again
+    const std::vector<AllocatedImage> retired = m_render_targets;
+    for (const AllocatedImage& image : retired) {
+        m_barriers.forget(image.image);
+    }
+    get_current_frame().deletion_queue.push_function([this, retired]() {
+        destroy_render_targets(retired);
+    });
+
+    create_render_targets(extent);
 }
 
 void Renderer::destroy_swapchain() {
@@ -270,7 +532,7 @@ void Renderer::destroy_swapchain() {
 
 void Renderer::init_commands() {
     VkCommandPoolCreateInfo command_pool_info = init::command_pool_create_info(m_graphics_queue_index, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
-    for (int i = 0; i < FRAME_OVERLAP; i++) {
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         VK_CHECK(vkCreateCommandPool(m_vkb_device.device, &command_pool_info, nullptr, &m_frames[i].command_pool));
 
         VkCommandBufferAllocateInfo cmd_alloc_info = init::command_buffer_allocate_info(m_frames[i].command_pool, 1);
@@ -285,6 +547,24 @@ void Renderer::init_commands() {
     }
     std::cout << "FIF Command buffers allocated" << std::endl;
 
+    if (m_async_compute_available) {
+        VkCommandPoolCreateInfo compute_pool_info = init::command_pool_create_info(m_compute_queue_index, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            VK_CHECK(vkCreateCommandPool(m_vkb_device.device, &compute_pool_info, nullptr, &m_frames[i].compute_command_pool));
+
+            VkCommandBufferAllocateInfo cmd_alloc_info = init::command_buffer_allocate_info(m_frames[i].compute_command_pool, 1);
+            VK_CHECK(vkAllocateCommandBuffers(m_vkb_device.device, &cmd_alloc_info, &m_frames[i].compute_command_buffer));
+        }
+
+        m_deletion_queue.push_function([this]() {
+            std::cout << "m_deletion_queue vkDestroyCommandPool compute" << std::endl;
+            for (const FrameData& frame : m_frames) {
+                vkDestroyCommandPool(m_vkb_device.device, frame.compute_command_pool, nullptr);
+            }
+        });
+        std::cout << "FIF compute command buffers allocated" << std::endl;
+    }
+
     VK_CHECK(vkCreateCommandPool(m_vkb_device.device, &command_pool_info, nullptr, &m_imm_command_pool));
     VkCommandBufferAllocateInfo cmd_alloc_info = init::command_buffer_allocate_info(m_imm_command_pool, 1);
     VK_CHECK(vkAllocateCommandBuffers(m_vkb_device.device, &cmd_alloc_info, &m_imm_command_buffer));
@@ -301,14 +581,12 @@ void Renderer::init_sync_objects() {
     VkFenceCreateInfo fence_info = init::fence_create_info(VK_FENCE_CREATE_SIGNALED_BIT);
     VkSemaphoreCreateInfo semaphore_info = init::semaphore_create_info();
 
-    for (int i = 0; i < FRAME_OVERLAP; i++) {
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         VK_CHECK(vkCreateFence(m_vkb_device.device, &fence_info, nullptr, &m_frames[i].render_fence));
         VK_CHECK(vkCreateSemaphore(m_vkb_device.device, &semaphore_info, nullptr, &m_frames[i].acquire_semaphore));
     }
 
-    for (int i = 0; i < m_swapchain_images.size(); i++) {
-        VK_CHECK(vkCreateSemaphore(m_vkb_device.device, &semaphore_info, nullptr, &m_submit_semaphores[i]));
-    }
+    create_submit_semaphores();
 
     VK_CHECK(vkCreateFence(m_vkb_device.device, &fence_info, nullptr, &m_imm_fence));
     std::cout << "Synchronization objects created" << std::endl;
@@ -325,12 +603,10 @@ void Renderer::init_sync_objects() {
         });
     }
 
-    for (const auto& semaphore : m_submit_semaphores) {
-        m_deletion_queue.push_function([&]() {
-            std::cout << "m_deletion_queue vkDestroySemaphore semaphore" << std::endl;
-            vkDestroySemaphore(m_vkb_device.device, semaphore, nullptr);
-        });
-    }
+    m_deletion_queue.push_function([this]() {
+        std::cout << "m_deletion_queue vkDestroySemaphore submit semaphores" << std::endl;
+        destroy_submit_semaphores();
+    });
 
     m_deletion_queue.push_function([this]() {
         std::cout << "m_deletion_queue vkDestroyFence" << std::endl;
@@ -338,6 +614,22 @@ void Renderer::init_sync_objects() {
     });
 }
 
+void Renderer::create_submit_semaphores() {
+    // Indexed by swapchain image, presentation of an image is the only thing that releases its semaphore
+    VkSemaphoreCreateInfo semaphore_info = init::semaphore_create_info();
+    m_submit_semaphores.resize(m_swapchain_images.size());
+    for (VkSemaphore& semaphore : m_submit_semaphores) {
+        VK_CHECK(vkCreateSemaphore(m_vkb_device.device, &semaphore_info, nullptr, &semaphore));
+    }
+}
+
+void Renderer::destroy_submit_semaphores() {
+    for (VkSemaphore semaphore : m_submit_semaphores) {
+        vkDestroySemaphore(m_vkb_device.device, semaphore, nullptr);
+    }
+    m_submit_semaphores.clear();
+}
+
 void Renderer::init_vma() {
     VmaAllocatorCreateInfo allocator_info = {};
     allocator_info.physicalDevice = m_vkb_physical_device.physical_device;
@@ -354,45 +646,192 @@ void Renderer::init_vma() {
     std::cout << "VMA allocator created" << std::endl;
 }
 
+void Renderer::init_render_graph() {
+    m_render_graph.init(m_vkb_device.device, m_allocator, &m_barriers);
+
+    m_deletion_queue.push_function([this]() {
+        std::cout << "m_deletion_queue m_render_graph.destroy()" << std::endl;
+        m_render_graph.destroy();
+    });
+
+    std::cout << "Render graph initialized" << std::endl;
+}
+
+void Renderer::init_geometry_pool() {
+    m_geometry_pool.init(m_vkb_device.device, m_allocator, GEOMETRY_POOL_VERTEX_CAPACITY, sizeof(Vertex), GEOMETRY_POOL_INDEX_CAPACITY);
+
+    m_deletion_queue.push_function([this]() {
+        std::cout << "m_deletion_queue m_geometry_pool.destroy()" << std::endl;
+        m_geometry_pool.destroy();
+    });
+
+    std::cout << "Geometry pool created" << std::endl;
+}
+
+void Renderer::init_async_compute() {
+    if (!m_async_compute_available) {
+        return;
+    }
+
+    VkSemaphoreTypeCreateInfo timeline_info = {};
+    timeline_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timeline_info.pNext = nullptr;
+    timeline_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timeline_info.initialValue = 0;
+    VkSemaphoreCreateInfo semaphore_info = init::semaphore_create_info();
+    semaphore_info.pNext = &timeline_info;
+    VK_CHECK(vkCreateSemaphore(m_vkb_device.device, &semaphore_info, nullptr, &m_compute_timeline));
+
+    m_deletion_queue.push_function([this]() {
+        std::cout << "m_deletion_queue vkDestroySemaphore compute timeline" << std::endl;
+        vkDestroySemaphore(m_vkb_device.device, m_compute_timeline, nullptr);
+    });
+
+    std::cout << "Async compute initialized" << std::endl;
+}
+
+void Renderer::init_job_system() {
+    // This thread is worker 0, it runs jobs whenever it waits on them
+    m_jobs.init();
+
+    m_deletion_queue.push_function([this]() {
+        std::cout << "m_deletion_queue m_jobs.shutdown()" << std::endl;
+        m_jobs.shutdown();
+    });
+}
+
+void Renderer::init_render_thread() {
+    // The scene jobs allocate from their worker's sub-arena
+    for (FrameSnapshot& snapshot : m_snapshots.slots()) {
+        snapshot.arena.init(1024 * 1024, m_jobs.thread_count(), 64 * 1024);
+    }
+    m_slot_frame_numbers.fill(NO_FRAME);
+    std::cout << "Render thread snapshots initialized" << std::endl;
+}
+
+void Renderer::init_capture() {
+    static_assert(std::is_trivially_copyable_v<FrameInputs>, "Frame inputs are written to captures as they are in memory");
+    std::scoped_lock lock(m_effects_mutex);
+    collect_parameter_blocks();
+    if (!m_options.replay_path.empty()) {
+        m_replaying = m_replay.open(m_options.replay_path, sizeof(FrameInputs), m_parameter_blocks);
+    } else if (!m_options.capture_path.empty()) {
+        m_capture.open(m_options.capture_path, sizeof(FrameInputs), m_parameter_blocks);
+    }
+}
+
+void Renderer::init_readback() {
+    if (m_options.frame_output_directory.empty()) {
+        return;
+    }
+
+    // Encoding takes far longer than the copy, enough buffers to cover the workers twice over plus the frames in flight
+    const uint32_t worker_count = std::max(1u, std::thread::hardware_concurrency() / 4);
+    if (!m_readback.init(m_vkb_device.device, m_allocator, m_options.frame_output_directory, m_options.frame_output_format,
+            MAX_FRAMES_IN_FLIGHT + worker_count * 2, worker_count)) {
+        return;
+    }
+    m_deletion_queue.push_function([this]() {
+        std::cout << "m_deletion_queue destroy frame readback" << std::endl;
+        m_readback.destroy();
+    });
+}
+
+void Renderer::init_shader_compiler() {
+    // glslang takes tens of milliseconds a shader, two workers keep the editor responsive without taking many cores.
+    // Without a user data directory the cache stays in memory
+    m_shader_compiler.init(user_data_directory("shaders"), 2);
+    m_shader_editor.source = EDITOR_TEMPLATE;
+    m_shader_editor.assignments = "color=1,0.5,0.2,1 time=@time";
+    m_deletion_queue.push_function([this]() {
+        std::cout << "m_deletion_queue destroy shader compiler" << std::endl;
+        m_shader_compiler.destroy();
+    });
+}
+
+void Renderer::collect_parameter_blocks() {
+    m_parameter_blocks.clear();
+    auto add_effect = [this](ComputeEffect& effect) {
+        for (const EffectParameter& parameter : effect.parameters) {
+            if (parameter.editable()) {
+                m_parameter_blocks.emplace_back(effect.parameter_data(parameter), parameter.member.size);
+            }
+        }
+    };
+    for (ComputeEffect& effect : m_effect_registry.effects()) {
+        add_effect(effect);
+    }
+    for (EffectChain& chain : m_effect_registry.chains()) {
+        m_parameter_blocks.push_back(std::as_writable_bytes(std::span(&chain.ticks_per_frame, 1)));
+        for (ChainPass& pass : chain.passes) {
+            add_effect(pass.effect);
+        }
+    }
+}
+
+bool Renderer::capture_frame_inputs(FrameInputs& inputs) {
+    if (!m_capture.is_open() && !m_replaying) {
+        return true;
+    }
+    std::scoped_lock lock(m_effects_mutex);
+    // Rebuilt every frame, it only points into the registry and costs nothing once the vector has grown
+    collect_parameter_blocks();
+    if (m_replaying) {
+        return m_replay.read_frame(&inputs, m_parameter_blocks);
+    }
+    m_capture.write_frame(&inputs, m_parameter_blocks);
+    return true;
+}
+
+void Renderer::apply_frame_inputs(const FrameInputs& inputs) {
+    // A no-op unless replaying, the UI already left everything like this
+    m_ui_settings = inputs.settings;
+    m_use_instancing = inputs.use_instancing;
+    m_mesh_grid_size = inputs.mesh_grid_size;
+    m_mouse_position = inputs.mouse_position;
+    if (inputs.reset_chain >= 0) {
+        std::scoped_lock lock(m_effects_mutex);
+        std::vector<EffectChain>& chains = m_effect_registry.chains();
+        if (inputs.reset_chain < static_cast<int>(chains.size())) {
+            chains[inputs.reset_chain].needs_reset = true;
+        }
+    }
+}
+
+void Renderer::init_profiler() {
+    m_profiler.init(m_vkb_device.device, m_vkb_physical_device.properties.limits.timestampPeriod, MAX_FRAMES_IN_FLIGHT);
+
+    m_deletion_queue.push_function([this]() {
+        std::cout << "m_deletion_queue m_profiler.destroy()" << std::endl;
+        m_profiler.destroy();
+    });
+
+    std::cout << "GPU profiler initialized" << std::endl;
+}
+
 void Renderer::init_descriptors() {
     std::vector<DescriptorAllocatorGrowable::PoolSizeRatio> sizes =
     {
         { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3 },
         { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 },
         { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3 },
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
         { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
     };
 
     m_global_descriptor_allocator.init(m_vkb_device.device, 10, sizes);
-    {
-        DescriptorLayoutBuilder builder = {};
-        builder.add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-        m_draw_image_descriptor_layout = builder.build(m_vkb_device.device, VK_SHADER_STAGE_COMPUTE_BIT);
-    }
-
-    m_draw_image_descriptors = m_global_descriptor_allocator.allocate(m_vkb_device.device, m_draw_image_descriptor_layout);
-
-    VkDescriptorImageInfo img_info = {};
-    img_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-    img_info.imageView = m_draw_image.image_view;
-
-    VkWriteDescriptorSet draw_image_write = {};
-    draw_image_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    draw_image_write.pNext = nullptr;
-    draw_image_write.dstBinding = 0;
-    draw_image_write.dstSet = m_draw_image_descriptors;
-    draw_image_write.descriptorCount = 1;
-    draw_image_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    draw_image_write.pImageInfo = &img_info;
-
-    vkUpdateDescriptorSets(m_vkb_device.device, 1, &draw_image_write, 0, nullptr);
 
-    // m_deletion_queue.push_function([&]() {
-    //     m_global_descriptor_allocator.destroy_pools(m_vkb_device.device);
-    //     vkDestroyDescriptorSetLayout(m_vkb_device.device, m_draw_image_descriptor_layout, nullptr);
-    // });
+    // Every per-frame constant comes from here. Dynamic uniform offsets, storage offsets and device addresses all
+    // have to respect the alignment, 16 covers the vec4 and mat4 data read through addresses
+    const VkPhysicalDeviceLimits& limits = m_vkb_physical_device.properties.limits;
+    const VkDeviceSize ring_alignment = std::max({limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment, VkDeviceSize{16}});
+    m_frame_ring.init(m_vkb_device.device, m_allocator, 4 * 1024 * 1024, ring_alignment, MAX_FRAMES_IN_FLIGHT);
+    m_deletion_queue.push_function([this]() {
+        std::cout << "m_deletion_queue m_frame_ring.destroy()" << std::endl;
+        m_frame_ring.destroy();
+    });
 
-    for (int i = 0; i < FRAME_OVERLAP; i++) {
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         // create a descriptor pool
         std::vector<DescriptorAllocatorGrowable::PoolSizeRatio> frame_sizes = {
             { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3 },
@@ -404,15 +843,19 @@ void Renderer::init_descriptors() {
         m_frames[i].frame_descriptors = DescriptorAllocatorGrowable{};
         m_frames[i].frame_descriptors.init(m_vkb_device.device, 1000, frame_sizes);
 
+        // Starting sizes only, an arena that overflows grows to fit at its next reset
+        m_frames[i].arena.init(1024 * 1024);
+
         m_deletion_queue.push_function([&, i]() {
             m_frames[i].frame_descriptors.clear_pools(m_vkb_device.device);
             m_frames[i].frame_descriptors.destroy_pools(m_vkb_device.device);
+            m_frames[i].arena.destroy();
         });
     }
 
     {
         DescriptorLayoutBuilder builder;
-        builder.add_binding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+        builder.add_binding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
         m_gpu_scene_data_descriptor_layout = builder.build(m_vkb_device.device, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
     }
 
@@ -422,23 +865,89 @@ void Renderer::init_descriptors() {
         m_single_image_descriptor_layout = builder.build(m_vkb_device.device, VK_SHADER_STAGE_FRAGMENT_BIT);
     }
 
+    {
+        DescriptorLayoutBuilder builder;
+        builder.add_binding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+        builder.add_binding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        builder.add_binding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        m_material_descriptor_layout = builder.build(m_vkb_device.device, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+    }
+
     m_deletion_queue.push_function([&]() {
         m_global_descriptor_allocator.destroy_pools(m_vkb_device.device);
-        vkDestroyDescriptorSetLayout(m_vkb_device.device, m_draw_image_descriptor_layout, nullptr);
         vkDestroyDescriptorSetLayout(m_vkb_device.device, m_gpu_scene_data_descriptor_layout, nullptr);
         vkDestroyDescriptorSetLayout(m_vkb_device.device, m_single_image_descriptor_layout, nullptr);
+        vkDestroyDescriptorSetLayout(m_vkb_device.device, m_material_descriptor_layout, nullptr);
     });
 
     std::cout << "Descriptors initialized" << std::endl;
 }
 
-void Renderer::draw_frame() {
+void Renderer::apply_frame_settings() {
+    if (static_cast<uint32_t>(m_settings.frames_in_flight) == m_frames_in_flight) {
+        return;
+    }
+
+    // Slots are picked by m_frame_index % m_frames_in_flight, every frame still in flight has to finish before that changes
+    std::vector<VkFence> fences;
+    for (uint32_t i = 0; i < m_frames_in_flight; i++) {
+        fences.push_back(m_frames[i].render_fence);
+    }
+    VK_CHECK(vkWaitForFences(m_vkb_device.device, static_cast<uint32_t>(fences.size()), fences.data(), true, UINT64_MAX));
+    for (FrameData& frame : m_frames) {
+        frame.deletion_queue.flush();
+        frame.submitted_since_flush = false;
+    }
+
+    m_frames_in_flight = static_cast<uint32_t>(m_settings.frames_in_flight);
+    m_frame_index = 0;
+    // Image count follows the frame count
+    resize_requested = true;
+    std::cout << "Frames in flight set to " << m_frames_in_flight << std::endl;
+}
+
+void Renderer::wait_for_frame() {
+    apply_frame_settings();
+
+    // Holding back until the frame m_frames_in_flight - 1 presents ago is on screen keeps the queue to the display
+    // that short, so the input sampled after this is as fresh as the setting allows
+    if (m_present_wait_supported && m_settings.use_present_wait && m_present_id >= m_frames_in_flight) {
+        const uint64_t target_present_id = m_present_id - (m_frames_in_flight - 1);
+        const VkResult result = m_wait_for_present(m_vkb_device.device, m_vkb_swapchain.swapchain, target_present_id, 100'000'000);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            resize_requested = true;
+        }
+    }
+
     VK_CHECK(vkWaitForFences(m_vkb_device.device, 1, &get_current_frame().render_fence, true, 1'000'000'000));
-    VK_CHECK(vkResetFences(m_vkb_device.device, 1, &get_current_frame().render_fence));
 
-    get_current_frame().deletion_queue.flush();
+    if (get_current_frame().submitted_since_flush) {
+        get_current_frame().deletion_queue.flush();
+        get_current_frame().submitted_since_flush = false;
+    }
     get_current_frame().frame_descriptors.clear_pools(m_vkb_device.device);
+    get_current_frame().arena.reset();
+    m_frame_ring.begin_frame(get_frame_slot());
+    m_profiler.begin_frame(get_frame_slot());
+    update_gpu_stats();
+    if (m_readback.enabled()) {
+        m_readback.poll();
+        m_stats.readback = m_readback.stats();
+    }
+
+    // What was just read back is from the frame this slot submitted last
+    uint64_t& previous_frame = m_slot_frame_numbers[get_frame_slot()];
+    if (m_replaying && previous_frame != NO_FRAME) {
+        FrameTiming& timing = m_frame_timings.frame(previous_frame);
+        timing.graphics_gpu_ms = m_stats.graphics_gpu_time;
+        timing.background_gpu_ms = m_stats.background_gpu_time;
+        timing.depth_prepass_gpu_ms = m_stats.depth_prepass_gpu_time;
+        timing.geometry_gpu_ms = m_stats.geometry_gpu_time;
+    }
+    previous_frame = NO_FRAME;
+}
 
+void Renderer::draw_frame() {
     uint32_t swapchain_image_index;
     // VK_CHECK(vkAcquireNextImageKHR(m_vkb_device.device, m_vkb_swapchain.swapchain, 1'000'000'000, get_current_frame().acquire_semaphore, nullptr, &swapchain_image_index));
     VkResult result = vkAcquireNextImageKHR(m_vkb_device.device, m_vkb_swapchain.swapchain, 1'000'000'000, get_current_frame().acquire_semaphore, nullptr, &swapchain_image_index);
@@ -446,37 +955,185 @@ void Renderer::draw_frame() {
         resize_requested = true;
         return;
     }
+    // Only reset once something is certain to signal it again, an early return above would otherwise deadlock the next wait
+    VK_CHECK(vkResetFences(m_vkb_device.device, 1, &get_current_frame().render_fence));
 
     VkCommandBuffer cmd_buffer = get_current_frame().main_command_buffer;
     VK_CHECK(vkResetCommandBuffer(cmd_buffer, 0));
 
-    m_draw_extent.height = std::min(m_swapchain_extent.height, m_draw_image.image_extent.height) * m_render_scale;
-    m_draw_extent.width= std::min(m_swapchain_extent.width, m_draw_image.image_extent.width) * m_render_scale;
+    // The draw image stays at full size, only the region rendered into shrinks, so a scale change never reallocates
+    if (m_settings.use_dynamic_resolution) {
+        // With async compute the background overlaps graphics, whichever is longer bounds the frame
+        m_render_scale = m_dynamic_resolution.update(std::max(m_stats.graphics_gpu_time, m_stats.background_gpu_time));
+    }
+    m_draw_extent.height = std::max(1u, static_cast<uint32_t>(std::min(m_swapchain_extent.height, m_draw_image.image_extent.height) * m_render_scale));
+    m_draw_extent.width = std::max(1u, static_cast<uint32_t>(std::min(m_swapchain_extent.width, m_draw_image.image_extent.width) * m_render_scale));
+    upload_scene();
+
+    const bool async_compute = m_async_compute_available && m_settings.use_async_compute;
+    if (async_compute && !m_async_compute_active) {
+        // Effect chain state was last written on the graphics queue and nothing orders that against the compute queue.
+        // Only happens when the setting is switched on, going the other way the graphics submit already waits on compute
+        std::scoped_lock lock(m_graphics_queue_mutex);
+        VK_CHECK(vkQueueWaitIdle(m_graphics_queue));
+    }
+    m_async_compute_active = async_compute;
+    if (async_compute) {
+        submit_background_compute();
+    }
 
     // Todo: Replace where these are used?
     // m_draw_image_extent.width = m_draw_image.image_extent.width;
     // m_draw_image_extent.height = m_draw_image.image_extent.height;
 
-    // For compute
+    // The presentation engine hands the image back in an unknown layout. Starting it at the acquire semaphore's
+    // wait stage chains the first barrier onto that wait
+    const VkImage swapchain_image = m_swapchain_images[swapchain_image_index];
+    m_barriers.track(swapchain_image, VK_IMAGE_ASPECT_COLOR_BIT, {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE});
+    m_barriers.reset_stats();
+
     VkCommandBufferBeginInfo begin_info = init::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
     VK_CHECK(vkBeginCommandBuffer(cmd_buffer, &begin_info));
-    util::transition_image(cmd_buffer, m_draw_image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-    draw_background(cmd_buffer);
-
-    // For imgui
-    util::transition_image(cmd_buffer, m_draw_image.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-    util::transition_image(cmd_buffer, m_swapchain_images[swapchain_image_index], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    util::copy_image_to_image(cmd_buffer, m_draw_image.image, m_swapchain_images[swapchain_image_index], m_draw_extent, m_swapchain_extent);
-    util::transition_image(cmd_buffer, m_swapchain_images[swapchain_image_index], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-    draw_imgui(cmd_buffer,  m_swapchain_image_views[swapchain_image_index]);
-    util::transition_image(cmd_buffer, m_swapchain_images[swapchain_image_index], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    const uint32_t graphics_scope = m_profiler.begin_scope(cmd_buffer, "graphics");
+
+    m_render_graph.begin_frame();
+    const RGResource draw_image = m_render_graph.import_image("draw image", m_draw_image.image, m_draw_image.image_view,
+        {m_draw_image.image_extent.width, m_draw_image.image_extent.height}, VK_IMAGE_ASPECT_COLOR_BIT);
+    const RGResource swapchain = m_render_graph.import_image("swapchain", swapchain_image, m_swapchain_image_views[swapchain_image_index],
+        m_swapchain_extent, VK_IMAGE_ASPECT_COLOR_BIT);
+    m_render_graph.set_output(swapchain, ImageUsage::Present);
+
+    if (async_compute) {
+        // Compute left the image in GENERAL. The submit waits on the timeline at the transfer stage,
+        // starting the image there chains the copy's barrier onto that wait
+        const AllocatedImage& background_image = m_background_images[get_frame_slot()];
+        m_barriers.track(background_image.image, VK_IMAGE_ASPECT_COLOR_BIT, {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_NONE});
+        const RGResource background = m_render_graph.import_image("async background", background_image.image, background_image.image_view,
+            {background_image.image_extent.width, background_image.image_extent.height}, VK_IMAGE_ASPECT_COLOR_BIT);
+
+        m_render_graph.add_pass("copy background", [&](RGPassBuilder& builder) {
+            builder.read(background, ImageUsage::TransferSrc);
+            builder.write(draw_image, ImageUsage::TransferDst, true);
+        }, [this, background, draw_image](VkCommandBuffer cmd, const RenderGraph& graph) {
+            util::copy_image_to_image(cmd, graph.image(background), graph.image(draw_image), m_draw_extent, m_draw_extent);
+        });
+    } else {
+        m_render_graph.add_pass("background", [&](RGPassBuilder& builder) {
+            builder.write(draw_image, ImageUsage::ComputeWrite, true);
+        }, [this](VkCommandBuffer cmd, const RenderGraph&) {
+            const uint32_t scope = m_profiler.begin_scope(cmd, "background");
+            draw_background(cmd, m_draw_image.image_view, true);
+            m_profiler.end_scope(cmd, scope);
+        });
+    }
+
+    if (m_settings.draw_meshes && !m_snapshot->draw_context.opaque_surfaces.empty() && m_opaque_pipeline.pipeline != VK_NULL_HANDLE) {
+        // Sized like the draw image rather than the draw extent, so render scale changes keep hitting the transient cache
+        const RGResource depth = m_render_graph.create_image("depth", {VK_FORMAT_D32_SFLOAT,
+            {m_draw_image.image_extent.width, m_draw_image.image_extent.height}, VK_IMAGE_ASPECT_DEPTH_BIT});
+        const bool depth_prepass = m_settings.use_depth_prepass && mesh_pipelines().depth_prepass != VK_NULL_HANDLE;
+
+        if (depth_prepass) {
+            m_render_graph.add_pass("depth prepass", [&](RGPassBuilder& builder) {
+                builder.write(depth, ImageUsage::DepthAttachment, true);
+            }, [this, depth](VkCommandBuffer cmd, const RenderGraph& graph) {
+                draw_depth_prepass(cmd, graph.image_view(depth));
+            });
+        }
+
+        m_render_graph.add_pass("geometry", [&](RGPassBuilder& builder) {
+            builder.write(draw_image, ImageUsage::ColorAttachment);
+            if (depth_prepass) {
+                builder.read(depth, ImageUsage::DepthRead);
+            } else {
+                builder.write(depth, ImageUsage::DepthAttachment, true);
+            }
+        }, [this, draw_image, depth, depth_prepass](VkCommandBuffer cmd, const RenderGraph& graph) {
+            draw_geometry(cmd, graph.image_view(draw_image), graph.image_view(depth), depth_prepass);
+        });
+    }
+
+    // The draw image as it's about to be scaled to the swapchain, at the rendered resolution
+    m_readback_recorded = false;
+    if (m_readback.enabled()) {
+        m_render_graph.add_pass("readback", [&](RGPassBuilder& builder) {
+            builder.read(draw_image, ImageUsage::TransferSrc);
+            builder.side_effect();
+        }, [this, draw_image](VkCommandBuffer cmd, const RenderGraph& graph) {
+            m_readback_recorded = m_readback.record_copy(cmd, graph.image(draw_image), m_draw_extent, m_snapshot->frame_number);
+        });
+    }
+
+    if (m_upscaler_available && m_settings.use_upscaler && m_render_scale < 1.0f) {
+        // Straight into the swapchain when it allows storage, otherwise into a transient that gets copied over
+        RGResource upscaled = swapchain;
+        if (!m_swapchain_storage_supported) {
+            upscaled = m_render_graph.create_image("upscaled", {m_draw_image.image_format, m_swapchain_extent});
+        }
+
+        m_render_graph.add_pass("upscale", [&](RGPassBuilder& builder) {
+            builder.read(draw_image, ImageUsage::ShaderRead);
+            builder.write(upscaled, ImageUsage::ComputeWrite, true);
+        }, [this, draw_image, upscaled](VkCommandBuffer cmd, const RenderGraph& graph) {
+            draw_upscale(cmd, graph.image_view(draw_image), graph.image_view(upscaled), graph.extent(upscaled));
+        });
+
+        if (upscaled != swapchain) {
+            m_render_graph.add_pass("copy upscaled", [&](RGPassBuilder& builder) {
+                builder.read(upscaled, ImageUsage::TransferSrc);
+                builder.write(swapchain, ImageUsage::TransferDst, true);
+            }, [this, upscaled, swapchain](VkCommandBuffer cmd, const RenderGraph& graph) {
+                util::copy_image_to_image(cmd, graph.image(upscaled), graph.image(swapchain), m_swapchain_extent, m_swapchain_extent);
+            });
+        }
+    } else {
+        m_render_graph.add_pass("blit to swapchain", [&](RGPassBuilder& builder) {
+            builder.read(draw_image, ImageUsage::TransferSrc);
+            builder.write(swapchain, ImageUsage::TransferDst, true);
+        }, [this, draw_image, swapchain](VkCommandBuffer cmd, const RenderGraph& graph) {
+            util::copy_image_to_image(cmd, graph.image(draw_image), graph.image(swapchain), m_draw_extent, m_swapchain_extent);
+        });
+    }
+
+    m_render_graph.add_pass("imgui", [&](RGPassBuilder& builder) {
+        builder.write(swapchain, ImageUsage::ColorAttachment);
+    }, [this, swapchain](VkCommandBuffer cmd, const RenderGraph& graph) {
+        draw_imgui(cmd, graph.image_view(swapchain));
+    });
+
+    m_render_graph.compile(get_current_frame().deletion_queue);
+    m_render_graph.execute(cmd_buffer);
+    m_stats.frame_arena_bytes = get_current_frame().arena.used();
+    m_stats.render_scale = m_render_scale;
+    m_stats.smoothed_gpu_time = m_dynamic_resolution.smoothed_frame_ms();
+    m_stats.present_mode = m_present_mode;
+    m_frame_ring.end_frame(get_frame_slot());
+    m_stats.frame_upload_bytes = m_frame_ring.frame_bytes();
+    m_stats.frame_ring_capacity = m_frame_ring.capacity();
+    m_profiler.end_scope(cmd_buffer, graphics_scope);
     VK_CHECK(vkEndCommandBuffer(cmd_buffer));
 
+    const BarrierStats barrier_stats = m_barriers.stats();
+    m_stats.barrier_count = barrier_stats.barrier_count;
+    m_stats.barrier_batch_count = barrier_stats.batch_count;
+    m_stats.render_graph = m_render_graph.stats();
+
     VkCommandBufferSubmitInfo cmd_buffer_info = init::command_buffer_submit_info(cmd_buffer);
-    VkSemaphoreSubmitInfo wait_info = init::semaphore_submit_info(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, get_current_frame().acquire_semaphore);
-    VkSemaphoreSubmitInfo signal_info = init::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, m_submit_semaphores[swapchain_image_index]);
-    VkSubmitInfo2 submit = init::submit_info(&cmd_buffer_info, &signal_info, &wait_info);
+    VkSemaphoreSubmitInfo wait_infos[2] = {
+        init::semaphore_submit_info(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, get_current_frame().acquire_semaphore),
+        init::semaphore_submit_info(VK_PIPELINE_STAGE_2_TRANSFER_BIT, m_compute_timeline),
+    };
+    wait_infos[1].value = m_compute_timeline_value;
+    VkSemaphoreSubmitInfo signal_infos[2] = {
+        init::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, m_submit_semaphores[swapchain_image_index]),
+        m_readback_recorded ? m_readback.signal_info() : VkSemaphoreSubmitInfo{},
+    };
+    VkSubmitInfo2 submit = init::submit_info(&cmd_buffer_info, signal_infos, wait_infos);
+    submit.waitSemaphoreInfoCount = async_compute ? 2 : 1;
+    submit.signalSemaphoreInfoCount = m_readback_recorded ? 2 : 1;
+    std::unique_lock queue_lock(m_graphics_queue_mutex);
     VK_CHECK(vkQueueSubmit2(m_graphics_queue, 1, &submit, get_current_frame().render_fence));
+    get_current_frame().submitted_since_flush = true;
 
     VkPresentInfoKHR present_info = {};
     present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -487,120 +1144,793 @@ void Renderer::draw_frame() {
     present_info.waitSemaphoreCount = 1;
     present_info.pImageIndices = &swapchain_image_index;
 
+    const uint64_t present_id = m_present_id + 1;
+    VkPresentIdKHR present_id_info = {};
+    present_id_info.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    present_id_info.pNext = nullptr;
+    present_id_info.swapchainCount = 1;
+    present_id_info.pPresentIds = &present_id;
+    if (m_present_wait_supported) {
+        present_info.pNext = &present_id_info;
+        m_present_id = present_id;
+    }
+
     // VK_CHECK(vkQueuePresentKHR(m_graphics_queue, &present_info));
     result = vkQueuePresentKHR(m_graphics_queue, &present_info);
+    queue_lock.unlock();
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         resize_requested = true;
     }
+    m_slot_frame_numbers[get_frame_slot()] = m_snapshot->frame_number;
     m_frame_index++;
 }
 
-void Renderer::draw_background(VkCommandBuffer cmd_buffer) {
-    ComputeEffect& compute_effect = m_background_effects[m_current_background_effect];
-    compute_effect.data.data3.x = std::floor(m_mouse_position.x / 16.0f);
-    compute_effect.data.data3.y = std::floor(m_mouse_position.y / 16.0f);
+void Renderer::submit_background_compute() {
+    const uint32_t frame_slot = get_frame_slot();
+    VkCommandBuffer cmd_buffer = get_current_frame().compute_command_buffer;
+    VK_CHECK(vkResetCommandBuffer(cmd_buffer, 0));
 
-    vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_effect.pipeline);
-    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_compute_pipeline_layout, 0, 1, &m_draw_image_descriptors, 0, nullptr);
-    vkCmdPushConstants(cmd_buffer, m_compute_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants), &compute_effect.data);
+    VkCommandBufferBeginInfo begin_info = init::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    VK_CHECK(vkBeginCommandBuffer(cmd_buffer, &begin_info));
+    const uint32_t scope = m_compute_timestamps_supported ? m_profiler.begin_scope(cmd_buffer, "background") : GpuProfiler::MAX_SCOPES_PER_FRAME;
+    // Graphics last read this image m_frames_in_flight frames ago and the frame fence already covered that, only the layout has to change
+    util::transition_image(cmd_buffer, m_background_images[frame_slot].image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    draw_background(cmd_buffer, m_background_images[frame_slot].image_view, m_compute_timestamps_supported);
+    m_profiler.end_scope(cmd_buffer, scope);
+    VK_CHECK(vkEndCommandBuffer(cmd_buffer));
 
-    vkCmdDispatch(cmd_buffer, std::ceil(m_draw_extent.width / 16.0), std::ceil(m_draw_extent.height / 16.0), 1);
+    // No fence, the graphics submit waits on this value and the frame fence comes after that
+    m_compute_timeline_value++;
+    VkCommandBufferSubmitInfo cmd_buffer_info = init::command_buffer_submit_info(cmd_buffer);
+    VkSemaphoreSubmitInfo signal_info = init::semaphore_submit_info(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, m_compute_timeline);
+    signal_info.value = m_compute_timeline_value;
+    VkSubmitInfo2 submit = init::submit_info(&cmd_buffer_info, &signal_info, nullptr);
+    VK_CHECK(vkQueueSubmit2(m_compute_queue, 1, &submit, VK_NULL_HANDLE));
 }
 
-void Renderer::init_pipelines() {
-    init_background_pipelines(); // Compute
+void Renderer::update_gpu_stats() {
+    const std::optional<GpuScope> graphics = m_profiler.find("graphics");
+    const std::optional<GpuScope> background = m_profiler.find("background");
+    m_stats.graphics_gpu_time = graphics ? static_cast<float>(graphics->duration_ms()) : 0.0f;
+    m_stats.background_gpu_time = background ? static_cast<float>(background->duration_ms()) : 0.0f;
+    const std::optional<GpuScope> depth_prepass = m_profiler.find("depth prepass");
+    const std::optional<GpuScope> geometry = m_profiler.find("geometry");
+    m_stats.depth_prepass_gpu_time = depth_prepass ? static_cast<float>(depth_prepass->duration_ms()) : 0.0f;
+    m_stats.geometry_gpu_time = geometry ? static_cast<float>(geometry->duration_ms()) : 0.0f;
+
+    // A frame's async background is meant to run while the previous frame's graphics work is still going.
+    // Timestamps from different queues share the device timebase on the hardware we care about, the spec doesn't promise it
+    m_stats.async_overlap_time = 0.0f;
+    if (m_settings.use_async_compute && background && m_previous_graphics_scope) {
+        const double overlap = std::min(background->end_ms, m_previous_graphics_scope->end_ms) - std::max(background->begin_ms, m_previous_graphics_scope->begin_ms);
+        m_stats.async_overlap_time = static_cast<float>(std::max(overlap, 0.0));
+    }
+    m_previous_graphics_scope = graphics;
+
+    // Per tick rather than per frame so changing the tick count doesn't move the number
+    const auto [chain_index, ticks] = m_recorded_ticks[get_frame_slot()];
+    const std::optional<GpuScope> tick_scope = m_profiler.find("background ticks");
+    std::scoped_lock lock(m_effects_mutex);
+    std::vector<EffectChain>& chains = m_effect_registry.chains();
+    if (tick_scope && ticks > 0 && chain_index >= 0 && chain_index < static_cast<int>(chains.size())) {
+        EffectChain& chain = chains[chain_index];
+        const float tick_ms = static_cast<float>(tick_scope->duration_ms()) / static_cast<float>(ticks);
+        chain.tick_ms = chain.tick_ms <= 0.0f ? tick_ms : chain.tick_ms + 0.1f * (tick_ms - chain.tick_ms);
+        m_stats.background_tick_time = chain.tick_ms;
+    } else {
+        m_stats.background_tick_time = 0.0f;
+    }
 }
 
-void Renderer::init_background_pipelines() {
-    VkPipelineLayoutCreateInfo compute_layout_info = {};
-    compute_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    compute_layout_info.pNext = nullptr;
-    compute_layout_info.pSetLayouts = &m_draw_image_descriptor_layout;
-    compute_layout_info.setLayoutCount = 1;
+void Renderer::draw_background(VkCommandBuffer cmd_buffer, VkImageView target_image_view, bool timestamps) {
+    std::scoped_lock lock(m_effects_mutex);
+    // Pipelines the shader editor replaced. Every frame that could still use one was submitted before this one
+    std::vector<VkPipeline> retired = m_effect_registry.take_retired_pipelines();
+    if (!retired.empty()) {
+        get_current_frame().deletion_queue.push_function([device = m_vkb_device.device, retired]() {
+            for (VkPipeline pipeline : retired) {
+                vkDestroyPipeline(device, pipeline, nullptr);
+            }
+        });
+    }
+
+    std::vector<ComputeEffect>& effects = m_effect_registry.effects();
+    std::vector<EffectChain>& chains = m_effect_registry.chains();
+    m_recorded_ticks[get_frame_slot()] = {-1, 0};
+    const int background_count = static_cast<int>(effects.size() + chains.size());
+    if (background_count == 0) {
+        return;
+    }
+    const int selected = std::clamp(m_settings.background_effect, 0, background_count - 1);
+
+    EffectFrameInputs inputs = {};
+    inputs.time = m_snapshot->time;
+    inputs.mouse_x = m_snapshot->mouse_position.x;
+    inputs.mouse_y = m_snapshot->mouse_position.y;
+    inputs.extent = m_draw_extent;
+
+    if (selected >= static_cast<int>(effects.size())) {
+        const int chain_index = selected - static_cast<int>(effects.size());
+        draw_effect_chain(cmd_buffer, chains[chain_index], target_image_view, inputs, timestamps);
+        m_recorded_ticks[get_frame_slot()] = {chain_index, timestamps ? chains[chain_index].ticks_per_frame : 0};
+        return;
+    }
+
+    ComputeEffect& compute_effect = effects[selected];
+    DescriptorWriter writer(&get_current_frame().arena);
+    writer.write_image(compute_effect.output_binding, target_image_view, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    dispatch_effect(cmd_buffer, compute_effect, writer, inputs);
+}
+
+void Renderer::dispatch_effect(VkCommandBuffer cmd_buffer, ComputeEffect& effect, DescriptorWriter& writer, const EffectFrameInputs& inputs) {
+    effect.update_inputs(inputs);
+
+    // Render targets get replaced on resize, a set from the frame allocator never outlives the view it points at
+    VkDescriptorSet set = get_current_frame().frame_descriptors.allocate(m_vkb_device.device, effect.set_layout);
+    writer.update_set(m_vkb_device.device, set);
+
+    vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, effect.pipeline);
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, effect.layout, 0, 1, &set, 0, nullptr);
+    if (!effect.push_constants.empty()) {
+        vkCmdPushConstants(cmd_buffer, effect.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, static_cast<uint32_t>(effect.push_constants.size()), effect.push_constants.data());
+    }
+
+    const std::array<uint32_t, 3> groups = effect.group_count(inputs.extent);
+    vkCmdDispatch(cmd_buffer, groups[0], groups[1], groups[2]);
+}
+
+void Renderer::draw_effect_chain(VkCommandBuffer cmd_buffer, EffectChain& chain, VkImageView target_image_view, EffectFrameInputs inputs, bool timestamps) {
+    ensure_chain_images(chain);
+
+    // Chain images stay in GENERAL and only ever see compute work, so plain memory barriers order the dispatches.
+    // One also sits in front of the first dispatch, covering what the previous frame wrote into the persistent state
+    VkMemoryBarrier2 memory_barrier = {};
+    memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    memory_barrier.pNext = nullptr;
+    memory_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    memory_barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    memory_barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+    VkDependencyInfo dependency_info = {};
+    dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependency_info.pNext = nullptr;
+    dependency_info.memoryBarrierCount = 1;
+    dependency_info.pMemoryBarriers = &memory_barrier;
+
+    std::vector<VkImageMemoryBarrier2> reset_barriers;
+    if (chain.needs_reset) {
+        for (const ChainImage& image : chain.images) {
+            for (uint32_t i = 0; i < (image.ping_pong ? 2u : 1u); i++) {
+                VkImageMemoryBarrier2 barrier = {};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+                barrier.pNext = nullptr;
+                barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+                barrier.srcAccessMask = VK_ACCESS_2_NONE;
+                barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+                barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = image.targets[i].image;
+                barrier.subresourceRange = init::image_subresource_range(VK_IMAGE_ASPECT_COLOR_BIT);
+                reset_barriers.push_back(barrier);
+            }
+        }
+        dependency_info.imageMemoryBarrierCount = static_cast<uint32_t>(reset_barriers.size());
+        dependency_info.pImageMemoryBarriers = reset_barriers.data();
+        inputs.reset = true;
+    }
+    vkCmdPipelineBarrier2(cmd_buffer, &dependency_info);
+    dependency_info.imageMemoryBarrierCount = 0;
+    dependency_info.pImageMemoryBarriers = nullptr;
+
+    bool first_dispatch = true;
+    auto run_pass = [&](ChainPass& pass) {
+        if (!first_dispatch) {
+            vkCmdPipelineBarrier2(cmd_buffer, &dependency_info);
+        }
+        first_dispatch = false;
+
+        DescriptorWriter writer(&get_current_frame().arena);
+        for (const ChainImageRef& ref : pass.images) {
+            writer.write_image(static_cast<int>(ref.binding), chain.image_view(ref, target_image_view), VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        }
+        dispatch_effect(cmd_buffer, pass.effect, writer, inputs);
+    };
+
+    const bool has_ticks = std::any_of(chain.passes.begin(), chain.passes.end(), [](const ChainPass& pass) { return pass.per_tick; });
+    if (has_ticks) {
+        const uint32_t scope = timestamps ? m_profiler.begin_scope(cmd_buffer, "background ticks", VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT) : GpuProfiler::MAX_SCOPES_PER_FRAME;
+        for (int tick = 0; tick < chain.ticks_per_frame; tick++) {
+            for (ChainPass& pass : chain.passes) {
+                if (pass.per_tick) {
+                    run_pass(pass);
+                }
+            }
+            chain.swap();
+            inputs.reset = false;
+        }
+        m_profiler.end_scope(cmd_buffer, scope, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    }
+
+    for (ChainPass& pass : chain.passes) {
+        if (!pass.per_tick) {
+            run_pass(pass);
+        }
+    }
+    chain.needs_reset = false;
+}
+
+void Renderer::ensure_chain_images(EffectChain& chain) {
+    // Chain images follow the draw image, including its slack, so a render scale change keeps the simulation going
+    const VkExtent2D extent = {m_draw_image.image_extent.width, m_draw_image.image_extent.height};
+    if (chain.extent.width == extent.width && chain.extent.height == extent.height) {
+        return;
+    }
+
+    if (chain.extent.width != 0) {
+        EffectChain retired = {};
+        retired.images = chain.images;
+        retired.extent = chain.extent;
+        get_current_frame().deletion_queue.push_function([this, retired]() {
+            destroy_chain_images(retired);
+        });
+    }
 
+    for (ChainImage& image : chain.images) {
+        for (uint32_t i = 0; i < (image.ping_pong ? 2u : 1u); i++) {
+            image.targets[i] = create_shared_storage_image({extent.width, extent.height, 1}, 0);
+        }
+    }
+    chain.extent = extent;
+    chain.needs_reset = true;
+    chain.current = 0;
+}
+
+void Renderer::destroy_chain_images(const EffectChain& chain) {
+    if (chain.extent.width == 0) {
+        return;
+    }
+    for (const ChainImage& image : chain.images) {
+        for (uint32_t i = 0; i < (image.ping_pong ? 2u : 1u); i++) {
+            vkDestroyImageView(m_vkb_device.device, image.targets[i].image_view, nullptr);
+            vmaDestroyImage(m_allocator, image.targets[i].image, image.targets[i].allocation);
+        }
+    }
+}
+
+void Renderer::init_pipelines() {
+    init_background_pipelines(); // Compute
+    init_upscale_pipeline();
+    init_mesh_pipelines();
+}
+
+void Renderer::init_mesh_pipelines() {
     VkPushConstantRange push_constant = {};
-    push_constant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     push_constant.offset = 0;
-    push_constant.size = sizeof(ComputePushConstants);
-    compute_layout_info.pPushConstantRanges = &push_constant;
-    compute_layout_info.pushConstantRangeCount = 1;
+    push_constant.size = sizeof(GPUDrawPushConstants);
+
+    const VkDescriptorSetLayout set_layouts[] = {m_gpu_scene_data_descriptor_layout, m_material_descriptor_layout};
+    VkPipelineLayoutCreateInfo layout_info = init::pipeline_layout_create_info();
+    layout_info.pSetLayouts = set_layouts;
+    layout_info.setLayoutCount = 2;
+    layout_info.pPushConstantRanges = &push_constant;
+    layout_info.pushConstantRangeCount = 1;
+    VK_CHECK(vkCreatePipelineLayout(m_vkb_device.device, &layout_info, nullptr, &m_opaque_pipeline.layout));
+
+    m_deletion_queue.push_function([this]() {
+        std::cout << "m_deletion_queue destroy mesh pipelines" << std::endl;
+        for (const MeshPipelines& pipelines : {m_mesh_pipelines, m_instanced_mesh_pipelines}) {
+            vkDestroyPipeline(m_vkb_device.device, pipelines.opaque, nullptr);
+            vkDestroyPipeline(m_vkb_device.device, pipelines.opaque_after_prepass, nullptr);
+            vkDestroyPipeline(m_vkb_device.device, pipelines.depth_prepass, nullptr);
+        }
+        vkDestroyPipelineLayout(m_vkb_device.device, m_opaque_pipeline.layout, nullptr);
+    });
+
+    VkShaderModule mesh_vertex_shader = {};
+    if (!util::load_shader_module("mesh.vert", m_vkb_device.device, &mesh_vertex_shader)) {
+        std::cerr << "Failed to load mesh vertex shader, meshes disabled" << std::endl;
+        return;
+    }
+    VkShaderModule mesh_fragment_shader = {};
+    if (!util::load_shader_module("mesh.frag", m_vkb_device.device, &mesh_fragment_shader)) {
+        std::cerr << "Failed to load mesh fragment shader, meshes disabled" << std::endl;
+        vkDestroyShaderModule(m_vkb_device.device, mesh_vertex_shader, nullptr);
+        return;
+    }
+
+    // Both vertex shader variants share the layout, their push constants fit inside GPUDrawPushConstants' range
+    const auto build_mesh_pipelines = [this, mesh_fragment_shader](VkShaderModule vertex_shader, std::string_view vertex_shader_name) {
+        MeshPipelines pipelines;
+
+        // Reverse-Z: depth clears to 0 and nearer is greater, which spreads float precision evenly over the view distance
+        PipelineBuilder builder;
+        builder.set_layout(m_opaque_pipeline.layout);
+        builder.set_shaders(vertex_shader, mesh_fragment_shader);
+        builder.set_input_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+        builder.set_polygon_mode(VK_POLYGON_MODE_FILL);
+        builder.set_cull_mode(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+        builder.set_multisampling_none();
+        builder.disable_blending();
+        builder.enable_depthtest(true, VK_COMPARE_OP_GREATER_OR_EQUAL);
+        builder.set_color_attachment_format(m_draw_image.image_format);
+        builder.set_depth_format(VK_FORMAT_D32_SFLOAT);
+        pipelines.opaque = builder.build_pipeline(m_vkb_device.device);
+
+        // The EQUAL test below only works if both pipelines compute bit-identical depth. A vertex shader without
+        // invariant gl_Position gets no pre-pass pipelines, which leaves the pre-pass off rather than z-fighting
+        const std::optional<std::span<const uint32_t>> vertex_code = find_embedded_shader(vertex_shader_name);
+        const std::optional<ShaderReflection> reflection = vertex_code.has_value() ? reflect::reflect_spirv(vertex_code.value()) : std::nullopt;
+        if (!reflection.has_value() || !reflection->invariant_position) {
+            std::cerr << vertex_shader_name << " doesn't declare gl_Position invariant, depth pre-pass disabled" << std::endl;
+            return pipelines;
+        }
+
+        // After a pre-pass only the closest surface of each pixel matches, so the fragment shader runs once per pixel
+        builder.enable_depthtest(false, VK_COMPARE_OP_EQUAL);
+        pipelines.opaque_after_prepass = builder.build_pipeline(m_vkb_device.device);
+
+        builder.set_shaders(vertex_shader, VK_NULL_HANDLE);
+        builder.set_no_color_attachment();
+        builder.enable_depthtest(true, VK_COMPARE_OP_GREATER_OR_EQUAL);
+        pipelines.depth_prepass = builder.build_pipeline(m_vkb_device.device);
+        return pipelines;
+    };
+
+    m_mesh_pipelines = build_mesh_pipelines(mesh_vertex_shader, "mesh.vert");
+    m_opaque_pipeline.pipeline = m_mesh_pipelines.opaque;
+    vkDestroyShaderModule(m_vkb_device.device, mesh_vertex_shader, nullptr);
+
+    VkShaderModule instanced_vertex_shader = {};
+    if (util::load_shader_module("mesh_instanced.vert", m_vkb_device.device, &instanced_vertex_shader)) {
+        m_instanced_mesh_pipelines = build_mesh_pipelines(instanced_vertex_shader, "mesh_instanced.vert");
+        m_instancing_available = m_instanced_mesh_pipelines.opaque != VK_NULL_HANDLE;
+        vkDestroyShaderModule(m_vkb_device.device, instanced_vertex_shader, nullptr);
+    } else {
+        std::cerr << "Failed to load instanced mesh vertex shader, instancing disabled" << std::endl;
+    }
+
+    vkDestroyShaderModule(m_vkb_device.device, mesh_fragment_shader, nullptr);
+    std::cout << "Mesh pipelines initialized" << std::endl;
+}
+
+void Renderer::update_scene(FrameSnapshot& snapshot) {
+    const auto start = std::chrono::system_clock::now();
+
+    GPUSceneData& scene_data = snapshot.scene_data;
+    scene_data.view = glm::translate(glm::vec3(0.0f, 0.0f, -8.0f));
+    // Near and far swapped for reverse-Z. The draw extent is the window scaled on both axes, same aspect
+    const float aspect = static_cast<float>(std::max(1u, snapshot.window_extent.width)) / static_cast<float>(std::max(1u, snapshot.window_extent.height));
+    scene_data.proj = glm::perspective(glm::radians(70.0f), aspect, 10000.0f, 0.1f);
+    // glTF and GLM are Y up, Vulkan clip space is Y down
+    scene_data.proj[1][1] *= -1;
+    scene_data.view_proj = scene_data.proj * scene_data.view;
+    scene_data.ambient_color = glm::vec4(0.1f);
+    scene_data.sunlight_color = glm::vec4(1.0f);
+    scene_data.sunlight_direction = glm::vec4(0.0f, 1.0f, 0.5f, 1.0f);
+
+    if (m_actor_grid_size != m_mesh_grid_size) {
+        populate_scene();
+    }
+
+    // The render thread is done with this snapshot's previous contents, it only ever holds the one it took last
+    DrawContext& draw_context = snapshot.draw_context;
+    const ArenaAllocator<RenderObject> allocator(&snapshot.arena);
+    draw_context.opaque_surfaces = FrameVector<RenderObject>(allocator);
+    draw_context.instanced_draws = FrameVector<InstancedDraw>(allocator);
+    draw_context.instance_transforms = FrameVector<Affine3x4>(allocator);
+    snapshot.arena.reset();
+    const uint32_t renderable_count = static_cast<uint32_t>(m_actors.pool<Renderable>().size());
+    draw_context.opaque_surfaces.resize(renderable_count);
+    RenderObject* objects = draw_context.opaque_surfaces.data();
+    uint8_t* visible = snapshot.arena.allocate_array<uint8_t>(renderable_count);
+    // Renderables without a transform or bounds are skipped by the walk below and stay invisible
+    memset(visible, 0, renderable_count);
+
+    // Animation, world matrices, culling, then the draw lists. Each stage fans out over the workers and the next one
+    // is a continuation of it, this thread helps out until the draw lists are done
+    JobCounter animation;
+    JobCounter transforms;
+    JobCounter culling;
+    JobCounter draw_lists;
+    systems::animate(m_actors, m_jobs, snapshot.time, &animation);
+    m_jobs.run_after(animation, [this, &transforms](uint32_t) {
+        systems::update_world_matrices(m_actors, m_jobs, &transforms);
+    }, &transforms);
+    m_jobs.run_after(transforms, [this, objects, visible, &scene_data, &culling](uint32_t) {
+        // Renderable drives the walk, so each one's draw lands at its own position in the pool
+        const glm::mat4* view_proj = &scene_data.view_proj;
+        m_actors.parallel_each<Renderable, Transform, Bounds>(m_jobs, 1024, [objects, visible, view_proj](uint32_t position,
+            const Renderable& renderable, const Transform& transform, const Bounds& bounds) {
+            RenderObject& draw = objects[position];
+            draw.index_count = renderable.index_count;
+            draw.first_index = renderable.first_index;
+            draw.vertex_offset = renderable.vertex_offset;
+            draw.material = renderable.material;
+            draw.transform = transform.world;
+            draw.vertex_buffer_address = renderable.vertex_buffer_address;
+            visible[position] = is_visible(bounds, transform.world, *view_proj) ? 1 : 0;
+        }, &culling);
+    }, &culling);
+    m_jobs.run_after(culling, [this, &snapshot, visible](uint32_t worker_index) {
+        FrameVector<RenderObject>& surfaces = snapshot.draw_context.opaque_surfaces;
+        size_t visible_count = 0;
+        for (size_t i = 0; i < surfaces.size(); i++) {
+            if (visible[i]) {
+                surfaces[visible_count++] = surfaces[i];
+            }
+        }
+        m_simulation_stats.culled_object_count = static_cast<int>(surfaces.size() - visible_count);
+        surfaces.resize(visible_count);
+
+        if (m_use_instancing && m_instancing_available) {
+            build_instanced_draws(snapshot.draw_context, snapshot.arena.thread_arena(worker_index));
+        }
+    }, &draw_lists);
+    // Every counter is waited on, a worker that finished an earlier stage may still be touching its counter
+    m_jobs.wait(draw_lists);
+    m_jobs.wait(culling);
+    m_jobs.wait(transforms);
+    m_jobs.wait(animation);
+
+    m_simulation_stats.snapshot_arena_bytes = snapshot.arena.used();
+    const auto end = std::chrono::system_clock::now();
+    m_simulation_stats.scene_update_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0f;
+}
+
+void Renderer::upload_scene() {
+    const RingAllocation scene_allocation = allocate_frame_data(sizeof(GPUSceneData));
+    memcpy(scene_allocation.data, &m_snapshot->scene_data, sizeof(GPUSceneData));
+    m_scene_data_offset = static_cast<uint32_t>(scene_allocation.offset);
+    // The set points at the whole ring through a dynamic offset, it only has to be rewritten when the ring grows
+    if (scene_allocation.buffer != m_scene_descriptor_buffer) {
+        m_scene_descriptors = m_global_descriptor_allocator.allocate(m_vkb_device.device, m_gpu_scene_data_descriptor_layout);
+        DescriptorWriter writer;
+        writer.write_buffer(0, scene_allocation.buffer, sizeof(GPUSceneData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+        writer.update_set(m_vkb_device.device, m_scene_descriptors);
+        m_scene_descriptor_buffer = scene_allocation.buffer;
+    }
+
+    const FrameVector<Affine3x4>& instance_transforms = m_snapshot->draw_context.instance_transforms;
+    if (!instance_transforms.empty()) {
+        const size_t size = instance_transforms.size() * sizeof(Affine3x4);
+        const RingAllocation instance_allocation = allocate_frame_data(size);
+        memcpy(instance_allocation.data, instance_transforms.data(), size);
+        m_instance_data_address = instance_allocation.address;
+    }
+
+    m_stats.draw_call_count = 0;
+    m_stats.triangle_count = 0;
+    m_stats.mesh_draw_time = 0.0f;
+}
 
-    VK_CHECK(vkCreatePipelineLayout(m_vkb_device.device, &compute_layout_info, nullptr, &m_compute_pipeline_layout));
+void Renderer::populate_scene() {
+    // Every surface of every test mesh in each cell of a square grid, one actor per surface
+    m_actors.clear();
+    const float cell_width = static_cast<float>(m_test_meshes.size()) * 3.0f;
+    for (int grid_z = 0; grid_z < m_mesh_grid_size; grid_z++) {
+        for (int grid_x = 0; grid_x < m_mesh_grid_size; grid_x++) {
+            const float cell_x = (static_cast<float>(grid_x) - 0.5f * static_cast<float>(m_mesh_grid_size - 1)) * cell_width;
+            for (size_t i = 0; i < m_test_meshes.size(); i++) {
+                const MeshAsset& mesh = *m_test_meshes[i];
+                const float x = cell_x + (static_cast<float>(i) - 0.5f * static_cast<float>(m_test_meshes.size() - 1)) * 3.0f;
+                EffectParameters parameters = {};
+                parameters.spin_speed = 0.5f;
+                parameters.rest_position = glm::vec3(x, 0.0f, static_cast<float>(grid_z) * -3.0f);
+
+                for (const GeoSurface& surface : mesh.surfaces) {
+                    const Actor actor = m_actors.create();
+                    m_actors.add(actor, Transform{.position = parameters.rest_position});
+                    m_actors.add(actor, parameters);
+                    m_actors.add(actor, surface.bounds);
+                    Renderable renderable = {};
+                    renderable.index_count = surface.count;
+                    renderable.first_index = mesh.mesh_buffers.first_index + surface.start_index;
+                    renderable.vertex_offset = mesh.mesh_buffers.vertex_offset;
+                    renderable.material = surface.material ? &surface.material->data : &m_default_data;
+                    renderable.vertex_buffer_address = mesh.mesh_buffers.vertex_buffer_address;
+                    m_actors.add(actor, renderable);
+                }
+            }
+        }
+    }
+    m_actor_grid_size = m_mesh_grid_size;
+    std::cout << "Scene populated with " << m_actors.actor_count() << " actors" << std::endl;
+}
+
+bool Renderer::is_visible(const Bounds& bounds, const Affine3x4& world, const glm::mat4& view_proj) {
+    constexpr glm::vec3 corners[] = {
+        {1, 1, 1}, {1, 1, -1}, {1, -1, 1}, {1, -1, -1}, {-1, 1, 1}, {-1, 1, -1}, {-1, -1, 1}, {-1, -1, -1},
+    };
 
-    VkShaderModule compute_gradient_shader = {};
-    if (!util::load_shader_module("../src/shaders/gradient_color.spv", m_vkb_device.device, &compute_gradient_shader)) {
-        std::cerr << "Failed to load gradient shader" << std::endl;
+    // Clip space box around the object's bounds, outside the view volume on any axis means it can't be seen
+    const glm::mat4 matrix = view_proj * to_mat4(world);
+    glm::vec3 min = glm::vec3(1.5f);
+    glm::vec3 max = glm::vec3(-1.5f);
+    for (const glm::vec3& corner : corners) {
+        const glm::vec4 clip = matrix * glm::vec4(bounds.origin + corner * bounds.extents, 1.0f);
+        if (clip.w <= 0.0f) {
+            // Straddles the camera plane, the projected box would be meaningless
+            return true;
+        }
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        min = glm::min(ndc, min);
+        max = glm::max(ndc, max);
     }
+    return min.z <= 1.0f && max.z >= 0.0f && min.x <= 1.0f && max.x >= -1.0f && min.y <= 1.0f && max.y >= -1.0f;
+}
 
-    VkShaderModule compute_sky_shader = {};
-    if (!util::load_shader_module("../src/shaders/sky.spv", m_vkb_device.device, &compute_sky_shader)) {
-        std::cerr << "Failed to load sky shader" << std::endl;
+RingAllocation Renderer::allocate_frame_data(VkDeviceSize size) {
+    std::optional<RingAllocation> allocation = m_frame_ring.allocate(size);
+    if (!allocation) {
+        // Frames in flight keep reading the old buffer, it goes away when this slot comes around again
+        m_frame_ring.grow(size, get_current_frame().deletion_queue);
+        allocation = m_frame_ring.allocate(size);
     }
+    return allocation.value();
+}
 
-    VkShaderModule compute_grid_shader = {};
-    if (!util::load_shader_module("../src/shaders/grid.spv", m_vkb_device.device, &compute_grid_shader)) {
-        std::cerr << "Failed to load grid shader" << std::endl;
+void Renderer::build_instanced_draws(DrawContext& draw_context, FrameArena& arena) {
+    FrameVector<RenderObject>& surfaces = draw_context.opaque_surfaces;
+    if (surfaces.empty()) {
+        return;
+    }
+    draw_context.instanced_draws = FrameVector<InstancedDraw>(ArenaAllocator<InstancedDraw>(&arena));
+    draw_context.instance_transforms = FrameVector<Affine3x4>(ArenaAllocator<Affine3x4>(&arena));
+    draw_context.instance_transforms.reserve(surfaces.size());
+
+    // Sorting brings every copy of a surface next to each other, each run then becomes one draw
+    std::ranges::sort(surfaces, [](const RenderObject& a, const RenderObject& b) {
+        return std::tie(a.material, a.first_index, a.index_count, a.vertex_offset) < std::tie(b.material, b.first_index, b.index_count, b.vertex_offset);
+    });
+
+    for (uint32_t i = 0; i < surfaces.size(); i++) {
+        const RenderObject& surface = surfaces[i];
+        draw_context.instance_transforms.push_back(surface.transform);
+
+        if (!draw_context.instanced_draws.empty()) {
+            InstancedDraw& group = draw_context.instanced_draws.back();
+            if (group.material == surface.material && group.first_index == surface.first_index &&
+                group.index_count == surface.index_count && group.vertex_offset == surface.vertex_offset) {
+                group.instance_count++;
+                continue;
+            }
+        }
+
+        InstancedDraw group = {};
+        group.index_count = surface.index_count;
+        group.first_index = surface.first_index;
+        group.vertex_offset = surface.vertex_offset;
+        group.material = surface.material;
+        group.vertex_buffer_address = surface.vertex_buffer_address;
+        group.first_instance = i;
+        group.instance_count = 1;
+        draw_context.instanced_draws.push_back(group);
+    }
+}
+
+const MeshPipelines& Renderer::mesh_pipelines() const {
+    return m_snapshot->draw_context.instanced_draws.empty() ? m_mesh_pipelines : m_instanced_mesh_pipelines;
+}
+
+void Renderer::draw_depth_prepass(VkCommandBuffer cmd_buffer, VkImageView depth_image_view) {
+    const auto start = std::chrono::system_clock::now();
+    const uint32_t scope = m_profiler.begin_scope(cmd_buffer, "depth prepass");
+
+    VkRenderingAttachmentInfo depth_attachment = init::depth_attachment_info(depth_image_view);
+    VkRenderingInfo render_info = init::rendering_info(m_draw_extent, nullptr, &depth_attachment);
+    render_info.colorAttachmentCount = 0;
+
+    vkCmdBeginRendering(cmd_buffer, &render_info);
+    draw_meshes(cmd_buffer, mesh_pipelines().depth_prepass);
+    vkCmdEndRendering(cmd_buffer);
+
+    m_profiler.end_scope(cmd_buffer, scope);
+    const auto end = std::chrono::system_clock::now();
+    m_stats.mesh_draw_time += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0f;
+}
+
+void Renderer::draw_geometry(VkCommandBuffer cmd_buffer, VkImageView color_image_view, VkImageView depth_image_view, bool depth_prepass) {
+    const auto start = std::chrono::system_clock::now();
+    const uint32_t scope = m_profiler.begin_scope(cmd_buffer, "geometry");
+
+    VkRenderingAttachmentInfo color_attachment = init::color_attachment_info(color_image_view, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    VkRenderingAttachmentInfo depth_attachment = init::depth_attachment_info(depth_image_view);
+    if (depth_prepass) {
+        // Read only from here on, nothing after this pass needs depth either
+        depth_attachment = init::depth_attachment_info(depth_image_view, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+        depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_NONE;
+    }
+    VkRenderingInfo render_info = init::rendering_info(m_draw_extent, &color_attachment, &depth_attachment);
+
+    vkCmdBeginRendering(cmd_buffer, &render_info);
+    draw_meshes(cmd_buffer, depth_prepass ? mesh_pipelines().opaque_after_prepass : mesh_pipelines().opaque);
+    vkCmdEndRendering(cmd_buffer);
+
+    for (const RenderObject& draw : m_snapshot->draw_context.opaque_surfaces) {
+        m_stats.triangle_count += static_cast<int>(draw.index_count / 3);
+    }
+
+    m_profiler.end_scope(cmd_buffer, scope);
+    const auto end = std::chrono::system_clock::now();
+    m_stats.mesh_draw_time += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0f;
+}
+
+void Renderer::draw_meshes(VkCommandBuffer cmd_buffer, VkPipeline pipeline) {
+    vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+    VkViewport viewport = {};
+    viewport.x = 0;
+    viewport.y = 0;
+    viewport.width = static_cast<float>(m_draw_extent.width);
+    viewport.height = static_cast<float>(m_draw_extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmd_buffer, 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.offset = {0, 0};
+    scissor.extent = m_draw_extent;
+    vkCmdSetScissor(cmd_buffer, 0, 1, &scissor);
+
+    // Every mesh lives in the geometry pool, one index buffer binding covers all of them
+    vkCmdBindIndexBuffer(cmd_buffer, m_geometry_pool.index_buffer(), 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_opaque_pipeline.layout, 0, 1, &m_scene_descriptors, 1, &m_scene_data_offset);
+
+    const MaterialInstance* last_material = nullptr;
+    if (!m_snapshot->draw_context.instanced_draws.empty()) {
+        for (const InstancedDraw& draw : m_snapshot->draw_context.instanced_draws) {
+            if (draw.material != last_material) {
+                vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_opaque_pipeline.layout, 1, 1, &draw.material->materialSet, 0, nullptr);
+                last_material = draw.material;
+            }
+
+            GPUInstancedPushConstants push_constants = {};
+            push_constants.vertex_buffer = draw.vertex_buffer_address;
+            push_constants.instance_buffer = m_instance_data_address;
+            vkCmdPushConstants(cmd_buffer, m_opaque_pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GPUInstancedPushConstants), &push_constants);
+            vkCmdDrawIndexed(cmd_buffer, draw.index_count, draw.instance_count, draw.first_index, draw.vertex_offset, draw.first_instance);
+            m_stats.draw_call_count++;
+        }
+        return;
+    }
+
+    for (const RenderObject& draw : m_snapshot->draw_context.opaque_surfaces) {
+        if (draw.material != last_material) {
+            vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_opaque_pipeline.layout, 1, 1, &draw.material->materialSet, 0, nullptr);
+            last_material = draw.material;
+        }
+
+        GPUDrawPushConstants push_constants = {};
+        push_constants.world_matrix = draw.transform;
+        push_constants.vertex_buffer = draw.vertex_buffer_address;
+        vkCmdPushConstants(cmd_buffer, m_opaque_pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GPUDrawPushConstants), &push_constants);
+        vkCmdDrawIndexed(cmd_buffer, draw.index_count, 1, draw.first_index, draw.vertex_offset, 0);
+        m_stats.draw_call_count++;
+    }
+}
+
+void Renderer::init_upscale_pipeline() {
+    {
+        DescriptorLayoutBuilder builder;
+        builder.add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        builder.add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        m_upscale_descriptor_layout = builder.build(m_vkb_device.device, VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+
+    VkPushConstantRange push_constant = {};
+    push_constant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant.offset = 0;
+    push_constant.size = sizeof(UpscalePushConstants);
+
+    VkPipelineLayoutCreateInfo layout_info = {};
+    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.pNext = nullptr;
+    layout_info.pSetLayouts = &m_upscale_descriptor_layout;
+    layout_info.setLayoutCount = 1;
+    layout_info.pPushConstantRanges = &push_constant;
+    layout_info.pushConstantRangeCount = 1;
+    VK_CHECK(vkCreatePipelineLayout(m_vkb_device.device, &layout_info, nullptr, &m_upscale_pipeline_layout));
+
+    m_deletion_queue.push_function([this]() {
+        std::cout << "m_deletion_queue destroy upscale pipeline" << std::endl;
+        vkDestroyPipeline(m_vkb_device.device, m_upscale_pipeline, nullptr);
+        vkDestroyPipelineLayout(m_vkb_device.device, m_upscale_pipeline_layout, nullptr);
+        vkDestroyDescriptorSetLayout(m_vkb_device.device, m_upscale_descriptor_layout, nullptr);
+    });
+
+    // Without formatless storage writes or the shader the final step stays a linear blit
+    if (!m_storage_write_without_format) {
+        std::cout << "shaderStorageImageWriteWithoutFormat not supported, upscaler disabled" << std::endl;
+        return;
+    }
+
+    VkShaderModule upscale_shader = {};
+    if (!util::load_shader_module("upscale.comp", m_vkb_device.device, &upscale_shader)) {
+        std::cerr << "Failed to load upscale shader, upscaler disabled" << std::endl;
+        return;
     }
 
     VkPipelineShaderStageCreateInfo stage_info = {};
     stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     stage_info.pNext = nullptr;
     stage_info.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-    stage_info.module = compute_gradient_shader;
+    stage_info.module = upscale_shader;
     stage_info.pName = "main";
 
-    VkComputePipelineCreateInfo compute_pipeline_create_info = {};
-    compute_pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    compute_pipeline_create_info.pNext = nullptr;
-    compute_pipeline_create_info.layout = m_compute_pipeline_layout;
-    compute_pipeline_create_info.stage = stage_info;
-
-    ComputeEffect gradient = {};
-    gradient.layout = m_compute_pipeline_layout;
-    gradient.name = "gradient";
-    gradient.data = {};
-    gradient.data.data1 = glm::vec4(1, 0, 0, 1);
-    gradient.data.data2 = glm::vec4(0, 0, 1, 1);
-    VK_CHECK(vkCreateComputePipelines(m_vkb_device.device, VK_NULL_HANDLE, 1, &compute_pipeline_create_info, nullptr, &gradient.pipeline));
-
-    compute_pipeline_create_info.stage.module = compute_sky_shader;
-    ComputeEffect sky = {};
-    sky.layout = m_compute_pipeline_layout;
-    sky.name = "sky";
-    sky.data = {};
-    sky.data.data1 = glm::vec4(0.1, 0.2, 0.4 ,0.97);
-    VK_CHECK(vkCreateComputePipelines(m_vkb_device.device, VK_NULL_HANDLE, 1, &compute_pipeline_create_info, nullptr, &sky.pipeline));
-
-    compute_pipeline_create_info.stage.module = compute_grid_shader;
-    ComputeEffect grid = {};
-    grid.layout = m_compute_pipeline_layout;
-    grid.name = "grid";
-    grid.data = {};
-    grid.data.data1 = glm::vec4(1.0, 1.0, 1.0 ,1.0);
-    grid.data.data2 = glm::vec4(0.0, 0.0, 0.0 ,1.0);
-    grid.data.data3 = glm::vec4(0.0, 0.0, 0.0 ,1.0);
-    VK_CHECK(vkCreateComputePipelines(m_vkb_device.device, VK_NULL_HANDLE, 1, &compute_pipeline_create_info, nullptr, &grid.pipeline));
-
-    m_background_effects.push_back(gradient);
-    m_background_effects.push_back(sky);
-    m_background_effects.push_back(grid);
-
-    vkDestroyShaderModule(m_vkb_device.device, compute_gradient_shader, nullptr);
-    vkDestroyShaderModule(m_vkb_device.device, compute_sky_shader, nullptr);
-    vkDestroyShaderModule(m_vkb_device.device, compute_grid_shader, nullptr);
-
-    m_deletion_queue.push_function([this, gradient, sky, grid]() {
-        vkDestroyPipelineLayout(m_vkb_device.device, m_compute_pipeline_layout, nullptr);
-        vkDestroyPipeline(m_vkb_device.device, gradient.pipeline, nullptr);
-        vkDestroyPipeline(m_vkb_device.device, sky.pipeline, nullptr);
-        vkDestroyPipeline(m_vkb_device.device, grid.pipeline, nullptr);
+    VkComputePipelineCreateInfo pipeline_info = {};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.pNext = nullptr;
+    pipeline_info.layout = m_upscale_pipeline_layout;
+    pipeline_info.stage = stage_info;
+    VK_CHECK(vkCreateComputePipelines(m_vkb_device.device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &m_upscale_pipeline));
+    vkDestroyShaderModule(m_vkb_device.device, upscale_shader, nullptr);
+
+    m_upscaler_available = true;
+    std::cout << "Upscale pipeline initialized" << std::endl;
+}
+
+void Renderer::draw_upscale(VkCommandBuffer cmd_buffer, VkImageView source, VkImageView destination, VkExtent2D destination_extent) {
+    VkDescriptorSet set = get_current_frame().frame_descriptors.allocate(m_vkb_device.device, m_upscale_descriptor_layout);
+    DescriptorWriter writer(&get_current_frame().arena);
+    writer.write_image(0, source, m_default_sampler_linear, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+    writer.write_image(1, destination, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    writer.update_set(m_vkb_device.device, set);
+
+    UpscalePushConstants push_constants = {};
+    push_constants.source_extent = glm::vec2(m_draw_extent.width, m_draw_extent.height);
+    push_constants.source_texture_size = glm::vec2(m_draw_image.image_extent.width, m_draw_image.image_extent.height);
+    push_constants.destination_extent = glm::vec2(destination_extent.width, destination_extent.height);
+    push_constants.sharpness = m_settings.upscale_sharpness;
+
+    vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_upscale_pipeline);
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_upscale_pipeline_layout, 0, 1, &set, 0, nullptr);
+    vkCmdPushConstants(cmd_buffer, m_upscale_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(UpscalePushConstants), &push_constants);
+    vkCmdDispatch(cmd_buffer, (destination_extent.width + 15) / 16, (destination_extent.height + 15) / 16, 1);
+}
+
+void Renderer::init_background_pipelines() {
+    m_pipeline_layouts.init(m_vkb_device.device);
+    m_effect_registry.init(m_vkb_device.device, &m_pipeline_layouts);
+
+    // Manifest assignments and chain bindings go by the names reflection reads from OpName/OpMemberName. A build that
+    // strips them (glslc -O, spirv-opt --strip-debug) leaves every effect unlabelled and every chain rejected
+    const std::optional<std::span<const uint32_t>> known_code = find_embedded_shader("gradient_color.comp");
+    const std::optional<ShaderReflection> known_reflection = known_code.has_value() ? reflect::reflect_spirv(known_code.value()) : std::nullopt;
+    if (!known_reflection.has_value() || known_reflection->find_push_constant("data1") == nullptr) {
+        std::cerr << "gradient_color.comp reflects without member names, the embedded shaders were built without debug info "
+            "and effects.txt can't assign parameters or bind chain images" << std::endl;
+    }
+
+    const size_t effect_count = m_effect_registry.load_manifest(embedded_effect_manifest());
+
+    m_deletion_queue.push_function([this]() {
+        std::cout << "m_deletion_queue destroy background effects" << std::endl;
+        for (const EffectChain& chain : m_effect_registry.chains()) {
+            destroy_chain_images(chain);
+        }
+        m_effect_registry.destroy();
+        m_pipeline_layouts.destroy();
     });
 
-    std::cout << "Background pipelines initialized" << std::endl;
+    std::cout << "Background pipelines initialized, " << effect_count << " effects and chains sharing "
+        << m_pipeline_layouts.pipeline_layout_count() << " pipeline layouts" << std::endl;
 }
 
 void Renderer::init_imgui() {
     IMGUI_CHECKVERSION();
+    // ImGui allocates through malloc, routing it past the counter keeps its allocations in the per-frame figure
+    ImGui::SetAllocatorFunctions([](size_t size, void*) -> void* {
+        memory::count_allocation();
+        return malloc(size);
+    }, [](void* pointer, void*) {
+        free(pointer);
+    });
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
@@ -619,7 +1949,8 @@ void Renderer::init_imgui() {
     init_info.DescriptorPoolSize = IMGUI_IMPL_VULKAN_MINIMUM_IMAGE_SAMPLER_POOL_SIZE; // (Optional) Set to create internal descriptor pool instead of using DescriptorPool
     init_info.PipelineInfoMain.Subpass = 0;
     init_info.MinImageCount = 2;
-    init_info.ImageCount = 2;
+    // ImGui rotates its vertex buffers over ImageCount frames, it must cover every frame that can be in flight
+    init_info.ImageCount = MAX_FRAMES_IN_FLIGHT;
     init_info.PipelineInfoMain.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
     init_info.UseDynamicRendering = true;
     //init_info.Allocator = YOUR_ALLOCATOR; // optional
@@ -653,7 +1984,7 @@ void Renderer::draw_imgui(VkCommandBuffer cmd, VkImageView target_image_view) {
     VkRenderingInfo render_info = init::rendering_info(m_swapchain_extent, &color_attachment, nullptr);
 
     vkCmdBeginRendering(cmd, &render_info);
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+    ImGui_ImplVulkan_RenderDrawData(m_snapshot->imgui.draw_data(), cmd);
     vkCmdEndRendering(cmd);
 }
 
@@ -670,7 +2001,10 @@ void Renderer::immediate_submit(std::function<void(VkCommandBuffer cmd)> &&funct
 
     VkCommandBufferSubmitInfo cmd_info = init::command_buffer_submit_info(imm_cmd);
     VkSubmitInfo2 submit_info = init::submit_info(&cmd_info, nullptr, nullptr);
-    VK_CHECK(vkQueueSubmit2(m_graphics_queue, 1, &submit_info, m_imm_fence));
+    {
+        std::scoped_lock lock(m_graphics_queue_mutex);
+        VK_CHECK(vkQueueSubmit2(m_graphics_queue, 1, &submit_info, m_imm_fence));
+    }
     VK_CHECK(vkWaitForFences(m_vkb_device.device, 1, &m_imm_fence, true, 9999999999));
 }
 
@@ -699,36 +2033,51 @@ GPUMeshBuffers Renderer::upload_mesh(std::span<uint32_t> indices, std::span<Vert
     const size_t vertex_buffer_size = vertices.size() * sizeof(Vertex);
     const size_t index_buffer_size = indices.size() * sizeof(uint32_t);
 
-    GPUMeshBuffers new_surface;
-    new_surface.vertex_buffer = create_buffer(vertex_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_AUTO);
+    GPUMeshBuffers new_surface = {};
+    new_surface.vertex_allocation = m_geometry_pool.allocate_vertices(static_cast<uint32_t>(vertices.size()));
+    new_surface.index_allocation = m_geometry_pool.allocate_indices(static_cast<uint32_t>(indices.size()));
+    if (!new_surface.vertex_allocation.is_valid() || !new_surface.index_allocation.is_valid()) {
+        std::cerr << "Geometry pool is out of space for mesh with " << vertices.size() << " vertices and " << indices.size() << " indices" << std::endl;
+        m_geometry_pool.free(new_surface.vertex_allocation, new_surface.index_allocation);
+        return {};
+    }
 
-    VkBufferDeviceAddressInfo device_adress_info = { .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, .buffer = new_surface.vertex_buffer.buffer };
-    new_surface.vertex_buffer_address = vkGetBufferDeviceAddress(m_vkb_device.device, &device_adress_info);
-    new_surface.index_buffer = create_buffer(index_buffer_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO);
+    new_surface.first_index = new_surface.index_allocation.offset;
+    new_surface.index_count = static_cast<uint32_t>(indices.size());
+    new_surface.vertex_offset = static_cast<int32_t>(new_surface.vertex_allocation.offset);
+    new_surface.vertex_count = static_cast<uint32_t>(vertices.size());
+    // Vertex pulling indexes with gl_VertexIndex, which already includes vertex_offset
+    new_surface.vertex_buffer_address = m_geometry_pool.vertex_buffer_address();
 
     AllocatedBuffer staging = create_buffer(vertex_buffer_size + index_buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_AUTO);
     void* data = staging.info.pMappedData; // had to change this from vkguides staging.alloction.GetMappedData()
     memcpy(data, vertices.data(), vertex_buffer_size);
     memcpy((char*)data + vertex_buffer_size, indices.data(), index_buffer_size);
 
-    immediate_submit([vertex_buffer_size, index_buffer_size, staging, new_surface](VkCommandBuffer cmd) {
+    const VkBuffer vertex_buffer = m_geometry_pool.vertex_buffer();
+    const VkBuffer index_buffer = m_geometry_pool.index_buffer();
+    immediate_submit([vertex_buffer_size, index_buffer_size, staging, new_surface, vertex_buffer, index_buffer](VkCommandBuffer cmd) {
         VkBufferCopy vertex_copy = {};
-        vertex_copy.dstOffset = 0;
+        vertex_copy.dstOffset = static_cast<VkDeviceSize>(new_surface.vertex_allocation.offset) * sizeof(Vertex);
         vertex_copy.srcOffset = 0;
         vertex_copy.size = vertex_buffer_size;
-        vkCmdCopyBuffer(cmd, staging.buffer, new_surface.vertex_buffer.buffer, 1, &vertex_copy);
+        vkCmdCopyBuffer(cmd, staging.buffer, vertex_buffer, 1, &vertex_copy);
 
         VkBufferCopy index_copy = {};
-        index_copy.dstOffset = 0;
+        index_copy.dstOffset = static_cast<VkDeviceSize>(new_surface.index_allocation.offset) * sizeof(uint32_t);
         index_copy.srcOffset = vertex_buffer_size;
         index_copy.size = index_buffer_size;
-        vkCmdCopyBuffer(cmd, staging.buffer, new_surface.index_buffer.buffer, 1, &index_copy);
+        vkCmdCopyBuffer(cmd, staging.buffer, index_buffer, 1, &index_copy);
     });
 
     destroy_buffer(staging);
     return new_surface;
 }
 
+void Renderer::destroy_mesh(const GPUMeshBuffers& mesh) {
+    m_geometry_pool.free(mesh.vertex_allocation, mesh.index_allocation);
+}
+
 void Renderer::init_default_data() {
     std::array<Vertex, 4> rect_vertices;
     rect_vertices[0].position = {0.5,-0.5, 0};
@@ -750,8 +2099,6 @@ void Renderer::init_default_data() {
     rect_indices[4] = 1;
     rect_indices[5] = 3;
 
-    //m_test_meshes = load_gltf_meshes(this, "../assets/basicmesh.glb").value();
-
     uint32_t white = glm::packUnorm4x8(glm::vec4(1, 1, 1, 1));
     m_white_image = create_image((void*)&white, VkExtent3D{ 1, 1, 1 }, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
 
@@ -777,6 +2124,8 @@ void Renderer::init_default_data() {
 
     sample.magFilter = VK_FILTER_LINEAR;
     sample.minFilter = VK_FILTER_LINEAR;
+    sample.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    sample.maxLod = VK_LOD_CLAMP_NONE;
     vkCreateSampler(m_vkb_device.device, &sample, nullptr, &m_default_sampler_linear);
 
     m_deletion_queue.push_function([&](){
@@ -789,6 +2138,46 @@ void Renderer::init_default_data() {
         destroy_image(m_black_image);
         destroy_image(m_error_checkerboard_image);
     });
+
+    m_default_material_constants = create_buffer(sizeof(MaterialConstants), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    MaterialConstants material_constants = {};
+    material_constants.color_factors = glm::vec4(1.0f);
+    material_constants.metal_rough_factors = glm::vec4(1.0f, 0.5f, 0.0f, 0.0f);
+    memcpy(m_default_material_constants.info.pMappedData, &material_constants, sizeof(MaterialConstants));
+
+    m_default_data.pipeline = &m_opaque_pipeline;
+    m_default_data.passType = MaterialPass::MainColor;
+    m_default_data.materialSet = m_global_descriptor_allocator.allocate(m_vkb_device.device, m_material_descriptor_layout);
+    DescriptorWriter writer;
+    writer.write_buffer(0, m_default_material_constants.buffer, sizeof(MaterialConstants), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+    writer.write_image(1, m_white_image.image_view, m_default_sampler_linear, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+    writer.write_image(2, m_white_image.image_view, m_default_sampler_linear, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+    writer.update_set(m_vkb_device.device, m_default_data.materialSet);
+
+    // Trimmed once before anything is imported, imports only trim after adding entries
+    m_texture_cache_directory = user_data_directory("textures");
+    if (!m_texture_cache_directory.empty()) {
+        texture::trim_cache(m_texture_cache_directory);
+    }
+
+    m_test_meshes = loader::load_gltf_meshes(this, "../assets/basicmesh.glb").value_or(std::vector<std::shared_ptr<MeshAsset>>{});
+
+    m_deletion_queue.push_function([this]() {
+        std::cout << "m_deletion_queue destroy meshes" << std::endl;
+        for (const std::shared_ptr<MeshAsset>& mesh : m_test_meshes) {
+            destroy_mesh(mesh->mesh_buffers);
+        }
+        m_test_meshes.clear();
+        for (const AllocatedImage& image : m_material_images) {
+            destroy_image(image);
+        }
+        m_material_images.clear();
+        for (const AllocatedBuffer& buffer : m_material_buffers) {
+            destroy_buffer(buffer);
+        }
+        m_material_buffers.clear();
+        destroy_buffer(m_default_material_constants);
+    });
 }
 
 AllocatedImage Renderer::create_image(VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped) {
@@ -798,7 +2187,7 @@ AllocatedImage Renderer::create_image(VkExtent3D size, VkFormat format, VkImageU
 
     VkImageCreateInfo img_info = init::image_create_info(format, usage, size);
     if (mipmapped) {
-        img_info.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(size.width, size.height)))) + 1;
+        img_info.mipLevels = texture::mip_level_count(size);
     }
 
     VmaAllocationCreateInfo alloc_info = {};
@@ -819,12 +2208,23 @@ AllocatedImage Renderer::create_image(VkExtent3D size, VkFormat format, VkImageU
 }
 
 AllocatedImage Renderer::create_image(void *data, VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped) {
-    size_t data_size = size.depth * size.width * size.height * 4;
+    const size_t data_size = static_cast<size_t>(size.depth) * size.width * size.height * texture::bytes_per_pixel(format);
     AllocatedBuffer upload_buffer = create_buffer(data_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
 
     memcpy(upload_buffer.info.pMappedData, data, data_size);
 
+    // Mips are built with blits, which the format has to support. Linear filtering is optional for some formats (e.g. 32 bit float)
+    VkFormatProperties format_properties = {};
+    vkGetPhysicalDeviceFormatProperties(m_vkb_physical_device.physical_device, format, &format_properties);
+    const VkFormatFeatureFlags blit_features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    if (mipmapped && (format_properties.optimalTilingFeatures & blit_features) != blit_features) {
+        std::cerr << "Format " << string_VkFormat(format) << " can't be blitted, skipping mip generation" << std::endl;
+        mipmapped = false;
+    }
+    const VkFilter mip_filter = (format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
     AllocatedImage new_image = create_image(size, format, usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, mipmapped);
+    const uint32_t mip_levels = mipmapped ? texture::mip_level_count(size) : 1;
 
     immediate_submit([&](VkCommandBuffer cmd) {
         util::transition_image(cmd, new_image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
@@ -842,14 +2242,172 @@ AllocatedImage Renderer::create_image(void *data, VkExtent3D size, VkFormat form
         vkCmdCopyBufferToImage(cmd, upload_buffer.buffer, new_image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
             &copy_region);
 
-        util::transition_image(cmd, new_image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        if (mipmapped) {
+            util::generate_mipmaps(cmd, new_image.image, VkExtent2D{size.width, size.height}, mip_levels, mip_filter);
+        } else {
+            util::transition_image(cmd, new_image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
         });
 
     destroy_buffer(upload_buffer);
     return new_image;
 }
 
+AllocatedImage Renderer::create_image(const CompressedTexture& texture, VkImageUsageFlags usage) {
+    AllocatedBuffer upload_buffer = create_buffer(texture.data.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    memcpy(upload_buffer.info.pMappedData, texture.data.data(), texture.data.size());
+
+    AllocatedImage new_image = {};
+    new_image.image_format = texture.format;
+    new_image.image_extent = texture.extent;
+
+    VkImageCreateInfo img_info = init::image_create_info(texture.format, usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT, texture.extent);
+    img_info.mipLevels = static_cast<uint32_t>(texture.mips.size());
+
+    VmaAllocationCreateInfo alloc_info = {};
+    alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    alloc_info.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VK_CHECK(vmaCreateImage(m_allocator, &img_info, &alloc_info, &new_image.image, &new_image.allocation, nullptr));
+
+    VkImageViewCreateInfo view_info = init::image_view_create_info(texture.format, new_image.image, VK_IMAGE_ASPECT_COLOR_BIT);
+    view_info.subresourceRange.levelCount = img_info.mipLevels;
+    VK_CHECK(vkCreateImageView(m_vkb_device.device, &view_info, nullptr, &new_image.image_view));
+
+    // The mips were built offline, so every level is a straight copy
+    std::vector<VkBufferImageCopy> copy_regions;
+    copy_regions.reserve(texture.mips.size());
+    for (uint32_t mip = 0; mip < texture.mips.size(); mip++) {
+        VkBufferImageCopy copy_region = {};
+        copy_region.bufferOffset = texture.mips[mip].offset;
+        copy_region.bufferRowLength = 0;
+        copy_region.bufferImageHeight = 0;
+        copy_region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        copy_region.imageSubresource.mipLevel = mip;
+        copy_region.imageSubresource.baseArrayLayer = 0;
+        copy_region.imageSubresource.layerCount = 1;
+        copy_region.imageExtent = texture.mips[mip].extent;
+        copy_regions.push_back(copy_region);
+    }
+
+    immediate_submit([&](VkCommandBuffer cmd) {
+        util::transition_image(cmd, new_image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        vkCmdCopyBufferToImage(cmd, upload_buffer.buffer, new_image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(copy_regions.size()), copy_regions.data());
+        util::transition_image(cmd, new_image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    });
+
+    destroy_buffer(upload_buffer);
+    return new_image;
+}
+
+std::optional<AllocatedImage> Renderer::load_texture(const std::string& file_path, bool srgb) {
+    DecodedImage decoded = texture::decode_image(file_path, srgb);
+    if (!decoded.is_valid()) {
+        return std::nullopt;
+    }
+    return create_image(decoded.pixels.data(), decoded.extent, decoded.format, VK_IMAGE_USAGE_SAMPLED_BIT, true);
+}
+
+std::vector<std::optional<AllocatedImage>> Renderer::load_textures(std::span<const std::string> file_paths, bool srgb) {
+    // Decoding is the slow part, so it runs on worker threads. Uploads stay on this thread since they use the immediate queue
+    std::vector<DecodedImage> decoded_images = texture::decode_images(m_jobs, file_paths, srgb);
+
+    std::vector<std::optional<AllocatedImage>> textures;
+    textures.reserve(decoded_images.size());
+    for (DecodedImage& decoded : decoded_images) {
+        if (!decoded.is_valid()) {
+            textures.emplace_back(std::nullopt);
+            continue;
+        }
+        textures.emplace_back(create_image(decoded.pixels.data(), decoded.extent, decoded.format, VK_IMAGE_USAGE_SAMPLED_BIT, true));
+    }
+    return textures;
+}
+
+std::vector<std::optional<AllocatedImage>> Renderer::load_compressed_textures(std::span<const std::string> file_paths, std::span<const TextureRole> roles) {
+    if (!m_bc_textures_supported) {
+        // Decoded in parallel as two batches, albedo as sRGB and the other roles as linear data
+        std::vector<std::optional<AllocatedImage>> textures(file_paths.size());
+        for (const bool srgb : {true, false}) {
+            std::vector<std::string> batch_paths;
+            std::vector<size_t> batch_indices;
+            for (size_t i = 0; i < file_paths.size(); i++) {
+                if ((roles[i] == TextureRole::Albedo) == srgb) {
+                    batch_paths.push_back(file_paths[i]);
+                    batch_indices.push_back(i);
+                }
+            }
+            std::vector<std::optional<AllocatedImage>> batch = load_textures(batch_paths, srgb);
+            for (size_t i = 0; i < batch.size(); i++) {
+                textures[batch_indices[i]] = std::move(batch[i]);
+            }
+        }
+        return textures;
+    }
+
+    std::vector<CompressedTexture> compressed = texture::import_compressed(m_jobs, file_paths, roles, m_texture_cache_directory);
+
+    std::vector<std::optional<AllocatedImage>> textures;
+    textures.reserve(compressed.size());
+    for (size_t i = 0; i < compressed.size(); i++) {
+        if (compressed[i].is_valid()) {
+            textures.emplace_back(create_image(compressed[i], VK_IMAGE_USAGE_SAMPLED_BIT));
+        } else {
+            // 16 bit and HDR sources aren't block compressed, they keep their full precision format
+            textures.emplace_back(load_texture(file_paths[i], roles[i] == TextureRole::Albedo));
+        }
+    }
+    return textures;
+}
+
+std::vector<std::shared_ptr<GLTFMaterial>> Renderer::create_materials(std::span<const MaterialDescription> materials, std::span<const std::string> image_paths,
+    std::span<const TextureRole> image_roles) {
+    std::vector<std::shared_ptr<GLTFMaterial>> created;
+    if (materials.empty()) {
+        return created;
+    }
+
+    const std::vector<std::optional<AllocatedImage>> images = load_compressed_textures(image_paths, image_roles);
+    for (const std::optional<AllocatedImage>& image : images) {
+        if (image.has_value()) {
+            m_material_images.push_back(image.value());
+        }
+    }
+    const auto image_view = [&](std::optional<uint32_t> index) {
+        if (!index.has_value()) {
+            return m_white_image.image_view;
+        }
+        return images[index.value()].has_value() ? images[index.value()]->image_view : m_error_checkerboard_image.image_view;
+    };
+
+    // Every material's constants in one buffer, each at an offset a uniform descriptor can start at
+    const VkDeviceSize alignment = std::max(m_vkb_physical_device.properties.limits.minUniformBufferOffsetAlignment, VkDeviceSize{16});
+    const VkDeviceSize stride = (sizeof(MaterialConstants) + alignment - 1) / alignment * alignment;
+    const AllocatedBuffer constants = create_buffer(stride * materials.size(), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    m_material_buffers.push_back(constants);
+
+    created.reserve(materials.size());
+    for (size_t i = 0; i < materials.size(); i++) {
+        const MaterialDescription& description = materials[i];
+        memcpy(static_cast<std::byte*>(constants.info.pMappedData) + stride * i, &description.constants, sizeof(MaterialConstants));
+
+        std::shared_ptr<GLTFMaterial> material = std::make_shared<GLTFMaterial>();
+        material->data.pipeline = &m_opaque_pipeline;
+        material->data.passType = MaterialPass::MainColor;
+        material->data.materialSet = m_global_descriptor_allocator.allocate(m_vkb_device.device, m_material_descriptor_layout);
+        DescriptorWriter writer;
+        writer.write_buffer(0, constants.buffer, sizeof(MaterialConstants), stride * i, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+        writer.write_image(1, image_view(description.color_image), m_default_sampler_linear, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        writer.write_image(2, image_view(description.metal_rough_image), m_default_sampler_linear, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        writer.update_set(m_vkb_device.device, material->data.materialSet);
+        created.push_back(std::move(material));
+    }
+    return created;
+}
+
 void Renderer::destroy_image(const AllocatedImage &image) {
     vkDestroyImageView(m_vkb_device.device, image.image_view, nullptr);
     vmaDestroyImage(m_allocator, image.image, image.allocation);
@@ -859,9 +2417,14 @@ void Renderer::run() {
     SDL_Event e;
     bool quit = false;
     bool show_demo_window = true;
-    while (!quit) {
+    m_render_thread = std::thread(&Renderer::render_thread_main, this);
+    // Kept until a snapshot carries it, a resize that comes in while minimised would be lost otherwise
+    bool window_resized = false;
 
+    while (!quit) {
         auto start = std::chrono::system_clock::now();
+        const uint64_t allocations_at_start = memory::allocation_count();
+
         // Todo: Normalize the mouse coords
         while (SDL_PollEvent(&e) != 0) {
             ImGui_ImplSDL3_ProcessEvent(&e);
@@ -877,7 +2440,7 @@ void Renderer::run() {
             }
 
             if (e.window.type == SDL_EVENT_WINDOW_RESIZED) {
-                resize_requested = true;
+                window_resized = true;
             }
 
             if (e.type == SDL_EVENT_MOUSE_MOTION) {
@@ -885,56 +2448,351 @@ void Renderer::run() {
                 //std::cout << "X Mouse:" << get_current_frame().mouse_position.x << '\n' << "Y Mouse:" << get_current_frame().mouse_position.y << std::endl;
             }
 
-            // Todo: Game of Life?
             // if (e.type == SDL_EVENT_MOUSE_BUTTON_DOWN) {
             //     std::cout << "Mouse clicked" << std::endl;
             // }
         }
 
-        if (stop_rendering) {
+        if (stop_rendering && !m_replaying) {
+            // Nothing gets published, the render thread sits in take() until the window is back
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
             continue;
         }
 
-        if (resize_requested) {
-            int width, height;
-            SDL_GetWindowSize(m_window, &width, &height);
-            m_window_extent.width = width;
-            m_window_extent.height = height;
-            resize_swapchain(m_window_extent.width, m_window_extent.height);
+        EngineStats stats;
+        {
+            std::scoped_lock lock(m_stats_mutex);
+            stats = m_published_stats;
         }
 
+        // The render thread may still be reading the snapshot published last, this one is ours until publish()
+        FrameSnapshot& snapshot = m_snapshots.write_slot();
+        // Value initialised, the explicit padding is written to captures too
+        FrameInputs inputs = {};
+        int width, height;
+        SDL_GetWindowSize(m_window, &width, &height);
+        inputs.time = static_cast<float>(SDL_GetTicks()) / 1000.0f;
+        inputs.window_extent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+        inputs.resize_requested = window_resized;
+        inputs.mouse_position = m_mouse_position;
+
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplSDL3_NewFrame();
         ImGui::NewFrame();
-        if (ImGui::Begin("background")) {
-            ComputeEffect& selected = m_background_effects[m_current_background_effect];
-            ImGui::SliderFloat("Render Scale", &m_render_scale, 0.3f, 1.f);
-            ImGui::Text("Selected effect: %s", selected.name);
-            ImGui::SliderInt("Effect Index", &m_current_background_effect,0, m_background_effects.size() - 1);
-            ImGui::InputFloat4("data1",(float*)& selected.data.data1);
-            ImGui::InputFloat4("data2",(float*)& selected.data.data2);
-            ImGui::InputFloat4("data3",(float*)& selected.data.data3);
-            ImGui::InputFloat4("data4",(float*)& selected.data.data4);
-        }
-        ImGui::End();
-
-        ImGui::Begin("Stats");
-        ImGui::Text("frametime %f ms", m_stats.frame_time);
-        ImGui::Text("draw time %f ms", m_stats.mesh_draw_time);
-        ImGui::Text("update time %f ms", m_stats.scene_update_time);
-        ImGui::Text("triangles %i", m_stats.triangle_count);
-        ImGui::Text("draws %i", m_stats.draw_call_count);
-        ImGui::End();
+        build_imgui(stats);
         //ImGui::ShowDemoWindow(&show_demo_window);
-        //Todo: Move the imgui functions?
         ImGui::Render();
-        draw_frame();
 
-        auto end = std::chrono::system_clock::now();
+        // Texture uploads go to the graphics queue and touch ImGui's own texture data, both happen here rather than
+        // on the render thread, which only ever sees the copy
+        ImDrawData* draw_data = ImGui::GetDrawData();
+        if (draw_data->Textures != nullptr) {
+            for (ImTextureData* texture : *draw_data->Textures) {
+                if (texture->Status != ImTextureStatus_OK) {
+                    std::scoped_lock lock(m_graphics_queue_mutex);
+                    ImGui_ImplVulkan_UpdateTexture(texture);
+                }
+            }
+        }
+        snapshot.imgui.copy(*draw_data);
+
+        // Everything the UI decided this frame, replaced wholesale by the capture's when replaying
+        inputs.settings = m_ui_settings;
+        inputs.use_instancing = m_use_instancing;
+        inputs.mesh_grid_size = m_mesh_grid_size;
+        inputs.reset_chain = m_reset_chain;
+        m_reset_chain = -1;
+        if (!capture_frame_inputs(inputs)) {
+            quit = true;
+            break;
+        }
+        if (m_replaying && (inputs.window_extent.width != static_cast<uint32_t>(width) ||
+                            inputs.window_extent.height != static_cast<uint32_t>(height))) {
+            SDL_SetWindowSize(m_window, static_cast<int>(inputs.window_extent.width), static_cast<int>(inputs.window_extent.height));
+            SDL_SyncWindow(m_window);
+            inputs.resize_requested = true;
+        }
+        apply_frame_inputs(inputs);
+
+        snapshot.settings = inputs.settings;
+        snapshot.window_extent = inputs.window_extent;
+        snapshot.resize_requested = inputs.resize_requested;
+        snapshot.mouse_position = inputs.mouse_position;
+        snapshot.time = inputs.time;
+        snapshot.frame_number = m_frame_number++;
+        const auto scene_start = std::chrono::system_clock::now();
+        update_scene(snapshot);
+        const auto end = std::chrono::system_clock::now();
+        snapshot.scene_update_ms = std::chrono::duration_cast<std::chrono::microseconds>(end - scene_start).count() / 1000.0f;
+        snapshot.main_thread_ms = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0f;
+        m_snapshots.publish();
+        window_resized = false;
+
         auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-        m_stats.frame_time = elapsed.count() / 1000.0f;
+        m_simulation_stats.frame_time = elapsed.count() / 1000.0f;
+        m_simulation_stats.frame_allocations = static_cast<uint32_t>(memory::allocation_count() - allocations_at_start);
+    }
+
+    m_snapshots.close();
+    m_render_thread.join();
+    m_capture.close();
+    if (m_replaying) {
+        m_frame_timings.print_summary();
+        m_frame_timings.write_csv(m_options.timings_path);
+    }
+}
+
+void Renderer::render_thread_main() {
+    while (FrameSnapshot* snapshot = m_snapshots.take()) {
+        const auto start = std::chrono::system_clock::now();
+        apply_snapshot(*snapshot);
+        // Waiting here rather than on the main thread leaves input and the UI free to run ahead by one frame
+        wait_for_frame();
+        if (resize_requested) {
+            resize_swapchain(m_window_extent.width, m_window_extent.height);
+        }
+        draw_frame();
+        m_snapshot = nullptr;
+
+        const auto end = std::chrono::system_clock::now();
+        m_stats.frame_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0f;
+        if (m_replaying) {
+            FrameTiming& timing = m_frame_timings.frame(snapshot->frame_number);
+            timing.main_thread_ms = snapshot->main_thread_ms;
+            timing.scene_update_ms = snapshot->scene_update_ms;
+            timing.render_thread_ms = m_stats.frame_time;
+            timing.draw_call_count = m_stats.draw_call_count;
+            timing.triangle_count = m_stats.triangle_count;
+        }
+        std::scoped_lock lock(m_stats_mutex);
+        m_published_stats = m_stats;
+    }
+}
+
+void Renderer::apply_snapshot(FrameSnapshot& snapshot) {
+    const RenderSettings& settings = snapshot.settings;
+    if (settings.use_dynamic_resolution != m_settings.use_dynamic_resolution) {
+        m_dynamic_resolution.reset(m_render_scale);
+    }
+    if (settings.present_mode != m_settings.present_mode || snapshot.resize_requested) {
+        resize_requested = true;
+    }
+    m_settings = settings;
+    m_dynamic_resolution.settings.target_frame_ms = m_settings.target_gpu_ms;
+    if (!m_settings.use_dynamic_resolution) {
+        m_render_scale = m_settings.render_scale;
+    }
+    m_window_extent = snapshot.window_extent;
+    m_snapshot = &snapshot;
+}
+
+void Renderer::build_imgui(const EngineStats& stats) {
+    if (ImGui::Begin("background")) {
+        RenderSettings& settings = m_ui_settings;
+        ImGui::Checkbox("Dynamic resolution", &settings.use_dynamic_resolution);
+        if (settings.use_dynamic_resolution) {
+            ImGui::SliderFloat("Target GPU ms", &settings.target_gpu_ms, 2.0f, 50.0f);
+            ImGui::Text("Render scale %.3f (gpu %.2f ms smoothed)", stats.render_scale, stats.smoothed_gpu_time);
+        } else {
+            ImGui::SliderFloat("Render Scale", &settings.render_scale, 0.3f, 1.f);
+        }
+        if (m_async_compute_available) {
+            ImGui::Checkbox("Async compute", &settings.use_async_compute);
+        }
+        if (m_upscaler_available) {
+            ImGui::Checkbox("Compute upscaler", &settings.use_upscaler);
+            ImGui::SliderFloat("Sharpness", &settings.upscale_sharpness, 0.0f, 1.0f);
+        }
+        ImGui::Checkbox("Draw meshes", &settings.draw_meshes);
+        ImGui::Checkbox("Depth pre-pass", &settings.use_depth_prepass);
+        if (m_instancing_available) {
+            ImGui::Checkbox("Instancing", &m_use_instancing);
+        }
+        ImGui::SliderInt("Mesh grid", &m_mesh_grid_size, 1, 100);
+        ImGui::SliderInt("Frames in flight", &settings.frames_in_flight, 1, MAX_FRAMES_IN_FLIGHT);
+        constexpr VkPresentModeKHR present_modes[] = {VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+        constexpr const char* present_mode_names[] = {"FIFO", "MAILBOX", "IMMEDIATE"};
+        int present_mode_index = static_cast<int>(std::find(std::begin(present_modes), std::end(present_modes), settings.present_mode) - std::begin(present_modes));
+        // The render thread recreates the swapchain when it sees the mode change
+        if (ImGui::Combo("Present mode", &present_mode_index, present_mode_names, IM_ARRAYSIZE(present_mode_names))) {
+            settings.present_mode = present_modes[present_mode_index];
+        }
+        ImGui::Text("Active present mode: %s", string_VkPresentModeKHR(stats.present_mode));
+        if (m_present_wait_supported) {
+            ImGui::Checkbox("Present wait pacing", &settings.use_present_wait);
+        }
+
+        std::scoped_lock lock(m_effects_mutex);
+        std::vector<ComputeEffect>& effects = m_effect_registry.effects();
+        std::vector<EffectChain>& chains = m_effect_registry.chains();
+        const int background_count = static_cast<int>(effects.size() + chains.size());
+        if (background_count > 0) {
+            ImGui::SliderInt("Effect Index", &settings.background_effect, 0, background_count - 1);
+            settings.background_effect = std::clamp(settings.background_effect, 0, background_count - 1);
+
+            // One widget per push constant the shader declares, inputs the renderer fills are shown but not editable
+            auto effect_parameters = [](ComputeEffect& effect) {
+                for (const EffectParameter& parameter : effect.parameters) {
+                    const ShaderBlockMember& member = parameter.member;
+                    if (!parameter.editable()) {
+                        ImGui::TextDisabled("%s", member.name.c_str());
+                        continue;
+                    }
+                    const ImGuiDataType data_type = member.type == ShaderValueType::Float ? ImGuiDataType_Float :
+                        member.type == ShaderValueType::Int ? ImGuiDataType_S32 : ImGuiDataType_U32;
+                    ImGui::InputScalarN(member.name.c_str(), data_type, effect.parameter_data(parameter), static_cast<int>(member.components));
+                }
+            };
+
+            if (settings.background_effect < static_cast<int>(effects.size())) {
+                ComputeEffect& selected = effects[settings.background_effect];
+                ImGui::Text("Selected effect: %s (%ux%u)", selected.name.c_str(), selected.local_size[0], selected.local_size[1]);
+                effect_parameters(selected);
+            } else {
+                EffectChain& chain = chains[settings.background_effect - effects.size()];
+                ImGui::Text("Selected chain: %s, %zu passes", chain.name.c_str(), chain.passes.size());
+                ImGui::SliderInt("Ticks per frame", &chain.ticks_per_frame, 1, 64);
+                if (ImGui::Button("Reset")) {
+                    m_reset_chain = settings.background_effect - static_cast<int>(effects.size());
+                }
+                ImGui::Text("tick %.3f ms", chain.tick_ms);
+                for (size_t i = 0; i < chain.passes.size(); i++) {
+                    ChainPass& pass = chain.passes[i];
+                    ImGui::PushID(static_cast<int>(i));
+                    if (ImGui::TreeNode(pass.effect.name.c_str(), "%s%s", pass.effect.name.c_str(), pass.per_tick ? " (tick)" : "")) {
+                        effect_parameters(pass.effect);
+                        ImGui::TreePop();
+                    }
+                    ImGui::PopID();
+                }
+            }
+        }
+    }
+    ImGui::End();
+
+    build_shader_editor();
+
+    ImGui::Begin("Stats");
+    ImGui::Text("frametime %f ms main, %f ms render", m_simulation_stats.frame_time, stats.frame_time);
+    ImGui::Text("draw time %f ms", stats.mesh_draw_time);
+    ImGui::Text("update time %f ms", m_simulation_stats.scene_update_time);
+    ImGui::Text("triangles %i", stats.triangle_count);
+    ImGui::Text("culled objects %i", m_simulation_stats.culled_object_count);
+    const JobSystemStats job_stats = m_jobs.stats();
+    ImGui::Text("jobs %u threads, %llu run, %llu stolen", m_jobs.thread_count(),
+        static_cast<unsigned long long>(job_stats.jobs_executed), static_cast<unsigned long long>(job_stats.jobs_stolen));
+    ImGui::Text("transform kernels %s", transform_math::isa_name(transform_math::active_isa()));
+    if (m_readback.enabled()) {
+        ImGui::Text("frame output %.0f fps, %llu written, %llu dropped, %u pending", stats.readback.frames_per_second,
+            static_cast<unsigned long long>(stats.readback.frames_written), static_cast<unsigned long long>(stats.readback.frames_dropped),
+            stats.readback.frames_pending);
+    }
+    ImGui::Text("draws %i", stats.draw_call_count);
+    ImGui::Text("heap allocations %u, frame arena %.1f KB, snapshot arena %.1f KB", m_simulation_stats.frame_allocations,
+        stats.frame_arena_bytes / 1024.0, m_simulation_stats.snapshot_arena_bytes / 1024.0);
+    ImGui::Text("frame uploads %.1f / %.1f KB", stats.frame_upload_bytes / 1024.0, stats.frame_ring_capacity / 1024.0);
+    ImGui::Text("barriers %u in %u batches", stats.barrier_count, stats.barrier_batch_count);
+    ImGui::Text("gpu graphics %.3f ms, background %.3f ms", stats.graphics_gpu_time, stats.background_gpu_time);
+    ImGui::Text("gpu depth prepass %.3f ms, geometry %.3f ms", stats.depth_prepass_gpu_time, stats.geometry_gpu_time);
+    if (stats.background_tick_time > 0.0f) {
+        ImGui::Text("background tick %.3f ms", stats.background_tick_time);
+    }
+    if (m_async_compute_available && m_ui_settings.use_async_compute) {
+        ImGui::Text("async overlap %.3f ms", stats.async_overlap_time);
+    }
+    ImGui::Text("passes %u (%u culled), heap allocations %u", stats.render_graph.pass_count, stats.render_graph.culled_pass_count,
+        stats.render_graph.heap_allocations);
+    ImGui::Text("transients %u, %.1f / %.1f MB aliased", stats.render_graph.transient_image_count,
+        stats.render_graph.transient_memory / (1024.0 * 1024.0), stats.render_graph.transient_memory_unaliased / (1024.0 * 1024.0));
+    const GeometryPoolStats pool_stats = m_geometry_pool.stats();
+    ImGui::Text("meshes %u", pool_stats.mesh_count);
+    ImGui::Text("vertices %u / %u", pool_stats.vertex_capacity - pool_stats.vertices_free, pool_stats.vertex_capacity);
+    ImGui::Text("indices %u / %u", pool_stats.index_capacity - pool_stats.indices_free, pool_stats.index_capacity);
+    ImGui::End();
+}
+
+void Renderer::build_shader_editor() {
+    ShaderEditor& editor = m_shader_editor;
+    // Picked up here rather than on a worker so the registry is only ever changed by this thread
+    if (editor.pending.valid() && editor.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        apply_editor_result(editor.pending.get());
+    }
+
+    if (!ImGui::Begin("Shader editor")) {
+        ImGui::End();
+        return;
+    }
+
+    input_string("Name", editor.name);
+    input_string("Defines", editor.defines);
+    input_string("Inputs", editor.assignments);
+    ImGui::InputTextMultiline("##source", editor.source.data(), editor.source.capacity() + 1, ImVec2(-FLT_MIN, ImGui::GetTextLineHeight() * 24),
+        ImGuiInputTextFlags_CallbackResize | ImGuiInputTextFlags_AllowTabInput, resize_string, &editor.source);
+
+    // Adding an effect changes the parameter blocks a capture records, so the registry stays as it is meanwhile
+    const bool recording = m_capture.is_open() || m_replaying;
+    ImGui::BeginDisabled(editor.pending.valid() || recording || editor.name.empty());
+    if (ImGui::Button("Compile")) {
+        std::vector<ShaderDefine> defines;
+        for (const std::string& word : split_words(editor.defines)) {
+            const size_t equals = word.find('=');
+            defines.push_back({word.substr(0, equals), equals == std::string::npos ? "1" : word.substr(equals + 1)});
+        }
+        editor.pending = m_shader_compiler.compile(editor.name + ".comp", editor.source, ShaderStage::Compute, std::move(defines));
+        editor.status = "Compiling...";
+    }
+    ImGui::EndDisabled();
+    if (recording) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("not while capturing or replaying");
+    }
+
+    if (!editor.status.empty()) {
+        ImGui::SameLine();
+        if (editor.failed) {
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", editor.status.c_str());
+        } else {
+            ImGui::TextUnformatted(editor.status.c_str());
+        }
+    }
+    if (!editor.log.empty()) {
+        ImGui::PushStyleColor(ImGuiCol_Text, editor.failed ? ImVec4(1.0f, 0.4f, 0.4f, 1.0f) : ImGui::GetStyleColorVec4(ImGuiCol_TextDisabled));
+        ImGui::TextWrapped("%s", editor.log.c_str());
+        ImGui::PopStyleColor();
     }
+
+    const ShaderCompilerStats compiler_stats = m_shader_compiler.stats();
+    ImGui::TextDisabled("%llu compiled, %llu failed, cache hits %llu in memory and %llu on disk", static_cast<unsigned long long>(compiler_stats.compiled),
+        static_cast<unsigned long long>(compiler_stats.failed), static_cast<unsigned long long>(compiler_stats.memory_hits),
+        static_cast<unsigned long long>(compiler_stats.disk_hits));
+    ImGui::End();
 }
 
+void Renderer::apply_editor_result(ShaderCompileResult result) {
+    ShaderEditor& editor = m_shader_editor;
+    editor.log = result.log;
+    editor.failed = !result.succeeded();
+    if (editor.failed) {
+        editor.status = "Compile failed";
+        return;
+    }
 
+    const std::vector<std::string> assignments = split_words(editor.assignments);
+    std::ostringstream errors;
+    std::optional<size_t> index;
+    {
+        std::scoped_lock lock(m_effects_mutex);
+        index = m_effect_registry.replace_effect(editor.name, result.spirv, assignments, errors);
+    }
+    editor.log += errors.str();
+    if (!index.has_value()) {
+        editor.failed = true;
+        editor.status = "Compiled, but can't run as an effect";
+        return;
+    }
+
+    m_ui_settings.background_effect = static_cast<int>(index.value());
+    char status[64];
+    snprintf(status, sizeof(status), "%s in %.1f ms", result.from_cache ? "From cache" : "Compiled", result.milliseconds);
+    editor.status = status;
+}
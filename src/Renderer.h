@@ -1,57 +1,68 @@
 #ifndef PORTFOLIO_RENDERER_H
 #define PORTFOLIO_RENDERER_H
 
+#include <array>
 #include <deque>
 #include <functional>
+#include <future>
 #include <memory>
+#include <optional>
 #include <ranges>
+#include <mutex>
 #include <span>
+#include <string>
+#include <thread>
 
+#include "Barriers.h"
+#include "ComputeEffects.h"
 #include "Descriptors.h"
+#include "DynamicResolution.h"
+#include "FrameArena.h"
+#include "FrameCapture.h"
+#include "FrameReadback.h"
+#include "FrameRingBuffer.h"
+#include "GeometryPool.h"
+#include "GpuProfiler.h"
+#include "ImGuiDrawDataCopy.h"
+#include "JobSystem.h"
+#include "RenderGraph.h"
+#include "Scene.h"
+#include "ShaderCompiler.h"
+#include "TextureCompression.h"
+#include "TripleBuffer.h"
 #include "Types.h"
 
 #include "external/VkBootstrap.h"
 #include "SDL3/SDL.h"
 #include "external/vk_mem_alloc.h"
 
-//Todo: Change calls to push_function to be capture by value and not reference? (according to ChatGPT)
-struct DeletionQueue {
-    std::deque<std::function<void()>> deletion_queue;
-    void push_function(std::function<void()>&& func) {
-        deletion_queue.emplace_back(std::move(func));
-    }
-    void flush() {
-        for (auto& func : std::ranges::reverse_view(deletion_queue)) {
-            func();
-        }
-        deletion_queue.clear();
-    }
-};
-
 struct FrameData {
+    // Flushed once the fence shows a submit made after the functions were pushed has finished
     DeletionQueue deletion_queue;
+    // Set by every submit on render_fence, cleared by the flush. A frame that returns before submitting leaves the fence
+    // signalled by an older submit, which says nothing about what was retired since
+    bool submitted_since_flush = false;
 
     VkCommandPool command_pool;
     VkCommandBuffer main_command_buffer;
+    // Only created when a dedicated compute queue exists
+    VkCommandPool compute_command_pool;
+    VkCommandBuffer compute_command_buffer;
 
     VkSemaphore acquire_semaphore;
     VkFence render_fence;
 
     DescriptorAllocatorGrowable frame_descriptors;
+    // Descriptor writes and other data built while recording, rewound once the fence has signalled
+    FrameArena arena;
 };
 
-struct ComputePushConstants {
-    glm::vec4 data1;
-    glm::vec4 data2;
-    glm::vec4 data3;
-    glm::vec4 data4;
-};
-
-struct ComputeEffect {
-    const char* name;
-    VkPipeline pipeline;
-    VkPipelineLayout layout;
-    ComputePushConstants data;
+struct UpscalePushConstants {
+    glm::vec2 source_extent;
+    glm::vec2 source_texture_size;
+    glm::vec2 destination_extent;
+    float sharpness;
+    float padding;
 };
 
 struct MousePosition {
@@ -59,6 +70,21 @@ struct MousePosition {
     float y = 0.0f;
 };
 
+// A compute effect typed into the shader editor, added to the registry under name once it compiles
+struct ShaderEditor {
+    std::string name = "editor";
+    std::string source;
+    // NAME=VALUE pairs separated by spaces
+    std::string defines;
+    // member=value pairs separated by spaces, as on a manifest line
+    std::string assignments;
+    std::future<ShaderCompileResult> pending;
+    std::string status;
+    // Compiler output and the effect registry's complaints, shown under the source
+    std::string log;
+    bool failed = false;
+};
+
 struct Vertex {
     glm::vec3 position;
     float uv_x;
@@ -76,39 +102,233 @@ struct GPUSceneData {
     glm::vec4 sunlight_color;
 };
 
+// Ranges inside the shared GeometryPool buffers. Draw with
+// vkCmdDrawIndexed(cmd, index_count, 1, first_index, vertex_offset, 0) after binding the pool's index buffer.
 struct GPUMeshBuffers {
-    AllocatedBuffer index_buffer;
-    AllocatedBuffer vertex_buffer;
+    uint32_t first_index;
+    uint32_t index_count;
+    int32_t vertex_offset;
+    uint32_t vertex_count;
+    VkDeviceAddress vertex_buffer_address;
+    OffsetAllocator::Allocation vertex_allocation;
+    OffsetAllocator::Allocation index_allocation;
+};
+
+// Descriptor set of one glTF material, the surfaces using it share it
+struct GLTFMaterial {
+    MaterialInstance data;
+};
+
+struct GeoSurface {
+    // Relative to the mesh's first index
+    uint32_t start_index;
+    uint32_t count;
+    Bounds bounds;
+    // Null draws with the renderer's default material
+    std::shared_ptr<GLTFMaterial> material;
+};
+
+struct MeshAsset {
+    std::string name;
+    std::vector<GeoSurface> surfaces;
+    GPUMeshBuffers mesh_buffers;
+};
+
+struct MaterialConstants {
+    glm::vec4 color_factors;
+    glm::vec4 metal_rough_factors;
+};
+
+// A glTF material as the loader reads it, the images index the paths handed to create_materials along with it
+struct MaterialDescription {
+    MaterialConstants constants;
+    std::optional<uint32_t> color_image;
+    std::optional<uint32_t> metal_rough_image;
+};
+
+// One indexed draw with everything the mesh passes need, so recording never looks at the mesh again
+struct RenderObject {
+    uint32_t index_count;
+    uint32_t first_index;
+    int32_t vertex_offset;
+    MaterialInstance* material;
+    Affine3x4 transform;
+    VkDeviceAddress vertex_buffer_address;
+};
+
+// Every render object sharing a surface and a material, their world matrices are
+// [first_instance, first_instance + instance_count) of the frame's instance buffer
+struct InstancedDraw {
+    uint32_t index_count;
+    uint32_t first_index;
+    int32_t vertex_offset;
+    MaterialInstance* material;
     VkDeviceAddress vertex_buffer_address;
+    uint32_t first_instance;
+    uint32_t instance_count;
 };
 
+struct DrawContext {
+    FrameVector<RenderObject> opaque_surfaces;
+    // Filled instead of drawing opaque_surfaces one by one when instancing is on
+    FrameVector<InstancedDraw> instanced_draws;
+    // World matrices of instanced_draws, copied into the frame ring when the frame is recorded
+    FrameVector<Affine3x4> instance_transforms;
+};
+
+// mesh.vert reads world_matrix as a mat3x4, the same layout the instance buffer uses
 struct GPUDrawPushConstants {
-    glm::mat4 world_matrix;
+    Affine3x4 world_matrix;
+    VkDeviceAddress vertex_buffer;
+};
+static_assert(sizeof(GPUDrawPushConstants) == 56, "GPUDrawPushConstants has to match mesh.vert's push constant block");
+
+struct GPUInstancedPushConstants {
     VkDeviceAddress vertex_buffer;
+    VkDeviceAddress instance_buffer;
+};
+
+struct MeshPipelines {
+    VkPipeline opaque = VK_NULL_HANDLE;
+    // EQUAL depth test against a pre-pass, no depth writes
+    VkPipeline opaque_after_prepass = VK_NULL_HANDLE;
+    VkPipeline depth_prepass = VK_NULL_HANDLE;
+};
+
+// Everything the UI changes that the render thread reads. The main thread edits its own copy and every snapshot
+// carries one over
+struct RenderSettings {
+    // Ignored while dynamic resolution picks the scale
+    float render_scale = 1.0f;
+    float target_gpu_ms = 1000.0f / 60.0f;
+    float upscale_sharpness = 0.3f;
+    int frames_in_flight = 2;
+    VkPresentModeKHR present_mode = VK_PRESENT_MODE_FIFO_KHR;
+    // Indexes the registry's effects followed by its chains
+    int background_effect = 0;
+    bool use_dynamic_resolution = false;
+    bool use_async_compute = false;
+    bool use_upscaler = true;
+    bool draw_meshes = true;
+    bool use_depth_prepass = true;
+    bool use_present_wait = true;
+    // Captures store this byte for byte, padding is spelled out so every byte has a known value
+    uint8_t padding[2] = {};
+};
+static_assert(sizeof(RenderSettings) == 32, "RenderSettings has implicit padding");
+
+// What the main thread decides a frame by, besides effect parameters. A capture holds one of these per frame, written
+// as it is in memory, so it's ordered and padded by hand to leave no bytes that aren't members
+struct FrameInputs {
+    // Seconds, drives the scene and the effects' time input
+    float time;
+    VkExtent2D window_extent;
+    MousePosition mouse_position;
+    RenderSettings settings;
+    int mesh_grid_size;
+    // Chain whose Reset button was pressed, -1 for none
+    int reset_chain;
+    bool resize_requested;
+    bool use_instancing;
+    uint8_t padding[2];
+};
+static_assert(sizeof(FrameInputs) == 64, "FrameInputs has implicit padding");
+
+// From the command line
+struct RendererOptions {
+    // Records every frame's inputs
+    std::string capture_path;
+    // Plays a capture back instead of taking input, then writes per-frame timings
+    std::string replay_path;
+    std::string timings_path = "replay_timings.csv";
+    // Hidden window on SDL's offscreen video driver where it's available
+    bool headless = false;
+    // Picks a software implementation such as lavapipe over any GPU, for numbers that don't depend on the machine's GPU
+    bool prefer_cpu_device = false;
+    // Writes every frame's draw image here when set
+    std::string frame_output_directory;
+    ImageFileFormat frame_output_format = ImageFileFormat::Png;
 };
 
+// One frame, built by the main thread and recorded by the render thread
+struct FrameSnapshot {
+    RenderSettings settings;
+    VkExtent2D window_extent = {};
+    bool resize_requested = false;
+    MousePosition mouse_position = {};
+    float time = 0.0f;
+    uint64_t frame_number = 0;
+    // Main thread's share of the frame, for the replay timings
+    float main_thread_ms = 0.0f;
+    float scene_update_ms = 0.0f;
+    GPUSceneData scene_data = {};
+    // Backs the draw lists, rewound when the main thread starts on this snapshot again
+    FrameArena arena;
+    DrawContext draw_context;
+    ImGuiDrawDataCopy imgui;
+};
+
+// Written by the render thread, the main thread shows the copy taken after the last finished frame
 struct EngineStats {
+    // Render thread time for one frame, waiting on the GPU included
     float frame_time;
     int triangle_count;
     int draw_call_count;
-    float scene_update_time;
     float mesh_draw_time;
+    float render_scale;
+    float smoothed_gpu_time;
+    VkPresentModeKHR present_mode;
+    uint32_t barrier_count;
+    uint32_t barrier_batch_count;
+    RenderGraphStats render_graph;
+    float graphics_gpu_time;
+    float background_gpu_time;
+    float async_overlap_time;
+    // Smoothed cost of one simulation tick of the selected effect chain
+    float background_tick_time;
+    float depth_prepass_gpu_time;
+    float geometry_gpu_time;
+    size_t frame_arena_bytes;
+    // Uniform and storage data written into the frame ring
+    uint64_t frame_upload_bytes;
+    VkDeviceSize frame_ring_capacity;
+    ReadbackStats readback;
+};
+
+// Written by the main thread
+struct SimulationStats {
+    float frame_time;
+    float scene_update_time;
+    int culled_object_count;
+    // Heap allocations over the last frame on either thread, zero once everything per-frame comes from arenas
+    uint32_t frame_allocations;
+    size_t snapshot_arena_bytes;
 };
 
-constexpr unsigned int FRAME_OVERLAP = 2;
+constexpr unsigned int MAX_FRAMES_IN_FLIGHT = 4;
+// Render targets grow to this multiple of what's needed and only shrink once they are this many times too big
+constexpr float RENDER_TARGET_GROWTH = 1.25f;
+constexpr uint64_t RENDER_TARGET_SHRINK_RATIO = 4;
+constexpr uint32_t GEOMETRY_POOL_VERTEX_CAPACITY = 2 * 1024 * 1024;
+constexpr uint32_t GEOMETRY_POOL_INDEX_CAPACITY = 8 * 1024 * 1024;
 
 class Renderer {
+    // Drives frames and subsystems directly, without the render thread
+    friend class RendererBench;
+
 public:
-    Renderer();
+    explicit Renderer(const RendererOptions& options = {});
     ~Renderer();
     void run();
     GPUMeshBuffers upload_mesh(std::span<uint32_t> indices, std::span<Vertex> vertices);
+    void destroy_mesh(const GPUMeshBuffers& mesh);
     AllocatedBuffer create_buffer(size_t alloc_size, VkBufferUsageFlags usage, VmaMemoryUsage memory_usage);
 
     vkb::Device m_vkb_device = {};
     VkDescriptorSetLayout m_gpu_scene_data_descriptor_layout;
     AllocatedImage m_draw_image = {};
-    AllocatedImage m_depth_image = {};
+    // Draw image plus the async background images, everything that follows the swapchain size
+    std::vector<AllocatedImage> m_render_targets;
     AllocatedImage m_error_checkerboard_image;
     AllocatedImage m_white_image;
     AllocatedImage m_black_image;
@@ -118,16 +338,64 @@ public:
 
     AllocatedImage create_image(VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped = false);
     AllocatedImage create_image(void* data, VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped = false);
+    AllocatedImage create_image(const CompressedTexture& texture, VkImageUsageFlags usage);
+    std::optional<AllocatedImage> load_texture(const std::string& file_path, bool srgb = true);
+    std::vector<std::optional<AllocatedImage>> load_textures(std::span<const std::string> file_paths, bool srgb = true);
+    std::vector<std::optional<AllocatedImage>> load_compressed_textures(std::span<const std::string> file_paths, std::span<const TextureRole> roles);
+    // Loads the images through load_compressed_textures by role and builds a descriptor set per material. Missing
+    // images sample white, images that failed to load the error checkerboard. Freed at shutdown
+    std::vector<std::shared_ptr<GLTFMaterial>> create_materials(std::span<const MaterialDescription> materials, std::span<const std::string> image_paths,
+        std::span<const TextureRole> image_roles);
     void destroy_buffer(const AllocatedBuffer &buffer);
     void destroy_image(const AllocatedImage& image);
 
 private:
+    RendererOptions m_options;
     bool m_is_initialized = false;
+    bool m_bc_textures_supported = false;
+    // Block compressed imports, under the user data directory, empty when there is none
+    std::string m_texture_cache_directory;
     int m_frame_index = 0;
     bool stop_rendering = false;
     bool resize_requested = false;
     VkExtent2D m_draw_extent = {};
     float m_render_scale = 1.0f;
+    DynamicResolution m_dynamic_resolution;
+
+    // The main thread handles input, the UI and the scene for the next frame while the render thread records and
+    // submits the current one. Anything both touch goes through a snapshot, except the effect registry
+    TripleBuffer<FrameSnapshot> m_snapshots;
+    std::thread m_render_thread;
+    // Main thread's settings, the UI edits these
+    RenderSettings m_ui_settings;
+    // Render thread's, from the snapshot being recorded
+    RenderSettings m_settings;
+    FrameSnapshot* m_snapshot = nullptr;
+    std::mutex m_stats_mutex;
+    EngineStats m_published_stats = {};
+    SimulationStats m_simulation_stats = {};
+    // Effect parameters are edited in place by the UI, this keeps that apart from recording
+    std::mutex m_effects_mutex;
+    uint64_t m_frame_number = 0;
+    // Set by the UI, goes out with the frame's inputs
+    int m_reset_chain = -1;
+
+    CaptureWriter m_capture;
+    CaptureReader m_replay;
+    bool m_replaying = false;
+    // Every editable effect parameter and chain tick count, in registry order. Needs m_effects_mutex
+    std::vector<std::span<std::byte>> m_parameter_blocks;
+    // Render thread's while it runs. Filled when replaying
+    FrameTimingLog m_frame_timings;
+    static constexpr uint64_t NO_FRAME = UINT64_MAX;
+    // Frame number each slot last submitted, its timestamps are read back the next time the slot comes around
+    std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> m_slot_frame_numbers = {};
+    // Render thread's. Draw image copies for --dump-frames
+    FrameReadback m_readback;
+    bool m_readback_recorded = false;
+    // Main thread's
+    ShaderCompiler m_shader_compiler;
+    ShaderEditor m_shader_editor;
 
 
     VkExtent2D m_window_extent = {1700, 900};
@@ -145,33 +413,92 @@ private:
     std::vector<VkImage> m_swapchain_images;
     std::vector<VkImageView> m_swapchain_image_views;
 
-    FrameData m_frames[FRAME_OVERLAP];
-    FrameData& get_current_frame() {return m_frames[m_frame_index % FRAME_OVERLAP];}
+    // Per-frame resources exist for MAX_FRAMES_IN_FLIGHT, the first m_frames_in_flight of them are in use
+    FrameData m_frames[MAX_FRAMES_IN_FLIGHT];
+    uint32_t m_frames_in_flight = 2;
+    uint32_t get_frame_slot() const {return static_cast<uint32_t>(m_frame_index) % m_frames_in_flight;}
+    FrameData& get_current_frame() {return m_frames[get_frame_slot()];}
     std::vector<VkSemaphore> m_submit_semaphores;
 
+    std::vector<VkPresentModeKHR> m_supported_present_modes;
+    VkPresentModeKHR m_present_mode = VK_PRESENT_MODE_FIFO_KHR;
+    bool m_present_wait_supported = false;
+    uint64_t m_present_id = 0;
+    PFN_vkWaitForPresentKHR m_wait_for_present = nullptr;
+
     VkQueue m_graphics_queue = VK_NULL_HANDLE;
     uint32_t m_graphics_queue_index = 0;
+    // The render thread submits and presents, the main thread uploads ImGui textures and immediate work
+    std::mutex m_graphics_queue_mutex;
+
+    VkQueue m_compute_queue = VK_NULL_HANDLE;
+    uint32_t m_compute_queue_index = 0;
+    bool m_async_compute_available = false;
+    // Whether the last frame ran its background on the compute queue
+    bool m_async_compute_active = false;
+    bool m_compute_timestamps_supported = false;
+    VkSemaphore m_compute_timeline = VK_NULL_HANDLE;
+    uint64_t m_compute_timeline_value = 0;
+    AllocatedImage m_background_images[MAX_FRAMES_IN_FLIGHT] = {};
 
     VkExtent2D m_draw_image_extent = {};
 
     DescriptorAllocatorGrowable m_global_descriptor_allocator;
-    VkDescriptorSet m_draw_image_descriptors;
-    VkDescriptorSetLayout m_draw_image_descriptor_layout;
 
-    VkPipeline m_compute_pipeline = VK_NULL_HANDLE;
-    VkPipelineLayout m_compute_pipeline_layout = VK_NULL_HANDLE;
+    bool m_storage_write_without_format = false;
+    bool m_swapchain_storage_supported = false;
+    bool m_upscaler_available = false;
+    VkDescriptorSetLayout m_upscale_descriptor_layout = VK_NULL_HANDLE;
+    VkPipelineLayout m_upscale_pipeline_layout = VK_NULL_HANDLE;
+    VkPipeline m_upscale_pipeline = VK_NULL_HANDLE;
 
     VkFence m_imm_fence = VK_NULL_HANDLE;
     VkCommandBuffer m_imm_command_buffer = VK_NULL_HANDLE;
     VkCommandPool m_imm_command_pool = VK_NULL_HANDLE;
 
-    std::vector<ComputeEffect> m_background_effects;
-    int m_current_background_effect = 0;
+    PipelineLayoutCache m_pipeline_layouts;
+    EffectRegistry m_effect_registry;
+    // Chain index and tick count each frame slot recorded, so the read back knows what the tick scope covered
+    std::array<std::pair<int, int>, MAX_FRAMES_IN_FLIGHT> m_recorded_ticks = {};
 
     MousePosition m_mouse_position = {};
 
     VkDescriptorSetLayout m_single_image_descriptor_layout;
+    VkDescriptorSetLayout m_material_descriptor_layout;
     MaterialInstance m_default_data;
+    AllocatedBuffer m_default_material_constants = {};
+    // Everything create_materials made, destroyed with the meshes
+    std::vector<AllocatedImage> m_material_images;
+    std::vector<AllocatedBuffer> m_material_buffers;
+
+    // Layout shared by every mesh pipeline, pipeline is m_mesh_pipelines.opaque
+    MaterialPipeline m_opaque_pipeline = {};
+    // One world matrix per draw through GPUDrawPushConstants
+    MeshPipelines m_mesh_pipelines;
+    // World matrices from the frame's instance buffer through GPUInstancedPushConstants
+    MeshPipelines m_instanced_mesh_pipelines;
+    // Set once at init, the main thread reads it to build instanced draws and show the toggle
+    bool m_instancing_available = false;
+    std::vector<std::shared_ptr<MeshAsset>> m_test_meshes;
+    // Points at m_scene_descriptor_buffer, each frame's scene data is picked with m_scene_data_offset
+    VkDescriptorSet m_scene_descriptors = VK_NULL_HANDLE;
+    VkBuffer m_scene_descriptor_buffer = VK_NULL_HANDLE;
+    uint32_t m_scene_data_offset = 0;
+    VkDeviceAddress m_instance_data_address = 0;
+    bool m_use_instancing = true;
+    // Copies of every test mesh along each side of a square grid
+    int m_mesh_grid_size = 1;
+    // Grid size m_actors was last populated for
+    int m_actor_grid_size = 0;
+    ActorRegistry m_actors;
+
+    JobSystem m_jobs;
+    GeometryPool m_geometry_pool;
+    FrameRingBuffer m_frame_ring;
+    BarrierTracker m_barriers;
+    RenderGraph m_render_graph;
+    GpuProfiler m_profiler;
+    std::optional<GpuScope> m_previous_graphics_scope;
 
     EngineStats m_stats;
 
@@ -185,14 +512,68 @@ private:
     void resize_swapchain(uint32_t width, uint32_t height);
     void init_swapchain();
     void destroy_swapchain();
+    void create_render_targets(VkExtent2D extent);
+    void destroy_render_targets(const std::vector<AllocatedImage>& render_targets);
+    void ensure_render_targets(VkExtent2D required);
+    VkPresentModeKHR choose_present_mode(VkPresentModeKHR requested) const;
+    uint32_t swapchain_image_count() const;
+    VkImageUsageFlags swapchain_usage_flags() const;
+    void create_submit_semaphores();
+    void destroy_submit_semaphores();
     void init_commands();
     void init_sync_objects();
     void init_vma();
+    void init_geometry_pool();
+    void init_render_graph();
+    void init_async_compute();
+    void init_job_system();
+    void init_profiler();
     void init_descriptors();
+    void init_render_thread();
+    void init_capture();
+    void init_readback();
+    void init_shader_compiler();
+    void collect_parameter_blocks();
+    // Writes the frame's inputs into the capture, or replaces them with the next captured ones. False at the end of a replay
+    bool capture_frame_inputs(FrameInputs& inputs);
+    void apply_frame_inputs(const FrameInputs& inputs);
+    void render_thread_main();
+    // Called from the render thread with each snapshot it takes
+    void apply_snapshot(FrameSnapshot& snapshot);
+    void apply_frame_settings();
+    void wait_for_frame();
     void draw_frame();
-    void draw_background(VkCommandBuffer cmd_buffer);
+    void build_imgui(const EngineStats& stats);
+    void build_shader_editor();
+    void apply_editor_result(ShaderCompileResult result);
+    void draw_background(VkCommandBuffer cmd_buffer, VkImageView target_image_view, bool timestamps);
+    void draw_effect_chain(VkCommandBuffer cmd_buffer, EffectChain& chain, VkImageView target_image_view, EffectFrameInputs inputs, bool timestamps);
+    void dispatch_effect(VkCommandBuffer cmd_buffer, ComputeEffect& effect, DescriptorWriter& writer, const EffectFrameInputs& inputs);
+    void ensure_chain_images(EffectChain& chain);
+    void destroy_chain_images(const EffectChain& chain);
+    AllocatedImage create_shared_storage_image(VkExtent3D extent, VkImageUsageFlags usage);
+    void submit_background_compute();
+    void update_gpu_stats();
     void init_pipelines();
     void init_background_pipelines();
+    void init_upscale_pipeline();
+    void init_mesh_pipelines();
+    // Main thread, fills the snapshot's scene data and draw lists
+    void update_scene(FrameSnapshot& snapshot);
+    // Render thread, puts the snapshot's scene data and instance transforms into the frame ring
+    void upload_scene();
+    // Groups the draw context's surfaces by mesh and material, collecting their transforms in the same order
+    static void build_instanced_draws(DrawContext& draw_context, FrameArena& arena);
+    // Recreates the actors of the test mesh grid
+    void populate_scene();
+    static bool is_visible(const Bounds& bounds, const Affine3x4& world, const glm::mat4& view_proj);
+    // Grows the ring instead of failing
+    RingAllocation allocate_frame_data(VkDeviceSize size);
+    const MeshPipelines& mesh_pipelines() const;
+    void draw_depth_prepass(VkCommandBuffer cmd_buffer, VkImageView depth_image_view);
+    void draw_geometry(VkCommandBuffer cmd_buffer, VkImageView color_image_view, VkImageView depth_image_view, bool depth_prepass);
+    void draw_meshes(VkCommandBuffer cmd_buffer, VkPipeline pipeline);
+    void draw_upscale(VkCommandBuffer cmd_buffer, VkImageView source, VkImageView destination, VkExtent2D destination_extent);
     void init_imgui();
     void draw_imgui(VkCommandBuffer cmd, VkImageView target_image_view);
     void immediate_submit(std::function<void(VkCommandBuffer cmd)>&& function);
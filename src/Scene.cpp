@@ -0,0 +1,23 @@
+#include "Scene.h"
+
+#include <cmath>
+
+namespace systems {
+    void animate(ActorRegistry& actors, JobSystem& jobs, float time, JobCounter* counter) {
+        actors.parallel_each<EffectParameters, Transform>(jobs, 4096, [time](uint32_t, const EffectParameters& parameters, Transform& transform) {
+            transform.rotation = glm::angleAxis(time * parameters.spin_speed + parameters.phase, parameters.spin_axis);
+            transform.position = parameters.rest_position;
+            transform.position.y += parameters.bob_height * std::sin(time * parameters.bob_speed + parameters.phase);
+        }, counter);
+    }
+
+    void update_world_matrices(ActorRegistry& actors, JobSystem& jobs, JobCounter* counter) {
+        // Every Transform is written, so batches go straight over the pool and the kernels read each field in place
+        const std::span<Transform> transforms = actors.pool<Transform>().components();
+        jobs.parallel_for(static_cast<uint32_t>(transforms.size()), 4096, [transforms](uint32_t begin, uint32_t end, uint32_t) {
+            Transform* first = transforms.data() + begin;
+            transform_math::compose_trs({&first->position, sizeof(Transform)}, {&first->rotation, sizeof(Transform)},
+                {&first->scale, sizeof(Transform)}, {&first->world, sizeof(Transform)}, end - begin);
+        }, counter);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef PORTFOLIO_SCENE_H
+#define PORTFOLIO_SCENE_H
+
+#include "Actor.h"
+#include "TransformMath.h"
+#include "Types.h"
+
+// Axis aligned box in mesh space
+struct Bounds {
+    glm::vec3 origin;
+    float sphere_radius;
+    glm::vec3 extents;
+};
+
+struct Transform {
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    // Written by systems::update_world_matrices from the fields above
+    Affine3x4 world = to_affine(glm::mat4(1.0f));
+};
+
+// One surface of a mesh in the geometry pool, what a draw needs besides the transform
+struct Renderable {
+    uint32_t index_count;
+    uint32_t first_index;
+    int32_t vertex_offset;
+    MaterialInstance* material;
+    VkDeviceAddress vertex_buffer_address;
+};
+
+// Inputs of the scene's animation, a spin around an axis and a bob along Y
+struct EffectParameters {
+    glm::vec3 spin_axis = glm::vec3(0.0f, 1.0f, 0.0f);
+    float spin_speed = 0.0f;
+    float bob_height = 0.0f;
+    float bob_speed = 0.0f;
+    float phase = 0.0f;
+    // Position the bob is relative to
+    glm::vec3 rest_position = glm::vec3(0.0f);
+};
+
+// Each system fans out over the job system and adds its jobs to counter, wait on it before reading what it wrote
+namespace systems {
+    void animate(ActorRegistry& actors, JobSystem& jobs, float time, JobCounter* counter);
+    void update_world_matrices(ActorRegistry& actors, JobSystem& jobs, JobCounter* counter);
+}
+
+#endif //PORTFOLIO_SCENE_H
@@ -0,0 +1,392 @@
+#include "ShaderCompiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+
+#ifdef SHADER_PLAYGROUND_GLSLANG
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+#endif
+
+namespace {
+    constexpr uint32_t CACHE_MAGIC = 0x56505343; // "CSPV"
+    // Bump when the compile options change, entries from older versions are recompiled
+    constexpr uint32_t CACHE_VERSION = 1;
+    constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+    uint64_t hash_bytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t hash_string(const std::string& text, uint64_t hash) {
+        // The length goes in too, so "AB" + "C" and "A" + "BC" don't collide
+        const uint64_t length = text.size();
+        hash = hash_bytes(&length, sizeof(length), hash);
+        return hash_bytes(text.data(), text.size(), hash);
+    }
+
+    // Layout: magic, version, key, word count, then the SPIR-V words
+    std::optional<std::vector<uint32_t>> load_cached(const std::string& file_path, uint64_t key) {
+        std::ifstream file(file_path, std::ios::binary);
+        if (!file.is_open()) {
+            return std::nullopt;
+        }
+
+        uint32_t header[2] = {};
+        uint64_t stored_key = 0;
+        uint64_t word_count = 0;
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        file.read(reinterpret_cast<char*>(&stored_key), sizeof(stored_key));
+        file.read(reinterpret_cast<char*>(&word_count), sizeof(word_count));
+        if (!file || header[0] != CACHE_MAGIC || header[1] != CACHE_VERSION || stored_key != key || word_count == 0 || word_count > (64u << 20)) {
+            return std::nullopt;
+        }
+
+        std::vector<uint32_t> spirv(word_count);
+        file.read(reinterpret_cast<char*>(spirv.data()), static_cast<std::streamsize>(word_count * sizeof(uint32_t)));
+        if (!file || spirv[0] != SPIRV_MAGIC) {
+            return std::nullopt;
+        }
+
+        // Hits refresh the write time, trimming goes by it, so entries still in use are the last to go
+        std::error_code error;
+        std::filesystem::last_write_time(file_path, std::filesystem::file_time_type::clock::now(), error);
+        return spirv;
+    }
+
+    // Returns the size of the entry written, 0 when it couldn't be
+    uint64_t store_cached(const std::string& file_path, uint64_t key, const std::vector<uint32_t>& spirv) {
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(file_path).parent_path(), error);
+
+        // Written to a temporary name first so a crash never leaves a truncated entry behind. Two workers can compile
+        // the same source at once, each gets its own temporary
+        const std::string temporary_path = file_path + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+        {
+            std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                std::cerr << "Failed to write shader cache entry " << file_path << std::endl;
+                return 0;
+            }
+
+            const uint32_t header[2] = {CACHE_MAGIC, CACHE_VERSION};
+            const uint64_t word_count = spirv.size();
+            file.write(reinterpret_cast<const char*>(header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+            file.write(reinterpret_cast<const char*>(&word_count), sizeof(word_count));
+            file.write(reinterpret_cast<const char*>(spirv.data()), static_cast<std::streamsize>(spirv.size() * sizeof(uint32_t)));
+            if (!file) {
+                file.close();
+                std::filesystem::remove(temporary_path, error);
+                return 0;
+            }
+        }
+        std::filesystem::rename(temporary_path, file_path, error);
+        if (error) {
+            std::filesystem::remove(temporary_path, error);
+            return 0;
+        }
+        return sizeof(uint32_t) * 2 + sizeof(uint64_t) * 2 + spirv.size() * sizeof(uint32_t);
+    }
+
+#ifdef SHADER_PLAYGROUND_GLSLANG
+    EShLanguage glslang_stage(ShaderStage stage) {
+        switch (stage) {
+            case ShaderStage::Vertex: return EShLangVertex;
+            case ShaderStage::Fragment: return EShLangFragment;
+            case ShaderStage::Compute: return EShLangCompute;
+        }
+        return EShLangCompute;
+    }
+
+    bool compile_glsl(const std::string& name, const std::string& source, ShaderStage stage, const std::vector<ShaderDefine>& defines,
+        std::vector<uint32_t>& spirv, std::string& log) {
+        const EShLanguage language = glslang_stage(stage);
+        // Same target as the build's glslc --target-env=vulkan1.3
+        glslang::TShader shader(language);
+        const char* text = source.c_str();
+        const int length = static_cast<int>(source.size());
+        const char* text_name = name.c_str();
+        shader.setStringsWithLengthsAndNames(&text, &length, &text_name, 1);
+        shader.setEnvInput(glslang::EShSourceGlsl, language, glslang::EShClientVulkan, 100);
+        shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+        shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+
+        std::string preamble;
+        for (const ShaderDefine& define : defines) {
+            preamble += "#define " + define.name + " " + define.value + "\n";
+        }
+        shader.setPreamble(preamble.c_str());
+
+        const EShMessages messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+        if (!shader.parse(GetDefaultResources(), 460, false, messages)) {
+            log = shader.getInfoLog();
+            return false;
+        }
+
+        glslang::TProgram program;
+        program.addShader(&shader);
+        if (!program.link(messages)) {
+            log = std::string(shader.getInfoLog()) + program.getInfoLog();
+            return false;
+        }
+
+        // Names are kept, the effect registry reflects binding and member names out of them
+        glslang::SpvOptions options = {};
+        options.generateDebugInfo = false;
+        options.stripDebugInfo = false;
+        options.disableOptimizer = false;
+        spv::SpvBuildLogger logger;
+        glslang::GlslangToSpv(*program.getIntermediate(language), spirv, &logger, &options);
+        log = std::string(shader.getInfoLog()) + logger.getAllMessages();
+        return !spirv.empty();
+    }
+#endif
+}
+
+void ShaderCompiler::init(const std::string& cache_directory, uint32_t worker_count, uint64_t max_cache_bytes) {
+#ifdef SHADER_PLAYGROUND_GLSLANG
+    glslang::InitializeProcess();
+#endif
+    m_cache_directory = cache_directory;
+    m_max_cache_bytes = max_cache_bytes;
+    if (!m_cache_directory.empty()) {
+        // No workers yet, so any temporary left is from a run that crashed mid write
+        std::scoped_lock lock(m_disk_mutex);
+        trim_disk_cache(m_max_cache_bytes, true);
+    }
+    m_stopping = false;
+    for (uint32_t i = 0; i < std::max(worker_count, 1u); i++) {
+        m_workers.emplace_back(&ShaderCompiler::worker_main, this);
+    }
+    std::cout << "Shader compiler " << (available() ? "running " : "built without glslang, ") << m_workers.size() << " workers, cache in "
+              << (cache_directory.empty() ? "memory only" : cache_directory) << " (" << m_disk_bytes / 1024 << " KB on disk)" << std::endl;
+}
+
+void ShaderCompiler::destroy() {
+    if (!enabled()) {
+        return;
+    }
+
+    {
+        std::scoped_lock lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_available.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+    m_memory_cache.clear();
+    m_memory_bytes = 0;
+#ifdef SHADER_PLAYGROUND_GLSLANG
+    glslang::FinalizeProcess();
+#endif
+
+    std::cout << "Shader compiler compiled " << m_stats.compiled << " shaders, " << m_stats.failed << " failed, cache hits "
+              << m_stats.memory_hits << " in memory and " << m_stats.disk_hits << " on disk" << std::endl;
+}
+
+bool ShaderCompiler::available() {
+#ifdef SHADER_PLAYGROUND_GLSLANG
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::future<ShaderCompileResult> ShaderCompiler::compile(std::string name, std::string source, ShaderStage stage, std::vector<ShaderDefine> defines) {
+    Request request = {std::move(name), std::move(source), stage, std::move(defines), {}};
+    std::future<ShaderCompileResult> result = request.promise.get_future();
+    {
+        std::scoped_lock lock(m_mutex);
+        m_queue.push_back(std::move(request));
+    }
+    m_work_available.notify_one();
+    return result;
+}
+
+ShaderCompilerStats ShaderCompiler::stats() {
+    std::scoped_lock lock(m_mutex);
+    return m_stats;
+}
+
+void ShaderCompiler::worker_main() {
+    while (true) {
+        Request request;
+        {
+            std::unique_lock lock(m_mutex);
+            m_work_available.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;
+            }
+            request = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        request.promise.set_value(run(request));
+    }
+}
+
+ShaderCompileResult ShaderCompiler::run(const Request& request) {
+    const auto start = std::chrono::steady_clock::now();
+    auto finish = [&](ShaderCompileResult& result) {
+        result.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    ShaderCompileResult result = {};
+    const uint64_t key = cache_key(request);
+    {
+        std::scoped_lock lock(m_mutex);
+        const auto cached = m_memory_cache.find(key);
+        if (cached != m_memory_cache.end()) {
+            m_stats.memory_hits++;
+            cached->second.last_used = ++m_memory_clock;
+            result.spirv = cached->second.spirv;
+            result.from_cache = true;
+            finish(result);
+            return result;
+        }
+    }
+
+    const std::string file_path = m_cache_directory.empty() ? std::string() : cache_file_path(key);
+    if (std::optional<std::vector<uint32_t>> spirv = file_path.empty() ? std::nullopt : load_cached(file_path, key)) {
+        result.spirv = std::move(spirv.value());
+        result.from_cache = true;
+        std::scoped_lock lock(m_mutex);
+        m_stats.disk_hits++;
+        remember(key, result.spirv);
+        finish(result);
+        return result;
+    }
+
+#ifdef SHADER_PLAYGROUND_GLSLANG
+    const bool compiled = compile_glsl(request.name, request.source, request.stage, request.defines, result.spirv, result.log);
+#else
+    const bool compiled = false;
+    result.log = "Built without glslang, shaders can't be compiled at runtime";
+#endif
+    if (!compiled) {
+        result.spirv.clear();
+        std::scoped_lock lock(m_mutex);
+        m_stats.failed++;
+        finish(result);
+        return result;
+    }
+
+    if (!file_path.empty()) {
+        const uint64_t written = store_cached(file_path, key, result.spirv);
+        std::scoped_lock lock(m_disk_mutex);
+        m_disk_bytes += written;
+        if (m_disk_bytes > m_max_cache_bytes) {
+            // Down to three quarters so a long editing session doesn't rescan the directory on every compile
+            trim_disk_cache(m_max_cache_bytes / 4 * 3, false);
+        }
+    }
+
+    std::scoped_lock lock(m_mutex);
+    m_stats.compiled++;
+    remember(key, result.spirv);
+    finish(result);
+    return result;
+}
+
+void ShaderCompiler::remember(uint64_t key, const std::vector<uint32_t>& spirv) {
+    // Two workers can compile the same source at once, the second result is the same SPIR-V
+    const auto [entry, inserted] = m_memory_cache.try_emplace(key, MemoryEntry{spirv, 0});
+    entry->second.last_used = ++m_memory_clock;
+    if (!inserted) {
+        return;
+    }
+
+    m_memory_bytes += spirv.size() * sizeof(uint32_t);
+    // A scan per eviction, the cache holds at most a few hundred modules
+    while (m_memory_bytes > SHADER_MEMORY_CACHE_MAX_BYTES && m_memory_cache.size() > 1) {
+        auto oldest = m_memory_cache.begin();
+        for (auto it = m_memory_cache.begin(); it != m_memory_cache.end(); ++it) {
+            if (it->second.last_used < oldest->second.last_used) {
+                oldest = it;
+            }
+        }
+        m_memory_bytes -= oldest->second.spirv.size() * sizeof(uint32_t);
+        m_memory_cache.erase(oldest);
+    }
+}
+
+uint64_t ShaderCompiler::cache_key(const Request& request) {
+    uint64_t hash = hash_bytes(&CACHE_VERSION, sizeof(CACHE_VERSION));
+    hash = hash_bytes(&request.stage, sizeof(request.stage), hash);
+    for (const ShaderDefine& define : request.defines) {
+        hash = hash_string(define.name, hash);
+        hash = hash_string(define.value, hash);
+    }
+    return hash_string(request.source, hash);
+}
+
+std::string ShaderCompiler::cache_file_path(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.spv", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(m_cache_directory) / name).string();
+}
+
+void ShaderCompiler::trim_disk_cache(uint64_t target_bytes, bool remove_temporaries) {
+    struct Entry {
+        std::filesystem::path path;
+        std::filesystem::file_time_type time;
+        uint64_t size;
+    };
+
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    std::error_code error;
+    // Incremented by hand, the range for throws when a file disappears under it
+    for (std::filesystem::directory_iterator file(m_cache_directory, error); !error && file != std::filesystem::directory_iterator();
+         file.increment(error)) {
+        std::error_code file_error;
+        const std::filesystem::path extension = file->path().extension();
+        if (remove_temporaries && extension == ".tmp") {
+            std::filesystem::remove(file->path(), file_error);
+            continue;
+        }
+        if (extension != ".spv") {
+            continue;
+        }
+        const uint64_t size = file->file_size(file_error);
+        if (file_error) {
+            continue;
+        }
+        const std::filesystem::file_time_type time = file->last_write_time(file_error);
+        if (file_error) {
+            continue;
+        }
+        entries.push_back({file->path(), time, size});
+        total += size;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+    uint32_t removed = 0;
+    for (const Entry& entry : entries) {
+        if (total <= target_bytes) {
+            break;
+        }
+        std::error_code file_error;
+        if (std::filesystem::remove(entry.path, file_error)) {
+            total -= entry.size;
+            removed++;
+        }
+    }
+    m_disk_bytes = total;
+    if (removed > 0) {
+        std::cout << "Shader cache removed " << removed << " old entries, " << total / 1024 << " KB left" << std::endl;
+    }
+}
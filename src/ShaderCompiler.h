@@ -0,0 +1,104 @@
+#ifndef PORTFOLIO_SHADER_COMPILER_H
+#define PORTFOLIO_SHADER_COMPILER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Beyond this the least recently used cache entries are deleted, every edit in the shader editor adds one
+constexpr uint64_t SHADER_CACHE_MAX_BYTES = 32ull << 20;
+// Same for the in-memory copies, which only save reading the file back
+constexpr uint64_t SHADER_MEMORY_CACHE_MAX_BYTES = 8ull << 20;
+
+enum class ShaderStage : uint32_t {
+    Vertex,
+    Fragment,
+    Compute,
+};
+
+struct ShaderDefine {
+    std::string name;
+    std::string value;
+};
+
+struct ShaderCompileResult {
+    // Empty when compilation failed
+    std::vector<uint32_t> spirv;
+    // glslang's errors and warnings, empty for a cache hit
+    std::string log;
+    bool from_cache = false;
+    float milliseconds = 0.0f;
+
+    bool succeeded() const { return !spirv.empty(); }
+};
+
+struct ShaderCompilerStats {
+    uint64_t compiled;
+    uint64_t failed;
+    uint64_t memory_hits;
+    uint64_t disk_hits;
+};
+
+// GLSL to SPIR-V on worker threads through glslang. Results are cached in memory and on disk, keyed by a hash of the
+// stage, defines and source, so compiling the same shader again skips glslang entirely, even across runs. Failures
+// aren't cached. Built without glslang every compile fails and says so
+class ShaderCompiler {
+public:
+    // An empty cache_directory keeps the cache in memory only
+    void init(const std::string& cache_directory, uint32_t worker_count, uint64_t max_cache_bytes = SHADER_CACHE_MAX_BYTES);
+    // Waits for the compiles already queued
+    void destroy();
+    bool enabled() const { return !m_workers.empty(); }
+    static bool available();
+
+    // name only labels the source in error messages
+    std::future<ShaderCompileResult> compile(std::string name, std::string source, ShaderStage stage, std::vector<ShaderDefine> defines = {});
+    ShaderCompilerStats stats();
+
+private:
+    struct Request {
+        std::string name;
+        std::string source;
+        ShaderStage stage;
+        std::vector<ShaderDefine> defines;
+        std::promise<ShaderCompileResult> promise;
+    };
+
+    void worker_main();
+    ShaderCompileResult run(const Request& request);
+    static uint64_t cache_key(const Request& request);
+    std::string cache_file_path(uint64_t key) const;
+    // Deletes the oldest entries until the directory is under target_bytes, m_disk_mutex must be held
+    void trim_disk_cache(uint64_t target_bytes, bool remove_temporaries);
+    // Adds to the memory cache, evicting the least recently used entries past SHADER_MEMORY_CACHE_MAX_BYTES,
+    // m_mutex must be held
+    void remember(uint64_t key, const std::vector<uint32_t>& spirv);
+
+    std::string m_cache_directory;
+    uint64_t m_max_cache_bytes = SHADER_CACHE_MAX_BYTES;
+    // Separate from m_mutex so a directory scan doesn't stall the other workers' memory cache lookups
+    std::mutex m_disk_mutex;
+    uint64_t m_disk_bytes = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_work_available;
+    std::deque<Request> m_queue;
+    std::vector<std::thread> m_workers;
+    bool m_stopping = false;
+    struct MemoryEntry {
+        std::vector<uint32_t> spirv;
+        uint64_t last_used;
+    };
+    std::unordered_map<uint64_t, MemoryEntry> m_memory_cache;
+    uint64_t m_memory_bytes = 0;
+    // Bumped on every lookup and insert, the entry with the lowest last_used goes first
+    uint64_t m_memory_clock = 0;
+    ShaderCompilerStats m_stats = {};
+};
+
+#endif //PORTFOLIO_SHADER_COMPILER_H
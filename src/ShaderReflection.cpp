@@ -0,0 +1,472 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+    constexpr size_t SPIRV_HEADER_WORDS = 5;
+
+    // Opcodes
+    constexpr uint32_t OP_NAME = 5;
+    constexpr uint32_t OP_MEMBER_NAME = 6;
+    constexpr uint32_t OP_ENTRY_POINT = 15;
+    constexpr uint32_t OP_EXECUTION_MODE = 16;
+    constexpr uint32_t OP_TYPE_INT = 21;
+    constexpr uint32_t OP_TYPE_FLOAT = 22;
+    constexpr uint32_t OP_TYPE_VECTOR = 23;
+    constexpr uint32_t OP_TYPE_MATRIX = 24;
+    constexpr uint32_t OP_TYPE_IMAGE = 25;
+    constexpr uint32_t OP_TYPE_SAMPLER = 26;
+    constexpr uint32_t OP_TYPE_SAMPLED_IMAGE = 27;
+    constexpr uint32_t OP_TYPE_ARRAY = 28;
+    constexpr uint32_t OP_TYPE_RUNTIME_ARRAY = 29;
+    constexpr uint32_t OP_TYPE_STRUCT = 30;
+    constexpr uint32_t OP_TYPE_POINTER = 32;
+    constexpr uint32_t OP_CONSTANT = 43;
+    constexpr uint32_t OP_SPEC_CONSTANT = 50;
+    constexpr uint32_t OP_VARIABLE = 59;
+    constexpr uint32_t OP_DECORATE = 71;
+    constexpr uint32_t OP_MEMBER_DECORATE = 72;
+    constexpr uint32_t OP_EXECUTION_MODE_ID = 331;
+    constexpr uint32_t OP_TYPE_ACCELERATION_STRUCTURE = 5341;
+
+    // Decorations
+    constexpr uint32_t DECORATION_BLOCK = 2;
+    constexpr uint32_t DECORATION_BUFFER_BLOCK = 3;
+    constexpr uint32_t DECORATION_MATRIX_STRIDE = 7;
+    constexpr uint32_t DECORATION_ARRAY_STRIDE = 6;
+    constexpr uint32_t DECORATION_BUILT_IN = 11;
+    constexpr uint32_t DECORATION_INVARIANT = 18;
+    constexpr uint32_t DECORATION_BINDING = 33;
+    constexpr uint32_t DECORATION_DESCRIPTOR_SET = 34;
+    constexpr uint32_t DECORATION_OFFSET = 35;
+
+    // Storage classes
+    constexpr uint32_t STORAGE_UNIFORM_CONSTANT = 0;
+    constexpr uint32_t STORAGE_UNIFORM = 2;
+    constexpr uint32_t STORAGE_PUSH_CONSTANT = 9;
+    constexpr uint32_t STORAGE_STORAGE_BUFFER = 12;
+    constexpr uint32_t STORAGE_PHYSICAL_STORAGE_BUFFER = 5349;
+
+    // Built-ins
+    constexpr uint32_t BUILT_IN_POSITION = 0;
+
+    // Execution modes
+    constexpr uint32_t MODE_LOCAL_SIZE = 17;
+    constexpr uint32_t MODE_LOCAL_SIZE_ID = 38;
+
+    // Image dimensions and the Sampled operand
+    constexpr uint32_t DIM_BUFFER = 5;
+    constexpr uint32_t DIM_SUBPASS_DATA = 6;
+    constexpr uint32_t IMAGE_SAMPLED = 1;
+    constexpr uint32_t IMAGE_STORAGE = 2;
+
+    struct Member {
+        std::string name;
+        uint32_t offset = 0;
+        uint32_t matrix_stride = 0;
+        bool position = false;
+        bool invariant = false;
+    };
+
+    // Everything any instruction said about one result id
+    struct Id {
+        uint32_t opcode = 0;
+        std::string name;
+        // Pointee for pointers, type for variables and constants, element type for vectors/matrices/arrays
+        uint32_t type_id = 0;
+        uint32_t storage_class = 0;
+        uint32_t width = 0;
+        uint32_t signedness = 0;
+        uint32_t component_count = 0;
+        uint32_t length_id = 0;
+        uint32_t image_dim = 0;
+        uint32_t image_sampled = 0;
+        uint32_t constant = 0;
+        uint32_t array_stride = 0;
+        std::vector<uint32_t> member_types;
+        std::vector<Member> members;
+        std::optional<uint32_t> set;
+        std::optional<uint32_t> binding;
+        bool block = false;
+        bool buffer_block = false;
+        bool position = false;
+        bool invariant = false;
+    };
+
+    std::string read_string(std::span<const uint32_t> words) {
+        std::string result;
+        for (uint32_t word : words) {
+            for (int byte = 0; byte < 4; byte++) {
+                const char c = static_cast<char>((word >> (byte * 8)) & 0xff);
+                if (c == '\0') {
+                    return result;
+                }
+                result.push_back(c);
+            }
+        }
+        return result;
+    }
+
+    Member& member_at(Id& id, uint32_t index) {
+        if (id.members.size() <= index) {
+            id.members.resize(index + 1);
+        }
+        return id.members[index];
+    }
+
+    uint32_t type_size(const std::vector<Id>& ids, uint32_t type_id, uint32_t matrix_stride = 0) {
+        const Id& type = ids[type_id];
+        switch (type.opcode) {
+            case OP_TYPE_INT:
+            case OP_TYPE_FLOAT:
+                return type.width / 8;
+            case OP_TYPE_VECTOR:
+                return type.component_count * type_size(ids, type.type_id);
+            case OP_TYPE_MATRIX:
+                return type.component_count * (matrix_stride != 0 ? matrix_stride : type_size(ids, type.type_id));
+            case OP_TYPE_ARRAY: {
+                const uint32_t element = type.array_stride != 0 ? type.array_stride : type_size(ids, type.type_id);
+                return ids[type.length_id].constant * element;
+            }
+            case OP_TYPE_STRUCT: {
+                uint32_t size = 0;
+                for (size_t i = 0; i < type.member_types.size(); i++) {
+                    const Member member = i < type.members.size() ? type.members[i] : Member{};
+                    size = std::max(size, member.offset + type_size(ids, type.member_types[i], member.matrix_stride));
+                }
+                return size;
+            }
+            case OP_TYPE_POINTER:
+                // Buffer device addresses, anything else can't live in a block
+                return type.storage_class == STORAGE_PHYSICAL_STORAGE_BUFFER ? 8 : 0;
+            default:
+                // Runtime arrays and opaque types have no size of their own
+                return 0;
+        }
+    }
+
+    void classify_member(const std::vector<Id>& ids, uint32_t type_id, ShaderBlockMember& member) {
+        const Id* type = &ids[type_id];
+        member.components = 1;
+        if (type->opcode == OP_TYPE_VECTOR) {
+            member.components = type->component_count;
+            type = &ids[type->type_id];
+        }
+
+        if (type->opcode == OP_TYPE_FLOAT && type->width == 32) {
+            member.type = ShaderValueType::Float;
+        } else if (type->opcode == OP_TYPE_INT && type->width == 32) {
+            member.type = type->signedness ? ShaderValueType::Int : ShaderValueType::UInt;
+        } else {
+            member.type = ShaderValueType::Other;
+            member.components = 0;
+        }
+    }
+
+    std::optional<VkDescriptorType> descriptor_type(const std::vector<Id>& ids, const Id& variable, uint32_t& count) {
+        uint32_t type_id = ids[variable.type_id].type_id;
+        count = 1;
+        // Arrays of resources become descriptor counts
+        while (ids[type_id].opcode == OP_TYPE_ARRAY || ids[type_id].opcode == OP_TYPE_RUNTIME_ARRAY) {
+            count = ids[type_id].opcode == OP_TYPE_ARRAY ? count * ids[ids[type_id].length_id].constant : 0;
+            type_id = ids[type_id].type_id;
+        }
+        const Id& type = ids[type_id];
+
+        switch (variable.storage_class) {
+            case STORAGE_UNIFORM_CONSTANT:
+                switch (type.opcode) {
+                    case OP_TYPE_SAMPLER:
+                        return VK_DESCRIPTOR_TYPE_SAMPLER;
+                    case OP_TYPE_SAMPLED_IMAGE:
+                        return ids[type.type_id].image_dim == DIM_BUFFER ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                    case OP_TYPE_IMAGE:
+                        if (type.image_dim == DIM_SUBPASS_DATA) {
+                            return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+                        }
+                        if (type.image_sampled == IMAGE_STORAGE) {
+                            return type.image_dim == DIM_BUFFER ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+                        }
+                        if (type.image_sampled == IMAGE_SAMPLED) {
+                            return type.image_dim == DIM_BUFFER ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+                        }
+                        return std::nullopt;
+                    case OP_TYPE_ACCELERATION_STRUCTURE:
+                        return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+                    default:
+                        return std::nullopt;
+                }
+            case STORAGE_UNIFORM:
+                // Old style storage buffers are Uniform blocks decorated BufferBlock
+                return type.buffer_block ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            case STORAGE_STORAGE_BUFFER:
+                return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    VkShaderStageFlagBits execution_model_stage(uint32_t model) {
+        switch (model) {
+            case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+            case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+            case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+            case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+            case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+            case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+            case 5364: return VK_SHADER_STAGE_TASK_BIT_EXT;
+            case 5365: return VK_SHADER_STAGE_MESH_BIT_EXT;
+            default: return VK_SHADER_STAGE_ALL;
+        }
+    }
+}
+
+const ShaderBlockMember* ShaderReflection::find_push_constant(const std::string& name) const {
+    for (const ShaderBlockMember& member : push_constants) {
+        if (member.name == name) {
+            return &member;
+        }
+    }
+    return nullptr;
+}
+
+namespace reflect {
+    std::optional<ShaderReflection> reflect_spirv(std::span<const uint32_t> code) {
+        if (code.size() < SPIRV_HEADER_WORDS || code[0] != SPIRV_MAGIC) {
+            std::cerr << "Not a SPIR-V module" << std::endl;
+            return std::nullopt;
+        }
+
+        const uint32_t bound = code[3];
+        std::vector<Id> ids(bound);
+        ShaderReflection reflection = {};
+        bool has_entry_point = false;
+        std::array<uint32_t, 3> local_size_ids = {};
+        bool local_size_from_ids = false;
+
+        auto valid = [bound](uint32_t id) { return id < bound; };
+
+        size_t offset = SPIRV_HEADER_WORDS;
+        while (offset < code.size()) {
+            const uint32_t word_count = code[offset] >> 16;
+            const uint32_t opcode = code[offset] & 0xffff;
+            if (word_count == 0 || offset + word_count > code.size()) {
+                std::cerr << "Malformed SPIR-V instruction at word " << offset << std::endl;
+                return std::nullopt;
+            }
+            const std::span<const uint32_t> operands = code.subspan(offset + 1, word_count - 1);
+            offset += word_count;
+
+            switch (opcode) {
+                case OP_NAME:
+                    if (operands.size() >= 2 && valid(operands[0])) {
+                        ids[operands[0]].name = read_string(operands.subspan(1));
+                    }
+                    break;
+                case OP_MEMBER_NAME:
+                    if (operands.size() >= 3 && valid(operands[0])) {
+                        member_at(ids[operands[0]], operands[1]).name = read_string(operands.subspan(2));
+                    }
+                    break;
+                case OP_ENTRY_POINT:
+                    // Only the first entry point is reflected, glslc emits exactly one
+                    if (!has_entry_point && operands.size() >= 3) {
+                        reflection.stage = execution_model_stage(operands[0]);
+                        reflection.entry_point = read_string(operands.subspan(2));
+                        has_entry_point = true;
+                    }
+                    break;
+                case OP_EXECUTION_MODE:
+                    if (operands.size() >= 5 && operands[1] == MODE_LOCAL_SIZE) {
+                        reflection.local_size = {operands[2], operands[3], operands[4]};
+                    }
+                    break;
+                case OP_EXECUTION_MODE_ID:
+                    if (operands.size() >= 5 && operands[1] == MODE_LOCAL_SIZE_ID) {
+                        local_size_ids = {operands[2], operands[3], operands[4]};
+                        local_size_from_ids = true;
+                    }
+                    break;
+                case OP_TYPE_INT:
+                    if (operands.size() >= 3 && valid(operands[0])) {
+                        ids[operands[0]].opcode = opcode;
+                        ids[operands[0]].width = operands[1];
+                        ids[operands[0]].signedness = operands[2];
+                    }
+                    break;
+                case OP_TYPE_FLOAT:
+                    if (operands.size() >= 2 && valid(operands[0])) {
+                        ids[operands[0]].opcode = opcode;
+                        ids[operands[0]].width = operands[1];
+                    }
+                    break;
+                case OP_TYPE_VECTOR:
+                case OP_TYPE_MATRIX:
+                    if (operands.size() >= 3 && valid(operands[0])) {
+                        ids[operands[0]].opcode = opcode;
+                        ids[operands[0]].type_id = operands[1];
+                        ids[operands[0]].component_count = operands[2];
+                    }
+                    break;
+                case OP_TYPE_IMAGE:
+                    if (operands.size() >= 7 && valid(operands[0])) {
+                        ids[operands[0]].opcode = opcode;
+                        ids[operands[0]].type_id = operands[1];
+                        ids[operands[0]].image_dim = operands[2];
+                        ids[operands[0]].image_sampled = operands[6];
+                    }
+                    break;
+                case OP_TYPE_SAMPLER:
+                case OP_TYPE_ACCELERATION_STRUCTURE:
+                    if (!operands.empty() && valid(operands[0])) {
+                        ids[operands[0]].opcode = opcode;
+                    }
+                    break;
+                case OP_TYPE_SAMPLED_IMAGE:
+                case OP_TYPE_RUNTIME_ARRAY:
+                    if (operands.size() >= 2 && valid(operands[0])) {
+                        ids[operands[0]].opcode = opcode;
+                        ids[operands[0]].type_id = operands[1];
+                    }
+                    break;
+                case OP_TYPE_ARRAY:
+                    if (operands.size() >= 3 && valid(operands[0])) {
+                        ids[operands[0]].opcode = opcode;
+                        ids[operands[0]].type_id = operands[1];
+                        ids[operands[0]].length_id = operands[2];
+                    }
+                    break;
+                case OP_TYPE_STRUCT:
+                    if (!operands.empty() && valid(operands[0])) {
+                        ids[operands[0]].opcode = opcode;
+                        ids[operands[0]].member_types.assign(operands.begin() + 1, operands.end());
+                    }
+                    break;
+                case OP_TYPE_POINTER:
+                    if (operands.size() >= 3 && valid(operands[0])) {
+                        ids[operands[0]].opcode = opcode;
+                        ids[operands[0]].storage_class = operands[1];
+                        ids[operands[0]].type_id = operands[2];
+                    }
+                    break;
+                case OP_CONSTANT:
+                case OP_SPEC_CONSTANT:
+                    // Only the low word matters, these are array lengths and workgroup sizes
+                    if (operands.size() >= 3 && valid(operands[1])) {
+                        ids[operands[1]].opcode = opcode;
+                        ids[operands[1]].type_id = operands[0];
+                        ids[operands[1]].constant = operands[2];
+                    }
+                    break;
+                case OP_VARIABLE:
+                    if (operands.size() >= 3 && valid(operands[1])) {
+                        ids[operands[1]].opcode = opcode;
+                        ids[operands[1]].type_id = operands[0];
+                        ids[operands[1]].storage_class = operands[2];
+                    }
+                    break;
+                case OP_DECORATE:
+                    if (operands.size() >= 2 && valid(operands[0])) {
+                        Id& target = ids[operands[0]];
+                        switch (operands[1]) {
+                            case DECORATION_BLOCK: target.block = true; break;
+                            case DECORATION_BUFFER_BLOCK: target.buffer_block = true; break;
+                            case DECORATION_ARRAY_STRIDE: if (operands.size() >= 3) target.array_stride = operands[2]; break;
+                            case DECORATION_BINDING: if (operands.size() >= 3) target.binding = operands[2]; break;
+                            case DECORATION_DESCRIPTOR_SET: if (operands.size() >= 3) target.set = operands[2]; break;
+                            case DECORATION_BUILT_IN: target.position = operands.size() >= 3 && operands[2] == BUILT_IN_POSITION; break;
+                            case DECORATION_INVARIANT: target.invariant = true; break;
+                            default: break;
+                        }
+                    }
+                    break;
+                case OP_MEMBER_DECORATE:
+                    if (operands.size() >= 3 && valid(operands[0])) {
+                        Member& member = member_at(ids[operands[0]], operands[1]);
+                        // Invariant is the only one without a value
+                        const uint32_t value = operands.size() >= 4 ? operands[3] : 0;
+                        switch (operands[2]) {
+                            case DECORATION_OFFSET: member.offset = value; break;
+                            case DECORATION_MATRIX_STRIDE: member.matrix_stride = value; break;
+                            case DECORATION_BUILT_IN: member.position = operands.size() >= 4 && value == BUILT_IN_POSITION; break;
+                            case DECORATION_INVARIANT: member.invariant = true; break;
+                            default: break;
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        if (!has_entry_point) {
+            std::cerr << "SPIR-V module has no entry point" << std::endl;
+            return std::nullopt;
+        }
+
+        if (local_size_from_ids) {
+            for (size_t i = 0; i < 3; i++) {
+                if (valid(local_size_ids[i])) {
+                    reflection.local_size[i] = ids[local_size_ids[i]].constant;
+                }
+            }
+        }
+
+        // glslang puts gl_Position in the gl_PerVertex block and decorates the member, other compilers may decorate a
+        // standalone variable
+        for (const Id& id : ids) {
+            reflection.invariant_position |= id.position && id.invariant;
+            for (const Member& member : id.members) {
+                reflection.invariant_position |= member.position && member.invariant;
+            }
+        }
+
+        for (const Id& variable : ids) {
+            if (variable.opcode != OP_VARIABLE || !valid(variable.type_id)) {
+                continue;
+            }
+
+            if (variable.storage_class == STORAGE_PUSH_CONSTANT) {
+                const uint32_t block_id = ids[variable.type_id].type_id;
+                const Id& block = ids[block_id];
+                reflection.push_constant_size = type_size(ids, block_id);
+                for (size_t i = 0; i < block.member_types.size(); i++) {
+                    const Member member = i < block.members.size() ? block.members[i] : Member{};
+                    ShaderBlockMember reflected = {};
+                    reflected.name = member.name;
+                    reflected.offset = member.offset;
+                    reflected.size = type_size(ids, block.member_types[i], member.matrix_stride);
+                    classify_member(ids, block.member_types[i], reflected);
+                    reflection.push_constants.push_back(reflected);
+                }
+                continue;
+            }
+
+            if (!variable.binding.has_value()) {
+                continue;
+            }
+
+            uint32_t count = 1;
+            const std::optional<VkDescriptorType> type = descriptor_type(ids, variable, count);
+            if (!type.has_value()) {
+                continue;
+            }
+
+            ShaderBinding binding = {};
+            // Blocks are usually declared without an instance name worth showing, fall back to the block type's name
+            binding.name = !variable.name.empty() ? variable.name : ids[ids[variable.type_id].type_id].name;
+            binding.set = variable.set.value_or(0);
+            binding.binding = variable.binding.value();
+            binding.type = type.value();
+            binding.count = count;
+            reflection.bindings.push_back(binding);
+        }
+
+        std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const ShaderBinding& a, const ShaderBinding& b) {
+            return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+        });
+        return reflection;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef PORTFOLIO_SHADERREFLECTION_H
+#define PORTFOLIO_SHADERREFLECTION_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+enum class ShaderValueType : uint8_t {
+    Float,
+    Int,
+    UInt,
+    // Matrices, structs, arrays, anything a single widget can't edit
+    Other
+};
+
+struct ShaderBlockMember {
+    std::string name;
+    uint32_t offset;
+    uint32_t size;
+    ShaderValueType type;
+    // 1 for scalars, 2-4 for vectors
+    uint32_t components;
+};
+
+struct ShaderBinding {
+    std::string name;
+    uint32_t set;
+    uint32_t binding;
+    VkDescriptorType type;
+    // 0 for runtime sized arrays
+    uint32_t count;
+};
+
+struct ShaderReflection {
+    VkShaderStageFlagBits stage;
+    std::string entry_point;
+    std::array<uint32_t, 3> local_size = {1, 1, 1};
+    uint32_t push_constant_size = 0;
+    std::vector<ShaderBlockMember> push_constants;
+    std::vector<ShaderBinding> bindings;
+    // gl_Position is declared invariant, so every pipeline using the shader computes bit-identical depth
+    bool invariant_position = false;
+
+    const ShaderBlockMember* find_push_constant(const std::string& name) const;
+};
+
+namespace reflect {
+    // Reads just enough of the module to build layouts: entry point, workgroup size, push constant block, resource
+    // bindings. Member and variable names need the debug info glslc keeps by default
+    std::optional<ShaderReflection> reflect_spirv(std::span<const uint32_t> code);
+}
+
+#endif //PORTFOLIO_SHADERREFLECTION_H
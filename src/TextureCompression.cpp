@@ -0,0 +1,571 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+
+#include "Utilities.h"
+
+namespace {
+    constexpr uint32_t CACHE_MAGIC = 0x43425053; // "SPBC"
+    // Bump whenever the encoder output changes so stale cache entries are ignored
+    constexpr uint32_t CACHE_VERSION = 1;
+    constexpr size_t BLOCK_SIZE_8 = 8;
+    constexpr size_t BLOCK_SIZE_16 = 16;
+
+    struct Rgba8 {
+        uint8_t r, g, b, a;
+    };
+
+    struct Image8 {
+        uint32_t width;
+        uint32_t height;
+        std::vector<Rgba8> texels;
+
+        const Rgba8& at(uint32_t x, uint32_t y) const {
+            // Blocks hanging off the edge replicate the last row/column
+            x = std::min(x, width - 1);
+            y = std::min(y, height - 1);
+            return texels[static_cast<size_t>(y) * width + x];
+        }
+    };
+
+    float srgb_to_linear(uint8_t value) {
+        const float c = value / 255.0f;
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    uint8_t linear_to_srgb(float value) {
+        const float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        return static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+    }
+
+    // 2x2 box filter. Albedo is averaged in linear space, normals are renormalized after averaging
+    Image8 downsample(const Image8& source, TextureRole role) {
+        Image8 result = {};
+        result.width = std::max(source.width / 2, 1u);
+        result.height = std::max(source.height / 2, 1u);
+        result.texels.resize(static_cast<size_t>(result.width) * result.height);
+
+        std::array<float, 256> srgb_table = {};
+        for (int i = 0; i < 256; i++) {
+            srgb_table[i] = srgb_to_linear(static_cast<uint8_t>(i));
+        }
+
+        for (uint32_t y = 0; y < result.height; y++) {
+            for (uint32_t x = 0; x < result.width; x++) {
+                const Rgba8 samples[4] = {
+                    source.at(x * 2, y * 2), source.at(x * 2 + 1, y * 2),
+                    source.at(x * 2, y * 2 + 1), source.at(x * 2 + 1, y * 2 + 1)
+                };
+
+                float sum[4] = {};
+                for (const Rgba8& sample : samples) {
+                    if (role == TextureRole::Albedo) {
+                        sum[0] += srgb_table[sample.r];
+                        sum[1] += srgb_table[sample.g];
+                        sum[2] += srgb_table[sample.b];
+                    } else {
+                        sum[0] += sample.r / 255.0f;
+                        sum[1] += sample.g / 255.0f;
+                        sum[2] += sample.b / 255.0f;
+                    }
+                    sum[3] += sample.a / 255.0f;
+                }
+                for (float& channel : sum) {
+                    channel *= 0.25f;
+                }
+
+                Rgba8& out = result.texels[static_cast<size_t>(y) * result.width + x];
+                if (role == TextureRole::Albedo) {
+                    out = {linear_to_srgb(sum[0]), linear_to_srgb(sum[1]), linear_to_srgb(sum[2]), 0};
+                } else if (role == TextureRole::Normal) {
+                    float nx = sum[0] * 2.0f - 1.0f;
+                    float ny = sum[1] * 2.0f - 1.0f;
+                    float nz = sum[2] * 2.0f - 1.0f;
+                    const float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+                    if (length > 1e-5f) {
+                        nx /= length;
+                        ny /= length;
+                        nz /= length;
+                    }
+                    auto encode = [](float n) { return static_cast<uint8_t>(std::clamp((n * 0.5f + 0.5f) * 255.0f + 0.5f, 0.0f, 255.0f)); };
+                    out = {encode(nx), encode(ny), encode(nz), 0};
+                } else {
+                    auto encode = [](float c) { return static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f)); };
+                    out = {encode(sum[0]), encode(sum[1]), encode(sum[2]), 0};
+                }
+                out.a = static_cast<uint8_t>(std::clamp(sum[3] * 255.0f + 0.5f, 0.0f, 255.0f));
+            }
+        }
+        return result;
+    }
+
+    uint16_t pack_565(const float color[3]) {
+        const uint16_t r = static_cast<uint16_t>(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+        const uint16_t g = static_cast<uint16_t>(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+        const uint16_t b = static_cast<uint16_t>(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void unpack_565(uint16_t packed, int color[3]) {
+        const int r = (packed >> 11) & 31;
+        const int g = (packed >> 5) & 63;
+        const int b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // Endpoints come from the principal axis of the block's colors, which handles gradients
+    // much better than the bounding box diagonal. Always uses the 4 color mode so it is valid inside BC3 too.
+    void encode_bc1_block(const Rgba8 texels[16], std::byte* out) {
+        float mean[3] = {};
+        for (int i = 0; i < 16; i++) {
+            mean[0] += texels[i].r;
+            mean[1] += texels[i].g;
+            mean[2] += texels[i].b;
+        }
+        for (float& m : mean) {
+            m /= 16.0f;
+        }
+
+        float covariance[6] = {};
+        for (int i = 0; i < 16; i++) {
+            const float r = texels[i].r - mean[0];
+            const float g = texels[i].g - mean[1];
+            const float b = texels[i].b - mean[2];
+            covariance[0] += r * r;
+            covariance[1] += r * g;
+            covariance[2] += r * b;
+            covariance[3] += g * g;
+            covariance[4] += g * b;
+            covariance[5] += b * b;
+        }
+
+        // Power iteration converges quickly for a 3x3 matrix
+        float axis[3] = {1.0f, 1.0f, 1.0f};
+        for (int iteration = 0; iteration < 8; iteration++) {
+            const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+            const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+            const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+            const float length = std::max({std::abs(x), std::abs(y), std::abs(z)});
+            if (length < 1e-6f) {
+                break;
+            }
+            axis[0] = x / length;
+            axis[1] = y / length;
+            axis[2] = z / length;
+        }
+
+        float min_projection = 1e30f;
+        float max_projection = -1e30f;
+        for (int i = 0; i < 16; i++) {
+            const float projection = (texels[i].r - mean[0]) * axis[0] + (texels[i].g - mean[1]) * axis[1] + (texels[i].b - mean[2]) * axis[2];
+            min_projection = std::min(min_projection, projection);
+            max_projection = std::max(max_projection, projection);
+        }
+
+        const float axis_length_squared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+        float endpoint_max[3];
+        float endpoint_min[3];
+        for (int c = 0; c < 3; c++) {
+            const float direction = axis_length_squared > 0.0f ? axis[c] / axis_length_squared : 0.0f;
+            endpoint_max[c] = mean[c] + direction * max_projection;
+            endpoint_min[c] = mean[c] + direction * min_projection;
+        }
+
+        uint16_t color0 = pack_565(endpoint_max);
+        uint16_t color1 = pack_565(endpoint_min);
+        if (color0 < color1) {
+            std::swap(color0, color1);
+        }
+
+        uint32_t indices = 0;
+        if (color0 != color1) {
+            int palette[4][3];
+            unpack_565(color0, palette[0]);
+            unpack_565(color1, palette[1]);
+            for (int c = 0; c < 3; c++) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+
+            for (int i = 0; i < 16; i++) {
+                int best_index = 0;
+                int best_distance = INT32_MAX;
+                for (int p = 0; p < 4; p++) {
+                    const int dr = texels[i].r - palette[p][0];
+                    const int dg = texels[i].g - palette[p][1];
+                    const int db = texels[i].b - palette[p][2];
+                    const int distance = dr * dr + dg * dg + db * db;
+                    if (distance < best_distance) {
+                        best_distance = distance;
+                        best_index = p;
+                    }
+                }
+                indices |= static_cast<uint32_t>(best_index) << (i * 2);
+            }
+        }
+
+        memcpy(out, &color0, 2);
+        memcpy(out + 2, &color1, 2);
+        memcpy(out + 4, &indices, 4);
+    }
+
+    // Single channel block used for BC3 alpha, BC4 and both halves of BC5. Uses the 8 value mode
+    void encode_bc4_block(const uint8_t values[16], std::byte* out) {
+        uint8_t max_value = 0;
+        uint8_t min_value = 255;
+        for (int i = 0; i < 16; i++) {
+            max_value = std::max(max_value, values[i]);
+            min_value = std::min(min_value, values[i]);
+        }
+
+        uint64_t indices = 0;
+        if (max_value != min_value) {
+            const float range = static_cast<float>(max_value - min_value);
+            for (int i = 0; i < 16; i++) {
+                // Ramp position 0 is max (index 0), 7 is min (index 1), everything between maps to indices 2..7
+                const int ramp = static_cast<int>(std::lround((max_value - values[i]) * 7.0f / range));
+                uint64_t index = 0;
+                if (ramp == 0) {
+                    index = 0;
+                } else if (ramp == 7) {
+                    index = 1;
+                } else {
+                    index = static_cast<uint64_t>(ramp + 1);
+                }
+                indices |= index << (i * 3);
+            }
+        }
+
+        out[0] = static_cast<std::byte>(max_value);
+        out[1] = static_cast<std::byte>(min_value);
+        for (int i = 0; i < 6; i++) {
+            out[2 + i] = static_cast<std::byte>((indices >> (i * 8)) & 0xFF);
+        }
+    }
+
+    size_t block_size(VkFormat format) {
+        switch (format) {
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC4_UNORM_BLOCK:
+                return BLOCK_SIZE_8;
+            default:
+                return BLOCK_SIZE_16;
+        }
+    }
+
+    void encode_block(VkFormat format, const Rgba8 texels[16], std::byte* out) {
+        uint8_t channel[16];
+        switch (format) {
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                encode_bc1_block(texels, out);
+                break;
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+                for (int i = 0; i < 16; i++) {
+                    channel[i] = texels[i].a;
+                }
+                encode_bc4_block(channel, out);
+                encode_bc1_block(texels, out + 8);
+                break;
+            case VK_FORMAT_BC4_UNORM_BLOCK:
+                for (int i = 0; i < 16; i++) {
+                    channel[i] = texels[i].r;
+                }
+                encode_bc4_block(channel, out);
+                break;
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+                for (int i = 0; i < 16; i++) {
+                    channel[i] = texels[i].r;
+                }
+                encode_bc4_block(channel, out);
+                for (int i = 0; i < 16; i++) {
+                    channel[i] = texels[i].g;
+                }
+                encode_bc4_block(channel, out + 8);
+                break;
+            default:
+                std::cerr << "encode_block: unhandled format " << format << std::endl;
+                break;
+        }
+    }
+
+    std::vector<std::byte> encode_image(JobSystem& jobs, const Image8& image, VkFormat format) {
+        const uint32_t blocks_x = (image.width + 3) / 4;
+        const uint32_t blocks_y = (image.height + 3) / 4;
+        const size_t bytes_per_block = block_size(format);
+        std::vector<std::byte> encoded(static_cast<size_t>(blocks_x) * blocks_y * bytes_per_block);
+
+        // One block row per task keeps the tasks big enough to be worth a thread hop
+        util::parallel_for(jobs, blocks_y, [&](size_t block_y) {
+            Rgba8 texels[16];
+            for (uint32_t block_x = 0; block_x < blocks_x; block_x++) {
+                for (uint32_t y = 0; y < 4; y++) {
+                    for (uint32_t x = 0; x < 4; x++) {
+                        texels[y * 4 + x] = image.at(block_x * 4 + x, static_cast<uint32_t>(block_y) * 4 + y);
+                    }
+                }
+                std::byte* out = encoded.data() + (block_y * blocks_x + block_x) * bytes_per_block;
+                encode_block(format, texels, out);
+            }
+        });
+        return encoded;
+    }
+
+    uint64_t hash_bytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::optional<std::vector<std::byte>> read_file(const std::string& file_path) {
+        std::ifstream file(file_path, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) {
+            return std::nullopt;
+        }
+        const size_t file_size = file.tellg();
+        std::vector<std::byte> bytes(file_size);
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(file_size));
+        return bytes;
+    }
+
+    std::string cache_path(const std::string& cache_directory, const std::vector<std::byte>& source, TextureRole role) {
+        uint64_t hash = hash_bytes(source.data(), source.size());
+        hash = hash_bytes(&role, sizeof(role), hash);
+        hash = hash_bytes(&CACHE_VERSION, sizeof(CACHE_VERSION), hash);
+
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bctex", static_cast<unsigned long long>(hash));
+        return (std::filesystem::path(cache_directory) / name).string();
+    }
+
+    // Layout: magic, version, format, width, height, mip count, then per mip (width, height, size, bytes)
+    std::optional<CompressedTexture> load_cached(const std::string& file_path) {
+        std::ifstream file(file_path, std::ios::binary);
+        if (!file.is_open()) {
+            return std::nullopt;
+        }
+
+        uint32_t header[6] = {};
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!file || header[0] != CACHE_MAGIC || header[1] != CACHE_VERSION) {
+            return std::nullopt;
+        }
+
+        CompressedTexture texture = {};
+        texture.format = static_cast<VkFormat>(header[2]);
+        texture.extent = {header[3], header[4], 1};
+        for (uint32_t mip = 0; mip < header[5]; mip++) {
+            uint32_t mip_header[2] = {};
+            uint64_t size = 0;
+            file.read(reinterpret_cast<char*>(mip_header), sizeof(mip_header));
+            file.read(reinterpret_cast<char*>(&size), sizeof(size));
+            if (!file) {
+                return std::nullopt;
+            }
+
+            CompressedMip compressed_mip = {texture.data.size(), static_cast<size_t>(size), {mip_header[0], mip_header[1], 1}};
+            texture.data.resize(texture.data.size() + compressed_mip.size);
+            file.read(reinterpret_cast<char*>(texture.data.data() + compressed_mip.offset), static_cast<std::streamsize>(compressed_mip.size));
+            if (!file) {
+                return std::nullopt;
+            }
+            texture.mips.push_back(compressed_mip);
+        }
+
+        // Hits refresh the write time, trimming goes by it, so textures still in use are the last to go
+        std::error_code error;
+        std::filesystem::last_write_time(file_path, std::filesystem::file_time_type::clock::now(), error);
+        return texture;
+    }
+
+    void store_cached(const std::string& file_path, const CompressedTexture& texture) {
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(file_path).parent_path(), error);
+
+        // Written to a temporary name first so a crash never leaves a truncated entry behind
+        const std::string temporary_path = file_path + ".tmp";
+        {
+            std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                std::cerr << "Failed to write texture cache entry " << file_path << std::endl;
+                return;
+            }
+
+            const uint32_t header[6] = {CACHE_MAGIC, CACHE_VERSION, static_cast<uint32_t>(texture.format), texture.extent.width, texture.extent.height, static_cast<uint32_t>(texture.mips.size())};
+            file.write(reinterpret_cast<const char*>(header), sizeof(header));
+            for (const CompressedMip& mip : texture.mips) {
+                const uint32_t mip_header[2] = {mip.extent.width, mip.extent.height};
+                const uint64_t size = mip.size;
+                file.write(reinterpret_cast<const char*>(mip_header), sizeof(mip_header));
+                file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+                file.write(reinterpret_cast<const char*>(texture.data.data() + mip.offset), static_cast<std::streamsize>(mip.size));
+            }
+        }
+        std::filesystem::rename(temporary_path, file_path, error);
+    }
+
+    void trim_directory(const std::string& cache_directory, uint64_t target_bytes, bool remove_temporaries) {
+        struct Entry {
+            std::filesystem::path path;
+            std::filesystem::file_time_type time;
+            uint64_t size;
+        };
+
+        std::vector<Entry> entries;
+        uint64_t total = 0;
+        std::error_code error;
+        // Incremented by hand, the range for throws when a file disappears under it
+        for (std::filesystem::directory_iterator file(cache_directory, error); !error && file != std::filesystem::directory_iterator();
+             file.increment(error)) {
+            std::error_code file_error;
+            const std::filesystem::path extension = file->path().extension();
+            if (remove_temporaries && extension == ".tmp") {
+                std::filesystem::remove(file->path(), file_error);
+                continue;
+            }
+            if (extension != ".bctex") {
+                continue;
+            }
+            const uint64_t size = file->file_size(file_error);
+            if (file_error) {
+                continue;
+            }
+            const std::filesystem::file_time_type time = file->last_write_time(file_error);
+            if (file_error) {
+                continue;
+            }
+            entries.push_back({file->path(), time, size});
+            total += size;
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+        uint32_t removed = 0;
+        for (const Entry& entry : entries) {
+            if (total <= target_bytes) {
+                break;
+            }
+            std::error_code file_error;
+            if (std::filesystem::remove(entry.path, file_error)) {
+                total -= entry.size;
+                removed++;
+            }
+        }
+        if (removed > 0) {
+            std::cout << "Texture cache removed " << removed << " old entries, " << total / 1024 << " KB left" << std::endl;
+        }
+    }
+}
+
+namespace texture {
+    VkFormat compressed_format(TextureRole role, bool has_alpha) {
+        switch (role) {
+            case TextureRole::Albedo:
+                return has_alpha ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+            case TextureRole::Normal:
+                return VK_FORMAT_BC5_UNORM_BLOCK;
+            case TextureRole::MetalRough:
+                return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        }
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    CompressedTexture compress(JobSystem& jobs, const DecodedImage& image, TextureRole role) {
+        if (!image.is_valid() || texture::bytes_per_pixel(image.format) != 4) {
+            return {};
+        }
+
+        Image8 level = {};
+        level.width = image.extent.width;
+        level.height = image.extent.height;
+        level.texels.resize(static_cast<size_t>(level.width) * level.height);
+        memcpy(level.texels.data(), image.pixels.data(), level.texels.size() * sizeof(Rgba8));
+
+        const bool has_alpha = std::any_of(level.texels.begin(), level.texels.end(), [](const Rgba8& texel) { return texel.a != 255; });
+
+        CompressedTexture compressed = {};
+        compressed.format = compressed_format(role, has_alpha);
+        compressed.extent = image.extent;
+
+        const uint32_t mip_levels = texture::mip_level_count(image.extent);
+        for (uint32_t mip = 0; mip < mip_levels; mip++) {
+            if (mip > 0) {
+                level = downsample(level, role);
+            }
+
+            std::vector<std::byte> encoded = encode_image(jobs, level, compressed.format);
+            compressed.mips.push_back({compressed.data.size(), encoded.size(), {level.width, level.height, 1}});
+            compressed.data.insert(compressed.data.end(), encoded.begin(), encoded.end());
+        }
+        return compressed;
+    }
+
+    CompressedTexture import_compressed(JobSystem& jobs, const std::string& file_path, TextureRole role, const std::string& cache_directory,
+        uint64_t max_cache_bytes) {
+        const std::string paths[1] = {file_path};
+        const TextureRole roles[1] = {role};
+        return std::move(import_compressed(jobs, paths, roles, cache_directory, max_cache_bytes)[0]);
+    }
+
+    std::vector<CompressedTexture> import_compressed(JobSystem& jobs, std::span<const std::string> file_paths, std::span<const TextureRole> roles,
+        const std::string& cache_directory, uint64_t max_cache_bytes) {
+        assert(file_paths.size() == roles.size());
+        std::vector<CompressedTexture> textures(file_paths.size());
+        std::vector<std::string> cache_paths(file_paths.size());
+        std::vector<DecodedImage> decoded(file_paths.size());
+
+        // Cache lookups and decodes are independent per file
+        util::parallel_for(jobs, file_paths.size(), [&](size_t index) {
+            std::optional<std::vector<std::byte>> source = read_file(file_paths[index]);
+            if (!source) {
+                std::cerr << "Failed to open texture " << file_paths[index] << std::endl;
+                return;
+            }
+
+            cache_paths[index] = cache_directory.empty() ? std::string() : cache_path(cache_directory, *source, roles[index]);
+            if (std::optional<CompressedTexture> cached = cache_paths[index].empty() ? std::nullopt : load_cached(cache_paths[index])) {
+                textures[index] = std::move(*cached);
+                return;
+            }
+            decoded[index] = texture::decode_image(*source, file_paths[index], roles[index] == TextureRole::Albedo);
+        });
+
+        // Cache misses get encoded one at a time, each encode already spreads its blocks over every core
+        bool stored = false;
+        for (size_t index = 0; index < file_paths.size(); index++) {
+            if (textures[index].is_valid() || !decoded[index].is_valid()) {
+                continue;
+            }
+            textures[index] = compress(jobs, decoded[index], roles[index]);
+            if (textures[index].is_valid() && !cache_paths[index].empty()) {
+                store_cached(cache_paths[index], textures[index]);
+                stored = true;
+                std::cout << "Compressed " << file_paths[index] << " into the texture cache" << std::endl;
+            }
+        }
+        if (stored) {
+            trim_directory(cache_directory, max_cache_bytes, false);
+        }
+        return textures;
+    }
+
+    void trim_cache(const std::string& cache_directory, uint64_t max_bytes) {
+        trim_directory(cache_directory, max_bytes, true);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef PORTFOLIO_TEXTURECOMPRESSION_H
+#define PORTFOLIO_TEXTURECOMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "Textures.h"
+
+// Matches the samplers in input_structures.glsl: colorTex is Albedo, metalRoughTex is MetalRough
+enum class TextureRole : uint8_t {
+    Albedo,
+    Normal,
+    MetalRough
+};
+
+struct CompressedMip {
+    size_t offset;
+    size_t size;
+    VkExtent3D extent;
+};
+
+// Block compressed image with its full mip chain packed back to back in data
+struct CompressedTexture {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent3D extent = {0, 0, 1};
+    std::vector<CompressedMip> mips;
+    std::vector<std::byte> data;
+
+    bool is_valid() const { return !mips.empty(); }
+};
+
+// Beyond this the least recently used cache entries are deleted, an entry is a texture's whole mip chain
+constexpr uint64_t TEXTURE_CACHE_MAX_BYTES = 256ull << 20;
+
+namespace texture {
+    // BC1 for opaque albedo, BC3 when albedo has alpha, BC5 (RG) for normals and BC1 for metal-rough (G and B channels)
+    VkFormat compressed_format(TextureRole role, bool has_alpha);
+    // Only 8 bit sources are compressed, 16 bit and float images return an invalid texture
+    CompressedTexture compress(JobSystem& jobs, const DecodedImage& image, TextureRole role);
+
+    // Decode + compress with the result cached in cache_directory, keyed by a hash of the source file and the role. An
+    // empty cache_directory compresses every time. New entries trim the cache back under max_cache_bytes
+    CompressedTexture import_compressed(JobSystem& jobs, const std::string& file_path, TextureRole role, const std::string& cache_directory,
+        uint64_t max_cache_bytes = TEXTURE_CACHE_MAX_BYTES);
+    std::vector<CompressedTexture> import_compressed(JobSystem& jobs, std::span<const std::string> file_paths, std::span<const TextureRole> roles,
+        const std::string& cache_directory, uint64_t max_cache_bytes = TEXTURE_CACHE_MAX_BYTES);
+    // Deletes the least recently used entries until the cache fits in max_bytes, and temporaries a crashed write left.
+    // Call before any import that may write to the same directory
+    void trim_cache(const std::string& cache_directory, uint64_t max_bytes = TEXTURE_CACHE_MAX_BYTES);
+}
+
+#endif //PORTFOLIO_TEXTURECOMPRESSION_H
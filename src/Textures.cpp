@@ -0,0 +1,121 @@
+#include "Textures.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iostream>
+
+#include "Utilities.h"
+#include "external/stb_image.h"
+
+namespace {
+    // stb_image hands back malloc'd memory, copy it into a vector so DecodedImage owns its pixels
+    template<typename T>
+    void take_pixels(DecodedImage& image, T* pixels, int width, int height) {
+        const size_t size = static_cast<size_t>(width) * height * 4 * sizeof(T);
+        image.pixels.resize(size);
+        memcpy(image.pixels.data(), pixels, size);
+        image.extent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1};
+        stbi_image_free(pixels);
+    }
+}
+
+namespace texture {
+    DecodedImage decode_image(const std::string& file_path, bool srgb) {
+        DecodedImage image = {};
+        image.name = file_path;
+
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        if (stbi_is_hdr(file_path.c_str())) {
+            if (float* pixels = stbi_loadf(file_path.c_str(), &width, &height, &channels, STBI_rgb_alpha)) {
+                take_pixels(image, pixels, width, height);
+                image.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            }
+        } else if (stbi_is_16_bit(file_path.c_str())) {
+            if (stbi_us* pixels = stbi_load_16(file_path.c_str(), &width, &height, &channels, STBI_rgb_alpha)) {
+                take_pixels(image, pixels, width, height);
+                image.format = VK_FORMAT_R16G16B16A16_UNORM;
+            }
+        } else {
+            if (stbi_uc* pixels = stbi_load(file_path.c_str(), &width, &height, &channels, STBI_rgb_alpha)) {
+                take_pixels(image, pixels, width, height);
+                image.format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+            }
+        }
+
+        if (!image.is_valid()) {
+            std::cerr << "Failed to decode " << file_path << ": " << stbi_failure_reason() << std::endl;
+        }
+        return image;
+    }
+
+    DecodedImage decode_image(std::span<const std::byte> encoded, const std::string& name, bool srgb) {
+        DecodedImage image = {};
+        image.name = name;
+
+        const auto* buffer = reinterpret_cast<const stbi_uc*>(encoded.data());
+        const int length = static_cast<int>(encoded.size());
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        if (stbi_is_hdr_from_memory(buffer, length)) {
+            if (float* pixels = stbi_loadf_from_memory(buffer, length, &width, &height, &channels, STBI_rgb_alpha)) {
+                take_pixels(image, pixels, width, height);
+                image.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            }
+        } else if (stbi_is_16_bit_from_memory(buffer, length)) {
+            if (stbi_us* pixels = stbi_load_16_from_memory(buffer, length, &width, &height, &channels, STBI_rgb_alpha)) {
+                take_pixels(image, pixels, width, height);
+                image.format = VK_FORMAT_R16G16B16A16_UNORM;
+            }
+        } else {
+            if (stbi_uc* pixels = stbi_load_from_memory(buffer, length, &width, &height, &channels, STBI_rgb_alpha)) {
+                take_pixels(image, pixels, width, height);
+                image.format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+            }
+        }
+
+        if (!image.is_valid()) {
+            std::cerr << "Failed to decode " << name << ": " << stbi_failure_reason() << std::endl;
+        }
+        return image;
+    }
+
+    std::vector<DecodedImage> decode_images(JobSystem& jobs, std::span<const std::string> file_paths, bool srgb) {
+        std::vector<DecodedImage> images(file_paths.size());
+        util::parallel_for(jobs, file_paths.size(), [&](size_t index) {
+            images[index] = decode_image(file_paths[index], srgb);
+        });
+        return images;
+    }
+
+    uint32_t bytes_per_pixel(VkFormat format) {
+        switch (format) {
+            case VK_FORMAT_R8_UNORM:
+                return 1;
+            case VK_FORMAT_R8G8_UNORM:
+                return 2;
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_B8G8R8A8_UNORM:
+            case VK_FORMAT_B8G8R8A8_SRGB:
+            case VK_FORMAT_R32_SFLOAT:
+            case VK_FORMAT_D32_SFLOAT:
+                return 4;
+            case VK_FORMAT_R16G16B16A16_UNORM:
+            case VK_FORMAT_R16G16B16A16_SFLOAT:
+                return 8;
+            case VK_FORMAT_R32G32B32A32_SFLOAT:
+                return 16;
+            default:
+                std::cerr << "bytes_per_pixel: unhandled format " << format << std::endl;
+                return 4;
+        }
+    }
+
+    uint32_t mip_level_count(VkExtent3D extent) {
+        return std::bit_width(std::max(extent.width, extent.height));
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef PORTFOLIO_TEXTURES_H
+#define PORTFOLIO_TEXTURES_H
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+class JobSystem;
+
+// CPU side image straight out of stb_image. Pixels are always expanded to 4 channels,
+// the channel type (8 bit, 16 bit or float) is kept and reflected in format.
+struct DecodedImage {
+    std::vector<std::byte> pixels;
+    VkExtent3D extent = {0, 0, 1};
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    std::string name;
+
+    bool is_valid() const { return !pixels.empty(); }
+};
+
+namespace texture {
+    DecodedImage decode_image(const std::string& file_path, bool srgb);
+    DecodedImage decode_image(std::span<const std::byte> encoded, const std::string& name, bool srgb);
+    // Decodes every file as jobs on the pool. Results are in the same order as file_paths
+    std::vector<DecodedImage> decode_images(JobSystem& jobs, std::span<const std::string> file_paths, bool srgb);
+
+    uint32_t bytes_per_pixel(VkFormat format);
+    uint32_t mip_level_count(VkExtent3D extent);
+}
+
+#endif //PORTFOLIO_TEXTURES_H
@@ -0,0 +1,390 @@
+#include "TransformMath.h"
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_MATH_SSE
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+    using transform_math::Isa;
+    using transform_math::detail::Kernels;
+
+    // The reference every vector kernel has to match
+    void compose_trs_scalar(Strided<const glm::vec3> translations, Strided<const glm::quat> rotations, Strided<const glm::vec3> scales,
+        Strided<Affine3x4> out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const glm::vec3& t = translations[i];
+            const glm::quat& q = rotations[i];
+            const glm::vec3& s = scales[i];
+            const float xx = q.x * q.x * 2.0f, yy = q.y * q.y * 2.0f, zz = q.z * q.z * 2.0f;
+            const float xy = q.x * q.y * 2.0f, xz = q.x * q.z * 2.0f, yz = q.y * q.z * 2.0f;
+            const float wx = q.w * q.x * 2.0f, wy = q.w * q.y * 2.0f, wz = q.w * q.z * 2.0f;
+            Affine3x4& m = out[i];
+            m.rows[0] = glm::vec4((1.0f - yy - zz) * s.x, (xy - wz) * s.y, (xz + wy) * s.z, t.x);
+            m.rows[1] = glm::vec4((xy + wz) * s.x, (1.0f - xx - zz) * s.y, (yz - wx) * s.z, t.y);
+            m.rows[2] = glm::vec4((xz - wy) * s.x, (yz + wx) * s.y, (1.0f - xx - yy) * s.z, t.z);
+        }
+    }
+
+    void multiply_mat4_scalar(Strided<const glm::mat4> a, Strided<const glm::mat4> b, Strided<glm::mat4> out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const glm::mat4& lhs = a[i];
+            const glm::mat4& rhs = b[i];
+            glm::mat4& result = out[i];
+            for (int column = 0; column < 4; column++) {
+                result[column] = lhs[0] * rhs[column][0] + lhs[1] * rhs[column][1] + lhs[2] * rhs[column][2] + lhs[3] * rhs[column][3];
+            }
+        }
+    }
+
+    void multiply_affine_scalar(Strided<const Affine3x4> a, Strided<const Affine3x4> b, Strided<Affine3x4> out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const Affine3x4& lhs = a[i];
+            const Affine3x4& rhs = b[i];
+            Affine3x4& result = out[i];
+            for (int row = 0; row < 3; row++) {
+                const glm::vec4& r = lhs.rows[row];
+                result.rows[row] = r.x * rhs.rows[0] + r.y * rhs.rows[1] + r.z * rhs.rows[2] + glm::vec4(0.0f, 0.0f, 0.0f, r.w);
+            }
+        }
+    }
+
+    // The inverse of a 3x3 with rows a, b, c has the columns b x c, c x a, a x b over the determinant
+    void inverse_scalar(Strided<const Affine3x4> in, Strided<Affine3x4> out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const Affine3x4& m = in[i];
+            const glm::vec3 a(m.rows[0]), b(m.rows[1]), c(m.rows[2]);
+            const glm::vec3 translation(m.rows[0].w, m.rows[1].w, m.rows[2].w);
+            const glm::vec3 bc = glm::cross(b, c), ca = glm::cross(c, a), ab = glm::cross(a, b);
+            const float inverse_determinant = 1.0f / glm::dot(a, bc);
+            for (int row = 0; row < 3; row++) {
+                const glm::vec3 r = glm::vec3(bc[row], ca[row], ab[row]) * inverse_determinant;
+                out[i].rows[row] = glm::vec4(r, -glm::dot(r, translation));
+            }
+        }
+    }
+
+    // Same cross products, the transpose puts them in the rows
+    void normal_matrices_scalar(Strided<const Affine3x4> in, Strided<Affine3x4> out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const Affine3x4& m = in[i];
+            const glm::vec3 a(m.rows[0]), b(m.rows[1]), c(m.rows[2]);
+            const glm::vec3 bc = glm::cross(b, c), ca = glm::cross(c, a), ab = glm::cross(a, b);
+            const float inverse_determinant = 1.0f / glm::dot(a, bc);
+            out[i].rows[0] = glm::vec4(bc * inverse_determinant, 0.0f);
+            out[i].rows[1] = glm::vec4(ca * inverse_determinant, 0.0f);
+            out[i].rows[2] = glm::vec4(ab * inverse_determinant, 0.0f);
+        }
+    }
+
+    constexpr Kernels SCALAR_KERNELS = {
+        compose_trs_scalar,
+        multiply_mat4_scalar,
+        multiply_affine_scalar,
+        inverse_scalar,
+        normal_matrices_scalar,
+    };
+
+#ifdef TRANSFORM_MATH_SSE
+    // Four elements at a time, one register per matrix entry with an element in each lane
+    struct AffineLanes {
+        __m128 m[3][4];
+    };
+
+    __m128 splat(__m128 v, int lane) {
+        switch (lane) {
+            case 0: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0));
+            case 1: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+            case 2: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2));
+            default: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+    }
+
+    AffineLanes load_lanes(Strided<const Affine3x4> in, size_t i) {
+        AffineLanes lanes = {};
+        for (int row = 0; row < 3; row++) {
+            __m128 e0 = _mm_loadu_ps(&in[i].rows[row].x);
+            __m128 e1 = _mm_loadu_ps(&in[i + 1].rows[row].x);
+            __m128 e2 = _mm_loadu_ps(&in[i + 2].rows[row].x);
+            __m128 e3 = _mm_loadu_ps(&in[i + 3].rows[row].x);
+            _MM_TRANSPOSE4_PS(e0, e1, e2, e3);
+            lanes.m[row][0] = e0;
+            lanes.m[row][1] = e1;
+            lanes.m[row][2] = e2;
+            lanes.m[row][3] = e3;
+        }
+        return lanes;
+    }
+
+    void store_lanes(Strided<Affine3x4> out, size_t i, const AffineLanes& lanes) {
+        for (int row = 0; row < 3; row++) {
+            __m128 e0 = lanes.m[row][0];
+            __m128 e1 = lanes.m[row][1];
+            __m128 e2 = lanes.m[row][2];
+            __m128 e3 = lanes.m[row][3];
+            _MM_TRANSPOSE4_PS(e0, e1, e2, e3);
+            _mm_storeu_ps(&out[i].rows[row].x, e0);
+            _mm_storeu_ps(&out[i + 1].rows[row].x, e1);
+            _mm_storeu_ps(&out[i + 2].rows[row].x, e2);
+            _mm_storeu_ps(&out[i + 3].rows[row].x, e3);
+        }
+    }
+
+    template<typename T, typename Field>
+    __m128 gather(Strided<const T> in, size_t i, Field field) {
+        return _mm_setr_ps(field(in[i]), field(in[i + 1]), field(in[i + 2]), field(in[i + 3]));
+    }
+
+    void compose_trs_sse(Strided<const glm::vec3> translations, Strided<const glm::quat> rotations, Strided<const glm::vec3> scales,
+        Strided<Affine3x4> out, size_t count) {
+        const __m128 one = _mm_set1_ps(1.0f);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m128 x = gather(rotations, i, [](const glm::quat& q) { return q.x; });
+            const __m128 y = gather(rotations, i, [](const glm::quat& q) { return q.y; });
+            const __m128 z = gather(rotations, i, [](const glm::quat& q) { return q.z; });
+            const __m128 w = gather(rotations, i, [](const glm::quat& q) { return q.w; });
+            const __m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+            const __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+            const __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+            const __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+            const __m128 sx = gather(scales, i, [](const glm::vec3& s) { return s.x; });
+            const __m128 sy = gather(scales, i, [](const glm::vec3& s) { return s.y; });
+            const __m128 sz = gather(scales, i, [](const glm::vec3& s) { return s.z; });
+
+            AffineLanes lanes;
+            lanes.m[0][0] = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, yy), zz), sx);
+            lanes.m[0][1] = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+            lanes.m[0][2] = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+            lanes.m[0][3] = gather(translations, i, [](const glm::vec3& t) { return t.x; });
+            lanes.m[1][0] = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+            lanes.m[1][1] = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, xx), zz), sy);
+            lanes.m[1][2] = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+            lanes.m[1][3] = gather(translations, i, [](const glm::vec3& t) { return t.y; });
+            lanes.m[2][0] = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+            lanes.m[2][1] = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+            lanes.m[2][2] = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, xx), yy), sz);
+            lanes.m[2][3] = gather(translations, i, [](const glm::vec3& t) { return t.z; });
+            store_lanes(out, i, lanes);
+        }
+        compose_trs_scalar(translations.from(i), rotations.from(i), scales.from(i), out.from(i), count - i);
+    }
+
+    void multiply_mat4_sse(Strided<const glm::mat4> a, Strided<const glm::mat4> b, Strided<glm::mat4> out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const __m128 a0 = _mm_loadu_ps(&a[i][0].x);
+            const __m128 a1 = _mm_loadu_ps(&a[i][1].x);
+            const __m128 a2 = _mm_loadu_ps(&a[i][2].x);
+            const __m128 a3 = _mm_loadu_ps(&a[i][3].x);
+            for (int column = 0; column < 4; column++) {
+                const __m128 bc = _mm_loadu_ps(&b[i][column].x);
+                const __m128 result = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(a0, splat(bc, 0)), _mm_mul_ps(a1, splat(bc, 1))),
+                    _mm_add_ps(_mm_mul_ps(a2, splat(bc, 2)), _mm_mul_ps(a3, splat(bc, 3))));
+                _mm_storeu_ps(&out[i][column].x, result);
+            }
+        }
+    }
+
+    void multiply_affine_sse(Strided<const Affine3x4> a, Strided<const Affine3x4> b, Strided<Affine3x4> out, size_t count) {
+        const __m128 w_mask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+        for (size_t i = 0; i < count; i++) {
+            const __m128 b0 = _mm_loadu_ps(&b[i].rows[0].x);
+            const __m128 b1 = _mm_loadu_ps(&b[i].rows[1].x);
+            const __m128 b2 = _mm_loadu_ps(&b[i].rows[2].x);
+            for (int row = 0; row < 3; row++) {
+                const __m128 ar = _mm_loadu_ps(&a[i].rows[row].x);
+                const __m128 result = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(splat(ar, 0), b0), _mm_mul_ps(splat(ar, 1), b1)),
+                    _mm_add_ps(_mm_mul_ps(splat(ar, 2), b2), _mm_and_ps(ar, w_mask)));
+                _mm_storeu_ps(&out[i].rows[row].x, result);
+            }
+        }
+    }
+
+    // Cross products of the rows and one over the determinant, what inverse and normal_matrices both start from
+    struct Cofactors {
+        __m128 bc[3], ca[3], ab[3];
+        __m128 inverse_determinant;
+    };
+
+    Cofactors cofactors(const AffineLanes& m) {
+        const __m128* a = m.m[0];
+        const __m128* b = m.m[1];
+        const __m128* c = m.m[2];
+        Cofactors result;
+        result.bc[0] = _mm_sub_ps(_mm_mul_ps(b[1], c[2]), _mm_mul_ps(b[2], c[1]));
+        result.bc[1] = _mm_sub_ps(_mm_mul_ps(b[2], c[0]), _mm_mul_ps(b[0], c[2]));
+        result.bc[2] = _mm_sub_ps(_mm_mul_ps(b[0], c[1]), _mm_mul_ps(b[1], c[0]));
+        result.ca[0] = _mm_sub_ps(_mm_mul_ps(c[1], a[2]), _mm_mul_ps(c[2], a[1]));
+        result.ca[1] = _mm_sub_ps(_mm_mul_ps(c[2], a[0]), _mm_mul_ps(c[0], a[2]));
+        result.ca[2] = _mm_sub_ps(_mm_mul_ps(c[0], a[1]), _mm_mul_ps(c[1], a[0]));
+        result.ab[0] = _mm_sub_ps(_mm_mul_ps(a[1], b[2]), _mm_mul_ps(a[2], b[1]));
+        result.ab[1] = _mm_sub_ps(_mm_mul_ps(a[2], b[0]), _mm_mul_ps(a[0], b[2]));
+        result.ab[2] = _mm_sub_ps(_mm_mul_ps(a[0], b[1]), _mm_mul_ps(a[1], b[0]));
+        const __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], result.bc[0]), _mm_mul_ps(a[1], result.bc[1])),
+            _mm_mul_ps(a[2], result.bc[2]));
+        result.inverse_determinant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+        return result;
+    }
+
+    void inverse_sse(Strided<const Affine3x4> in, Strided<Affine3x4> out, size_t count) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const AffineLanes m = load_lanes(in, i);
+            const Cofactors c = cofactors(m);
+            AffineLanes result;
+            for (int row = 0; row < 3; row++) {
+                const __m128 x = _mm_mul_ps(c.bc[row], c.inverse_determinant);
+                const __m128 y = _mm_mul_ps(c.ca[row], c.inverse_determinant);
+                const __m128 z = _mm_mul_ps(c.ab[row], c.inverse_determinant);
+                const __m128 moved = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m.m[0][3]), _mm_mul_ps(y, m.m[1][3])), _mm_mul_ps(z, m.m[2][3]));
+                result.m[row][0] = x;
+                result.m[row][1] = y;
+                result.m[row][2] = z;
+                result.m[row][3] = _mm_sub_ps(_mm_setzero_ps(), moved);
+            }
+            store_lanes(out, i, result);
+        }
+        inverse_scalar(in.from(i), out.from(i), count - i);
+    }
+
+    void normal_matrices_sse(Strided<const Affine3x4> in, Strided<Affine3x4> out, size_t count) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const Cofactors c = cofactors(load_lanes(in, i));
+            AffineLanes result;
+            const __m128* rows[3] = {c.bc, c.ca, c.ab};
+            for (int row = 0; row < 3; row++) {
+                for (int column = 0; column < 3; column++) {
+                    result.m[row][column] = _mm_mul_ps(rows[row][column], c.inverse_determinant);
+                }
+                result.m[row][3] = _mm_setzero_ps();
+            }
+            store_lanes(out, i, result);
+        }
+        normal_matrices_scalar(in.from(i), out.from(i), count - i);
+    }
+
+    constexpr Kernels SSE_KERNELS = {
+        compose_trs_sse,
+        multiply_mat4_sse,
+        multiply_affine_sse,
+        inverse_sse,
+        normal_matrices_sse,
+    };
+
+    bool cpu_has_avx2() {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        const bool os_saves_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+        const bool fma = (info[2] & (1 << 12)) != 0;
+        __cpuidex(info, 7, 0);
+        return os_saves_ymm && fma && (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+    }
+#endif
+
+    Isa detect_isa() {
+#ifdef TRANSFORM_MATH_SSE
+        if (transform_math::detail::avx2_kernels() && cpu_has_avx2()) {
+            return Isa::Avx2;
+        }
+        return Isa::Sse;
+#else
+        return Isa::Scalar;
+#endif
+    }
+
+    std::atomic<const Kernels*> g_kernels = nullptr;
+    std::atomic<Isa> g_isa = Isa::Scalar;
+
+    const Kernels& kernels() {
+        const Kernels* active = g_kernels.load(std::memory_order_acquire);
+        if (!active) {
+            transform_math::set_isa(transform_math::supported_isa());
+            active = g_kernels.load(std::memory_order_acquire);
+        }
+        return *active;
+    }
+}
+
+namespace transform_math {
+    void compose_trs(Strided<const glm::vec3> translations, Strided<const glm::quat> rotations, Strided<const glm::vec3> scales,
+        Strided<Affine3x4> out, size_t count) {
+        kernels().compose_trs(translations, rotations, scales, out, count);
+    }
+
+    void multiply(Strided<const glm::mat4> a, Strided<const glm::mat4> b, Strided<glm::mat4> out, size_t count) {
+        kernels().multiply_mat4(a, b, out, count);
+    }
+
+    void multiply(Strided<const Affine3x4> a, Strided<const Affine3x4> b, Strided<Affine3x4> out, size_t count) {
+        kernels().multiply_affine(a, b, out, count);
+    }
+
+    void inverse(Strided<const Affine3x4> in, Strided<Affine3x4> out, size_t count) {
+        kernels().inverse(in, out, count);
+    }
+
+    void normal_matrices(Strided<const Affine3x4> in, Strided<Affine3x4> out, size_t count) {
+        kernels().normal_matrices(in, out, count);
+    }
+
+    Isa active_isa() {
+        kernels();
+        return g_isa.load(std::memory_order_relaxed);
+    }
+
+    Isa supported_isa() {
+        static const Isa isa = detect_isa();
+        return isa;
+    }
+
+    void set_isa(Isa isa) {
+        isa = std::min(isa, supported_isa());
+        const Kernels* selected = &detail::scalar_kernels();
+#ifdef TRANSFORM_MATH_SSE
+        if (isa == Isa::Sse) {
+            selected = detail::sse_kernels();
+        } else if (isa == Isa::Avx2) {
+            selected = detail::avx2_kernels();
+        }
+#endif
+        g_isa.store(isa, std::memory_order_relaxed);
+        g_kernels.store(selected, std::memory_order_release);
+    }
+
+    const char* isa_name(Isa isa) {
+        switch (isa) {
+            case Isa::Scalar: return "scalar";
+            case Isa::Sse: return "SSE2";
+            case Isa::Avx2: return "AVX2+FMA";
+        }
+        return "unknown";
+    }
+
+    namespace detail {
+        const Kernels& scalar_kernels() {
+            return SCALAR_KERNELS;
+        }
+
+        const Kernels* sse_kernels() {
+#ifdef TRANSFORM_MATH_SSE
+            return &SSE_KERNELS;
+#else
+            return nullptr;
+#endif
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef PORTFOLIO_TRANSFORM_MATH_H
+#define PORTFOLIO_TRANSFORM_MATH_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+// Upper three rows of an affine mat4, row major, so rows[r] = (m[0][r], m[1][r], m[2][r], m[3][r]). 48 bytes instead
+// of 64, a shader reads it as a mat3x4 m and transforms with vec4(p, 1.0) * m
+struct Affine3x4 {
+    glm::vec4 rows[3];
+};
+
+inline Affine3x4 to_affine(const glm::mat4& m) {
+    return {{
+        glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]),
+        glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]),
+        glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]),
+    }};
+}
+
+inline glm::mat4 to_mat4(const Affine3x4& a) {
+    return {
+        a.rows[0].x, a.rows[1].x, a.rows[2].x, 0.0f,
+        a.rows[0].y, a.rows[1].y, a.rows[2].y, 0.0f,
+        a.rows[0].z, a.rows[1].z, a.rows[2].z, 0.0f,
+        a.rows[0].w, a.rows[1].w, a.rows[2].w, 1.0f,
+    };
+}
+
+inline glm::vec3 transform_point(const Affine3x4& a, const glm::vec3& p) {
+    const glm::vec4 point(p, 1.0f);
+    return {glm::dot(a.rows[0], point), glm::dot(a.rows[1], point), glm::dot(a.rows[2], point)};
+}
+
+// An array the kernels walk, stride is the distance in bytes between elements so a field of an array of structs can
+// be passed in place
+template<typename T>
+struct Strided {
+    T* data = nullptr;
+    size_t stride = sizeof(T);
+
+    Strided() = default;
+    Strided(T* data, size_t stride = sizeof(T)) : data(data), stride(stride) {
+        // The vector kernels address floats
+        assert(stride % sizeof(float) == 0);
+    }
+
+    T* element(size_t i) const {
+        using Byte = std::conditional_t<std::is_const_v<T>, const std::byte, std::byte>;
+        return reinterpret_cast<T*>(reinterpret_cast<Byte*>(data) + i * stride);
+    }
+    T& operator[](size_t i) const { return *element(i); }
+    // The same array starting at element i
+    Strided from(size_t i) const { return {element(i), stride}; }
+};
+
+// Batched transform math. Every function handles count elements with the widest kernels this CPU runs, picked the
+// first time any of them is called. Inputs and outputs must not overlap
+namespace transform_math {
+    enum class Isa {
+        Scalar,
+        Sse,
+        Avx2,
+    };
+
+    // translation * rotation * scale per element
+    void compose_trs(Strided<const glm::vec3> translations, Strided<const glm::quat> rotations, Strided<const glm::vec3> scales,
+        Strided<Affine3x4> out, size_t count);
+    // a[i] * b[i]
+    void multiply(Strided<const glm::mat4> a, Strided<const glm::mat4> b, Strided<glm::mat4> out, size_t count);
+    void multiply(Strided<const Affine3x4> a, Strided<const Affine3x4> b, Strided<Affine3x4> out, size_t count);
+    // Matrices have to be invertible, there is no check for a zero determinant
+    void inverse(Strided<const Affine3x4> in, Strided<Affine3x4> out, size_t count);
+    // Inverse transpose of the upper 3x3, translation comes out zero
+    void normal_matrices(Strided<const Affine3x4> in, Strided<Affine3x4> out, size_t count);
+
+    Isa active_isa();
+    // Best the CPU supports, set_isa clamps to it. For benchmarks and checking one path against another
+    Isa supported_isa();
+    void set_isa(Isa isa);
+    const char* isa_name(Isa isa);
+
+    namespace detail {
+        struct Kernels {
+            void (*compose_trs)(Strided<const glm::vec3>, Strided<const glm::quat>, Strided<const glm::vec3>, Strided<Affine3x4>, size_t);
+            void (*multiply_mat4)(Strided<const glm::mat4>, Strided<const glm::mat4>, Strided<glm::mat4>, size_t);
+            void (*multiply_affine)(Strided<const Affine3x4>, Strided<const Affine3x4>, Strided<Affine3x4>, size_t);
+            void (*inverse)(Strided<const Affine3x4>, Strided<Affine3x4>, size_t);
+            void (*normal_matrices)(Strided<const Affine3x4>, Strided<Affine3x4>, size_t);
+        };
+
+        const Kernels& scalar_kernels();
+        // nullptr off x86, or for AVX2 when TransformMathAvx2.cpp was built without it enabled
+        const Kernels* sse_kernels();
+        const Kernels* avx2_kernels();
+    }
+}
+
+#endif //PORTFOLIO_TRANSFORM_MATH_H
@@ -0,0 +1,220 @@
+// Built with AVX2 and FMA enabled, TransformMath.cpp only hands these out when the CPU reports both
+#include "TransformMath.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace {
+    using transform_math::detail::Kernels;
+
+    // Eight elements at a time, one register per matrix entry with an element in each lane
+    struct AffineLanes {
+        __m256 m[3][4];
+    };
+
+    // Byte offsets of eight consecutive elements, as float indices for the gathers
+    __m256i lane_indices(size_t stride) {
+        return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(static_cast<int>(stride / sizeof(float))));
+    }
+
+    __m256 gather(const float* first, __m256i indices) {
+        return _mm256_i32gather_ps(first, indices, sizeof(float));
+    }
+
+    AffineLanes load_lanes(Strided<const Affine3x4> in, size_t i) {
+        const __m256i indices = lane_indices(in.stride);
+        const Affine3x4& first = in[i];
+        AffineLanes lanes;
+        for (int row = 0; row < 3; row++) {
+            for (int column = 0; column < 4; column++) {
+                lanes.m[row][column] = gather(&first.rows[row].x + column, indices);
+            }
+        }
+        return lanes;
+    }
+
+    // No scatter in AVX2, each half goes back to four rows with a 4x4 transpose
+    void store_lanes(Strided<Affine3x4> out, size_t i, const AffineLanes& lanes) {
+        for (int row = 0; row < 3; row++) {
+            for (int half = 0; half < 2; half++) {
+                __m128 e0 = half ? _mm256_extractf128_ps(lanes.m[row][0], 1) : _mm256_castps256_ps128(lanes.m[row][0]);
+                __m128 e1 = half ? _mm256_extractf128_ps(lanes.m[row][1], 1) : _mm256_castps256_ps128(lanes.m[row][1]);
+                __m128 e2 = half ? _mm256_extractf128_ps(lanes.m[row][2], 1) : _mm256_castps256_ps128(lanes.m[row][2]);
+                __m128 e3 = half ? _mm256_extractf128_ps(lanes.m[row][3], 1) : _mm256_castps256_ps128(lanes.m[row][3]);
+                _MM_TRANSPOSE4_PS(e0, e1, e2, e3);
+                const size_t base = i + half * 4;
+                _mm_storeu_ps(&out[base].rows[row].x, e0);
+                _mm_storeu_ps(&out[base + 1].rows[row].x, e1);
+                _mm_storeu_ps(&out[base + 2].rows[row].x, e2);
+                _mm_storeu_ps(&out[base + 3].rows[row].x, e3);
+            }
+        }
+    }
+
+    void compose_trs_avx2(Strided<const glm::vec3> translations, Strided<const glm::quat> rotations, Strided<const glm::vec3> scales,
+        Strided<Affine3x4> out, size_t count) {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256i rotation_indices = lane_indices(rotations.stride);
+        const __m256i translation_indices = lane_indices(translations.stride);
+        const __m256i scale_indices = lane_indices(scales.stride);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const glm::quat& q = rotations[i];
+            const glm::vec3& t = translations[i];
+            const glm::vec3& s = scales[i];
+            const __m256 x = gather(&q.x, rotation_indices);
+            const __m256 y = gather(&q.y, rotation_indices);
+            const __m256 z = gather(&q.z, rotation_indices);
+            const __m256 w = gather(&q.w, rotation_indices);
+            const __m256 x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+            const __m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+            const __m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+            const __m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+            const __m256 sx = gather(&s.x, scale_indices);
+            const __m256 sy = gather(&s.y, scale_indices);
+            const __m256 sz = gather(&s.z, scale_indices);
+
+            AffineLanes lanes;
+            lanes.m[0][0] = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(one, yy), zz), sx);
+            lanes.m[0][1] = _mm256_mul_ps(_mm256_sub_ps(xy, wz), sy);
+            lanes.m[0][2] = _mm256_mul_ps(_mm256_add_ps(xz, wy), sz);
+            lanes.m[0][3] = gather(&t.x, translation_indices);
+            lanes.m[1][0] = _mm256_mul_ps(_mm256_add_ps(xy, wz), sx);
+            lanes.m[1][1] = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(one, xx), zz), sy);
+            lanes.m[1][2] = _mm256_mul_ps(_mm256_sub_ps(yz, wx), sz);
+            lanes.m[1][3] = gather(&t.y, translation_indices);
+            lanes.m[2][0] = _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx);
+            lanes.m[2][1] = _mm256_mul_ps(_mm256_add_ps(yz, wx), sy);
+            lanes.m[2][2] = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(one, xx), yy), sz);
+            lanes.m[2][3] = gather(&t.z, translation_indices);
+            store_lanes(out, i, lanes);
+        }
+        transform_math::detail::scalar_kernels().compose_trs(translations.from(i), rotations.from(i), scales.from(i), out.from(i), count - i);
+    }
+
+    // Two result columns per register, each lane of a picks up the matching column of b
+    void multiply_mat4_avx2(Strided<const glm::mat4> a, Strided<const glm::mat4> b, Strided<glm::mat4> out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a[i][0].x));
+            const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a[i][1].x));
+            const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a[i][2].x));
+            const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a[i][3].x));
+            for (int column = 0; column < 4; column += 2) {
+                const __m256 bc = _mm256_loadu_ps(&b[i][column].x);
+                __m256 result = _mm256_mul_ps(a0, _mm256_permute_ps(bc, _MM_SHUFFLE(0, 0, 0, 0)));
+                result = _mm256_fmadd_ps(a1, _mm256_permute_ps(bc, _MM_SHUFFLE(1, 1, 1, 1)), result);
+                result = _mm256_fmadd_ps(a2, _mm256_permute_ps(bc, _MM_SHUFFLE(2, 2, 2, 2)), result);
+                result = _mm256_fmadd_ps(a3, _mm256_permute_ps(bc, _MM_SHUFFLE(3, 3, 3, 3)), result);
+                _mm256_storeu_ps(&out[i][column].x, result);
+            }
+        }
+    }
+
+    // Rows 0 and 1 share a register, row 2 goes through the lower half on its own
+    void multiply_affine_avx2(Strided<const Affine3x4> a, Strided<const Affine3x4> b, Strided<Affine3x4> out, size_t count) {
+        const __m256 w_mask = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+        for (size_t i = 0; i < count; i++) {
+            const __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&b[i].rows[0].x));
+            const __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&b[i].rows[1].x));
+            const __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&b[i].rows[2].x));
+
+            const __m256 a01 = _mm256_loadu_ps(&a[i].rows[0].x);
+            __m256 rows01 = _mm256_and_ps(a01, w_mask);
+            rows01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(0, 0, 0, 0)), b0, rows01);
+            rows01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(1, 1, 1, 1)), b1, rows01);
+            rows01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(2, 2, 2, 2)), b2, rows01);
+            _mm256_storeu_ps(&out[i].rows[0].x, rows01);
+
+            const __m128 a2 = _mm_loadu_ps(&a[i].rows[2].x);
+            __m128 row2 = _mm_and_ps(a2, _mm256_castps256_ps128(w_mask));
+            row2 = _mm_fmadd_ps(_mm_permute_ps(a2, _MM_SHUFFLE(0, 0, 0, 0)), _mm256_castps256_ps128(b0), row2);
+            row2 = _mm_fmadd_ps(_mm_permute_ps(a2, _MM_SHUFFLE(1, 1, 1, 1)), _mm256_castps256_ps128(b1), row2);
+            row2 = _mm_fmadd_ps(_mm_permute_ps(a2, _MM_SHUFFLE(2, 2, 2, 2)), _mm256_castps256_ps128(b2), row2);
+            _mm_storeu_ps(&out[i].rows[2].x, row2);
+        }
+    }
+
+    // Cross products of the rows and one over the determinant, what inverse and normal_matrices both start from
+    struct Cofactors {
+        __m256 bc[3], ca[3], ab[3];
+        __m256 inverse_determinant;
+    };
+
+    __m256 cross_component(__m256 u1, __m256 v2, __m256 u2, __m256 v1) {
+        return _mm256_fmsub_ps(u1, v2, _mm256_mul_ps(u2, v1));
+    }
+
+    Cofactors cofactors(const AffineLanes& m) {
+        const __m256* a = m.m[0];
+        const __m256* b = m.m[1];
+        const __m256* c = m.m[2];
+        Cofactors result;
+        result.bc[0] = cross_component(b[1], c[2], b[2], c[1]);
+        result.bc[1] = cross_component(b[2], c[0], b[0], c[2]);
+        result.bc[2] = cross_component(b[0], c[1], b[1], c[0]);
+        result.ca[0] = cross_component(c[1], a[2], c[2], a[1]);
+        result.ca[1] = cross_component(c[2], a[0], c[0], a[2]);
+        result.ca[2] = cross_component(c[0], a[1], c[1], a[0]);
+        result.ab[0] = cross_component(a[1], b[2], a[2], b[1]);
+        result.ab[1] = cross_component(a[2], b[0], a[0], b[2]);
+        result.ab[2] = cross_component(a[0], b[1], a[1], b[0]);
+        const __m256 determinant = _mm256_fmadd_ps(a[2], result.bc[2], _mm256_fmadd_ps(a[1], result.bc[1], _mm256_mul_ps(a[0], result.bc[0])));
+        result.inverse_determinant = _mm256_div_ps(_mm256_set1_ps(1.0f), determinant);
+        return result;
+    }
+
+    void inverse_avx2(Strided<const Affine3x4> in, Strided<Affine3x4> out, size_t count) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const AffineLanes m = load_lanes(in, i);
+            const Cofactors c = cofactors(m);
+            AffineLanes result;
+            for (int row = 0; row < 3; row++) {
+                const __m256 x = _mm256_mul_ps(c.bc[row], c.inverse_determinant);
+                const __m256 y = _mm256_mul_ps(c.ca[row], c.inverse_determinant);
+                const __m256 z = _mm256_mul_ps(c.ab[row], c.inverse_determinant);
+                const __m256 moved = _mm256_fmadd_ps(z, m.m[2][3], _mm256_fmadd_ps(y, m.m[1][3], _mm256_mul_ps(x, m.m[0][3])));
+                result.m[row][0] = x;
+                result.m[row][1] = y;
+                result.m[row][2] = z;
+                result.m[row][3] = _mm256_sub_ps(_mm256_setzero_ps(), moved);
+            }
+            store_lanes(out, i, result);
+        }
+        transform_math::detail::scalar_kernels().inverse(in.from(i), out.from(i), count - i);
+    }
+
+    void normal_matrices_avx2(Strided<const Affine3x4> in, Strided<Affine3x4> out, size_t count) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const Cofactors c = cofactors(load_lanes(in, i));
+            AffineLanes result;
+            const __m256* rows[3] = {c.bc, c.ca, c.ab};
+            for (int row = 0; row < 3; row++) {
+                for (int column = 0; column < 3; column++) {
+                    result.m[row][column] = _mm256_mul_ps(rows[row][column], c.inverse_determinant);
+                }
+                result.m[row][3] = _mm256_setzero_ps();
+            }
+            store_lanes(out, i, result);
+        }
+        transform_math::detail::scalar_kernels().normal_matrices(in.from(i), out.from(i), count - i);
+    }
+
+    constexpr Kernels AVX2_KERNELS = {
+        compose_trs_avx2,
+        multiply_mat4_avx2,
+        multiply_affine_avx2,
+        inverse_avx2,
+        normal_matrices_avx2,
+    };
+}
+#endif
+
+const transform_math::detail::Kernels* transform_math::detail::avx2_kernels() {
+#if defined(__AVX2__)
+    return &AVX2_KERNELS;
+#else
+    return nullptr;
+#endif
+}
@@ -0,0 +1,70 @@
+#ifndef PORTFOLIO_TRIPLEBUFFER_H
+#define PORTFOLIO_TRIPLEBUFFER_H
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <utility>
+
+// Hands frames from one producer thread to one consumer thread. One slot is being written, one is waiting and one
+// is being read, so neither side ever touches a slot the other one has. Nothing is dropped: publish() holds the
+// producer back while the waiting slot hasn't been taken, which keeps it at most one frame ahead of the consumer
+template<typename T>
+class TripleBuffer {
+public:
+    // Slot the producer fills next, it stays the producer's until publish()
+    T& write_slot() { return m_slots[m_write]; }
+
+    // False once closed, the slot was not handed over then
+    bool publish() {
+        std::unique_lock lock(m_mutex);
+        m_taken.wait(lock, [this]() { return !m_has_ready || m_closed; });
+        if (m_closed) {
+            return false;
+        }
+        std::swap(m_write, m_ready);
+        m_has_ready = true;
+        m_published.notify_one();
+        return true;
+    }
+
+    // Blocks until a slot is published, nullptr once closed. The slot stays the consumer's until the next take()
+    T* take() {
+        std::unique_lock lock(m_mutex);
+        m_published.wait(lock, [this]() { return m_has_ready || m_closed; });
+        if (!m_has_ready) {
+            return nullptr;
+        }
+        std::swap(m_read, m_ready);
+        m_has_ready = false;
+        m_taken.notify_one();
+        return &m_slots[m_read];
+    }
+
+    // Wakes both sides for good. A slot published before this is dropped
+    void close() {
+        std::scoped_lock lock(m_mutex);
+        m_closed = true;
+        m_has_ready = false;
+        m_published.notify_all();
+        m_taken.notify_all();
+    }
+
+    // Every slot, for setting them up before either thread runs
+    std::span<T, 3> slots() { return m_slots; }
+
+private:
+    std::array<T, 3> m_slots;
+    uint32_t m_write = 0;
+    uint32_t m_ready = 1;
+    uint32_t m_read = 2;
+    bool m_has_ready = false;
+    bool m_closed = false;
+    std::mutex m_mutex;
+    std::condition_variable m_published;
+    std::condition_variable m_taken;
+};
+
+#endif //PORTFOLIO_TRIPLEBUFFER_H
@@ -4,7 +4,9 @@
 #include "vulkan/vk_enum_string_helper.h"
 #include <iostream>
 #include <cassert>
+#include <functional>
 #include <memory>
+#include <ranges>
 #include <vector>
 
 #include "glm/glm.hpp"
@@ -25,6 +27,22 @@
     } \
 }
 
+//Todo: Change calls to push_function to be capture by value and not reference? (according to ChatGPT)
+struct DeletionQueue {
+    // A vector so a flushed frame queue keeps its capacity. The std::function captures still allocate, which only
+    // happens on frames that retire something
+    std::vector<std::function<void()>> deletion_queue;
+    void push_function(std::function<void()>&& func) {
+        deletion_queue.emplace_back(std::move(func));
+    }
+    void flush() {
+        for (auto& func : std::ranges::reverse_view(deletion_queue)) {
+            func();
+        }
+        deletion_queue.clear();
+    }
+};
+
 enum class MaterialPass : uint8_t {
     MainColor,
     Transparent,
@@ -1,7 +1,10 @@
 #include "Utilities.h"
 
-#include <fstream>
+#include <algorithm>
+#include <iostream>
 #include <vector>
+
+#include "EmbeddedShaders.h"
 #include "Initializers.h"
 
 namespace util {
@@ -29,6 +32,78 @@ namespace util {
         vkCmdPipelineBarrier2(cmd, &dependency_info);
     }
 
+    void transition_mips(VkCommandBuffer cmd, VkImage image, uint32_t base_mip, uint32_t mip_count, VkImageLayout current_layout, VkImageLayout new_layout) {
+        VkImageMemoryBarrier2 image_barrier = {};
+        image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        image_barrier.pNext = nullptr;
+        image_barrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        image_barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        image_barrier.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        image_barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        image_barrier.oldLayout = current_layout;
+        image_barrier.newLayout = new_layout;
+
+        image_barrier.subresourceRange = init::image_subresource_range(VK_IMAGE_ASPECT_COLOR_BIT);
+        image_barrier.subresourceRange.baseMipLevel = base_mip;
+        image_barrier.subresourceRange.levelCount = mip_count;
+        image_barrier.image = image;
+
+        VkDependencyInfo dependency_info {};
+        dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependency_info.pNext = nullptr;
+        dependency_info.imageMemoryBarrierCount = 1;
+        dependency_info.pImageMemoryBarriers = &image_barrier;
+
+        vkCmdPipelineBarrier2(cmd, &dependency_info);
+    }
+
+    void generate_mipmaps(VkCommandBuffer cmd, VkImage image, VkExtent2D image_size, uint32_t mip_levels, VkFilter filter) {
+        for (uint32_t mip = 0; mip < mip_levels; mip++) {
+            // The level we just filled becomes the source of the next one
+            transition_mips(cmd, image, mip, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+            if (mip + 1 == mip_levels) {
+                break;
+            }
+
+            const VkExtent2D half_size = { std::max(image_size.width / 2, 1u), std::max(image_size.height / 2, 1u) };
+
+            VkImageBlit2 blit_region = {};
+            blit_region.sType = VK_STRUCTURE_TYPE_IMAGE_BLIT_2;
+            blit_region.pNext = nullptr;
+            blit_region.srcOffsets[1].x = static_cast<int32_t>(image_size.width);
+            blit_region.srcOffsets[1].y = static_cast<int32_t>(image_size.height);
+            blit_region.srcOffsets[1].z = 1;
+            blit_region.dstOffsets[1].x = static_cast<int32_t>(half_size.width);
+            blit_region.dstOffsets[1].y = static_cast<int32_t>(half_size.height);
+            blit_region.dstOffsets[1].z = 1;
+            blit_region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit_region.srcSubresource.baseArrayLayer = 0;
+            blit_region.srcSubresource.layerCount = 1;
+            blit_region.srcSubresource.mipLevel = mip;
+            blit_region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit_region.dstSubresource.baseArrayLayer = 0;
+            blit_region.dstSubresource.layerCount = 1;
+            blit_region.dstSubresource.mipLevel = mip + 1;
+
+            VkBlitImageInfo2 blit_info = {};
+            blit_info.sType = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2;
+            blit_info.pNext = nullptr;
+            blit_info.dstImage = image;
+            blit_info.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            blit_info.srcImage = image;
+            blit_info.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            blit_info.filter = filter;
+            blit_info.regionCount = 1;
+            blit_info.pRegions = &blit_region;
+
+            vkCmdBlitImage2(cmd, &blit_info);
+            image_size = half_size;
+        }
+
+        // Whole chain is now in TRANSFER_SRC, hand it to the shaders in one go
+        transition_mips(cmd, image, 0, mip_levels, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
     void copy_image_to_image(VkCommandBuffer cmd, VkImage source, VkImage destination, VkExtent2D src_size, VkExtent2D dst_size)
     {
         VkImageBlit2 blit_region = {};
@@ -63,23 +138,21 @@ namespace util {
         vkCmdBlitImage2(cmd, &blit_info);
     }
 
-    bool load_shader_module(const char* file_path, VkDevice device, VkShaderModule* out_shader_module) {
-        std::ifstream file(file_path, std::ios::ate | std::ios::binary);
-        if (!file.is_open()) {
+    bool load_shader_module(EmbeddedShaderName shader_name, VkDevice device, VkShaderModule* out_shader_module) {
+        const std::optional<std::span<const uint32_t>> code = find_embedded_shader(shader_name.view());
+        if (!code.has_value()) {
+            std::cerr << "No embedded shader named " << shader_name.view() << std::endl;
             return false;
         }
+        return create_shader_module(code.value(), device, out_shader_module);
+    }
 
-        const size_t file_size = file.tellg();
-        std::vector<uint32_t> buffer(file_size / sizeof(uint32_t));
-        file.seekg(0);
-        file.read((char*)buffer.data(), file_size);
-        file.close();
-
+    bool create_shader_module(std::span<const uint32_t> code, VkDevice device, VkShaderModule* out_shader_module) {
         VkShaderModuleCreateInfo create_info = {};
         create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
         create_info.pNext = nullptr;
-        create_info.codeSize = buffer.size() * sizeof(uint32_t);
-        create_info.pCode = buffer.data();
+        create_info.codeSize = code.size() * sizeof(uint32_t);
+        create_info.pCode = code.data();
 
         VkShaderModule shader_module = {};
         if (vkCreateShaderModule(device, &create_info, nullptr, &shader_module) != VK_SUCCESS) {
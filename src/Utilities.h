@@ -1,12 +1,47 @@
 #ifndef PORTFOLIO_UTILITIES_H
 #define PORTFOLIO_UTILITIES_H
 
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
 #include <vulkan/vulkan.h>
 
+#include "EmbeddedShaders.h"
+#include "JobSystem.h"
+
 namespace util {
     void transition_image(VkCommandBuffer cmd, VkImage image, VkImageLayout current_layout, VkImageLayout new_layout);
+    void transition_mips(VkCommandBuffer cmd, VkImage image, uint32_t base_mip, uint32_t mip_count, VkImageLayout current_layout, VkImageLayout new_layout);
+    // Expects every level in TRANSFER_DST_OPTIMAL with level 0 filled, leaves every level in SHADER_READ_ONLY_OPTIMAL
+    void generate_mipmaps(VkCommandBuffer cmd, VkImage image, VkExtent2D image_size, uint32_t mip_levels, VkFilter filter);
     void copy_image_to_image(VkCommandBuffer cmd, VkImage source, VkImage destination, VkExtent2D src_size, VkExtent2D dst_size);
-    bool load_shader_module(const char* file_path, VkDevice device, VkShaderModule* out_shader_module);
+    // Creates a module from one of the shaders the build embeds, named by its source file, e.g. "mesh.vert"
+    bool load_shader_module(EmbeddedShaderName shader_name, VkDevice device, VkShaderModule* out_shader_module);
+    bool create_shader_module(std::span<const uint32_t> code, VkDevice device, VkShaderModule* out_shader_module);
+    // Runs function(i) for i in [0, count) as jobs on the pool, returns once every call has finished. Waiting runs
+    // jobs too, so it can be nested inside another call. Outside the pool, where nothing can be scheduled, the calls
+    // run one after another on the calling thread
+    template<typename F>
+    void parallel_for(JobSystem& jobs, size_t count, const F& function) {
+        if (JobSystem::worker_index() == UINT32_MAX) {
+            for (size_t i = 0; i < count; i++) {
+                function(i);
+            }
+            return;
+        }
+
+        // Jobs hold a pointer, function itself outlives them because this waits
+        JobCounter counter;
+        const F* body = &function;
+        jobs.parallel_for(static_cast<uint32_t>(count), 1, [body](uint32_t begin, uint32_t end, uint32_t) {
+            for (uint32_t i = begin; i < end; i++) {
+                (*body)(i);
+            }
+        }, &counter);
+        jobs.wait(counter);
+    }
 }
 
 #endif //PORTFOLIO_UTILITIES_H
\ No newline at end of file
@@ -1,7 +1,39 @@
+#include <iostream>
+#include <string_view>
+
 #include "Renderer.h"
 
-int main() {
-    Renderer renderer;
+// --capture <file> records every frame's inputs, --replay <file> plays them back and writes per-frame timings to
+// --timings <file>, --headless keeps the window off screen, --cpu-device prefers a software Vulkan implementation,
+// --dump-frames <directory> writes every frame out in the --dump-format, png by default
+int main(int argc, char** argv) {
+    RendererOptions options;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view argument = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (argument == "--capture" && has_value) {
+            options.capture_path = argv[++i];
+        } else if (argument == "--replay" && has_value) {
+            options.replay_path = argv[++i];
+        } else if (argument == "--timings" && has_value) {
+            options.timings_path = argv[++i];
+        } else if (argument == "--headless") {
+            options.headless = true;
+        } else if (argument == "--cpu-device") {
+            options.prefer_cpu_device = true;
+        } else if (argument == "--dump-frames" && has_value) {
+            options.frame_output_directory = argv[++i];
+        } else if (argument == "--dump-format" && has_value && parse_image_file_format(argv[i + 1], options.frame_output_format)) {
+            i++;
+        } else {
+            std::cerr << "Unknown argument " << argument << std::endl;
+            std::cerr << "Usage: " << argv[0] << " [--capture <file>] [--replay <file>] [--timings <file>] [--headless] [--cpu-device]"
+                      << " [--dump-frames <directory>] [--dump-format png|exr|raw]" << std::endl;
+            return 1;
+        }
+    }
+
+    Renderer renderer(options);
     renderer.run();
     return 0;
-}
\ No newline at end of file
+}
@@ -9,6 +9,9 @@ layout (location = 0) out vec3 outNormal;
 layout (location = 1) out vec3 outColor;
 layout (location = 2) out vec2 outUV;
 
+// The depth pre-pass and the EQUAL colour pass run different pipelines, depth has to come out bit-identical
+invariant gl_Position;
+
 struct Vertex {
 
 	vec3 position;
@@ -25,7 +28,8 @@ layout(buffer_reference, std430) readonly buffer VertexBuffer{
 //push constants block
 layout( push_constant ) uniform constants
 {
-	mat4 render_matrix;
+	// Affine3x4 on the CPU side, each column here is a row of the world matrix
+	mat3x4 worldMatrix;
 	VertexBuffer vertexBuffer;
 } PushConstants;
 
@@ -33,11 +37,11 @@ void main()
 {
 	Vertex v = PushConstants.vertexBuffer.vertices[gl_VertexIndex];
 	
-	vec4 position = vec4(v.position, 1.0f);
+	vec3 position = vec4(v.position, 1.0f) * PushConstants.worldMatrix;
 
-	gl_Position =  sceneData.viewproj * PushConstants.render_matrix *position;
+	gl_Position =  sceneData.viewproj * vec4(position, 1.0f);
 
-	outNormal = (PushConstants.render_matrix * vec4(v.normal, 0.f)).xyz;
+	outNormal = vec4(v.normal, 0.f) * PushConstants.worldMatrix;
 	outColor = v.color.xyz * materialData.colorFactors.xyz;	
 	outUV.x = v.uv_x;
 	outUV.y = v.uv_y;
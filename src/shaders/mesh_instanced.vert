@@ -0,0 +1,54 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_buffer_reference : require
+
+#include "input_structures.glsl"
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec3 outColor;
+layout (location = 2) out vec2 outUV;
+
+// The depth pre-pass and the EQUAL colour pass run different pipelines, depth has to come out bit-identical
+invariant gl_Position;
+
+struct Vertex {
+
+	vec3 position;
+	float uv_x;
+	vec3 normal;
+	float uv_y;
+	vec4 color;
+}; 
+
+layout(buffer_reference, std430) readonly buffer VertexBuffer{ 
+	Vertex vertices[];
+};
+
+// Affine3x4 on the CPU side, each column here is a row of the world matrix
+layout(buffer_reference, std430) readonly buffer InstanceBuffer{ 
+	mat3x4 worldMatrices[];
+};
+
+//push constants block
+layout( push_constant ) uniform constants
+{
+	VertexBuffer vertexBuffer;
+	InstanceBuffer instanceBuffer;
+} PushConstants;
+
+void main() 
+{
+	Vertex v = PushConstants.vertexBuffer.vertices[gl_VertexIndex];
+	// gl_InstanceIndex already includes the draw's firstInstance, which is where its group starts in the buffer
+	mat3x4 worldMatrix = PushConstants.instanceBuffer.worldMatrices[gl_InstanceIndex];
+
+	vec3 position = vec4(v.position, 1.0f) * worldMatrix;
+
+	gl_Position =  sceneData.viewproj * vec4(position, 1.0f);
+
+	outNormal = vec4(v.normal, 0.f) * worldMatrix;
+	outColor = v.color.xyz * materialData.colorFactors.xyz;	
+	outUV.x = v.uv_x;
+	outUV.y = v.uv_y;
+}